@@ -0,0 +1,89 @@
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include <stdint.h>
+
+/**
+ * Funzione di un benchmark.
+ *
+ * @param argc Numero degli argomenti, escluso il nome del benchmark
+ * @param argv Argomenti, escluso il nome del benchmark
+ * @return Exit code
+ */
+typedef int (*bench_function_t)(int argc, const char **argv);
+
+/**
+ * Tempo monotono attuale in nanosecondi
+ *
+ * @return Nanosecondi da un istante arbitrario
+ */
+uint64_t bench_now_nanos();
+
+/**
+ * Leggi un argomento numerico opzionale
+ *
+ * @param argc Numero degli argomenti
+ * @param argv Argomenti
+ * @param index Indice dell'argomento
+ * @param default_value Valore se l'argomento è assente o invalido
+ * @return Valore letto
+ */
+long bench_arg(int argc, const char **argv, int index, long default_value);
+
+/**
+ * Connettiti in TCP al server su 127.0.0.1
+ *
+ * @param port Porta del server
+ * @return -1 in caso di errore, il file descriptor della socket altrimenti
+ */
+int bench_connect_tcp(uint16_t port);
+
+/**
+ * Round trip tramite memoria condivisa, confrontati con TCP.
+ * Argomenti: [PORTA] [OPERAZIONI]
+ */
+int bench_shm(int argc, const char **argv);
+
+/**
+ * Connessioni al secondo con una sola operazione ciascuna.
+ * Argomenti: [PORTA] [CONNESSIONI] [plain|tfo]
+ */
+int bench_connect(int argc, const char **argv);
+
+/**
+ * Espressione valutata dal server in una sola richiesta, contro più round trip
+ * e contro le stesse operazioni in pipeline, collegate da ans.
+ * Argomenti: [PORTA] [ESPRESSIONI]
+ */
+int bench_expr(int argc, const char **argv);
+
+/**
+ * Throughput e precisione delle funzioni matematiche, in modalità exact e fast,
+ * confrontate con libm. Non serve il server.
+ * Argomenti: [VALORI]
+ */
+int bench_math(int argc, const char **argv);
+
+/**
+ * Moltiplicazione e divisione a precisione arbitraria con i diversi algoritmi,
+ * per operandi da 100 cifre fino al massimo indicato. Non serve il server.
+ * Gli algoritmi quadratici vengono saltati oltre SCOLASTICA_MAX cifre.
+ * Argomenti: [CIFRE_MAX] [SCOLASTICA_MAX]
+ */
+int bench_bignum(int argc, const char **argv);
+
+/**
+ * Prodotto tra matrici quadrate in GFLOP/s: tre cicli annidati e kernel a blocchi
+ * nello stesso processo, poi tramite il server, che divide i prodotti grandi tra i thread.
+ * Argomenti: [PORTA] [ORDINE_MAX]
+ */
+int bench_matrix(int argc, const char **argv);
+
+/**
+ * Integrale adattivo e ricerca di radici con 1, 2, 4... thread, fino a tutti quelli del pool.
+ * Non serve il server: i kernel sono quelli che usa, nello stesso processo.
+ * Argomenti: [PICCHI]
+ */
+int bench_calculus(int argc, const char **argv);
+
+#endif //BENCH_BENCH_H
@@ -0,0 +1,130 @@
+#include "bench.h"
+#include "../common/bignum.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Numero casuale con esattamente digits cifre decimali
+ */
+void _bench_random_bignum(struct bignum *number, size_t digits, uint64_t *state) {
+    char *text = malloc(digits + 1);
+    for (size_t i = 0; i < digits; i++) {
+        *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+        text[i] = (char) ('0' + (*state >> 33) % 10);
+    }
+    if (text[0] == '0')
+        text[0] = '1';
+    bignum_from_string(number, text, digits);
+    free(text);
+}
+
+/**
+ * Dimensione successiva nella sequenza 1, 2, 5, 10, 20, 50...
+ */
+size_t _bench_next_size(size_t size) {
+    size_t leading = size;
+    while (leading >= 10)
+        leading /= 10;
+    return leading == 2 ? size / 2 * 5 : size * 2;
+}
+
+/**
+ * Tempo medio di una moltiplicazione con l'algoritmo indicato, ripetendola per almeno 50 ms
+ *
+ * @return Millisecondi per operazione
+ */
+double _bench_multiply(const struct bignum *a, const struct bignum *b, enum bignum_algorithm algorithm,
+                       struct bignum *product) {
+    uint64_t start = bench_now_nanos(), elapsed;
+    long repetitions = 0;
+    do {
+        bignum_multiply_with(product, a, b, algorithm);
+        repetitions++;
+        elapsed = bench_now_nanos() - start;
+    } while (elapsed < 50000000);
+    return elapsed / 1e6 / repetitions;
+}
+
+/**
+ * Tempo medio di una divisione con l'algoritmo indicato, ripetendola per almeno 50 ms
+ */
+double _bench_divide(const struct bignum *a, const struct bignum *b, enum bignum_algorithm algorithm,
+                     struct bignum *quotient) {
+    uint64_t start = bench_now_nanos(), elapsed;
+    long repetitions = 0;
+    do {
+        bignum_divide_with(quotient, NULL, a, b, algorithm);
+        repetitions++;
+        elapsed = bench_now_nanos() - start;
+    } while (elapsed < 50000000);
+    return elapsed / 1e6 / repetitions;
+}
+
+/**
+ * Stampa una colonna di millisecondi, o un trattino se l'algoritmo è stato saltato
+ */
+void _bench_print_millis(double millis) {
+    if (millis < 0)
+        printf(" %14s", "-");
+    else
+        printf(" %14.3f", millis);
+}
+
+/**
+ * Moltiplicazione e divisione a precisione arbitraria con i diversi algoritmi,
+ * per operandi da 100 cifre fino al massimo indicato. Non serve il server.
+ * Gli algoritmi quadratici vengono saltati oltre SCOLASTICA_MAX cifre.
+ * Argomenti: [CIFRE_MAX] [SCOLASTICA_MAX]
+ */
+int bench_bignum(int argc, const char **argv) {
+    size_t max_digits = (size_t) bench_arg(argc, argv, 0, 1000000);
+    size_t max_quadratic_digits = (size_t) bench_arg(argc, argv, 1, 100000);
+    uint64_t state = 42;
+
+    struct bignum a, b, dividend, reference, result;
+    bignum_init(&a);
+    bignum_init(&b);
+    bignum_init(&dividend);
+    bignum_init(&reference);
+    bignum_init(&result);
+
+    printf("%9s %14s %14s %14s %14s %14s\n", "cifre", "mul scolast.", "karatsuba", "ntt",
+           "div scolast.", "newton");
+    printf("%9s %14s %14s %14s %14s %14s\n", "", "ms", "ms", "ms", "ms", "ms");
+
+    // Dimensioni 1-2-5, partendo da sotto la soglia di Karatsuba
+    for (size_t digits = 100; digits <= max_digits; digits = _bench_next_size(digits)) {
+        _bench_random_bignum(&a, digits, &state);
+        _bench_random_bignum(&b, digits, &state);
+        _bench_random_bignum(&dividend, 2 * digits, &state);
+        int quadratic = digits <= max_quadratic_digits;
+
+        // Tutti gli algoritmi devono dare lo stesso risultato
+        double schoolbook = quadratic ? _bench_multiply(&a, &b, BIGNUM_SCHOOLBOOK, &reference) : -1;
+        double karatsuba = _bench_multiply(&a, &b, BIGNUM_KARATSUBA, &result);
+        int mismatch = quadratic && bignum_compare(&reference, &result) != 0;
+        double ntt = _bench_multiply(&a, &b, BIGNUM_NTT, &reference);
+        mismatch |= bignum_compare(&reference, &result) != 0;
+
+        double schoolbook_division = quadratic ? _bench_divide(&dividend, &a, BIGNUM_SCHOOLBOOK, &reference) : -1;
+        double newton = _bench_divide(&dividend, &a, BIGNUM_NEWTON, &result);
+        mismatch |= quadratic && bignum_compare(&reference, &result) != 0;
+
+        printf("%9zu", digits);
+        _bench_print_millis(schoolbook);
+        _bench_print_millis(karatsuba);
+        _bench_print_millis(ntt);
+        _bench_print_millis(schoolbook_division);
+        _bench_print_millis(newton);
+        printf("%s\n", mismatch ? "  RISULTATI DIVERSI" : "");
+        fflush(stdout);
+    }
+
+    bignum_free(&a);
+    bignum_free(&b);
+    bignum_free(&dividend);
+    bignum_free(&reference);
+    bignum_free(&result);
+    clear_limb_pool();
+    return EXIT_SUCCESS;
+}
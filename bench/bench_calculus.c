@@ -0,0 +1,82 @@
+#include "bench.h"
+#include "../server/calculus.h"
+#include "../server/thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Chiamate al secondo di un integrale o di una ricerca di radice con al più threads thread,
+ * ripetendo il calcolo per almeno 200 ms
+ *
+ * @param value Dove scrivere il risultato dell'ultima chiamata
+ * @return Chiamate al secondo, o -1 in caso di errore
+ */
+double _bench_calculus_rate(const struct calculus_function *function, int is_root, operand_t a, operand_t b,
+                            size_t threads, operand_t *value) {
+    uint64_t start = bench_now_nanos(), elapsed;
+    long repetitions = 0;
+    do {
+        int status = is_root ? find_function_root(function, a, b, threads, value)
+                             : integrate_function(function, a, b, threads, value);
+        if (status != 0)
+            return -1;
+        repetitions++;
+        elapsed = bench_now_nanos() - start;
+    } while (elapsed < 200000000);
+    return (double) repetitions * 1e9 / (double) elapsed;
+}
+
+/**
+ * Integrale adattivo e ricerca di radici con 1, 2, 4... thread, fino a tutti quelli del pool.
+ * Non serve il server: i kernel sono quelli che usa, nello stesso processo.
+ * Argomenti: [PICCHI]
+ */
+int bench_calculus(int argc, const char **argv) {
+    long peaks = bench_arg(argc, argv, 0, 32);
+
+    // Somma di picchi stretti sparsi in [-1, 1]: la quadratura suddivide molto più vicino ai picchi
+    size_t integrand_size = (size_t) peaks * 64 + 1, integrand_len = 0;
+    char *integrand = malloc(integrand_size);
+    for (long i = 0; i < peaks; i++) {
+        double center = -0.95 + 1.9 * (double) i / (double) peaks;
+        integrand_len += snprintf(integrand + integrand_len, integrand_size - integrand_len,
+                                  "%s1 / ((x - %.4f) * (x - %.4f) + 0.000001)", i > 0 ? " + " : "", center, center);
+    }
+
+    const char *error = NULL;
+    struct expr_program *integral_program = compile_expression(integrand, &error);
+    struct expr_program *root_program = compile_expression("x * x * x - 2 * x * x + x / 3 - 1 / 27", &error);
+    if (integral_program == NULL || root_program == NULL) {
+        fprintf(stderr, "%s\n", error);
+        return EXIT_FAILURE;
+    }
+    struct calculus_function integral_function = {integral_program, NULL, NULL};
+    struct calculus_function root_function = {root_program, NULL, NULL};
+
+    printf("integrale di %ld picchi 1 / ((x - c)^2 + 1e-6) su [-1, 1], radice di x^3 - 2x^2 + x/3 - 1/27 "
+           "su [-10, 10]\n", peaks);
+    printf("%8s %14s %10s %14s %10s\n", "thread", "integrali/s", "speedup", "radici/s", "speedup");
+
+    double integral_base = 0, root_base = 0;
+    size_t pool_size = thread_pool_size();
+    for (size_t threads = 1;; threads = threads * 2 < pool_size ? threads * 2 : pool_size) {
+        operand_t integral, root;
+        double integral_rate = _bench_calculus_rate(&integral_function, 0, -1, 1, threads, &integral);
+        double root_rate = _bench_calculus_rate(&root_function, 1, -10, 10, threads, &root);
+        if (threads == 1) {
+            integral_base = integral_rate;
+            root_base = root_rate;
+        }
+        printf("%8zu %14.1f %9.2fx %14.1f %9.2fx   (%.15g, %.15g)\n", threads, integral_rate,
+               integral_rate / integral_base, root_rate, root_rate / root_base, integral, root);
+        fflush(stdout);
+        if (threads == pool_size)
+            break;
+    }
+
+    stop_thread_pool();
+    free_program(integral_program);
+    free_program(root_program);
+    free(integrand);
+    return EXIT_SUCCESS;
+}
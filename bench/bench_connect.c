@@ -0,0 +1,78 @@
+#include "bench.h"
+#include "../common/socket_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/**
+ * Esegui una connessione con una sola operazione.
+ *
+ * @param server_address Indirizzo del server
+ * @param fast_open Se diverso da zero, usa TCP Fast Open e chiudi la scrittura dopo la richiesta
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int _bench_one_connection(const struct sockaddr_in *server_address, int fast_open) {
+    static const char request[] = "+ 1 2\n";
+    char response[RESPONSE_LINE_MAX_SIZE];
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+
+    int result = -1;
+    if (fast_open) {
+        // La richiesta parte insieme al SYN, poi segnala che non ce ne saranno altre
+        if (sendto(fd, request, sizeof(request) - 1, MSG_FASTOPEN,
+                   (const struct sockaddr *) server_address, sizeof(*server_address)) == -1 ||
+            shutdown(fd, SHUT_WR) == -1)
+            goto end;
+    } else if (connect(fd, (const struct sockaddr *) server_address, sizeof(*server_address)) == -1 ||
+               write(fd, request, sizeof(request) - 1) == -1) {
+        goto end;
+    }
+
+    // Leggi la risposta completa
+    ssize_t received = 0, chunk;
+    while ((chunk = read(fd, response + received, sizeof(response) - received)) > 0) {
+        received += chunk;
+        if (response[received - 1] == '\n')
+            break;
+    }
+    result = received > 0 && response[0] != SERVER_ERROR_MESSAGE_PREFIX ? 0 : -1;
+
+end:
+    close(fd);
+    return result;
+}
+
+/**
+ * Connessioni al secondo con una sola operazione ciascuna.
+ * Argomenti: [PORTA] [CONNESSIONI] [plain|tfo]
+ */
+int bench_connect(int argc, const char **argv) {
+    uint16_t port = (uint16_t) bench_arg(argc, argv, 0, DEFAULT_PORT);
+    long connections = bench_arg(argc, argv, 1, 20000);
+    int fast_open = argc > 2 && strcmp(argv[2], "tfo") == 0;
+
+    struct sockaddr_in server_address = {0};
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(port);
+    server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    long failed = 0;
+    uint64_t start = bench_now_nanos();
+    for (long i = 0; i < connections; i++) {
+        if (_bench_one_connection(&server_address, fast_open) == -1)
+            failed++;
+    }
+    uint64_t elapsed = bench_now_nanos() - start;
+
+    printf("%s: %.0f connessioni/s, %.1f us/connessione, %ld fallite\n",
+           fast_open ? "tfo + one-shot" : "plain", connections * 1e9 / elapsed,
+           (double) elapsed / connections / 1000.0, failed);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
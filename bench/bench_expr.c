@@ -0,0 +1,92 @@
+#include "bench.h"
+#include "../common/calc_utils.h"
+#include "../common/socket_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Invia una linea e attendi la risposta
+ *
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int _bench_round_trip(FILE *server, const char *request, operand_t *result) {
+    char response[RESPONSE_LINE_MAX_SIZE];
+    fputs(request, server);
+    fflush(server);
+    if (fgets(response, sizeof(response), server) == NULL || response[0] == SERVER_ERROR_MESSAGE_PREFIX)
+        return -1;
+
+    // Il risultato segue i due timestamp
+    char *last_space = strrchr(response, ' ');
+    if (last_space == NULL)
+        return -1;
+    *result = strtod(last_space + 1, NULL);
+    return 0;
+}
+
+/**
+ * Espressione (a+b)*c/d valutata dal server in una sola richiesta,
+ * confrontata con tre round trip di singole operazioni e con le stesse tre in pipeline.
+ * Argomenti: [PORTA] [ESPRESSIONI]
+ */
+int bench_expr(int argc, const char **argv) {
+    uint16_t port = (uint16_t) bench_arg(argc, argv, 0, DEFAULT_PORT);
+    long expressions = bench_arg(argc, argv, 1, 20000);
+
+    int fd = bench_connect_tcp(port);
+    if (fd == -1)
+        return EXIT_FAILURE;
+    FILE *server = fdopen(fd, "r+");
+    char request[256];
+    operand_t result;
+
+    // Stesso testo ogni volta: il programma compilato viene dalla cache
+    uint64_t start = bench_now_nanos();
+    for (long i = 0; i < expressions; i++) {
+        if (_bench_round_trip(server, "expr (12.5+7.25)*3/4\n", &result) == -1)
+            return EXIT_FAILURE;
+    }
+    uint64_t elapsed = bench_now_nanos() - start;
+    printf("expr, in cache:     %8.2f us/espressione\n", elapsed / 1000.0 / expressions);
+
+    // Testo sempre diverso: parsing e compilazione ogni volta
+    start = bench_now_nanos();
+    for (long i = 0; i < expressions; i++) {
+        snprintf(request, sizeof(request), "expr (%ld+7.25)*3/4\n", i);
+        if (_bench_round_trip(server, request, &result) == -1)
+            return EXIT_FAILURE;
+    }
+    elapsed = bench_now_nanos() - start;
+    printf("expr, da compilare: %8.2f us/espressione\n", elapsed / 1000.0 / expressions);
+
+    // Stessa espressione in tre round trip
+    start = bench_now_nanos();
+    for (long i = 0; i < expressions; i++) {
+        snprintf(request, sizeof(request), "+ %ld 7.25\n", i);
+        if (_bench_round_trip(server, request, &result) == -1)
+            return EXIT_FAILURE;
+        snprintf(request, sizeof(request), "* %.17g 3\n", result);
+        if (_bench_round_trip(server, request, &result) == -1)
+            return EXIT_FAILURE;
+        snprintf(request, sizeof(request), "/ %.17g 4\n", result);
+        if (_bench_round_trip(server, request, &result) == -1)
+            return EXIT_FAILURE;
+    }
+    elapsed = bench_now_nanos() - start;
+    printf("3 round trip:       %8.2f us/espressione\n", elapsed / 1000.0 / expressions);
+
+    // Stesse tre operazioni inviate insieme: ognuna usa il risultato della precedente tramite ans
+    start = bench_now_nanos();
+    for (long i = 0; i < expressions; i++) {
+        fprintf(server, "+ %ld 7.25\n* ans 3\n", i);
+        if (_bench_round_trip(server, "/ ans 4\n", &result) == -1 ||
+            _bench_round_trip(server, "", &result) == -1 || _bench_round_trip(server, "", &result) == -1)
+            return EXIT_FAILURE;
+    }
+    elapsed = bench_now_nanos() - start;
+    printf("3 in pipeline (ans):%8.2f us/espressione\n", elapsed / 1000.0 / expressions);
+
+    fclose(server);
+    return EXIT_SUCCESS;
+}
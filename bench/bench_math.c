@@ -0,0 +1,156 @@
+#include "bench.h"
+#include "../common/math_kernels.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <quadmath.h>
+
+/**
+ * Generatore pseudocasuale xorshift64*, riproducibile tra le esecuzioni
+ */
+double _bench_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (double) ((*state * 2685821657736338717ULL) >> 11) * 0x1p-53;
+}
+
+/**
+ * Genera argomenti nel dominio di misura della funzione
+ *
+ * @param function Funzione
+ * @param values Dove scrivere gli argomenti
+ * @param count Numero di argomenti
+ */
+void _bench_math_inputs(enum math_function function, double *values, size_t count) {
+    uint64_t state = 0x9e3779b97f4a7c15ULL + function;
+    for (size_t i = 0; i < count; i++) {
+        double u = _bench_random(&state);
+        switch (function) {
+            case MATH_SQRT:
+            case MATH_LOG:
+                // Distribuzione logaritmica, per coprire tutti gli esponenti
+                values[i] = (1 + _bench_random(&state)) * ldexp(1, (int) (u * 1996) - 998);
+                break;
+            case MATH_EXP:
+                values[i] = u * 1400 - 700;
+                break;
+            case MATH_POW:
+                values[i] = u * 1000;
+                break;
+            default:
+                values[i] = u * 2e5 - 1e5;
+                break;
+        }
+    }
+}
+
+/**
+ * Valore di riferimento a 113 bit
+ */
+__float128 _bench_math_reference(enum math_function function, double x, double y) {
+    switch (function) {
+        case MATH_SQRT:
+            return sqrtq(x);
+        case MATH_EXP:
+            return expq(x);
+        case MATH_LOG:
+            return logq(x);
+        case MATH_SIN:
+            return sinq(x);
+        case MATH_COS:
+            return cosq(x);
+        case MATH_TAN:
+            return tanq(x);
+        default:
+            return powq(x, y);
+    }
+}
+
+/**
+ * Calcola con libm, un valore alla volta
+ */
+double _bench_math_libm(enum math_function function, double x, double y) {
+    switch (function) {
+        case MATH_SQRT:
+            return sqrt(x);
+        case MATH_EXP:
+            return exp(x);
+        case MATH_LOG:
+            return log(x);
+        case MATH_SIN:
+            return sin(x);
+        case MATH_COS:
+            return cos(x);
+        case MATH_TAN:
+            return tan(x);
+        default:
+            return pow(x, y);
+    }
+}
+
+/**
+ * Errore di un risultato in ULP del double più vicino al riferimento
+ */
+double _bench_ulp_error(double value, __float128 reference) {
+    double rounded = (double) reference;
+    if (!isfinite(rounded) || !isfinite(value))
+        return value == rounded ? 0 : INFINITY;
+    double ulp = nextafter(fabs(rounded), INFINITY) - fabs(rounded);
+    return (double) (fabsq(value - reference) / ulp);
+}
+
+/**
+ * Throughput e precisione delle funzioni matematiche, in modalità exact e fast,
+ * confrontate con libm. Non serve il server.
+ * Argomenti: [VALORI]
+ */
+int bench_math(int argc, const char **argv) {
+    size_t count = (size_t) bench_arg(argc, argv, 0, 1000000);
+    const double exponent = 2.5;
+    double *values = malloc(count * sizeof(double));
+    double *results = malloc(count * sizeof(double));
+    double *libm_results = malloc(count * sizeof(double));
+    double *exact_results = malloc(count * sizeof(double));
+
+    printf("%-5s %12s %12s %12s %10s %10s %10s\n", "", "libm Mval/s", "exact", "fast",
+           "ULP libm", "exact", "fast");
+
+    for (int function = 0; function < MATH_FUNCTIONS_COUNT; function++) {
+        _bench_math_inputs(function, values, count);
+
+        uint64_t start = bench_now_nanos();
+        for (size_t i = 0; i < count; i++)
+            libm_results[i] = _bench_math_libm(function, values[i], exponent);
+        double libm_seconds = (bench_now_nanos() - start) / 1e9;
+
+        start = bench_now_nanos();
+        calculate_function_batch(function, MATH_MODE_EXACT, values, exponent, exact_results, count);
+        double exact_seconds = (bench_now_nanos() - start) / 1e9;
+
+        start = bench_now_nanos();
+        calculate_function_batch(function, MATH_MODE_FAST, values, exponent, results, count);
+        double fast_seconds = (bench_now_nanos() - start) / 1e9;
+
+        // Il riferimento a 113 bit è lento: misura la precisione su un campione
+        double libm_error = 0, exact_error = 0, fast_error = 0;
+        size_t stride = count / 100000 > 0 ? count / 100000 : 1;
+        for (size_t i = 0; i < count; i += stride) {
+            __float128 reference = _bench_math_reference(function, values[i], exponent);
+            libm_error = fmax(libm_error, _bench_ulp_error(libm_results[i], reference));
+            exact_error = fmax(exact_error, _bench_ulp_error(exact_results[i], reference));
+            fast_error = fmax(fast_error, _bench_ulp_error(results[i], reference));
+        }
+
+        printf("%-5s %12.1f %12.1f %12.1f %10.3f %10.3f %10.3f\n", (const char *[]) {
+                       "sqrt", "exp", "log", "sin", "cos", "tan", "pow"}[function],
+               count / libm_seconds / 1e6, count / exact_seconds / 1e6, count / fast_seconds / 1e6,
+               libm_error, exact_error, fast_error);
+    }
+
+    free(values);
+    free(results);
+    free(libm_results);
+    free(exact_results);
+    return EXIT_SUCCESS;
+}
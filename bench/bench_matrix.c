@@ -0,0 +1,128 @@
+#include "bench.h"
+#include "../common/linear_algebra.h"
+#include "../common/socket_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/**
+ * Prodotto con tre cicli annidati, nell'ordine i-k-j che almeno legge B per righe
+ */
+void _bench_naive_multiply(const operand_t *a, const operand_t *b, operand_t *c, size_t size) {
+    memset(c, 0, size * size * sizeof(operand_t));
+    for (size_t i = 0; i < size; i++) {
+        for (size_t k = 0; k < size; k++) {
+            for (size_t j = 0; j < size; j++)
+                c[i * size + j] += a[i * size + k] * b[k * size + j];
+        }
+    }
+}
+
+/**
+ * Prodotto calcolato dal server, con gli operandi e il risultato in binario
+ *
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int _bench_server_multiply(FILE *server, const operand_t *a, const operand_t *b, operand_t *c, size_t size) {
+    char line[RESPONSE_LINE_MAX_SIZE];
+    fprintf(server, "mat mul %zu %zu %zu\n", size, size, size);
+    fwrite(a, sizeof(operand_t), size * size, server);
+    fwrite(b, sizeof(operand_t), size * size, server);
+    fflush(server);
+
+    // #VALORI, il blocco binario e la linea di risposta
+    if (fgets(line, sizeof(line), server) == NULL || line[0] != '#' ||
+        fread(c, sizeof(operand_t), size * size, server) != size * size ||
+        fgets(line, sizeof(line), server) == NULL || line[0] == SERVER_ERROR_MESSAGE_PREFIX)
+        return -1;
+    return 0;
+}
+
+/**
+ * Modi di calcolare il prodotto da confrontare
+ */
+enum bench_multiply_method {
+    BENCH_MULTIPLY_NAIVE,
+    BENCH_MULTIPLY_BLOCKED,
+    BENCH_MULTIPLY_SERVER
+};
+
+/**
+ * GFLOP/s di un modo di calcolare il prodotto, ripetendolo per almeno 200 ms
+ *
+ * @return GFLOP/s, o -1 se il server non ha risposto
+ */
+double _bench_gflops(enum bench_multiply_method method, FILE *server, const operand_t *a, const operand_t *b,
+                     operand_t *c, size_t size) {
+    uint64_t start = bench_now_nanos(), elapsed;
+    long repetitions = 0;
+    do {
+        if (method == BENCH_MULTIPLY_NAIVE)
+            _bench_naive_multiply(a, b, c, size);
+        else if (method == BENCH_MULTIPLY_BLOCKED)
+            matrix_multiply_rows(a, b, c, size, size, 0, size);
+        else if (_bench_server_multiply(server, a, b, c, size) != 0)
+            return -1;
+        repetitions++;
+        elapsed = bench_now_nanos() - start;
+    } while (elapsed < 200000000);
+    return 2.0 * (double) size * (double) size * (double) size * (double) repetitions / (double) elapsed;
+}
+
+/**
+ * Prodotto tra matrici quadrate in GFLOP/s: tre cicli annidati e kernel a blocchi
+ * nello stesso processo, poi tramite il server, che divide i prodotti grandi tra i thread.
+ * Argomenti: [PORTA] [ORDINE_MAX]
+ */
+int bench_matrix(int argc, const char **argv) {
+    uint16_t port = (uint16_t) bench_arg(argc, argv, 0, DEFAULT_PORT);
+    size_t max_size = (size_t) bench_arg(argc, argv, 1, 1024);
+
+    // Il server è facoltativo: senza, si misurano solo i kernel locali
+    int fd = bench_connect_tcp(port), enable = 1;
+    FILE *server = fd != -1 ? fdopen(fd, "r+") : NULL;
+
+    // Gli operandi sono scritti in più pezzi: senza Nagle l'ultimo parte subito
+    if (fd != -1)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(int));
+
+    printf("%8s %12s %12s %12s\n", "ordine", "ingenuo", "a blocchi", "server");
+    printf("%8s %12s %12s %12s\n", "", "GFLOP/s", "GFLOP/s", "GFLOP/s");
+
+    for (size_t size = 64; size <= max_size; size *= 2) {
+        operand_t *a = malloc(size * size * sizeof(operand_t));
+        operand_t *b = malloc(size * size * sizeof(operand_t));
+        operand_t *reference = malloc(size * size * sizeof(operand_t));
+        operand_t *c = malloc(size * size * sizeof(operand_t));
+        // Interi piccoli: i prodotti sono esatti con qualsiasi ordine delle somme
+        for (size_t i = 0; i < size * size; i++) {
+            a[i] = (double) (i % 17) - 8;
+            b[i] = (double) (i % 13) - 6;
+        }
+
+        double naive = _bench_gflops(BENCH_MULTIPLY_NAIVE, NULL, a, b, reference, size);
+        double blocked = _bench_gflops(BENCH_MULTIPLY_BLOCKED, NULL, a, b, c, size);
+        int mismatch = memcmp(reference, c, size * size * sizeof(operand_t)) != 0;
+
+        printf("%8zu %12.2f %12.2f", size, naive, blocked);
+        if (server != NULL) {
+            double remote = _bench_gflops(BENCH_MULTIPLY_SERVER, server, a, b, c, size);
+            mismatch |= remote < 0 || memcmp(reference, c, size * size * sizeof(operand_t)) != 0;
+            printf(" %12.2f", remote);
+        }
+        printf("%s\n", mismatch ? "  RISULTATI DIVERSI" : "");
+        fflush(stdout);
+
+        free(a);
+        free(b);
+        free(reference);
+        free(c);
+    }
+
+    if (server != NULL)
+        fclose(server);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include "bench.h"
+#include "../common/shm_ring.h"
+#include "../common/socket_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * Operazioni tenute in volo nella misura del throughput
+ */
+#define SHM_BENCH_PIPELINE 512
+
+/**
+ * Round trip tramite memoria condivisa, confrontati con TCP.
+ * Argomenti: [PORTA] [OPERAZIONI]
+ */
+int bench_shm(int argc, const char **argv) {
+    uint16_t port = (uint16_t) bench_arg(argc, argv, 0, DEFAULT_PORT);
+    long operations = bench_arg(argc, argv, 1, 1000000);
+
+    struct shm_session session;
+    if (shm_attach(port, &session) == -1)
+        return EXIT_FAILURE;
+
+    // Latenza: una sola operazione in volo
+    struct shm_response response;
+    uint64_t start = bench_now_nanos();
+    for (long i = 0; i < operations; i++) {
+        if (shm_submit(&session, (operand_t) i, '+', 1) == -1 || shm_receive(&session, &response) == -1) {
+            fprintf(stderr, "Sessione chiusa dal server\n");
+            return EXIT_FAILURE;
+        }
+    }
+    uint64_t elapsed = bench_now_nanos() - start;
+    printf("shm round trip:   %8.1f ns/op\n", (double) elapsed / operations);
+
+    // Throughput: fino a SHM_BENCH_PIPELINE operazioni in volo
+    long submitted = 0, received = 0;
+    start = bench_now_nanos();
+    while (received < operations) {
+        while (submitted < operations && submitted - received < SHM_BENCH_PIPELINE)
+            shm_submit(&session, (operand_t) submitted++, '*', 2);
+        if (shm_receive(&session, &response) == -1)
+            return EXIT_FAILURE;
+        received++;
+    }
+    elapsed = bench_now_nanos() - start;
+    printf("shm pipeline:     %8.1f ns/op  (%.2f Mop/s)\n",
+           (double) elapsed / operations, operations * 1000.0 / elapsed);
+    shm_detach(&session);
+
+    // Confronto: round trip TCP con il protocollo testuale
+    int tcp_fd = bench_connect_tcp(port);
+    if (tcp_fd == -1)
+        return EXIT_FAILURE;
+    FILE *tcp_file = fdopen(tcp_fd, "r+");
+    char line[RESPONSE_LINE_MAX_SIZE];
+    long tcp_operations = operations / 10 > 0 ? operations / 10 : 1;
+    start = bench_now_nanos();
+    for (long i = 0; i < tcp_operations; i++) {
+        fprintf(tcp_file, "+ %ld 1\n", i);
+        fflush(tcp_file);
+        if (fgets(line, sizeof(line), tcp_file) == NULL)
+            return EXIT_FAILURE;
+    }
+    elapsed = bench_now_nanos() - start;
+    printf("tcp round trip:   %8.1f ns/op\n", (double) elapsed / tcp_operations);
+    fclose(tcp_file);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#include "bench.h"
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+/**
+ * Un benchmark selezionabile da riga di comando
+ */
+struct bench_entry {
+    const char *name;
+    bench_function_t function;
+};
+
+/**
+ * Elenco dei benchmark disponibili
+ */
+const struct bench_entry benchmarks[] = {
+        {"shm", bench_shm},
+        {"connect", bench_connect},
+        {"expr", bench_expr},
+        {"math", bench_math},
+        {"bignum", bench_bignum},
+        {"matrix", bench_matrix},
+        {"calculus", bench_calculus},
+};
+
+/**
+ * Tempo monotono attuale in nanosecondi
+ *
+ * @return Nanosecondi da un istante arbitrario
+ */
+uint64_t bench_now_nanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ul + now.tv_nsec;
+}
+
+/**
+ * Leggi un argomento numerico opzionale
+ *
+ * @param argc Numero degli argomenti
+ * @param argv Argomenti
+ * @param index Indice dell'argomento
+ * @param default_value Valore se l'argomento è assente o invalido
+ * @return Valore letto
+ */
+long bench_arg(int argc, const char **argv, int index, long default_value) {
+    if (index >= argc)
+        return default_value;
+
+    char *end;
+    long value = strtol(argv[index], &end, 10);
+    return *end == '\0' && value > 0 ? value : default_value;
+}
+
+/**
+ * Connettiti in TCP al server su 127.0.0.1
+ *
+ * @param port Porta del server
+ * @return -1 in caso di errore, il file descriptor della socket altrimenti
+ */
+int bench_connect_tcp(uint16_t port) {
+    struct sockaddr_in server_address = {0};
+    server_address.sin_family = AF_INET;
+    server_address.sin_port = htons(port);
+    server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1 || connect(fd, (struct sockaddr *) &server_address, sizeof(server_address)) == -1) {
+        perror("connect");
+        if (fd != -1) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, const char **argv) {
+    setlocale(LC_CTYPE, "");
+
+    if (argc >= 2) {
+        for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+            if (strcmp(argv[1], benchmarks[i].name) == 0)
+                return benchmarks[i].function(argc - 2, argv + 2);
+        }
+    }
+
+    fprintf(stderr, "Utilizzo: %s BENCHMARK [ARGOMENTI]\n", argv[0]);
+    fprintf(stderr, "Benchmark disponibili:");
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+        fprintf(stderr, " %s", benchmarks[i].name);
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+}
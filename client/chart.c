@@ -1,23 +1,23 @@
 #include "chart.h"
 #include "../common/calc_utils.h"
+#include <stdint.h>
 #include <wchar.h>
-#include <sys/ioctl.h>
-#include <unistd.h>
 
 /**
- * Mostra sul terminale un grafico con i dati forniti in input.
+ * Disegna nel frame un grafico con i dati forniti in input.
  * 
  * Utilizza wchar_t, quindi tutte le printf (in tutto il programma)
  * devono essere di tipo WIDE, altrimenti è undefined behaviour.
  *
+ * @param frame Frame in disegno, largo quanto il terminale
  * @param original_data Dati da mostrare
  * @param data_len Dimensione dei dati
  */
-void plot_chart(const unsigned int *original_data, size_t data_len) {
-    // Ottieni la larghezza del terminale
-    struct winsize w;
-    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
-    int max_columns = (w.ws_col / 2) - 1;
+void plot_chart(struct term_frame *frame, const unsigned int *original_data, size_t data_len) {
+    // La larghezza del terminale è quella del frame
+    int max_columns = (frame->columns / 2) - 1;
+    if (max_columns < 1)
+        max_columns = 1;
 
     // Limita i dati agli ultimi max_columns
     size_t normalized_data_len;
@@ -26,30 +26,33 @@ void plot_chart(const unsigned int *original_data, size_t data_len) {
 
     // Trova il dato minore e maggiore.
     // Il minimo verrà mostrato ad altezza 1
-    unsigned int min_data = min(normalized_data, normalized_data_len);
-    unsigned int max_data = max(normalized_data, normalized_data_len);
+    unsigned int min_data = 0, max_data = 0;
+    if (normalized_data_len > 0) {
+        min_data = min(normalized_data, normalized_data_len);
+        max_data = max(normalized_data, normalized_data_len);
+    }
 
     // Normalizza i dati in un intervallo [1:10].
     for (size_t i = 0; i < normalized_data_len; i++) {
         normalized_data[i] =
-                max_data == min_data ? 1 : ((normalized_data[i] - min_data) * 9) / (max_data - min_data) + 1;
+                max_data == min_data ? 1 : ((uint64_t) (normalized_data[i] - min_data) * 9) / (max_data - min_data) + 1;
     }
 
-    wprintf(L"%lc\n", ARROW_UP);
+    term_frame_printf(frame, L"%lc\n", ARROW_UP);
     // Itera sulle righe (altezze) del grafico
     for (int curr_height = 10; curr_height >= 1; curr_height--) {
-        wprintf(L"%lc", VERTICAL_BAR);
+        term_frame_printf(frame, L"%lc", VERTICAL_BAR);
         // Itera sugli elementi dei dati
         for (int i = 0; i < normalized_data_len; i++) {
-            draw_single_cell(normalized_data, i, curr_height);
+            draw_single_cell(frame, normalized_data, i, curr_height);
         }
-        wprintf(L"\n");
+        term_frame_printf(frame, L"\n");
     }
 
-    wprintf(L"%lc", CORNER_BOTTOM_LEFT);
+    term_frame_printf(frame, L"%lc", CORNER_BOTTOM_LEFT);
     for (int i = 0; i < max_columns * 2; i++)
-        wprintf(L"%lc", HORIZONTAL_BAR);
-    wprintf(L">\n");
+        term_frame_printf(frame, L"%lc", HORIZONTAL_BAR);
+    term_frame_printf(frame, L">\n");
 }
 
 /**
@@ -73,11 +76,12 @@ void limit_data(const unsigned int *original_data, unsigned int *limited_data, s
 /**
  * Disegna una singola cella, grande 1x2, nel grafico
  *
+ * @param frame Frame in disegno
  * @param data Dati di origine del grafico
  * @param i Indice della riga della cella
  * @param curr_height Altezza corrente nel grafico
  */
-void draw_single_cell(const unsigned int *data, int i, int curr_height) {
+void draw_single_cell(struct term_frame *frame, const unsigned int *data, int i, int curr_height) {
     // Mostra il carattere corrispondente alla cella del grafico.
     // Il minimo e massimo tra l'elemento corrente e quello precedente
     unsigned int previous_element = i == 0 ? 0 : data[i - 1];
@@ -103,9 +107,9 @@ void draw_single_cell(const unsigned int *data, int i, int curr_height) {
     else
         prev_bar_char = ' '; // Questa cella deve restare vuota
 
-    wprintf(L"%lc", prev_bar_char);
+    term_frame_printf(frame, L"%lc", prev_bar_char);
 
     // Stampa la linea superiore della barra dell'elemento corrente
-    wprintf(L"%lc", data[i] == curr_height ? HORIZONTAL_BAR : L' ');
+    term_frame_printf(frame, L"%lc", data[i] == curr_height ? HORIZONTAL_BAR : L' ');
 }
 
@@ -2,6 +2,7 @@
 #define HW2_CHART_H
 
 #include <stddef.h>
+#include "../common/term_frame.h"
 
 /**
  * Simboli Unicode per disegnare il grafico
@@ -15,12 +16,13 @@
 #define CORNER_TOP_RIGHT ((wchar_t) 0x2510)
 
 /**
- * Mostra sul terminale un grafico con i dati forniti in input
+ * Disegna nel frame un grafico con i dati forniti in input
  *
+ * @param frame Frame in disegno, largo quanto il terminale
  * @param data Dati da mostrare
  * @param data_len Dimensione dei dati
  */
-void plot_chart(const unsigned int *original_data, size_t data_len);
+void plot_chart(struct term_frame *frame, const unsigned int *original_data, size_t data_len);
 
 /**
  * Limita i dati dell'array originale nei max_columns ultimi elementi.
@@ -37,10 +39,11 @@ void limit_data(const unsigned int *original_data, unsigned int *limited_data, s
 /**
  * Disegna una singola cella, grande 1x2, nel grafico
  *
+ * @param frame Frame in disegno
  * @param data Dati di origine del grafico
  * @param i Indice della riga della cella
  * @param curr_height Altezza corrente nel grafico
  */
-void draw_single_cell(const unsigned int *data, int i, int curr_height);
+void draw_single_cell(struct term_frame *frame, const unsigned int *data, int i, int curr_height);
 
 #endif //HW2_CHART_H
@@ -5,6 +5,11 @@
 #include "../common/timestamp.h"
 #include <stdio.h>
 
+/**
+ * Righe usate al massimo dalla richiesta di input, sotto al risultato
+ */
+#define USER_INPUT_ROWS 4
+
 /**
  * Richiedi in input all'utente l'operazione da inviare al server
  *
@@ -18,4 +18,11 @@ void log_message(const struct sock_info *client_info, const char *restrict forma
     fprintf(stderr, "%s", log_prefix);
     vfprintf(stderr, format, args);
     va_end(args);
+}
+
+/**
+ * Scrivi tutti i log in attesa, ovvero svuota stderr
+ */
+void flush_logging() {
+    fflush(stderr);
 }
\ No newline at end of file
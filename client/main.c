@@ -1,6 +1,9 @@
+#include <limits.h>
 #include <stdlib.h>
 #include <wchar.h>
 #include <signal.h>
+#include <poll.h>
+#include <unistd.h>
 #include "../common/calc_utils.h"
 #include "../common/main_init.h"
 #include "../common/logger.h"
@@ -33,8 +36,20 @@ size_t chart_data_allocated = 1;
  */
 size_t chart_data_len = 0;
 
+/**
+ * Schermata con grafico e risultato, aggiornata scrivendo solo le celle cambiate
+ */
+struct term_frame screen_frame = {};
+
+/**
+ * Diverso da zero se l'ultima schermata disegnata non è stata ancora mostrata
+ */
+int screen_frame_pending = 0;
+
 void update_chart(unsigned int new_time);
 
+void show_screen_frame(void);
+
 void do_server_operations(FILE *socket_input, FILE *socket_output, operand_t *left_operand, operand_t *right_operand,
                           char *operator);
 
@@ -67,7 +82,11 @@ int main(int argc, const char **argv) {
         }
 
         // Ripulisci lo schermo e inizializza l'area per il grafo
-        plot_chart(chart_data, chart_data_len);
+        if (begin_term_frame(&screen_frame) == 0) {
+            plot_chart(&screen_frame, chart_data, chart_data_len);
+            screen_frame.redraw = 1; // Sullo schermo ora ci sono i messaggi della connessione
+            show_screen_frame();
+        }
 
         // Apri il socket file descriptor come FILE pointer per usare funzioni
         // di libreria come fprintf e fscanf.
@@ -90,6 +109,7 @@ int main(int argc, const char **argv) {
     free(chart_data);
     chart_data = NULL;
     chart_data_len = 0;
+    free_term_frame(&screen_frame);
 
     close_logging();
     // Se la socket è chiusa, dopo i vari tentativi, e l'utente NON ha dato CTRL+D,
@@ -98,7 +118,7 @@ int main(int argc, const char **argv) {
 }
 
 /**
- * Aggiorna il grafico mostrato all'utente sui tempi delle operazioni
+ * Aggiungi un tempo ai dati del grafico mostrato all'utente
  *
  * @param new_time Nuovo tempo impiegato
  */
@@ -113,8 +133,27 @@ void update_chart(unsigned int new_time) {
     }
 
     chart_data[chart_data_len++] = new_time;
+}
 
-    plot_chart(chart_data, chart_data_len);
+/**
+ * Invia al terminale la schermata disegnata.
+ * Se l'input arriva più veloce di TERM_FRAME_MAX_FPS (es: da un file) la schermata viene saltata,
+ * e la prossima ridisegnata per intero: nel frattempo le richieste di input hanno spostato lo schermo.
+ * Con l'input da tastiera viene sempre mostrata.
+ */
+void show_screen_frame(void) {
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    if (term_frame_delay_millis(&screen_frame) > 0 && poll(&input, 1, 0) > 0) {
+        screen_frame.redraw = 1;
+        screen_frame_pending = 1;
+        return;
+    }
+
+    // L'input sotto la schermata può far scorrere il terminale, e spostare le righe già scritte
+    if (screen_frame.previous_rows_used + USER_INPUT_ROWS >= screen_frame.rows)
+        screen_frame.redraw = 1;
+    flush_term_frame(&screen_frame);
+    screen_frame_pending = 0;
 }
 
 /**
@@ -138,31 +177,40 @@ void do_server_operations(FILE *socket_input, FILE *socket_output, operand_t *le
     while (socket_fd > 0 && working) {
         // Leggi l'input utente, se non c'è già un input vecchio prima della ri-connessione
         if (*operator == '\0' && get_user_input(left_operand, right_operand, operator) == -1) {
-            // Non sarà più possibile avere input utente. Termina.
+            // Non sarà più possibile avere input utente. Termina, mostrando l'ultimo risultato.
+            if (screen_frame_pending)
+                flush_term_frame(&screen_frame);
             socket_fd = 0;
             working = 0;
         } else if (send_operation_to_server(socket_output, left_operand, right_operand, *operator) == 0 &&
                    recv_operation_from_server(socket_input, raw_server_line) == 0) {
             // Invio operazione e ricezione risposta dal server, entrambi avvenuti con successo.
-            wprintf(L"\e[1;1H\e[2J>>>   %lf %c %lf   <<<\n", *left_operand, *operator, *right_operand);
-
             // Ancora dobbiamo interpretare la risposta (errore, dati, sconosciuto).
+            // In caso di errore resta l'ultima schermata, con l'errore sotto l'input.
             if (parse_server_result(raw_server_line, &start_time, &end_time,
                                     &result, start_time_str, end_time_str) == 0) {
                 // Tutte le operazioni si sono concluse con successo!
                 // Calcola la differenza del tempo
                 char diff_time_str[TIMESTAMP_STRING_SIZE] = {};
                 timediff_to_string(&start_time, &end_time, diff_time_str);
-                uint16_t diff_micros = timestamp_to_micros(&end_time) - timestamp_to_micros(&start_time);
+                // A 16 bit la durata ripartiva da zero oltre 65 ms: si limita solo oltre UINT_MAX microsecondi
+                uint64_t start_micros = timestamp_to_micros(&start_time), end_micros = timestamp_to_micros(&end_time);
+                uint64_t diff_micros = end_micros > start_micros ? end_micros - start_micros : 0;
 
                 // Aggiorna il grafico
-                update_chart(diff_micros);
-
-                // Mostra il risultato
-                wprintf(L"Risultato calcolato: %lf\n", result);
-                wprintf(L"Ricezione richiesta: %s\n", start_time_str);
-                wprintf(L"Fine elaborazione:   %s\n", end_time_str);
-                wprintf(L"Tempo trascorso:     %s\n\n", diff_time_str);
+                update_chart(diff_micros < UINT_MAX ? (unsigned int) diff_micros : UINT_MAX);
+
+                // Disegna operazione, grafico e risultato, e mostrali insieme
+                if (begin_term_frame(&screen_frame) == 0) {
+                    term_frame_printf(&screen_frame, L">>>   %lf %c %lf   <<<\n",
+                                      *left_operand, *operator, *right_operand);
+                    plot_chart(&screen_frame, chart_data, chart_data_len);
+                    term_frame_printf(&screen_frame, L"Risultato calcolato: %lf\n", result);
+                    term_frame_printf(&screen_frame, L"Ricezione richiesta: %s\n", start_time_str);
+                    term_frame_printf(&screen_frame, L"Fine elaborazione:   %s\n", end_time_str);
+                    term_frame_printf(&screen_frame, L"Tempo trascorso:     %s\n", diff_time_str);
+                    show_screen_frame();
+                }
             }
 
             // Visto che il server ci ha risposto in qualche modo,
@@ -3,7 +3,9 @@
 #include "../common/main_init.h"
 #include <strings.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
+#include <errno.h>
 
 /**
  * Connettiti al server.
@@ -33,6 +35,12 @@ int connect_to_server(const char *ip, uint16_t port) {
         return -1;
     }
 
+    // Usa TCP Fast Open se possibile: la connect() ritorna subito
+    // e la prima operazione viene inviata insieme al SYN.
+    int enable = 1;
+    if (setsockopt(new_socket_fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &enable, sizeof(int)) < 0)
+        errno = 0; // Non supportato, si usa la connessione classica
+
     // Connetti al server
     if (connect(new_socket_fd, (struct sockaddr *) &server_address, sizeof(server_address)) == -1) {
         log_errno(NULL, "Errore nella connect del socket");
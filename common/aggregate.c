@@ -0,0 +1,274 @@
+#include "aggregate.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * Scegli lane per lane tra due vettori
+ */
+static inline vdouble _vselect(vint mask, vdouble if_true, vdouble if_false) {
+    return (vdouble) ((mask & (vint) if_true) | (~mask & (vint) if_false));
+}
+
+/**
+ * Valore assoluto di ogni lane, azzerando il bit del segno
+ */
+static inline vdouble _vabs(vdouble x) {
+    return (vdouble) ((vint) x & ((vint) {} + INT64_MAX));
+}
+
+/**
+ * Inizializza un aggregato vuoto
+ */
+void aggregate_init(struct aggregate *aggregate) {
+    memset(aggregate, 0, sizeof(struct aggregate));
+    aggregate->positive.empty = 1;
+    aggregate->negative.empty = 1;
+}
+
+/**
+ * Aggiungi un valore a una somma compensata (Neumaier)
+ */
+void _neumaier_add(double *sum, double *compensation, double value) {
+    double total = *sum + value;
+    if (fabs(*sum) >= fabs(value))
+        *compensation += (*sum - total) + value;
+    else
+        *compensation += (value - total) + *sum;
+    *sum = total;
+}
+
+/**
+ * Aggiungi i valori alle somme compensate, una per lane
+ */
+void _add_compensated(struct aggregate *aggregate, const operand_t *values, size_t count) {
+    vdouble sums, compensations;
+    memcpy(&sums, aggregate->sums, sizeof(vdouble));
+    memcpy(&compensations, aggregate->compensations, sizeof(vdouble));
+
+    size_t i = 0;
+    for (; i + MATH_VECTOR_WIDTH <= count; i += MATH_VECTOR_WIDTH) {
+        vdouble x, total;
+        memcpy(&x, values + i, sizeof(vdouble));
+        total = sums + x;
+        // L'errore di arrotondamento dipende da quale dei due addendi è più grande
+        compensations += _vselect(_vabs(sums) >= _vabs(x), (sums - total) + x, (x - total) + sums);
+        sums = total;
+    }
+
+    memcpy(aggregate->sums, &sums, sizeof(vdouble));
+    memcpy(aggregate->compensations, &compensations, sizeof(vdouble));
+    for (; i < count; i++)
+        _neumaier_add(&aggregate->sums[0], &aggregate->compensations[0], values[i]);
+}
+
+/**
+ * Aggiorna minimo, massimo, media e somma dei quadrati degli scarti con quelli del blocco
+ */
+void _add_moments(struct aggregate *aggregate, const operand_t *values, size_t count) {
+    vdouble block_sum = {}, block_min = (vdouble) {} + values[0], block_max = block_min;
+
+    size_t i = 0;
+    for (; i + MATH_VECTOR_WIDTH <= count; i += MATH_VECTOR_WIDTH) {
+        vdouble x;
+        memcpy(&x, values + i, sizeof(vdouble));
+        block_sum += x;
+        block_min = _vselect(x < block_min, x, block_min);
+        block_max = _vselect(x > block_max, x, block_max);
+    }
+
+    double sum = 0, min = block_min[0], max = block_max[0];
+    for (int lane = 0; lane < MATH_VECTOR_WIDTH; lane++) {
+        sum += block_sum[lane];
+        min = fmin(min, block_min[lane]);
+        max = fmax(max, block_max[lane]);
+    }
+    for (size_t j = i; j < count; j++) {
+        sum += values[j];
+        min = fmin(min, values[j]);
+        max = fmax(max, values[j]);
+    }
+
+    // Scarti dalla media del blocco, in un secondo passaggio che è già in cache
+    double mean = sum / (double) count;
+    vdouble deviations = {};
+    for (i = 0; i + MATH_VECTOR_WIDTH <= count; i += MATH_VECTOR_WIDTH) {
+        vdouble x;
+        memcpy(&x, values + i, sizeof(vdouble));
+        x -= mean;
+        deviations += x * x;
+    }
+
+    double squared_deviations = 0;
+    for (int lane = 0; lane < MATH_VECTOR_WIDTH; lane++)
+        squared_deviations += deviations[lane];
+    for (; i < count; i++)
+        squared_deviations += (values[i] - mean) * (values[i] - mean);
+
+    // Unisci le statistiche del blocco a quelle precedenti (Chan et al.)
+    double previous = (double) aggregate->count, total = previous + (double) count;
+    double delta = mean - aggregate->mean;
+    aggregate->mean += delta * (double) count / total;
+    aggregate->squared_deviations += squared_deviations + delta * delta * previous * (double) count / total;
+
+    aggregate->min = aggregate->count == 0 ? min : fmin(aggregate->min, min);
+    aggregate->max = aggregate->count == 0 ? max : fmax(aggregate->max, max);
+}
+
+/**
+ * Indice più alto con un conteggio non nullo, relativo alla finestra
+ */
+int _store_highest(const struct sketch_store *store) {
+    int highest = AGGREGATE_SKETCH_BUCKETS - 1;
+    while (highest > 0 && store->counts[highest] == 0)
+        highest--;
+    return highest;
+}
+
+/**
+ * Conta un valore nell'intervallo logaritmico indicato, spostando la finestra se necessario.
+ * Se la finestra non basta, gli intervalli più vicini allo zero vengono uniti.
+ *
+ * @param store Finestra di intervalli
+ * @param index Intervallo del valore
+ * @param count Valori da contare
+ */
+void _store_add(struct sketch_store *store, int index, uint64_t count) {
+    if (store->empty) {
+        store->offset = index - AGGREGATE_SKETCH_BUCKETS / 2;
+        store->empty = 0;
+    }
+
+    if (index >= store->offset + AGGREGATE_SKETCH_BUCKETS) {
+        // Sposta la finestra in alto: gli intervalli che escono si uniscono al più basso
+        int shift = index - (store->offset + AGGREGATE_SKETCH_BUCKETS - 1);
+        uint64_t collapsed = 0;
+        for (int i = 0; i < shift && i < AGGREGATE_SKETCH_BUCKETS; i++)
+            collapsed += store->counts[i];
+
+        if (shift < AGGREGATE_SKETCH_BUCKETS) {
+            memmove(store->counts, store->counts + shift,
+                    (AGGREGATE_SKETCH_BUCKETS - shift) * sizeof(uint64_t));
+            memset(store->counts + AGGREGATE_SKETCH_BUCKETS - shift, 0, shift * sizeof(uint64_t));
+        } else {
+            memset(store->counts, 0, sizeof(store->counts));
+        }
+        store->counts[0] += collapsed;
+        store->offset += shift;
+    } else if (index < store->offset) {
+        // Sposta la finestra in basso finché c'è spazio libero in cima
+        int room = AGGREGATE_SKETCH_BUCKETS - 1 - _store_highest(store);
+        int shift = store->offset - index < room ? store->offset - index : room;
+        if (shift > 0) {
+            memmove(store->counts + shift, store->counts, (AGGREGATE_SKETCH_BUCKETS - shift) * sizeof(uint64_t));
+            memset(store->counts, 0, shift * sizeof(uint64_t));
+            store->offset -= shift;
+        }
+        if (index < store->offset)
+            index = store->offset;
+    }
+
+    store->counts[index - store->offset] += count;
+}
+
+/**
+ * Conta i valori del blocco negli intervalli logaritmici dello sketch
+ */
+void _add_to_sketch(struct aggregate *aggregate, const operand_t *values, size_t count) {
+    operand_t logarithms[AGGREGATE_BLOCK_SIZE] = {};
+    for (size_t i = 0; i < count; i++)
+        logarithms[i] = fabs(values[i]) < AGGREGATE_SKETCH_MIN_VALUE ? 1 : fabs(values[i]);
+
+    // gamma = (1 + a) / (1 - a): ogni intervallo (gamma^(k-1), gamma^k] ha errore relativo a attorno al centro
+    double inverse_log_gamma = 1 / (log1p(AGGREGATE_SKETCH_ACCURACY) - log1p(-AGGREGATE_SKETCH_ACCURACY));
+    calculate_function_batch(MATH_LOG, MATH_MODE_FAST, logarithms, 0, logarithms, count);
+
+    for (size_t i = 0; i < count; i++) {
+        if (fabs(values[i]) < AGGREGATE_SKETCH_MIN_VALUE) {
+            aggregate->zero_count++;
+            continue;
+        }
+        int index = (int) ceil(logarithms[i] * inverse_log_gamma);
+        _store_add(values[i] > 0 ? &aggregate->positive : &aggregate->negative, index, 1);
+    }
+}
+
+/**
+ * Aggiungi un blocco di valori finiti all'aggregato
+ *
+ * @param aggregate Aggregato da aggiornare
+ * @param values Valori da aggiungere
+ * @param count Numero di valori, al più AGGREGATE_BLOCK_SIZE
+ */
+void aggregate_add_block(struct aggregate *aggregate, const operand_t *values, size_t count) {
+    if (count == 0)
+        return;
+
+    _add_compensated(aggregate, values, count);
+    _add_moments(aggregate, values, count);
+    _add_to_sketch(aggregate, values, count);
+    aggregate->count += count;
+}
+
+/**
+ * Somma compensata di tutti i valori
+ */
+operand_t aggregate_sum(const struct aggregate *aggregate) {
+    double sum = 0, compensation = 0;
+    for (int lane = 0; lane < MATH_VECTOR_WIDTH; lane++) {
+        _neumaier_add(&sum, &compensation, aggregate->sums[lane]);
+        compensation += aggregate->compensations[lane];
+    }
+    return sum + compensation;
+}
+
+/**
+ * Varianza campionaria, con n - 1 al denominatore. Serve almeno due valori.
+ */
+operand_t aggregate_variance(const struct aggregate *aggregate) {
+    return aggregate->squared_deviations / (double) (aggregate->count - 1);
+}
+
+/**
+ * Valore rappresentativo di un intervallo logaritmico: 2 gamma^k / (gamma + 1),
+ * con errore relativo al più AGGREGATE_SKETCH_ACCURACY su tutto l'intervallo
+ */
+double _bucket_value(int index) {
+    double log_gamma = log1p(AGGREGATE_SKETCH_ACCURACY) - log1p(-AGGREGATE_SKETCH_ACCURACY);
+    return exp(index * log_gamma) * (1 - AGGREGATE_SKETCH_ACCURACY);
+}
+
+/**
+ * Quantile approssimato, con errore relativo AGGREGATE_SKETCH_ACCURACY.
+ * Il quantile 0 è il minimo e il quantile 1 il massimo esatti.
+ *
+ * @param aggregate Aggregato, non vuoto
+ * @param quantile Quantile in [0, 1]
+ * @return Il valore approssimato
+ */
+operand_t aggregate_quantile(const struct aggregate *aggregate, double quantile) {
+    if (quantile <= 0)
+        return aggregate->min;
+    if (quantile >= 1)
+        return aggregate->max;
+
+    uint64_t rank = (uint64_t) (quantile * (double) (aggregate->count - 1));
+    uint64_t seen = 0;
+    double value = aggregate->max;
+
+    // Prima i negativi dal modulo più grande, poi gli zeri, poi i positivi dal più piccolo
+    const struct sketch_store *negative = &aggregate->negative, *positive = &aggregate->positive;
+    for (int i = AGGREGATE_SKETCH_BUCKETS - 1; i >= 0 && !negative->empty && seen <= rank; i--) {
+        seen += negative->counts[i];
+        value = -_bucket_value(negative->offset + i);
+    }
+    if (seen <= rank) {
+        seen += aggregate->zero_count;
+        value = 0;
+    }
+    for (int i = 0; i < AGGREGATE_SKETCH_BUCKETS && !positive->empty && seen <= rank; i++) {
+        seen += positive->counts[i];
+        value = _bucket_value(positive->offset + i);
+    }
+
+    return fmin(fmax(value, aggregate->min), aggregate->max);
+}
@@ -0,0 +1,109 @@
+#ifndef HW2_AGGREGATE_H
+#define HW2_AGGREGATE_H
+
+#include "math_kernels.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Valori raccolti prima di essere aggiunti tutti insieme all'aggregato
+ */
+#define AGGREGATE_BLOCK_SIZE 256
+
+/**
+ * Errore relativo massimo dei quantili approssimati
+ */
+#define AGGREGATE_SKETCH_ACCURACY 0.01
+
+/**
+ * Intervalli logaritmici per ogni segno nello sketch dei quantili.
+ * Con l'accuratezza dell'1% coprono un rapporto di circa 10^17 tra il valore più piccolo e il più grande;
+ * oltre, gli intervalli più vicini allo zero vengono uniti e perdono precisione.
+ */
+#define AGGREGATE_SKETCH_BUCKETS 2048
+
+/**
+ * Sotto questo modulo un valore conta come zero nello sketch
+ */
+#define AGGREGATE_SKETCH_MIN_VALUE 1e-300
+
+/**
+ * Conteggi di una finestra di intervalli logaritmici consecutivi:
+ * counts[i] conta i valori con modulo in (gamma^(offset + i - 1), gamma^(offset + i)]
+ */
+struct sketch_store {
+    uint64_t counts[AGGREGATE_SKETCH_BUCKETS];
+    int offset;
+    int empty;
+};
+
+/**
+ * Statistiche su un flusso di valori, con memoria costante.
+ *
+ * La somma è compensata (Neumaier) separatamente su ogni lane dei vettori SIMD,
+ * media e varianza seguono Welford, unendo blocco per blocco le statistiche con la formula di Chan.
+ * I quantili vengono da uno sketch logaritmico come DDSketch: errore relativo AGGREGATE_SKETCH_ACCURACY.
+ */
+struct aggregate {
+    uint64_t count;
+
+    /**
+     * Somme parziali e relativi errori di arrotondamento, una per lane
+     */
+    double sums[MATH_VECTOR_WIDTH];
+    double compensations[MATH_VECTOR_WIDTH];
+
+    double mean;
+
+    /**
+     * Somma dei quadrati degli scarti dalla media
+     */
+    double squared_deviations;
+
+    double min;
+    double max;
+
+    uint64_t zero_count;
+    struct sketch_store positive;
+
+    /**
+     * Valori negativi, per modulo
+     */
+    struct sketch_store negative;
+};
+
+/**
+ * Inizializza un aggregato vuoto
+ */
+void aggregate_init(struct aggregate *aggregate);
+
+/**
+ * Aggiungi un blocco di valori finiti all'aggregato
+ *
+ * @param aggregate Aggregato da aggiornare
+ * @param values Valori da aggiungere
+ * @param count Numero di valori, al più AGGREGATE_BLOCK_SIZE
+ */
+void aggregate_add_block(struct aggregate *aggregate, const operand_t *values, size_t count);
+
+/**
+ * Somma compensata di tutti i valori
+ */
+operand_t aggregate_sum(const struct aggregate *aggregate);
+
+/**
+ * Varianza campionaria, con n - 1 al denominatore. Serve almeno due valori.
+ */
+operand_t aggregate_variance(const struct aggregate *aggregate);
+
+/**
+ * Quantile approssimato, con errore relativo AGGREGATE_SKETCH_ACCURACY.
+ * Il quantile 0 è il minimo e il quantile 1 il massimo esatti.
+ *
+ * @param aggregate Aggregato, non vuoto
+ * @param quantile Quantile in [0, 1]
+ * @return Il valore approssimato
+ */
+operand_t aggregate_quantile(const struct aggregate *aggregate, double quantile);
+
+#endif //HW2_AGGREGATE_H
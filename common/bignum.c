@@ -0,0 +1,1111 @@
+#include "bignum.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * La classe più piccola del pool contiene 2^LIMB_POOL_MIN_SHIFT cifre
+ */
+#define LIMB_POOL_MIN_SHIFT 4
+
+/**
+ * Numero di classi del pool, ognuna di dimensione doppia della precedente.
+ * I blocchi più grandi vengono allocati e liberati direttamente.
+ */
+#define LIMB_POOL_CLASSES 24
+
+/**
+ * Blocco libero nel pool, collegato agli altri della stessa classe
+ */
+struct limb_block {
+    struct limb_block *next;
+};
+
+/**
+ * Liste dei blocchi liberi di ogni classe, e quanti ne contengono
+ */
+struct limb_block *limb_pool_free_lists[LIMB_POOL_CLASSES] = {};
+size_t limb_pool_cached[LIMB_POOL_CLASSES] = {};
+
+/**
+ * Mutua esclusione sulle liste del pool, condiviso da tutti i thread
+ */
+pthread_mutex_t limb_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Primo per la NTT, con la sua aritmetica di Montgomery modulo 2^32
+ */
+struct ntt_prime {
+    uint32_t mod;
+
+    /**
+     * -mod^-1 modulo 2^32
+     */
+    uint32_t inverse;
+
+    /**
+     * 2^64 modulo mod, per portare un valore nella forma di Montgomery
+     */
+    uint32_t r2;
+
+    /**
+     * Radice primitiva modulo mod
+     */
+    uint32_t generator;
+};
+
+/**
+ * Tre primi della forma c 2^k + 1: il loro prodotto (circa 2^86) supera
+ * ogni coefficiente della convoluzione, che si ricostruisce col teorema cinese del resto
+ */
+struct ntt_prime ntt_primes[3] = {{998244353, 0, 0, 3}, {167772161, 0, 0, 3}, {469762049, 0, 0, 3}};
+
+/**
+ * Inversi per il teorema cinese del resto: p1^-1 mod p2 e (p1 p2)^-1 mod p3
+ */
+uint64_t ntt_inverse_12, ntt_inverse_123;
+
+/**
+ * Inizializzazione delle costanti della NTT, una volta sola
+ */
+pthread_once_t ntt_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Classe del pool adatta a contenere un certo numero di cifre
+ */
+int _limb_pool_class(size_t limbs) {
+    int pool_class = 0;
+    while (((size_t) 1 << (pool_class + LIMB_POOL_MIN_SHIFT)) < limbs)
+        pool_class++;
+    return pool_class;
+}
+
+/**
+ * Prendi dal pool un vettore di cifre
+ *
+ * @param limbs Numero minimo di cifre
+ * @param capacity Dove scrivere il numero di cifre effettivamente disponibili
+ * @return Il vettore, non inizializzato
+ */
+limb_t *_limb_alloc(size_t limbs, size_t *capacity) {
+    int pool_class = _limb_pool_class(limbs);
+    if (pool_class >= LIMB_POOL_CLASSES) {
+        *capacity = limbs;
+        return malloc(limbs * sizeof(limb_t));
+    }
+
+    *capacity = (size_t) 1 << (pool_class + LIMB_POOL_MIN_SHIFT);
+    pthread_mutex_lock(&limb_pool_mutex);
+    struct limb_block *block = limb_pool_free_lists[pool_class];
+    if (block != NULL) {
+        limb_pool_free_lists[pool_class] = block->next;
+        limb_pool_cached[pool_class]--;
+    }
+    pthread_mutex_unlock(&limb_pool_mutex);
+
+    return block != NULL ? (limb_t *) block : malloc(*capacity * sizeof(limb_t));
+}
+
+/**
+ * Restituisci un vettore di cifre al pool
+ *
+ * @param limbs Vettore preso con _limb_alloc(), può essere NULL
+ * @param capacity Capacità restituita da _limb_alloc()
+ */
+void _limb_release(limb_t *limbs, size_t capacity) {
+    if (limbs == NULL)
+        return;
+
+    int pool_class = _limb_pool_class(capacity);
+    if (pool_class < LIMB_POOL_CLASSES && ((size_t) 1 << (pool_class + LIMB_POOL_MIN_SHIFT)) == capacity) {
+        pthread_mutex_lock(&limb_pool_mutex);
+        if (limb_pool_cached[pool_class] < LIMB_POOL_CACHED_BLOCKS) {
+            struct limb_block *block = (struct limb_block *) limbs;
+            block->next = limb_pool_free_lists[pool_class];
+            limb_pool_free_lists[pool_class] = block;
+            limb_pool_cached[pool_class]++;
+            limbs = NULL;
+        }
+        pthread_mutex_unlock(&limb_pool_mutex);
+    }
+
+    free(limbs);
+}
+
+/**
+ * Libera tutti i blocchi tenuti da parte dal pool
+ */
+void clear_limb_pool() {
+    pthread_mutex_lock(&limb_pool_mutex);
+    for (int pool_class = 0; pool_class < LIMB_POOL_CLASSES; pool_class++) {
+        while (limb_pool_free_lists[pool_class] != NULL) {
+            struct limb_block *block = limb_pool_free_lists[pool_class];
+            limb_pool_free_lists[pool_class] = block->next;
+            free(block);
+        }
+        limb_pool_cached[pool_class] = 0;
+    }
+    pthread_mutex_unlock(&limb_pool_mutex);
+}
+
+/**
+ * Inizializza un numero a zero, senza allocare memoria
+ *
+ * @param number Numero da inizializzare
+ */
+void bignum_init(struct bignum *number) {
+    number->limbs = NULL;
+    number->size = 0;
+    number->capacity = 0;
+    number->negative = 0;
+}
+
+/**
+ * Restituisci al pool la memoria di un numero, che torna a zero
+ *
+ * @param number Numero da liberare
+ */
+void bignum_free(struct bignum *number) {
+    _limb_release(number->limbs, number->capacity);
+    bignum_init(number);
+}
+
+/**
+ * Prepara un numero a contenere almeno un certo numero di cifre, perdendo il valore
+ */
+void _bignum_reserve(struct bignum *number, size_t limbs) {
+    if (number->capacity < limbs) {
+        _limb_release(number->limbs, number->capacity);
+        number->limbs = _limb_alloc(limbs, &number->capacity);
+    }
+}
+
+/**
+ * Sostituisci il contenuto di destination con quello di source, che torna a zero
+ */
+void _bignum_move(struct bignum *destination, struct bignum *source) {
+    if (destination == source)
+        return;
+    bignum_free(destination);
+    *destination = *source;
+    bignum_init(source);
+}
+
+/**
+ * Togli gli zeri più significativi
+ */
+void _bignum_normalize(struct bignum *number) {
+    while (number->size > 0 && number->limbs[number->size - 1] == 0)
+        number->size--;
+    if (number->size == 0)
+        number->negative = 0;
+}
+
+/**
+ * Copia delle cifre in un numero non negativo
+ */
+void _bignum_set_limbs(struct bignum *number, const limb_t *limbs, size_t count) {
+    _bignum_reserve(number, count);
+    memmove(number->limbs, limbs, count * sizeof(limb_t));
+    number->size = count;
+    number->negative = 0;
+    _bignum_normalize(number);
+}
+
+/**
+ * Confronta due vettori di cifre normalizzati
+ */
+int _limbs_compare(const limb_t *a, size_t a_size, const limb_t *b, size_t b_size) {
+    if (a_size != b_size)
+        return a_size < b_size ? -1 : 1;
+    for (size_t i = a_size; i > 0; i--) {
+        if (a[i - 1] != b[i - 1])
+            return a[i - 1] < b[i - 1] ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * result = a + b, con a_size >= b_size. Vengono scritte a_size cifre.
+ * result può coincidere con a.
+ *
+ * @return Riporto finale, 0 o 1
+ */
+limb_t _limbs_add(limb_t *result, const limb_t *a, size_t a_size, const limb_t *b, size_t b_size) {
+    limb_t carry = 0;
+    size_t i = 0;
+    for (; i < b_size; i++) {
+        limb_t sum = a[i] + b[i] + carry;
+        carry = sum >= BIGNUM_BASE;
+        result[i] = carry ? sum - BIGNUM_BASE : sum;
+    }
+    for (; i < a_size; i++) {
+        limb_t sum = a[i] + carry;
+        carry = sum >= BIGNUM_BASE;
+        result[i] = carry ? sum - BIGNUM_BASE : sum;
+    }
+    return carry;
+}
+
+/**
+ * result = a - b, con a_size >= b_size. Vengono scritte a_size cifre.
+ * result può coincidere con a.
+ *
+ * @return Prestito finale, 1 se b > a
+ */
+limb_t _limbs_subtract(limb_t *result, const limb_t *a, size_t a_size, const limb_t *b, size_t b_size) {
+    limb_t borrow = 0;
+    size_t i = 0;
+    for (; i < b_size; i++) {
+        limb_t subtrahend = b[i] + borrow;
+        borrow = a[i] < subtrahend;
+        result[i] = borrow ? a[i] + BIGNUM_BASE - subtrahend : a[i] - subtrahend;
+    }
+    for (; i < a_size; i++) {
+        limb_t digit = a[i];
+        result[i] = digit < borrow ? BIGNUM_BASE - 1 : digit - borrow;
+        borrow = digit < borrow;
+    }
+    return borrow;
+}
+
+/**
+ * result = a * factor, con factor < BIGNUM_BASE. Vengono scritte a_size cifre.
+ *
+ * @return Cifra di riporto
+ */
+limb_t _limbs_multiply_small(limb_t *result, const limb_t *a, size_t a_size, limb_t factor) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < a_size; i++) {
+        uint64_t product = (uint64_t) a[i] * factor + carry;
+        carry = product / BIGNUM_BASE;
+        result[i] = (limb_t) (product - carry * BIGNUM_BASE);
+    }
+    return (limb_t) carry;
+}
+
+/**
+ * quotient = a / divisor, con divisor < BIGNUM_BASE. Vengono scritte a_size cifre.
+ *
+ * @return Il resto
+ */
+limb_t _limbs_divide_small(limb_t *quotient, const limb_t *a, size_t a_size, limb_t divisor) {
+    uint64_t remainder = 0;
+    for (size_t i = a_size; i > 0; i--) {
+        uint64_t current = remainder * BIGNUM_BASE + a[i - 1];
+        quotient[i - 1] = (limb_t) (current / divisor);
+        remainder = current % divisor;
+    }
+    return (limb_t) remainder;
+}
+
+/**
+ * Moltiplicazione scolastica: result = a * b, a_size + b_size cifre.
+ * result non può coincidere con a o b.
+ */
+void _multiply_schoolbook(limb_t *result, const limb_t *a, size_t a_size, const limb_t *b, size_t b_size) {
+    memset(result, 0, (a_size + b_size) * sizeof(limb_t));
+    for (size_t i = 0; i < a_size; i++) {
+        uint64_t digit = a[i], carry = 0;
+        if (digit == 0)
+            continue;
+        for (size_t j = 0; j < b_size; j++) {
+            uint64_t sum = result[i + j] + digit * b[j] + carry;
+            carry = sum / BIGNUM_BASE;
+            result[i + j] = (limb_t) (sum - carry * BIGNUM_BASE);
+        }
+        result[i + b_size] = (limb_t) carry;
+    }
+}
+
+/**
+ * Memoria temporanea usata da _multiply_karatsuba() per operandi di size cifre
+ */
+size_t _karatsuba_scratch_size(size_t size) {
+    size_t scratch = 0;
+    while (size >= BIGNUM_KARATSUBA_THRESHOLD) {
+        size_t high = size - size / 2;
+        scratch += 4 * (high + 1);
+        size = high + 1;
+    }
+    return scratch;
+}
+
+/**
+ * Moltiplicazione di Karatsuba di due operandi della stessa lunghezza:
+ * (a1 B + a0)(b1 B + b0) = a1 b1 B^2 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B + a0 b0
+ *
+ * @param result Dove scrivere le 2 size cifre del prodotto
+ * @param scratch Memoria temporanea di almeno _karatsuba_scratch_size(size) cifre
+ */
+void _multiply_karatsuba(limb_t *result, const limb_t *a, const limb_t *b, size_t size, limb_t *scratch) {
+    if (size < BIGNUM_KARATSUBA_THRESHOLD) {
+        _multiply_schoolbook(result, a, size, b, size);
+        return;
+    }
+
+    size_t low = size / 2, high = size - low;
+
+    // a0 b0 e a1 b1 direttamente nelle due metà del risultato
+    _multiply_karatsuba(result, a, b, low, scratch);
+    _multiply_karatsuba(result + 2 * low, a + low, b + low, high, scratch);
+
+    limb_t *a_sum = scratch;
+    limb_t *b_sum = a_sum + high + 1;
+    limb_t *middle = b_sum + high + 1;
+    limb_t *next_scratch = middle + 2 * (high + 1);
+    a_sum[high] = _limbs_add(a_sum, a + low, high, a, low);
+    b_sum[high] = _limbs_add(b_sum, b + low, high, b, low);
+    _multiply_karatsuba(middle, a_sum, b_sum, high + 1, next_scratch);
+
+    size_t middle_size = 2 * (high + 1);
+    _limbs_subtract(middle, middle, middle_size, result, 2 * low);
+    _limbs_subtract(middle, middle, middle_size, result + 2 * low, 2 * high);
+    while (middle_size > 0 && middle[middle_size - 1] == 0)
+        middle_size--;
+
+    _limbs_add(result + low, result + low, 2 * size - low, middle, middle_size);
+}
+
+/**
+ * Inizializza le costanti di Montgomery e del teorema cinese del resto
+ */
+void _ntt_init(void) {
+    for (int i = 0; i < 3; i++) {
+        struct ntt_prime *prime = &ntt_primes[i];
+        // Inverso modulo 2^32 col metodo di Newton: ogni passo raddoppia i bit corretti
+        uint32_t inverse = prime->mod;
+        for (int step = 0; step < 5; step++)
+            inverse *= 2 - prime->mod * inverse;
+        prime->inverse = -inverse;
+        prime->r2 = (uint32_t) (((unsigned __int128) 1 << 64) % prime->mod);
+    }
+
+    // Inversi col piccolo teorema di Fermat
+    uint64_t p1 = ntt_primes[0].mod, p2 = ntt_primes[1].mod, p3 = ntt_primes[2].mod;
+    uint64_t base = p1 % p2, result = 1;
+    for (uint64_t exponent = p2 - 2; exponent > 0; exponent >>= 1, base = base * base % p2)
+        if (exponent & 1) result = result * base % p2;
+    ntt_inverse_12 = result;
+
+    base = p1 * p2 % p3, result = 1;
+    for (uint64_t exponent = p3 - 2; exponent > 0; exponent >>= 1, base = base * base % p3)
+        if (exponent & 1) result = result * base % p3;
+    ntt_inverse_123 = result;
+}
+
+/**
+ * Riduzione di Montgomery: t 2^-32 modulo mod, per t < mod 2^32
+ */
+static inline uint32_t _montgomery_reduce(uint64_t t, const struct ntt_prime *prime) {
+    uint32_t m = (uint32_t) t * prime->inverse;
+    uint32_t u = (uint32_t) ((t + (uint64_t) m * prime->mod) >> 32);
+    return u >= prime->mod ? u - prime->mod : u;
+}
+
+/**
+ * Prodotto di due valori nella forma di Montgomery
+ */
+static inline uint32_t _montgomery_multiply(uint32_t a, uint32_t b, const struct ntt_prime *prime) {
+    return _montgomery_reduce((uint64_t) a * b, prime);
+}
+
+/**
+ * Potenza di un valore nella forma di Montgomery
+ */
+uint32_t _montgomery_power(uint32_t base, uint64_t exponent, const struct ntt_prime *prime) {
+    uint32_t result = _montgomery_multiply(1, prime->r2, prime);
+    for (; exponent > 0; exponent >>= 1, base = _montgomery_multiply(base, base, prime))
+        if (exponent & 1) result = _montgomery_multiply(result, base, prime);
+    return result;
+}
+
+/**
+ * NTT iterativa radix-2 sul posto, con i valori nella forma di Montgomery
+ *
+ * @param values Vettore da trasformare, di lunghezza potenza di 2
+ * @param size Lunghezza
+ * @param roots Radici dell'unità di ogni livello: roots[half + j] = w_(2 half)^j, contigue per ogni livello
+ * @param prime Primo modulo cui lavorare
+ */
+void _ntt(uint32_t *values, size_t size, const uint32_t *roots, const struct ntt_prime *prime) {
+    for (size_t i = 1, j = 0; i < size; i++) {
+        size_t bit = size >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            uint32_t swap = values[i];
+            values[i] = values[j];
+            values[j] = swap;
+        }
+    }
+
+    for (size_t length = 2; length <= size; length <<= 1) {
+        size_t half = length / 2;
+        for (size_t i = 0; i < size; i += length) {
+            for (size_t j = 0; j < half; j++) {
+                uint32_t u = values[i + j];
+                uint32_t v = _montgomery_multiply(values[i + j + half], roots[half + j], prime);
+                uint32_t sum = u + v, difference = u - v;
+                values[i + j] = sum >= prime->mod ? sum - prime->mod : sum;
+                values[i + j + half] = u >= v ? difference : difference + prime->mod;
+            }
+        }
+    }
+}
+
+/**
+ * Moltiplicazione con la NTT su tre primi, ricostruendo i coefficienti
+ * della convoluzione col teorema cinese del resto.
+ *
+ * @param result Dove scrivere le a_size + b_size cifre del prodotto
+ */
+void _multiply_ntt(limb_t *result, const limb_t *a, size_t a_size, const limb_t *b, size_t b_size) {
+    pthread_once(&ntt_once, _ntt_init);
+
+    size_t result_size = a_size + b_size, size = 1;
+    while (size < result_size)
+        size <<= 1;
+
+    size_t a_capacity, b_capacity, roots_capacity, residues_capacity;
+    uint32_t *a_values = _limb_alloc(size, &a_capacity);
+    uint32_t *b_values = _limb_alloc(size, &b_capacity);
+    uint32_t *roots = _limb_alloc(size, &roots_capacity);
+    uint32_t *residues = _limb_alloc(3 * result_size, &residues_capacity);
+
+    for (int p = 0; p < 3; p++) {
+        const struct ntt_prime *prime = &ntt_primes[p];
+        for (size_t i = 0; i < size; i++) {
+            a_values[i] = i < a_size ? _montgomery_multiply(a[i] % prime->mod, prime->r2, prime) : 0;
+            b_values[i] = i < b_size ? _montgomery_multiply(b[i] % prime->mod, prime->r2, prime) : 0;
+        }
+
+        uint32_t generator = _montgomery_multiply(prime->generator, prime->r2, prime);
+        uint32_t root = _montgomery_power(generator, (prime->mod - 1) / size, prime);
+        // Potenze della radice per l'ultimo livello, poi ogni livello prende una potenza ogni due del successivo
+        roots[size / 2] = _montgomery_multiply(1, prime->r2, prime);
+        for (size_t i = size / 2 + 1; i < size; i++)
+            roots[i] = _montgomery_multiply(roots[i - 1], root, prime);
+        for (size_t i = size / 2 - 1; i > 0; i--)
+            roots[i] = roots[2 * i];
+
+        _ntt(a_values, size, roots, prime);
+        _ntt(b_values, size, roots, prime);
+        for (size_t i = 0; i < size; i++)
+            a_values[i] = _montgomery_multiply(a_values[i], b_values[i], prime);
+
+        // Trasformata inversa: la stessa trasformata, con gli elementi 1..size-1 invertiti, diviso size
+        _ntt(a_values, size, roots, prime);
+        uint32_t size_inverse = _montgomery_power(_montgomery_multiply((uint32_t) size, prime->r2, prime),
+                                                  prime->mod - 2, prime);
+        for (size_t i = 0; i < result_size; i++) {
+            uint32_t value = a_values[i == 0 ? 0 : size - i];
+            residues[p * result_size + i] = _montgomery_reduce(_montgomery_multiply(value, size_inverse, prime),
+                                                               prime);
+        }
+    }
+
+    // Teorema cinese del resto e propagazione dei riporti in base BIGNUM_BASE
+    uint64_t p1 = ntt_primes[0].mod, p2 = ntt_primes[1].mod, p3 = ntt_primes[2].mod;
+    unsigned __int128 carry = 0;
+    for (size_t i = 0; i < result_size; i++) {
+        uint64_t r1 = residues[i], r2 = residues[result_size + i], r3 = residues[2 * result_size + i];
+        uint64_t t = (r2 + p2 - r1 % p2) % p2 * ntt_inverse_12 % p2;
+        uint64_t x12 = r1 + p1 * t;
+        uint64_t t2 = (r3 + p3 - x12 % p3) % p3 * ntt_inverse_123 % p3;
+        carry += x12 + (unsigned __int128) (p1 * p2) * t2;
+
+        uint64_t low = (uint64_t) (carry % BIGNUM_BASE);
+        result[i] = (limb_t) low;
+        carry /= BIGNUM_BASE;
+    }
+
+    _limb_release(a_values, a_capacity);
+    _limb_release(b_values, b_capacity);
+    _limb_release(roots, roots_capacity);
+    _limb_release(residues, residues_capacity);
+}
+
+/**
+ * result = a * b, a_size + b_size cifre, con l'algoritmo indicato o scelto dalle soglie.
+ * result non può coincidere con a o b.
+ */
+void _multiply_limbs(limb_t *result, const limb_t *a, size_t a_size, const limb_t *b, size_t b_size,
+                     enum bignum_algorithm algorithm) {
+    if (a_size < b_size) {
+        const limb_t *swap = a;
+        a = b;
+        b = swap;
+        size_t swap_size = a_size;
+        a_size = b_size;
+        b_size = swap_size;
+    }
+
+    if (algorithm == BIGNUM_AUTO || algorithm == BIGNUM_NEWTON) {
+        if (b_size < BIGNUM_KARATSUBA_THRESHOLD)
+            algorithm = BIGNUM_SCHOOLBOOK;
+        else if (b_size < BIGNUM_NTT_THRESHOLD)
+            algorithm = BIGNUM_KARATSUBA;
+        else
+            algorithm = BIGNUM_NTT;
+    }
+    if (algorithm == BIGNUM_NTT && a_size + b_size > BIGNUM_NTT_MAX_LIMBS)
+        algorithm = BIGNUM_KARATSUBA;
+    if (algorithm == BIGNUM_KARATSUBA && b_size < BIGNUM_KARATSUBA_THRESHOLD)
+        algorithm = BIGNUM_SCHOOLBOOK;
+
+    if (algorithm == BIGNUM_SCHOOLBOOK) {
+        _multiply_schoolbook(result, a, a_size, b, b_size);
+    } else if (algorithm == BIGNUM_NTT) {
+        _multiply_ntt(result, a, a_size, b, b_size);
+    } else {
+        // Operandi sbilanciati: a viene diviso in blocchi lunghi quanto b
+        size_t scratch_capacity, product_capacity;
+        limb_t *scratch = _limb_alloc(_karatsuba_scratch_size(b_size), &scratch_capacity);
+        limb_t *product = _limb_alloc(2 * b_size, &product_capacity);
+        memset(result, 0, (a_size + b_size) * sizeof(limb_t));
+
+        for (size_t offset = 0; offset < a_size; offset += b_size) {
+            size_t block_size = a_size - offset < b_size ? a_size - offset : b_size;
+            if (block_size == b_size)
+                _multiply_karatsuba(product, a + offset, b, b_size, scratch);
+            else
+                _multiply_limbs(product, b, b_size, a + offset, block_size, BIGNUM_KARATSUBA);
+            _limbs_add(result + offset, result + offset, a_size + b_size - offset, product, block_size + b_size);
+        }
+
+        _limb_release(scratch, scratch_capacity);
+        _limb_release(product, product_capacity);
+    }
+}
+
+/**
+ * result = a * b con un algoritmo specifico.
+ * La NTT ricade su Karatsuba oltre BIGNUM_NTT_MAX_LIMBS.
+ */
+void bignum_multiply_with(struct bignum *result, const struct bignum *a, const struct bignum *b,
+                          enum bignum_algorithm algorithm) {
+    struct bignum product;
+    bignum_init(&product);
+    if (a->size > 0 && b->size > 0) {
+        _bignum_reserve(&product, a->size + b->size);
+        _multiply_limbs(product.limbs, a->limbs, a->size, b->limbs, b->size, algorithm);
+        product.size = a->size + b->size;
+        product.negative = a->negative != b->negative;
+        _bignum_normalize(&product);
+    }
+    _bignum_move(result, &product);
+}
+
+/**
+ * result = a * b, con l'algoritmo scelto dalle soglie. result può coincidere con a o b.
+ */
+void bignum_multiply(struct bignum *result, const struct bignum *a, const struct bignum *b) {
+    bignum_multiply_with(result, a, b, BIGNUM_AUTO);
+}
+
+/**
+ * Somma con i segni indicati, per condividere il codice tra somma e sottrazione
+ */
+void _bignum_add_signed(struct bignum *result, const struct bignum *a, int a_negative, const struct bignum *b,
+                        int b_negative) {
+    struct bignum sum;
+    bignum_init(&sum);
+
+    if (a_negative == b_negative) {
+        if (a->size < b->size) {
+            const struct bignum *swap = a;
+            a = b;
+            b = swap;
+        }
+        _bignum_reserve(&sum, a->size + 1);
+        sum.limbs[a->size] = _limbs_add(sum.limbs, a->limbs, a->size, b->limbs, b->size);
+        sum.size = a->size + 1;
+        sum.negative = a_negative;
+    } else {
+        // Segni opposti: sottrai il modulo minore dal maggiore, col segno del maggiore
+        int comparison = _limbs_compare(a->limbs, a->size, b->limbs, b->size);
+        if (comparison < 0) {
+            const struct bignum *swap = a;
+            a = b;
+            b = swap;
+            a_negative = b_negative;
+        }
+        _bignum_reserve(&sum, a->size);
+        _limbs_subtract(sum.limbs, a->limbs, a->size, b->limbs, b->size);
+        sum.size = a->size;
+        sum.negative = a_negative;
+    }
+
+    _bignum_normalize(&sum);
+    _bignum_move(result, &sum);
+}
+
+/**
+ * result = a + b. result può coincidere con a o b.
+ */
+void bignum_add(struct bignum *result, const struct bignum *a, const struct bignum *b) {
+    _bignum_add_signed(result, a, a->negative, b, b->negative);
+}
+
+/**
+ * result = a - b. result può coincidere con a o b.
+ */
+void bignum_subtract(struct bignum *result, const struct bignum *a, const struct bignum *b) {
+    _bignum_add_signed(result, a, a->negative, b, !b->negative);
+}
+
+/**
+ * Confronta due numeri
+ *
+ * @return Negativo, zero o positivo se a è minore, uguale o maggiore di b
+ */
+int bignum_compare(const struct bignum *a, const struct bignum *b) {
+    if (a->negative != b->negative)
+        return a->negative ? -1 : 1;
+    int comparison = _limbs_compare(a->limbs, a->size, b->limbs, b->size);
+    return a->negative ? -comparison : comparison;
+}
+
+/**
+ * result = a * BIGNUM_BASE^shift, oppure a / BIGNUM_BASE^-shift troncato se shift < 0
+ */
+void _bignum_shift_limbs(struct bignum *result, const struct bignum *a, long shift) {
+    struct bignum shifted;
+    bignum_init(&shifted);
+
+    if (shift >= 0 && a->size > 0) {
+        _bignum_reserve(&shifted, a->size + shift);
+        memset(shifted.limbs, 0, shift * sizeof(limb_t));
+        memcpy(shifted.limbs + shift, a->limbs, a->size * sizeof(limb_t));
+        shifted.size = a->size + shift;
+    } else if (shift < 0 && a->size > (size_t) -shift) {
+        _bignum_set_limbs(&shifted, a->limbs - shift, a->size + shift);
+    }
+    shifted.negative = shifted.size > 0 && a->negative;
+
+    _bignum_move(result, &shifted);
+}
+
+/**
+ * result = a * 10^digits
+ */
+void bignum_shift_decimal(struct bignum *result, const struct bignum *a, size_t digits) {
+    limb_t factor = 1;
+    for (size_t i = 0; i < digits % BIGNUM_BASE_DIGITS; i++)
+        factor *= 10;
+
+    struct bignum scaled;
+    bignum_init(&scaled);
+    if (a->size > 0) {
+        _bignum_reserve(&scaled, a->size + 1);
+        scaled.limbs[a->size] = _limbs_multiply_small(scaled.limbs, a->limbs, a->size, factor);
+        scaled.size = a->size + 1;
+        scaled.negative = a->negative;
+        _bignum_normalize(&scaled);
+    }
+
+    _bignum_shift_limbs(result, &scaled, (long) (digits / BIGNUM_BASE_DIGITS));
+    bignum_free(&scaled);
+}
+
+/**
+ * result = a^exponent, per quadrati successivi
+ */
+void bignum_power(struct bignum *result, const struct bignum *a, uint64_t exponent) {
+    struct bignum power, base;
+    bignum_init(&power);
+    bignum_init(&base);
+    _bignum_set_limbs(&power, (const limb_t[]) {1}, 1);
+    _bignum_set_limbs(&base, a->limbs, a->size);
+    base.negative = a->negative;
+
+    for (; exponent > 0; exponent >>= 1) {
+        if (exponent & 1)
+            bignum_multiply(&power, &power, &base);
+        if (exponent > 1)
+            bignum_multiply(&base, &base, &base);
+    }
+
+    bignum_free(&base);
+    _bignum_move(result, &power);
+}
+
+/**
+ * Divisione scolastica (algoritmo D di Knuth) di valori assoluti,
+ * con b_size >= 2 e a_size >= b_size.
+ *
+ * @param quotient Dove scrivere le a_size - b_size + 1 cifre del quoziente
+ * @param remainder Dove scrivere le b_size cifre del resto
+ */
+void _divide_schoolbook(limb_t *quotient, limb_t *remainder, const limb_t *a, size_t a_size, const limb_t *b,
+                        size_t b_size) {
+    // Normalizza in modo che la cifra più significativa del divisore sia >= BIGNUM_BASE / 2
+    limb_t factor = BIGNUM_BASE / (b[b_size - 1] + 1);
+    size_t u_capacity, v_capacity;
+    limb_t *u = _limb_alloc(a_size + 1, &u_capacity);
+    limb_t *v = _limb_alloc(b_size, &v_capacity);
+    u[a_size] = _limbs_multiply_small(u, a, a_size, factor);
+    _limbs_multiply_small(v, b, b_size, factor);
+
+    uint64_t top = v[b_size - 1], second = v[b_size - 2];
+    for (size_t j = a_size - b_size + 1; j > 0; j--) {
+        limb_t *window = u + j - 1;
+
+        // Stima della cifra del quoziente dalle prime cifre, in eccesso al massimo di 2
+        uint64_t numerator = (uint64_t) window[b_size] * BIGNUM_BASE + window[b_size - 1];
+        uint64_t estimate = numerator / top, estimate_remainder = numerator % top;
+        while (estimate >= BIGNUM_BASE ||
+               estimate * second > estimate_remainder * BIGNUM_BASE + window[b_size - 2]) {
+            estimate--;
+            estimate_remainder += top;
+            if (estimate_remainder >= BIGNUM_BASE)
+                break;
+        }
+
+        // window -= estimate * v
+        uint64_t carry = 0;
+        limb_t borrow = 0;
+        for (size_t i = 0; i < b_size; i++) {
+            uint64_t product = estimate * v[i] + carry;
+            carry = product / BIGNUM_BASE;
+            limb_t subtrahend = (limb_t) (product - carry * BIGNUM_BASE) + borrow;
+            borrow = window[i] < subtrahend;
+            window[i] = borrow ? window[i] + BIGNUM_BASE - subtrahend : window[i] - subtrahend;
+        }
+        uint64_t subtrahend = carry + borrow;
+
+        if (window[b_size] < subtrahend) {
+            // Stima ancora in eccesso di uno: riaggiungi il divisore
+            estimate--;
+            window[b_size] = (limb_t) (window[b_size] - subtrahend + _limbs_add(window, window, b_size, v, b_size));
+        } else {
+            window[b_size] -= (limb_t) subtrahend;
+        }
+        quotient[j - 1] = (limb_t) estimate;
+    }
+
+    _limbs_divide_small(remainder, u, b_size, factor);
+    _limb_release(u, u_capacity);
+    _limb_release(v, v_capacity);
+}
+
+/**
+ * Reciproco approssimato di Newton (Brent e Zimmermann, Modern Computer Arithmetic, alg. 3.5).
+ *
+ * Con a di n cifre e BIGNUM_BASE^n / 2 <= a < BIGNUM_BASE^n, calcola x tale che
+ * a x < BIGNUM_BASE^2n <= a (x + 2), raddoppiando la precisione a ogni livello.
+ */
+void _approximate_reciprocal(struct bignum *reciprocal, const struct bignum *a) {
+    size_t n = a->size;
+
+    if (n < BIGNUM_NEWTON_THRESHOLD || n <= 2) {
+        // Caso base: (BIGNUM_BASE^2n - 1) / a con la divisione scolastica
+        size_t numerator_capacity, remainder_capacity;
+        limb_t *numerator = _limb_alloc(2 * n, &numerator_capacity);
+        limb_t *remainder = _limb_alloc(n, &remainder_capacity);
+        for (size_t i = 0; i < 2 * n; i++)
+            numerator[i] = BIGNUM_BASE - 1;
+
+        _bignum_reserve(reciprocal, n + 1);
+        if (n == 1) {
+            reciprocal->limbs[n] = 0;
+            _limbs_divide_small(reciprocal->limbs, numerator, 2, a->limbs[0]);
+        } else {
+            _divide_schoolbook(reciprocal->limbs, remainder, numerator, 2 * n, a->limbs, n);
+        }
+        reciprocal->size = n + 1;
+        reciprocal->negative = 0;
+        _bignum_normalize(reciprocal);
+
+        _limb_release(numerator, numerator_capacity);
+        _limb_release(remainder, remainder_capacity);
+        return;
+    }
+
+    size_t low = (n - 1) / 2, high = n - low;
+    struct bignum a_high, t, power;
+    bignum_init(&a_high);
+    bignum_init(&t);
+    bignum_init(&power);
+
+    // Reciproco delle cifre più significative, a metà precisione
+    _bignum_shift_limbs(&a_high, a, -(long) low);
+    _approximate_reciprocal(reciprocal, &a_high);
+
+    // t = a x_h, corretto finché non è sotto BIGNUM_BASE^(n + high)
+    bignum_multiply(&t, a, reciprocal);
+    struct bignum one;
+    bignum_init(&one);
+    _bignum_set_limbs(&one, (const limb_t[]) {1}, 1);
+    while (t.size > n + high) {
+        bignum_subtract(reciprocal, reciprocal, &one);
+        bignum_subtract(&t, &t, a);
+    }
+
+    // Passo di Newton: x = x_h BASE^low + x_h (BASE^(n + high) - t) / BASE^(2 high)
+    _bignum_shift_limbs(&power, &one, (long) (n + high));
+    bignum_subtract(&t, &power, &t);
+    _bignum_shift_limbs(&t, &t, -(long) low);
+    bignum_multiply(&t, &t, reciprocal);
+    _bignum_shift_limbs(&t, &t, -(long) (2 * high - low));
+    _bignum_shift_limbs(reciprocal, reciprocal, (long) low);
+    bignum_add(reciprocal, reciprocal, &t);
+
+    bignum_free(&a_high);
+    bignum_free(&t);
+    bignum_free(&power);
+    bignum_free(&one);
+}
+
+/**
+ * Divisione di valori assoluti col reciproco di Newton: il dividendo viene diviso
+ * in blocchi lunghi quanto il divisore, e ogni blocco si divide con una riduzione di Barrett.
+ *
+ * @param quotient Dove scrivere il quoziente
+ * @param remainder Dove scrivere il resto
+ * @param a Dividendo, non negativo
+ * @param b Divisore, non negativo con almeno 2 cifre
+ */
+void _divide_newton(struct bignum *quotient, struct bignum *remainder, const struct bignum *a,
+                    const struct bignum *b) {
+    // Normalizza come per la divisione scolastica; il quoziente non cambia
+    limb_t factor = BIGNUM_BASE / (b->limbs[b->size - 1] + 1);
+    struct bignum u, v, reciprocal, partial, t, product;
+    bignum_init(&u);
+    bignum_init(&v);
+    bignum_init(&reciprocal);
+    bignum_init(&partial);
+    bignum_init(&t);
+    bignum_init(&product);
+
+    _bignum_reserve(&u, a->size + 1);
+    u.limbs[a->size] = _limbs_multiply_small(u.limbs, a->limbs, a->size, factor);
+    u.size = a->size + 1;
+    _bignum_normalize(&u);
+    _bignum_reserve(&v, b->size);
+    _limbs_multiply_small(v.limbs, b->limbs, b->size, factor);
+    v.size = b->size;
+
+    size_t n = v.size, blocks = (u.size + n - 1) / n;
+    _approximate_reciprocal(&reciprocal, &v);
+
+    struct bignum result;
+    bignum_init(&result);
+    _bignum_reserve(&result, blocks * n);
+    memset(result.limbs, 0, blocks * n * sizeof(limb_t));
+    result.size = blocks * n;
+
+    for (size_t block = blocks; block > 0; block--) {
+        // t = resto parziale * BASE^n + blocco, minore di v BASE^n
+        size_t first = (block - 1) * n;
+        size_t block_size = u.size - first < n ? u.size - first : n;
+        _bignum_reserve(&t, n + partial.size);
+        memset(t.limbs, 0, n * sizeof(limb_t));
+        memcpy(t.limbs, u.limbs + first, block_size * sizeof(limb_t));
+        if (partial.size > 0)
+            memcpy(t.limbs + n, partial.limbs, partial.size * sizeof(limb_t));
+        t.size = n + partial.size;
+        t.negative = 0;
+        _bignum_normalize(&t);
+
+        // Stima per difetto del quoziente del blocco, poi correzione
+        _bignum_shift_limbs(&product, &t, -(long) (n - 1));
+        bignum_multiply(&product, &product, &reciprocal);
+        _bignum_shift_limbs(&product, &product, -(long) (n + 1));
+        if (product.size > 0)
+            memcpy(result.limbs + first, product.limbs, product.size * sizeof(limb_t));
+
+        bignum_multiply(&product, &product, &v);
+        bignum_subtract(&partial, &t, &product);
+        while (bignum_compare(&partial, &v) >= 0) {
+            bignum_subtract(&partial, &partial, &v);
+            // Incrementa il quoziente del blocco, propagando il riporto
+            for (size_t i = first; ++result.limbs[i] == BIGNUM_BASE; i++)
+                result.limbs[i] = 0;
+        }
+    }
+
+    _bignum_normalize(&result);
+    _bignum_move(quotient, &result);
+
+    _bignum_reserve(remainder, partial.size > 0 ? partial.size : 1);
+    _limbs_divide_small(remainder->limbs, partial.limbs, partial.size, factor);
+    remainder->size = partial.size;
+    remainder->negative = 0;
+    _bignum_normalize(remainder);
+
+    bignum_free(&u);
+    bignum_free(&v);
+    bignum_free(&reciprocal);
+    bignum_free(&partial);
+    bignum_free(&t);
+    bignum_free(&product);
+}
+
+/**
+ * Divisione con un algoritmo specifico: BIGNUM_SCHOOLBOOK o BIGNUM_NEWTON
+ */
+int bignum_divide_with(struct bignum *quotient, struct bignum *remainder, const struct bignum *a,
+                       const struct bignum *b, enum bignum_algorithm algorithm) {
+    if (b->size == 0)
+        return -1;
+
+    struct bignum q, r;
+    bignum_init(&q);
+    bignum_init(&r);
+
+    if (_limbs_compare(a->limbs, a->size, b->limbs, b->size) < 0) {
+        // |a| < |b|: quoziente zero, resto a
+        _bignum_set_limbs(&r, a->limbs, a->size);
+    } else if (b->size == 1) {
+        _bignum_reserve(&q, a->size);
+        _bignum_reserve(&r, 1);
+        r.limbs[0] = _limbs_divide_small(q.limbs, a->limbs, a->size, b->limbs[0]);
+        q.size = a->size;
+        r.size = 1;
+    } else {
+        if (algorithm != BIGNUM_SCHOOLBOOK && algorithm != BIGNUM_NEWTON)
+            algorithm = b->size < BIGNUM_NEWTON_THRESHOLD ? BIGNUM_SCHOOLBOOK : BIGNUM_NEWTON;
+
+        if (algorithm == BIGNUM_SCHOOLBOOK) {
+            _bignum_reserve(&q, a->size - b->size + 1);
+            _bignum_reserve(&r, b->size);
+            _divide_schoolbook(q.limbs, r.limbs, a->limbs, a->size, b->limbs, b->size);
+            q.size = a->size - b->size + 1;
+            r.size = b->size;
+        } else {
+            struct bignum a_magnitude = *a, b_magnitude = *b;
+            a_magnitude.negative = b_magnitude.negative = 0;
+            _divide_newton(&q, &r, &a_magnitude, &b_magnitude);
+        }
+    }
+
+    // Troncamento verso lo zero: il resto ha il segno del dividendo
+    q.negative = a->negative != b->negative;
+    r.negative = a->negative;
+    _bignum_normalize(&q);
+    _bignum_normalize(&r);
+
+    if (quotient != NULL)
+        _bignum_move(quotient, &q);
+    if (remainder != NULL)
+        _bignum_move(remainder, &r);
+    bignum_free(&q);
+    bignum_free(&r);
+    return 0;
+}
+
+/**
+ * Divisione troncata verso lo zero, come in C: a = quotient * b + remainder.
+ *
+ * @param quotient Dove scrivere il quoziente, può essere NULL
+ * @param remainder Dove scrivere il resto, col segno di a, può essere NULL
+ * @return -1 se b è zero, 0 altrimenti
+ */
+int bignum_divide(struct bignum *quotient, struct bignum *remainder, const struct bignum *a,
+                  const struct bignum *b) {
+    return bignum_divide_with(quotient, remainder, a, b, BIGNUM_AUTO);
+}
+
+/**
+ * Leggi un intero decimale con segno opzionale
+ *
+ * @param number Dove scrivere il numero
+ * @param text Cifre decimali, con eventuale segno iniziale
+ * @param text_len Lunghezza del testo
+ * @return -1 se il testo non è un intero, 0 altrimenti
+ */
+int bignum_from_string(struct bignum *number, const char *text, size_t text_len) {
+    int negative = 0;
+    if (text_len > 0 && (text[0] == '-' || text[0] == '+')) {
+        negative = text[0] == '-';
+        text++;
+        text_len--;
+    }
+    if (text_len == 0)
+        return -1;
+    for (size_t i = 0; i < text_len; i++) {
+        if (text[i] < '0' || text[i] > '9')
+            return -1;
+    }
+
+    // Gruppi di BIGNUM_BASE_DIGITS cifre, partendo dalle meno significative
+    size_t limbs = (text_len + BIGNUM_BASE_DIGITS - 1) / BIGNUM_BASE_DIGITS;
+    _bignum_reserve(number, limbs);
+    for (size_t limb = 0; limb < limbs; limb++) {
+        size_t end = text_len - limb * BIGNUM_BASE_DIGITS;
+        size_t start = end > BIGNUM_BASE_DIGITS ? end - BIGNUM_BASE_DIGITS : 0;
+        limb_t value = 0;
+        for (size_t i = start; i < end; i++)
+            value = value * 10 + (text[i] - '0');
+        number->limbs[limb] = value;
+    }
+    number->size = limbs;
+    number->negative = negative;
+    _bignum_normalize(number);
+    return 0;
+}
+
+/**
+ * Numero di cifre decimali del valore assoluto, 1 per lo zero
+ */
+size_t bignum_digits(const struct bignum *number) {
+    if (number->size == 0)
+        return 1;
+    size_t digits = (number->size - 1) * BIGNUM_BASE_DIGITS;
+    for (limb_t top = number->limbs[number->size - 1]; top > 0; top /= 10)
+        digits++;
+    return digits;
+}
+
+/**
+ * Scrivi il numero in decimale
+ *
+ * @param number Numero da scrivere
+ * @param scale Cifre dopo la virgola: il numero vale number * 10^-scale
+ * @return Stringa da liberare con free()
+ */
+char *bignum_to_string(const struct bignum *number, size_t scale) {
+    size_t digits = bignum_digits(number);
+    char *text = malloc(digits + scale + 3);
+    char *cursor = text;
+
+    if (number->negative)
+        *cursor++ = '-';
+
+    // Cifre del valore assoluto
+    char *magnitude = malloc(digits + 1);
+    if (number->size == 0) {
+        strcpy(magnitude, "0");
+    } else {
+        size_t length = sprintf(magnitude, "%u", number->limbs[number->size - 1]);
+        for (size_t i = number->size - 1; i > 0; i--)
+            length += sprintf(magnitude + length, "%09u", number->limbs[i - 1]);
+    }
+
+    if (scale == 0) {
+        memcpy(cursor, magnitude, digits);
+        cursor += digits;
+    } else if (digits > scale) {
+        memcpy(cursor, magnitude, digits - scale);
+        cursor += digits - scale;
+        *cursor++ = '.';
+        memcpy(cursor, magnitude + digits - scale, scale);
+        cursor += scale;
+    } else {
+        // Solo parte decimale, preceduta da zeri
+        *cursor++ = '0';
+        *cursor++ = '.';
+        memset(cursor, '0', scale - digits);
+        cursor += scale - digits;
+        memcpy(cursor, magnitude, digits);
+        cursor += digits;
+    }
+    *cursor = '\0';
+
+    free(magnitude);
+    return text;
+}
@@ -0,0 +1,185 @@
+#ifndef HW2_BIGNUM_H
+#define HW2_BIGNUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Cifra di un numero a precisione arbitraria, in base BIGNUM_BASE
+ */
+typedef uint32_t limb_t;
+
+/**
+ * Base delle cifre: una potenza di 10, così la conversione da e verso
+ * stringhe decimali è lineare e le cifre decimali si spostano a blocchi
+ */
+#define BIGNUM_BASE 1000000000u
+
+/**
+ * Cifre decimali contenute in una cifra in base BIGNUM_BASE
+ */
+#define BIGNUM_BASE_DIGITS 9
+
+/**
+ * Sotto questo numero di cifre (in base BIGNUM_BASE) la moltiplicazione è quella scolastica,
+ * misurato con `bench.out bignum`
+ */
+#define BIGNUM_KARATSUBA_THRESHOLD 48
+
+/**
+ * Da questo numero di cifre dell'operando più corto si moltiplica con la NTT
+ */
+#define BIGNUM_NTT_THRESHOLD 5500
+
+/**
+ * Da questo numero di cifre del divisore si divide col reciproco di Newton
+ */
+#define BIGNUM_NEWTON_THRESHOLD 600
+
+/**
+ * Numero massimo di cifre del prodotto calcolato con la NTT,
+ * limitato dalla lunghezza massima della trasformata modulo 998244353
+ */
+#define BIGNUM_NTT_MAX_LIMBS (1 << 23)
+
+/**
+ * Numero massimo di cifre decimali di un risultato, per non esaurire la memoria
+ */
+#define BIGNUM_MAX_DIGITS 10000000
+
+/**
+ * Blocchi liberi tenuti da parte per ogni classe di dimensione del pool
+ */
+#define LIMB_POOL_CACHED_BLOCKS 16
+
+/**
+ * Intero con segno a precisione arbitraria.
+ * Le cifre sono little endian, e la più significativa non è mai zero.
+ */
+struct bignum {
+    limb_t *limbs;
+
+    /**
+     * Cifre usate, 0 se il numero è zero
+     */
+    size_t size;
+
+    /**
+     * Cifre allocate dal pool
+     */
+    size_t capacity;
+
+    int negative;
+};
+
+/**
+ * Algoritmo da usare, per confrontarli nei benchmark.
+ * Con BIGNUM_AUTO viene scelto in base alle soglie.
+ */
+enum bignum_algorithm {
+    BIGNUM_AUTO,
+    BIGNUM_SCHOOLBOOK,
+    BIGNUM_KARATSUBA,
+    BIGNUM_NTT,
+    BIGNUM_NEWTON
+};
+
+/**
+ * Inizializza un numero a zero, senza allocare memoria
+ *
+ * @param number Numero da inizializzare
+ */
+void bignum_init(struct bignum *number);
+
+/**
+ * Restituisci al pool la memoria di un numero, che torna a zero
+ *
+ * @param number Numero da liberare
+ */
+void bignum_free(struct bignum *number);
+
+/**
+ * Leggi un intero decimale con segno opzionale
+ *
+ * @param number Dove scrivere il numero
+ * @param text Cifre decimali, con eventuale segno iniziale
+ * @param text_len Lunghezza del testo
+ * @return -1 se il testo non è un intero, 0 altrimenti
+ */
+int bignum_from_string(struct bignum *number, const char *text, size_t text_len);
+
+/**
+ * Scrivi il numero in decimale
+ *
+ * @param number Numero da scrivere
+ * @param scale Cifre dopo la virgola: il numero vale number * 10^-scale
+ * @return Stringa da liberare con free()
+ */
+char *bignum_to_string(const struct bignum *number, size_t scale);
+
+/**
+ * Numero di cifre decimali del valore assoluto, 1 per lo zero
+ */
+size_t bignum_digits(const struct bignum *number);
+
+/**
+ * Confronta due numeri
+ *
+ * @return Negativo, zero o positivo se a è minore, uguale o maggiore di b
+ */
+int bignum_compare(const struct bignum *a, const struct bignum *b);
+
+/**
+ * result = a + b. result può coincidere con a o b.
+ */
+void bignum_add(struct bignum *result, const struct bignum *a, const struct bignum *b);
+
+/**
+ * result = a - b. result può coincidere con a o b.
+ */
+void bignum_subtract(struct bignum *result, const struct bignum *a, const struct bignum *b);
+
+/**
+ * result = a * b, con l'algoritmo scelto dalle soglie. result può coincidere con a o b.
+ */
+void bignum_multiply(struct bignum *result, const struct bignum *a, const struct bignum *b);
+
+/**
+ * result = a * b con un algoritmo specifico.
+ * La NTT ricade su Karatsuba oltre BIGNUM_NTT_MAX_LIMBS.
+ */
+void bignum_multiply_with(struct bignum *result, const struct bignum *a, const struct bignum *b,
+                          enum bignum_algorithm algorithm);
+
+/**
+ * result = a * 10^digits
+ */
+void bignum_shift_decimal(struct bignum *result, const struct bignum *a, size_t digits);
+
+/**
+ * result = a^exponent, per quadrati successivi
+ */
+void bignum_power(struct bignum *result, const struct bignum *a, uint64_t exponent);
+
+/**
+ * Divisione troncata verso lo zero, come in C: a = quotient * b + remainder.
+ *
+ * @param quotient Dove scrivere il quoziente, può essere NULL
+ * @param remainder Dove scrivere il resto, col segno di a, può essere NULL
+ * @return -1 se b è zero, 0 altrimenti
+ */
+int bignum_divide(struct bignum *quotient, struct bignum *remainder, const struct bignum *a,
+                  const struct bignum *b);
+
+/**
+ * Divisione con un algoritmo specifico: BIGNUM_SCHOOLBOOK o BIGNUM_NEWTON
+ */
+int bignum_divide_with(struct bignum *quotient, struct bignum *remainder, const struct bignum *a,
+                       const struct bignum *b, enum bignum_algorithm algorithm);
+
+/**
+ * Libera tutti i blocchi tenuti da parte dal pool
+ */
+void clear_limb_pool();
+
+#endif //HW2_BIGNUM_H
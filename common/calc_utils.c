@@ -1,4 +1,6 @@
 #include "calc_utils.h"
+#include "math_kernels.h"
+#include "typed_kernels.h"
 #include <errno.h>
 
 /**
@@ -58,8 +60,28 @@ double calculate_operation(operand_t left, char operator, operand_t right) {
             return left * right;
         case '/':
             return left / right;
+        case '^':
+            return calculate_function(MATH_POW, MATH_MODE_EXACT, left, right);
         default:
             errno = EINVAL;
             return 0;
     }
 }
+
+/**
+ * Elabora lo stesso operatore elemento per elemento su due vettori di operandi,
+ * con istruzioni SIMD per le operazioni che lo permettono.
+ *
+ * Imposta errno in caso di errore.
+ *
+ * @param left Operandi di sinistra
+ * @param operator Operatore, come per calculate_operation()
+ * @param right Operandi di destra
+ * @param results Dove scrivere i risultati, può coincidere con uno degli operandi
+ * @param count Numero di elementi
+ * @return -1 se l'operatore è sconosciuto, 0 altrimenti
+ */
+int calculate_operation_block(const operand_t *left, char operator, const operand_t *right, operand_t *results,
+                              size_t count) {
+    return calculate_typed_block(OPERAND_TYPE_F64, left, operator, right, results, count);
+}
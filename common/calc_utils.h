@@ -20,6 +20,22 @@ typedef double operand_t;
  */
 double calculate_operation(operand_t left, char operator, operand_t right);
 
+/**
+ * Elabora lo stesso operatore elemento per elemento su due vettori di operandi,
+ * con istruzioni SIMD per le operazioni che lo permettono.
+ *
+ * Imposta errno in caso di errore.
+ *
+ * @param left Operandi di sinistra
+ * @param operator Operatore, come per calculate_operation()
+ * @param right Operandi di destra
+ * @param results Dove scrivere i risultati, può coincidere con uno degli operandi
+ * @param count Numero di elementi
+ * @return -1 se l'operatore è sconosciuto, 0 altrimenti
+ */
+int calculate_operation_block(const operand_t *left, char operator, const operand_t *right, operand_t *results,
+                              size_t count);
+
 /**
  * Trova il numero minimo dall'array, non vuoto
  * @param data Array in cui trovare il minimo
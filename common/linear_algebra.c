@@ -0,0 +1,314 @@
+#include "linear_algebra.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Vettore con lo stesso valore in ogni lane
+ */
+static inline vdouble _vsplat(double value) {
+    return (vdouble) {} + value;
+}
+
+/**
+ * Valore assoluto di ogni lane, azzerando il bit del segno
+ */
+static inline vdouble _vabs(vdouble x) {
+    return (vdouble) ((vint) x & ((vint) {} + INT64_MAX));
+}
+
+/**
+ * Massimo lane per lane
+ */
+static inline vdouble _vmax(vdouble x, vdouble y) {
+    vint greater = x > y;
+    return (vdouble) ((greater & (vint) x) | (~greater & (vint) y));
+}
+
+/**
+ * Somma delle lane di un vettore
+ */
+static inline double _vsum(vdouble x) {
+    double sum = 0;
+    for (int lane = 0; lane < MATH_VECTOR_WIDTH; lane++)
+        sum += x[lane];
+    return sum;
+}
+
+/**
+ * y += alpha x, su count elementi
+ */
+static inline void _axpy(operand_t *y, double alpha, const operand_t *x, size_t count) {
+    vdouble alphas = _vsplat(alpha);
+    size_t i = 0;
+    for (; i + MATH_VECTOR_WIDTH <= count; i += MATH_VECTOR_WIDTH) {
+        vdouble xs, ys;
+        memcpy(&xs, x + i, sizeof(vdouble));
+        memcpy(&ys, y + i, sizeof(vdouble));
+        ys += alphas * xs;
+        memcpy(y + i, &ys, sizeof(vdouble));
+    }
+    for (; i < count; i++)
+        y[i] += alpha * x[i];
+}
+
+/**
+ * Prodotto scalare tra due vettori
+ */
+operand_t vector_dot(const operand_t *a, const operand_t *b, size_t count) {
+    // Due accumulatori, per non attendere la latenza di ogni somma
+    vdouble sum_even = {}, sum_odd = {};
+    size_t i = 0;
+    for (; i + 2 * MATH_VECTOR_WIDTH <= count; i += 2 * MATH_VECTOR_WIDTH) {
+        vdouble a_even, b_even, a_odd, b_odd;
+        memcpy(&a_even, a + i, sizeof(vdouble));
+        memcpy(&b_even, b + i, sizeof(vdouble));
+        memcpy(&a_odd, a + i + MATH_VECTOR_WIDTH, sizeof(vdouble));
+        memcpy(&b_odd, b + i + MATH_VECTOR_WIDTH, sizeof(vdouble));
+        sum_even += a_even * b_even;
+        sum_odd += a_odd * b_odd;
+    }
+
+    double sum = _vsum(sum_even + sum_odd);
+    for (; i < count; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+/**
+ * Norma di un vettore. La norma 2 è scalata per la norma infinito, quindi non va in overflow.
+ */
+operand_t vector_norm(const operand_t *values, size_t count, enum vector_norm norm) {
+    if (norm == VECTOR_NORM_2) {
+        double scale = vector_norm(values, count, VECTOR_NORM_INF);
+        if (scale == 0 || !isfinite(scale))
+            return scale;
+
+        vdouble sum = {}, inverse_scale = _vsplat(1 / scale);
+        size_t i = 0;
+        for (; i + MATH_VECTOR_WIDTH <= count; i += MATH_VECTOR_WIDTH) {
+            vdouble x;
+            memcpy(&x, values + i, sizeof(vdouble));
+            x *= inverse_scale;
+            sum += x * x;
+        }
+        double squares = _vsum(sum);
+        for (; i < count; i++)
+            squares += (values[i] / scale) * (values[i] / scale);
+        return scale * sqrt(squares);
+    }
+
+    vdouble accumulator = {};
+    size_t i = 0;
+    for (; i + MATH_VECTOR_WIDTH <= count; i += MATH_VECTOR_WIDTH) {
+        vdouble x;
+        memcpy(&x, values + i, sizeof(vdouble));
+        x = _vabs(x);
+        if (norm == VECTOR_NORM_1)
+            accumulator += x;
+        else
+            accumulator = _vmax(x, accumulator);
+    }
+
+    double result = norm == VECTOR_NORM_1 ? _vsum(accumulator) : 0;
+    for (int lane = 0; norm == VECTOR_NORM_INF && lane < MATH_VECTOR_WIDTH; lane++)
+        result = fmax(result, accumulator[lane]);
+    for (; i < count; i++)
+        result = norm == VECTOR_NORM_1 ? result + fabs(values[i]) : fmax(result, fabs(values[i]));
+    return result;
+}
+
+/**
+ * Copia un blocco di A in pannelli di MATRIX_MICRO_ROWS righe, colonna per colonna,
+ * nell'ordine in cui li legge il micro-kernel. Le righe mancanti dell'ultimo pannello sono zero.
+ *
+ * @param a Primo elemento del blocco
+ * @param stride Distanza tra le righe di A
+ * @param rows Righe del blocco
+ * @param depth Colonne del blocco
+ * @param packed Dove scrivere il blocco
+ */
+void _pack_a(const operand_t *a, size_t stride, size_t rows, size_t depth, operand_t *packed) {
+    for (size_t panel = 0; panel < rows; panel += MATRIX_MICRO_ROWS) {
+        for (size_t p = 0; p < depth; p++) {
+            for (size_t r = 0; r < MATRIX_MICRO_ROWS; r++)
+                *packed++ = panel + r < rows ? a[(panel + r) * stride + p] : 0;
+        }
+    }
+}
+
+/**
+ * Copia un blocco di B in pannelli di MATRIX_MICRO_COLS colonne, riga per riga.
+ * Le colonne mancanti dell'ultimo pannello sono zero.
+ *
+ * @param b Primo elemento del blocco
+ * @param stride Distanza tra le righe di B
+ * @param depth Righe del blocco
+ * @param cols Colonne del blocco
+ * @param packed Dove scrivere il blocco
+ */
+void _pack_b(const operand_t *b, size_t stride, size_t depth, size_t cols, operand_t *packed) {
+    for (size_t panel = 0; panel < cols; panel += MATRIX_MICRO_COLS) {
+        size_t panel_cols = cols - panel < MATRIX_MICRO_COLS ? cols - panel : MATRIX_MICRO_COLS;
+        for (size_t p = 0; p < depth; p++) {
+            memcpy(packed, b + p * stride + panel, panel_cols * sizeof(operand_t));
+            memset(packed + panel_cols, 0, (MATRIX_MICRO_COLS - panel_cols) * sizeof(operand_t));
+            packed += MATRIX_MICRO_COLS;
+        }
+    }
+}
+
+/**
+ * Aggiungi a un blocco MATRIX_MICRO_ROWS x MATRIX_MICRO_COLS di C il prodotto di due pannelli,
+ * tenendo tutte le somme nei registri.
+ *
+ * @param depth Lunghezza dei pannelli
+ * @param a Pannello di A
+ * @param b Pannello di B
+ * @param c Primo elemento del blocco di C
+ * @param stride Distanza tra le righe di C
+ * @param rows Righe di C da aggiornare, per l'ultimo pannello
+ * @param cols Colonne di C da aggiornare, per l'ultimo pannello
+ */
+static inline void _micro_kernel(size_t depth, const operand_t *a, const operand_t *b, operand_t *c, size_t stride,
+                                 size_t rows, size_t cols) {
+    vdouble sums[MATRIX_MICRO_ROWS][2] = {};
+
+    for (size_t p = 0; p < depth; p++) {
+        vdouble b_low, b_high;
+        memcpy(&b_low, b + p * MATRIX_MICRO_COLS, sizeof(vdouble));
+        memcpy(&b_high, b + p * MATRIX_MICRO_COLS + MATH_VECTOR_WIDTH, sizeof(vdouble));
+        for (int r = 0; r < MATRIX_MICRO_ROWS; r++) {
+            vdouble a_value = _vsplat(a[p * MATRIX_MICRO_ROWS + r]);
+            sums[r][0] += a_value * b_low;
+            sums[r][1] += a_value * b_high;
+        }
+    }
+
+    if (rows == MATRIX_MICRO_ROWS && cols == MATRIX_MICRO_COLS) {
+        for (int r = 0; r < MATRIX_MICRO_ROWS; r++) {
+            vdouble c_low, c_high;
+            memcpy(&c_low, c + r * stride, sizeof(vdouble));
+            memcpy(&c_high, c + r * stride + MATH_VECTOR_WIDTH, sizeof(vdouble));
+            c_low += sums[r][0];
+            c_high += sums[r][1];
+            memcpy(c + r * stride, &c_low, sizeof(vdouble));
+            memcpy(c + r * stride + MATH_VECTOR_WIDTH, &c_high, sizeof(vdouble));
+        }
+        return;
+    }
+
+    for (size_t r = 0; r < rows; r++) {
+        for (size_t col = 0; col < cols; col++)
+            c[r * stride + col] += sums[r][col / MATH_VECTOR_WIDTH][col % MATH_VECTOR_WIDTH];
+    }
+}
+
+/**
+ * Calcola le righe [row_begin, row_end) di C = A B, con matrici in ordine per righe.
+ * Parti diverse di C possono essere calcolate in parallelo.
+ *
+ * @param a Matrice A, righe x depth
+ * @param b Matrice B, depth x cols
+ * @param c Matrice C, righe x cols: vengono scritte solo le righe indicate
+ * @param depth Colonne di A e righe di B
+ * @param cols Colonne di B e di C
+ * @param row_begin Prima riga da calcolare
+ * @param row_end Riga successiva all'ultima
+ */
+void matrix_multiply_rows(const operand_t *a, const operand_t *b, operand_t *c, size_t depth, size_t cols,
+                          size_t row_begin, size_t row_end) {
+    memset(c + row_begin * cols, 0, (row_end - row_begin) * cols * sizeof(operand_t));
+    if (depth == 0)
+        return;
+
+    // I pannelli sono riempiti interamente, quindi servono dimensioni arrotondate ai multipli del micro-kernel
+    operand_t *packed_a = aligned_alloc(64, MATRIX_BLOCK_ROWS * MATRIX_BLOCK_DEPTH * sizeof(operand_t));
+    operand_t *packed_b = aligned_alloc(64, MATRIX_BLOCK_DEPTH * MATRIX_BLOCK_COLS * sizeof(operand_t));
+
+    for (size_t col_block = 0; col_block < cols; col_block += MATRIX_BLOCK_COLS) {
+        size_t block_cols = cols - col_block < MATRIX_BLOCK_COLS ? cols - col_block : MATRIX_BLOCK_COLS;
+
+        for (size_t depth_block = 0; depth_block < depth; depth_block += MATRIX_BLOCK_DEPTH) {
+            size_t block_depth = depth - depth_block < MATRIX_BLOCK_DEPTH ? depth - depth_block : MATRIX_BLOCK_DEPTH;
+            _pack_b(b + depth_block * cols + col_block, cols, block_depth, block_cols, packed_b);
+
+            for (size_t row_block = row_begin; row_block < row_end; row_block += MATRIX_BLOCK_ROWS) {
+                size_t block_rows = row_end - row_block < MATRIX_BLOCK_ROWS ? row_end - row_block : MATRIX_BLOCK_ROWS;
+                _pack_a(a + row_block * depth + depth_block, depth, block_rows, block_depth, packed_a);
+
+                for (size_t col = 0; col < block_cols; col += MATRIX_MICRO_COLS) {
+                    for (size_t row = 0; row < block_rows; row += MATRIX_MICRO_ROWS) {
+                        size_t rows = block_rows - row < MATRIX_MICRO_ROWS ? block_rows - row : MATRIX_MICRO_ROWS;
+                        size_t micro_cols = block_cols - col < MATRIX_MICRO_COLS ? block_cols - col
+                                                                                 : MATRIX_MICRO_COLS;
+                        _micro_kernel(block_depth, packed_a + row * block_depth, packed_b + col * block_depth,
+                                      c + (row_block + row) * cols + col_block + col, cols, rows, micro_cols);
+                    }
+                }
+            }
+        }
+    }
+
+    free(packed_a);
+    free(packed_b);
+}
+
+/**
+ * Scambia due righe di una matrice
+ */
+void _swap_rows(operand_t *matrix, size_t cols, size_t first, size_t second) {
+    for (size_t col = 0; col < cols; col++) {
+        operand_t value = matrix[first * cols + col];
+        matrix[first * cols + col] = matrix[second * cols + col];
+        matrix[second * cols + col] = value;
+    }
+}
+
+/**
+ * Risolvi il sistema A X = B con l'eliminazione di Gauss a pivot parziale.
+ *
+ * @param a Matrice A, size x size, che viene sovrascritta
+ * @param b Termini noti, size x rhs_count, sovrascritti con la soluzione X
+ * @param size Ordine della matrice
+ * @param rhs_count Colonne dei termini noti
+ * @return -1 se la matrice è singolare (anche solo numericamente), 0 altrimenti
+ */
+int matrix_solve(operand_t *a, operand_t *b, size_t size, size_t rhs_count) {
+    // Un pivot più piccolo di così è solo errore di arrotondamento
+    double tolerance = vector_norm(a, size * size, VECTOR_NORM_INF) * (double) size * DBL_EPSILON;
+
+    for (size_t col = 0; col < size; col++) {
+        size_t pivot = col;
+        for (size_t row = col + 1; row < size; row++) {
+            if (fabs(a[row * size + col]) > fabs(a[pivot * size + col]))
+                pivot = row;
+        }
+        if (!(fabs(a[pivot * size + col]) > tolerance))
+            return -1;
+        if (pivot != col) {
+            _swap_rows(a, size, pivot, col);
+            _swap_rows(b, rhs_count, pivot, col);
+        }
+
+        // Elimina la colonna dalle righe sotto, a vettori sulla parte destra della riga
+        for (size_t row = col + 1; row < size; row++) {
+            double factor = a[row * size + col] / a[col * size + col];
+            if (factor == 0)
+                continue;
+            _axpy(a + row * size + col, -factor, a + col * size + col, size - col);
+            _axpy(b + row * rhs_count, -factor, b + col * rhs_count, rhs_count);
+        }
+    }
+
+    // Sostituzione all'indietro, una riga di X alla volta
+    for (size_t row = size; row-- > 0;) {
+        for (size_t col = row + 1; col < size; col++)
+            _axpy(b + row * rhs_count, -a[row * size + col], b + col * rhs_count, rhs_count);
+        double inverse_pivot = 1 / a[row * size + row];
+        for (size_t rhs = 0; rhs < rhs_count; rhs++)
+            b[row * rhs_count + rhs] *= inverse_pivot;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef HW2_LINEAR_ALGEBRA_H
+#define HW2_LINEAR_ALGEBRA_H
+
+#include "math_kernels.h"
+#include <stddef.h>
+
+/**
+ * Righe e colonne del blocco di C calcolato interamente nei registri dal micro-kernel
+ */
+#define MATRIX_MICRO_ROWS 4
+#define MATRIX_MICRO_COLS (2 * MATH_VECTOR_WIDTH)
+
+/**
+ * Dimensioni dei blocchi del prodotto tra matrici, in elementi:
+ * un blocco di A (righe x profondità) resta nella cache L2,
+ * un blocco di B (profondità x colonne) nella cache L3.
+ */
+#define MATRIX_BLOCK_ROWS 64
+#define MATRIX_BLOCK_DEPTH 256
+#define MATRIX_BLOCK_COLS 1024
+
+/**
+ * Norme di un vettore
+ */
+enum vector_norm {
+    VECTOR_NORM_1,
+    VECTOR_NORM_2,
+    VECTOR_NORM_INF
+};
+
+/**
+ * Prodotto scalare tra due vettori
+ */
+operand_t vector_dot(const operand_t *a, const operand_t *b, size_t count);
+
+/**
+ * Norma di un vettore. La norma 2 è scalata per la norma infinito, quindi non va in overflow.
+ */
+operand_t vector_norm(const operand_t *values, size_t count, enum vector_norm norm);
+
+/**
+ * Calcola le righe [row_begin, row_end) di C = A B, con matrici in ordine per righe.
+ * Parti diverse di C possono essere calcolate in parallelo.
+ *
+ * @param a Matrice A, righe x depth
+ * @param b Matrice B, depth x cols
+ * @param c Matrice C, righe x cols: vengono scritte solo le righe indicate
+ * @param depth Colonne di A e righe di B
+ * @param cols Colonne di B e di C
+ * @param row_begin Prima riga da calcolare
+ * @param row_end Riga successiva all'ultima
+ */
+void matrix_multiply_rows(const operand_t *a, const operand_t *b, operand_t *c, size_t depth, size_t cols,
+                          size_t row_begin, size_t row_end);
+
+/**
+ * Risolvi il sistema A X = B con l'eliminazione di Gauss a pivot parziale.
+ *
+ * @param a Matrice A, size x size, che viene sovrascritta
+ * @param b Termini noti, size x rhs_count, sovrascritti con la soluzione X
+ * @param size Ordine della matrice
+ * @param rhs_count Colonne dei termini noti
+ * @return -1 se la matrice è singolare (anche solo numericamente), 0 altrimenti
+ */
+int matrix_solve(operand_t *a, operand_t *b, size_t size, size_t rhs_count);
+
+#endif //HW2_LINEAR_ALGEBRA_H
@@ -0,0 +1,51 @@
+#include "log_format.h"
+#include "logger.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Formatta un record binario come una linea del log di testo
+ *
+ * @param record Record, seguito dal suo testo
+ * @param buffer Dove scrivere la linea
+ * @param size Spazio disponibile
+ * @return Lunghezza della linea, troncata se necessario
+ */
+size_t format_log_binary_record(const struct log_binary_record *record, char *buffer, size_t size) {
+    const char *text = (const char *) (record + 1);
+
+    // Stesso prefisso di get_prefix(), ma senza inet_ntoa() che non è rientrante
+    char prefix[LOG_PREFIX_SIZE];
+    if (record->flags & LOG_BINARY_HAS_CLIENT) {
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &record->client_address, ip, sizeof(ip));
+        snprintf(prefix, LOG_PREFIX_SIZE, "[%s:%d] ", ip, ntohs(record->client_port));
+    } else {
+        strcpy(prefix, "[MAIN] ");
+    }
+
+    int length;
+    if (record->type == LOG_BINARY_RESULT) {
+        struct timestamp start_time = {.microseconds = record->start_micros};
+        time_t start_seconds = (time_t) record->start_seconds;
+        localtime_r(&start_seconds, &start_time.time);
+        char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+        timestamp_to_string(&start_time, start_time_str);
+
+        if (record->text_length == 0 && record->operator != '\0') {
+            length = snprintf(buffer, size, "%s%c %.17g %.17g = %lf, da %s per %u us\n", prefix,
+                              record->operator, record->left, record->right, record->result, start_time_str,
+                              record->elapsed_micros);
+        } else {
+            length = snprintf(buffer, size, "%s%.*s = %lf, da %s per %u us\n", prefix,
+                              record->text_length, text, record->result, start_time_str, record->elapsed_micros);
+        }
+    } else {
+        length = snprintf(buffer, size, "%s%.*s", prefix, record->text_length, text);
+    }
+
+    if (length < 0)
+        return 0;
+    return (size_t) length < size ? (size_t) length : size - 1;
+}
@@ -0,0 +1,106 @@
+#ifndef HW2_LOG_FORMAT_H
+#define HW2_LOG_FORMAT_H
+
+#include "calc_utils.h"
+#include <stdint.h>
+
+/**
+ * Formato del file di log del server: 0 per il testo, 1 per i record binari di struct log_binary_record,
+ * da leggere con log_decoder.out
+ */
+#define LOG_FILE_BINARY 0
+
+/**
+ * Estensione del file di log, secondo il formato
+ */
+#define LOG_FILE_EXTENSION (LOG_FILE_BINARY ? ".bin" : ".log")
+
+/**
+ * Valore magico e versione all'inizio di un file di log binario
+ */
+#define LOG_BINARY_MAGIC 0x474f4c43
+#define LOG_BINARY_VERSION 1
+
+/**
+ * Intestazione di un file di log binario, scritta quando il file è vuoto
+ */
+struct log_binary_header {
+    uint32_t magic;
+    uint16_t version;
+
+    /**
+     * Dimensione di struct log_binary_record, per riconoscere un formato incompatibile
+     */
+    uint16_t record_size;
+};
+
+/**
+ * Tipo di un record binario
+ */
+enum log_binary_type {
+    /**
+     * Messaggio di testo
+     */
+    LOG_BINARY_MESSAGE,
+
+    /**
+     * Risultato di un'operazione: operatore e operandi, oppure la linea dell'operazione nel testo
+     */
+    LOG_BINARY_RESULT
+};
+
+/**
+ * Il record ha un client: altrimenti il log è del processo
+ */
+#define LOG_BINARY_HAS_CLIENT 1
+
+/**
+ * Record di un file di log binario, seguito da text_length byte di testo.
+ * I campi sono nell'ordine dei byte della macchina che ha scritto il log.
+ */
+struct log_binary_record {
+    /**
+     * Dimensione totale del record, compreso il testo
+     */
+    uint16_t size;
+    uint16_t text_length;
+    uint8_t type;
+    uint8_t flags;
+
+    /**
+     * Operatore di un risultato, '\0' se l'operazione è nel testo.
+     * Se c'è l'operatore il testo può mancare: l'operazione viene ricostruita dagli operandi.
+     */
+    char operator;
+    uint8_t reserved;
+
+    /**
+     * Indirizzo IPv4 e porta del client, nell'ordine dei byte della rete
+     */
+    uint32_t client_address;
+    uint16_t client_port;
+    uint16_t reserved_port;
+
+    /**
+     * Inizio del calcolo in secondi dall'epoch e microsecondi, e sua durata
+     */
+    int64_t start_seconds;
+    uint32_t start_micros;
+    uint32_t elapsed_micros;
+
+    operand_t left;
+    operand_t right;
+    operand_t result;
+};
+
+/**
+ * Formatta un record binario come una linea del log di testo
+ *
+ * @param record Record, seguito dal suo testo
+ * @param buffer Dove scrivere la linea
+ * @param size Spazio disponibile
+ * @return Lunghezza della linea, troncata se necessario
+ */
+size_t format_log_binary_record(const struct log_binary_record *record, char *buffer, size_t size);
+
+#endif //HW2_LOG_FORMAT_H
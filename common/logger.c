@@ -1,4 +1,5 @@
 #include "logger.h"
+#include "log_format.h"
 #include <arpa/inet.h>
 #include <string.h>
 #include <errno.h>
@@ -15,12 +16,58 @@
 /**
  * Ultimi messaggi di log scritti nel file
  */
-char *logs_array[LOGS_ARRAY_SIZE] = {};
+struct recent_log_slot recent_logs[LOGS_ARRAY_SIZE] = {};
 
 /**
- * Indice da cui iniziare a leggere nel vettore circolare dei log
+ * Prossimo ticket da assegnare a una linea, la cui posizione è ticket % LOGS_ARRAY_SIZE
  */
-int logs_index = 0;
+_Atomic uint64_t recent_logs_next = 0;
+
+void push_recent_log(const char *line, size_t length) {
+    uint64_t ticket = atomic_fetch_add_explicit(&recent_logs_next, 1, memory_order_relaxed);
+    struct recent_log_slot *slot = &recent_logs[ticket % LOGS_ARRAY_SIZE];
+    uint64_t written = 2 * (ticket + 1);
+
+    // Prendi la posizione rendendo dispari la sequenza, se non c'è già una linea più recente
+    uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    do {
+        if (sequence >= written)
+            return;
+        if (sequence & 1) {
+            // Un altro scrittore, un giro indietro, sta ancora copiando
+            sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+            continue;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&slot->sequence, &sequence, written - 1,
+                                                    memory_order_relaxed, memory_order_relaxed));
+    atomic_thread_fence(memory_order_release);
+
+    slot->length = length < RECENT_LOG_LINE_SIZE ? length : RECENT_LOG_LINE_SIZE;
+    memcpy(slot->text, line, slot->length);
+    atomic_store_explicit(&slot->sequence, written, memory_order_release);
+}
+
+size_t read_recent_logs(char *buffer) {
+    uint64_t next = atomic_load_explicit(&recent_logs_next, memory_order_acquire);
+    uint64_t first = next > LOGS_ARRAY_SIZE ? next - LOGS_ARRAY_SIZE : 0;
+    size_t length = 0;
+
+    for (uint64_t ticket = first; ticket < next; ticket++) {
+        const struct recent_log_slot *slot = &recent_logs[ticket % LOGS_ARRAY_SIZE];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence != 2 * (ticket + 1))
+            continue; // Ancora in scrittura, o già sostituita da una più recente
+
+        size_t line_length = slot->length < RECENT_LOG_LINE_SIZE ? slot->length : RECENT_LOG_LINE_SIZE;
+        memcpy(buffer + length, slot->text, line_length);
+        atomic_thread_fence(memory_order_acquire);
+
+        // Se la sequenza è cambiata la copia può essere mista: scartala
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence)
+            length += line_length;
+    }
+    return length;
+}
 
 /**
  * Ottieni il prefisso del messaggio di log,
@@ -57,40 +104,18 @@ void log_errno(const struct sock_info *client_info, const char *error_msg) {
 }
 
 /**
- * Esegui il log di un risultato ottenuto con successo.
- *
- * @param client_info Informazioni sul client che ha provocato l'errore
- * @param operation_line Linea di input dell'operazione effettuata
- * @param result Risultato dell'operazione
- * @param start Tempo di inizio del calcolo
- * @param end Tempo di fine del calcolo
+ * Percorso del file di log scelto da _open_log_file(), vuoto se non è stato aperto
  */
-void log_result(const struct sock_info *client_info,
-                const char *operation_line,
-                operand_t result,
-                const struct timestamp *start_time,
-                const struct timestamp *end_time) {
-    uint64_t start_microseconds = start_time->microseconds;
-    uint64_t end_microseconds = end_time->microseconds;
-    char start_time_str[TIMESTAMP_STRING_SIZE] = {};
-    timestamp_to_string(start_time, start_time_str);
-
-    log_message(client_info,
-                "%s = %lf, da %s per %lu us\n",
-                operation_line,
-                result,
-                start_time_str,
-                end_microseconds - start_microseconds);
-}
+char log_file_path[LOG_FILE_PATH_SIZE] = {};
 
 /**
  * Apri il file di log, se non è ancora stato aperto.
  * Usa la modalità di append.
  *
- * @param filename Nome del file di log di default, senza estensione .log
+ * @param filename Nome del file di log di default, senza estensione LOG_FILE_EXTENSION
  * @param log_counter Indice del nome del file di log effettivamente usato,
  *          provando fino a MAX_LOG_FILES.
- *          Formato del file finale: filename (%d).log
+ *          Formato del file finale: filename (%d).log, o .bin per il formato binario
  * @return File pointer al log
  */
 FILE *_open_log_file(const char *original_filename, unsigned short *log_counter) {
@@ -104,14 +129,19 @@ FILE *_open_log_file(const char *original_filename, unsigned short *log_counter)
 
     // Nome del file di log del numero corrispondente a file_counter
     size_t count_filename_len = strlen(original_filename) + 9;
+    if (count_filename_len > LOG_FILE_PATH_SIZE) {
+        fprintf(stderr, "Nome del file di log troppo lungo\n");
+        return NULL;
+    }
     char count_filename[count_filename_len];
     strcpy(count_filename, original_filename);
-    strcat(count_filename, ".log");
+    strcat(count_filename, LOG_FILE_EXTENSION);
 
     while (log_file == NULL && *log_counter < MAX_LOG_FILES) {
         // Aggiorna il nome del file di log in base al numero del tentativo
         if (*log_counter > 0) {
-            snprintf(count_filename, count_filename_len, "%s (%d).log", original_filename, *log_counter);
+            snprintf(count_filename, count_filename_len, "%s (%d)%s", original_filename, *log_counter,
+                     LOG_FILE_EXTENSION);
         }
 
         log_file = fopen(count_filename, "a");
@@ -138,6 +168,10 @@ FILE *_open_log_file(const char *original_filename, unsigned short *log_counter)
     // Ultima iterazione lo manda oltre il reale numero del tentativo
     (*log_counter)--;
 
+    // Ricorda il nome scelto, per chi scrive nel file
+    if (log_file != NULL)
+        strcpy(log_file_path, count_filename);
+
     return log_file;
 }
 
@@ -167,9 +201,9 @@ int log_new_start(const char *filename) {
 
     // Comunica all'utente su che file di log stiamo scrivendo
     if (log_file_number == 0)
-        log_message(NULL, "File di log usato: %s.log\n", filename);
+        log_message(NULL, "File di log usato: %s%s\n", filename, LOG_FILE_EXTENSION);
     else
-        log_message(NULL, "File di log usato: %s (%d).log\n", filename, log_file_number);
+        log_message(NULL, "File di log usato: %s (%d)%s\n", filename, log_file_number, LOG_FILE_EXTENSION);
 
     return 0;
 }
@@ -184,13 +218,21 @@ FILE *open_log_file() {
     return _open_log_file(NULL, NULL);
 }
 
+/**
+ * Percorso del file di log in uso
+ *
+ * @return Il percorso, o NULL se il file di log non è stato aperto
+ */
+const char *get_log_file_path() {
+    return log_file_path[0] != '\0' ? log_file_path : NULL;
+}
+
 /**
  * Termina tutte le operazioni di log, chiudi il file e libera la memoria
  */
 void close_logging() {
-    // Rimuovi tutti i log in memoria
-    for (int i = 0; i < LOGS_ARRAY_SIZE; i++)
-        free(logs_array[i]);
+    // Scrivi i log ancora in attesa
+    flush_logging();
 
     // Chiudi il file di log e rimuovi il lock
     if (open_log_file() != NULL) {
@@ -13,6 +13,7 @@
 #include "socket_utils.h"
 #include "calc_utils.h"
 #include "timestamp.h"
+#include <stdatomic.h>
 #include <wchar.h>
 
 
@@ -26,20 +27,48 @@
  */
 #define LOG_LINE_MAX_SIZE 500
 
+/**
+ * Dimensione massima del percorso del file di log
+ */
+#define LOG_FILE_PATH_SIZE 256
+
 /**
  * Quanti sono gli ultimi log salvati nel vettore
  */
 #define LOGS_ARRAY_SIZE 8
 
 /**
- * Ultimi messaggi di log scritti nel file
+ * Dimensione massima di una linea formattata tra gli ultimi log, col prefisso e il risultato
  */
-extern char *logs_array[LOGS_ARRAY_SIZE];
+#define RECENT_LOG_LINE_SIZE (2 * LOG_LINE_MAX_SIZE)
 
 /**
- * Indice da cui iniziare a leggere nel vettore circolare dei log
+ * Posizione del vettore circolare degli ultimi log, preallocata e protetta da un seqlock.
+ * La sequenza è dispari durante una scrittura, e vale 2 * (ticket + 1) quando contiene la linea del ticket.
+ */
+struct recent_log_slot {
+    _Atomic uint64_t sequence;
+    uint16_t length;
+    char text[RECENT_LOG_LINE_SIZE];
+};
+
+/**
+ * Aggiungi una linea agli ultimi log. Lo scrittore prende la posizione con un incremento atomico:
+ * non attende mai i lettori, solo un altro scrittore sulla stessa posizione, un giro prima.
+ *
+ * @param line Linea formattata, compreso l'a capo
+ * @param length Lunghezza della linea, troncata a RECENT_LOG_LINE_SIZE
  */
-extern int logs_index;
+void push_recent_log(const char *line, size_t length);
+
+/**
+ * Copia gli ultimi log, dal più vecchio, senza bloccare gli scrittori.
+ * Una linea sovrascritta durante la copia viene saltata.
+ *
+ * @param buffer Dove scrivere le linee, grande almeno LOGS_ARRAY_SIZE * RECENT_LOG_LINE_SIZE
+ * @return Lunghezza del testo copiato
+ */
+size_t read_recent_logs(char *buffer);
 
 /**
  * Ottieni il prefisso del messaggio di log,
@@ -82,6 +111,28 @@ void log_result(const struct sock_info *client_info,
                 const struct timestamp *start_time,
                 const struct timestamp *end_time);
 
+/**
+ * Esegui il log di un'operazione binaria calcolata con successo.
+ * Nel formato binario vengono salvati solo operatore e operandi, senza la linea.
+ *
+ * @param client_info Informazioni sul client
+ * @param operation_line Linea di input dell'operazione effettuata
+ * @param operator Operatore
+ * @param left Operando di sinistra
+ * @param right Operando di destra
+ * @param result Risultato dell'operazione
+ * @param start_time Tempo di inizio del calcolo
+ * @param end_time Tempo di fine del calcolo
+ */
+void log_operation(const struct sock_info *client_info,
+                   const char *operation_line,
+                   char operator,
+                   operand_t left,
+                   operand_t right,
+                   operand_t result,
+                   const struct timestamp *start_time,
+                   const struct timestamp *end_time);
+
 /**
  * Esegui il log di inizio di una nuova sessione del server.
  *
@@ -100,6 +151,19 @@ int log_new_start(const char *filename);
  */
 FILE *open_log_file();
 
+/**
+ * Scrivi tutti i log in attesa. Nel server arresta anche il thread di scrittura:
+ * da qui in poi i log vengono scritti direttamente dal thread chiamante.
+ */
+void flush_logging();
+
+/**
+ * Percorso del file di log in uso
+ *
+ * @return Il percorso, o NULL se il file di log non è stato aperto
+ */
+const char *get_log_file_path();
+
 /**
  * Termina tutte le operazioni di log, chiudi il file e libera la memoria
  */
@@ -0,0 +1,468 @@
+#include "math_kernels.h"
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <quadmath.h>
+
+/**
+ * Sommato a un double di modulo < 2^51, lo arrotonda all'intero più vicino,
+ * che si trova poi nei bit meno significativi della mantissa.
+ */
+#define ROUNDING_SHIFTER 0x1.8p52
+
+/**
+ * ln(2) diviso in una parte alta con la mantissa corta (il prodotto con
+ * un intero piccolo è esatto) e una parte bassa con il resto
+ */
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+
+/**
+ * pi/2 diviso in tre parti: le prime due hanno 33 bit di mantissa,
+ * quindi il prodotto con un quadrante < 2^20 è esatto
+ */
+#define PIO2_1 1.57079632673412561417e+00
+#define PIO2_2 6.07710050630396597660e-11
+#define PIO2_3 2.02226624879595063154e-21
+
+/**
+ * Nomi delle funzioni, nell'ordine di enum math_function
+ */
+const char *math_function_names[MATH_FUNCTIONS_COUNT] = {"sqrt", "exp", "log", "sin", "cos", "tan", "pow"};
+
+/**
+ * Cerca una funzione dal suo nome
+ *
+ * @param name Nome della funzione, non necessariamente terminato da \0
+ * @param name_len Lunghezza del nome
+ * @return La funzione, oppure -1 se non esiste
+ */
+int find_math_function(const char *name, size_t name_len) {
+    for (int function = 0; function < MATH_FUNCTIONS_COUNT; function++) {
+        if (strlen(math_function_names[function]) == name_len &&
+            strncmp(math_function_names[function], name, name_len) == 0)
+            return function;
+    }
+    return -1;
+}
+
+/**
+ * Numero di argomenti di una funzione
+ *
+ * @param function Funzione
+ * @return 2 per pow (base ed esponente), 1 altrimenti
+ */
+int math_function_arity(enum math_function function) {
+    return function == MATH_POW ? 2 : 1;
+}
+
+/**
+ * Scegli lane per lane tra due vettori
+ *
+ * @param mask Maschera prodotta da un confronto
+ * @param if_true Valori delle lane in cui la maschera è vera
+ * @param if_false Valori delle altre lane
+ */
+static inline vdouble _vselect(vint mask, vdouble if_true, vdouble if_false) {
+    return (vdouble) ((mask & (vint) if_true) | (~mask & (vint) if_false));
+}
+
+/**
+ * Vettore con tutte le lane uguali
+ */
+static inline vdouble _vsplat(double value) {
+    return (vdouble) {} + value;
+}
+
+/**
+ * Errore di arrotondamento di un prodotto, con la scomposizione di Dekker
+ * (senza FMA, che non è garantita su x86-64 di base)
+ *
+ * @param a Primo fattore
+ * @param b Secondo fattore
+ * @param product a * b arrotondato
+ * @return a * b - product, esatto
+ */
+static inline vdouble _two_product_error(vdouble a, double b, vdouble product) {
+    const double split = 0x1p27 + 1;
+    vdouble a_big = a * split;
+    vdouble a_high = a_big - (a_big - a);
+    vdouble a_low = a - a_high;
+    double b_big = b * split;
+    double b_high = b_big - (b_big - b);
+    double b_low = b - b_high;
+    return ((a_high * b_high - product) + a_high * b_low + a_low * b_high) + a_low * b_low;
+}
+
+/**
+ * exp() vettoriale di x + x_tail: riduzione x = n ln2 + r con |r| <= ln2/2,
+ * poi Taylor di grado 13 su r e scalatura per 2^n.
+ *
+ * @param x Argomenti
+ * @param x_tail Parte bassa degli argomenti, se calcolati con precisione estesa (altrimenti 0)
+ */
+static inline vdouble _vexp(vdouble x, vdouble x_tail) {
+    // Oltre questi limiti il risultato è comunque infinito o zero; i NaN restano tali
+    x = _vselect(x > _vsplat(710.0), _vsplat(710.0), x);
+    x = _vselect(x < _vsplat(-746.0), _vsplat(-746.0), x);
+
+    vdouble shifted = x * M_LOG2E + ROUNDING_SHIFTER;
+    vdouble n = shifted - ROUNDING_SHIFTER;
+    vint n_int = (vint) shifted - (vint) _vsplat(ROUNDING_SHIFTER);
+    vdouble r = (x - n * LN2_HI) + (x_tail - n * LN2_LO);
+
+    vdouble q = _vsplat(1.0 / 6227020800.0);
+    q = q * r + 1.0 / 479001600.0;
+    q = q * r + 1.0 / 39916800.0;
+    q = q * r + 1.0 / 3628800.0;
+    q = q * r + 1.0 / 362880.0;
+    q = q * r + 1.0 / 40320.0;
+    q = q * r + 1.0 / 5040.0;
+    q = q * r + 1.0 / 720.0;
+    q = q * r + 1.0 / 120.0;
+    q = q * r + 1.0 / 24.0;
+    q = q * r + 1.0 / 6.0;
+    q = q * r + 0.5;
+    vdouble p = 1.0 + (r + (r * r) * q);
+
+    // 2^n in due fattori, così restano normali anche per n vicino a -1075 o 1024
+    vint n_half = n_int >> 1;
+    vdouble scale_1 = (vdouble) ((n_half + 1023) << 52);
+    vdouble scale_2 = (vdouble) ((n_int - n_half + 1023) << 52);
+    return p * scale_1 * scale_2;
+}
+
+/**
+ * log() vettoriale: x = 2^e m con m in [sqrt(2)/2, sqrt(2)], poi
+ * log(m) = f - f^2/2 + s (f^2/2 + R(s^2)) con f = m - 1, s = f / (2 + f).
+ *
+ * @param x Argomenti
+ * @param tail Se non NULL, dove scrivere la parte bassa del risultato,
+ *             che sommata al valore restituito ne estende la precisione
+ */
+static inline vdouble _vlog(vdouble x, vdouble *tail) {
+    // I subnormali vengono normalizzati moltiplicando per 2^54
+    vint subnormal = x < _vsplat(DBL_MIN);
+    vdouble normal_x = _vselect(subnormal, x * 0x1p54, x);
+
+    vint bits = (vint) normal_x;
+    vint e = ((bits >> 52) & 0x7ff) - 1023 - (subnormal & 54);
+    vdouble m = (vdouble) ((bits & 0x000fffffffffffffL) | 0x3ff0000000000000L);
+    vint above = m > _vsplat(M_SQRT2);
+    m = _vselect(above, m * 0.5, m);
+    e = e - above;
+
+    vdouble f = m - 1.0;
+    vdouble s = f / (2.0 + f);
+    vdouble z = s * s;
+    vdouble r = _vsplat(2.0 / 21.0);
+    r = r * z + 2.0 / 19.0;
+    r = r * z + 2.0 / 17.0;
+    r = r * z + 2.0 / 15.0;
+    r = r * z + 2.0 / 13.0;
+    r = r * z + 2.0 / 11.0;
+    r = r * z + 2.0 / 9.0;
+    r = r * z + 2.0 / 7.0;
+    r = r * z + 2.0 / 5.0;
+    r = r * z + 2.0 / 3.0;
+    r = r * z;
+
+    vdouble k = (vdouble) (e + (vint) _vsplat(ROUNDING_SHIFTER)) - ROUNDING_SHIFTER;
+    vdouble half_f_squared = 0.5 * f * f;
+    vdouble result;
+    if (tail == NULL) {
+        result = k * LN2_HI - ((half_f_squared - (s * (half_f_squared + r) + k * LN2_LO)) - f);
+    } else {
+        // k ln2_hi + f con la somma esatta di Knuth, poi i termini piccoli
+        vdouble high = k * LN2_HI;
+        vdouble sum = high + f;
+        vdouble f_part = sum - high;
+        vdouble sum_error = (high - (sum - f_part)) + (f - f_part);
+        vdouble small = sum_error + ((s * (half_f_squared + r) + k * LN2_LO) - half_f_squared);
+        result = sum + small;
+        *tail = small - (result - sum);
+    }
+
+    // Casi speciali
+    result = _vselect(x == _vsplat(0.0), _vsplat(-INFINITY), result);
+    result = _vselect(x < _vsplat(0.0), _vsplat(NAN), result);
+    result = _vselect(x == _vsplat(INFINITY), x, result);
+    result = _vselect(x != x, x, result);
+    return result;
+}
+
+/**
+ * Riduzione vettoriale per le funzioni trigonometriche: x = q pi/2 + r, |r| <= pi/4,
+ * con i polinomi di Taylor di seno e coseno su r.
+ *
+ * @param x Argomenti, in modulo <= MATH_FAST_TRIG_LIMIT
+ * @param sin_r Seno di r
+ * @param cos_r Coseno di r
+ * @return Quadrante q di ogni lane
+ */
+static inline vint _vsincos_reduced(vdouble x, vdouble *sin_r, vdouble *cos_r) {
+    vdouble shifted = x * M_2_PI + ROUNDING_SHIFTER;
+    vdouble q = shifted - ROUNDING_SHIFTER;
+    vint quadrant = (vint) shifted - (vint) _vsplat(ROUNDING_SHIFTER);
+
+    // r = r_high + r_low, tenendo traccia degli arrotondamenti delle sottrazioni
+    vdouble r_high = x - q * PIO2_1;
+    vdouble w = q * PIO2_2;
+    vdouble t = r_high;
+    r_high = t - w;
+    vdouble r_low = (t - r_high) - w;
+    w = q * PIO2_3;
+    t = r_high;
+    r_high = t - w;
+    r_low = r_low + ((t - r_high) - w);
+    t = r_high;
+    r_high = t + r_low;
+    r_low = r_low - (r_high - t);
+    vdouble z = r_high * r_high;
+
+    // sin(r_high + r_low) ~= r_high + r_high^3 S(z) + r_low (1 - z/2)
+    vdouble s = _vsplat(-1.0 / 1307674368000.0);
+    s = s * z + 1.0 / 6227020800.0;
+    s = s * z - 1.0 / 39916800.0;
+    s = s * z + 1.0 / 362880.0;
+    s = s * z - 1.0 / 5040.0;
+    s = s * z + 1.0 / 120.0;
+    vdouble v = z * r_high;
+    *sin_r = r_high - ((z * (0.5 * r_low - v * s) - r_low) - v * (-1.0 / 6.0));
+
+    // cos(r_high + r_low) ~= 1 - z/2 + z^2 C(z) - r_high r_low
+    vdouble c = _vsplat(1.0 / 20922789888000.0);
+    c = c * z - 1.0 / 87178291200.0;
+    c = c * z + 1.0 / 479001600.0;
+    c = c * z - 1.0 / 3628800.0;
+    c = c * z + 1.0 / 40320.0;
+    c = c * z - 1.0 / 720.0;
+    c = c * z + 1.0 / 24.0;
+    // 1 - z/2 con la correzione dell'errore di arrotondamento della sottrazione
+    vdouble half_z = 0.5 * z;
+    w = 1.0 - half_z;
+    *cos_r = w + (((1.0 - w) - half_z) + (z * z * c - r_high * r_low));
+
+    return quadrant;
+}
+
+/**
+ * sin() vettoriale
+ */
+static inline vdouble _vsin(vdouble x) {
+    vdouble sin_r, cos_r;
+    vint quadrant = _vsincos_reduced(x, &sin_r, &cos_r);
+    vdouble result = _vselect(-(quadrant & 1), cos_r, sin_r);
+    return (vdouble) ((vint) result ^ ((quadrant & 2) << 62));
+}
+
+/**
+ * cos() vettoriale
+ */
+static inline vdouble _vcos(vdouble x) {
+    vdouble sin_r, cos_r;
+    vint quadrant = _vsincos_reduced(x, &sin_r, &cos_r);
+    vdouble result = _vselect(-(quadrant & 1), sin_r, cos_r);
+    return (vdouble) ((vint) result ^ (((quadrant + 1) & 2) << 62));
+}
+
+/**
+ * tan() vettoriale: sin(r)/cos(r) nei quadranti pari, -cos(r)/sin(r) nei dispari
+ */
+static inline vdouble _vtan(vdouble x) {
+    vdouble sin_r, cos_r;
+    vint quadrant = _vsincos_reduced(x, &sin_r, &cos_r);
+    vint odd = -(quadrant & 1);
+    vdouble result = _vselect(odd, cos_r, sin_r) / _vselect(odd, sin_r, cos_r);
+    return (vdouble) ((vint) result ^ (odd & INT64_MIN));
+}
+
+/**
+ * Verifica che arrotondare a double un risultato long double dia
+ * lo stesso double che si otterrebbe dal valore esatto, cioè che il
+ * risultato non sia troppo vicino al punto medio tra due double.
+ *
+ * @param value Risultato in long double, con errore di pochi ULP del long double
+ * @return Diverso da zero se l'arrotondamento è sicuramente corretto
+ */
+int _is_rounding_safe(long double value) {
+    if (!isfinite(value) || value == 0)
+        return 1;
+
+    long double magnitude = fabsl(value);
+    long double midpoint;
+    if (magnitude >= DBL_MAX) {
+        // Soglia oltre la quale si arrotonda a infinito
+        midpoint = 0x1.fffffffffffff8p1023L;
+    } else {
+        double rounded = (double) magnitude;
+        double neighbour = nextafter(rounded, magnitude > rounded ? INFINITY : 0);
+        midpoint = ((long double) rounded + neighbour) / 2;
+    }
+
+    // Margine di 8 ULP del long double, oltre l'errore delle funzioni di libm
+    return fabsl(magnitude - midpoint) > ldexpl(magnitude, -60);
+}
+
+/**
+ * Calcola una funzione arrotondando correttamente il risultato,
+ * con la strategia di Ziv: prima in long double, poi a 113 bit
+ * solo nei rari casi in cui non basta.
+ */
+operand_t _exact_function(enum math_function function, operand_t x, operand_t y) {
+    long double value;
+    switch (function) {
+        case MATH_SQRT:
+            // La radice quadrata IEEE 754 è già arrotondata correttamente
+            return sqrt(x);
+        case MATH_EXP:
+            value = expl(x);
+            break;
+        case MATH_LOG:
+            value = logl(x);
+            break;
+        case MATH_SIN:
+            value = sinl(x);
+            break;
+        case MATH_COS:
+            value = cosl(x);
+            break;
+        case MATH_TAN:
+            value = tanl(x);
+            break;
+        case MATH_POW:
+            value = powl(x, y);
+            break;
+        default:
+            return NAN;
+    }
+
+    if (_is_rounding_safe(value))
+        return (operand_t) value;
+
+    switch (function) {
+        case MATH_EXP:
+            return (operand_t) expq(x);
+        case MATH_LOG:
+            return (operand_t) logq(x);
+        case MATH_SIN:
+            return (operand_t) sinq(x);
+        case MATH_COS:
+            return (operand_t) cosq(x);
+        case MATH_TAN:
+            return (operand_t) tanq(x);
+        default:
+            return (operand_t) powq(x, y);
+    }
+}
+
+/**
+ * Calcola un blocco di MATH_VECTOR_WIDTH valori con i kernel veloci
+ *
+ * @param function Funzione da calcolare
+ * @param values Argomenti
+ * @param exponent Esponente, solo per pow
+ * @param results Dove scrivere i risultati
+ */
+void _fast_block(enum math_function function, const operand_t *values, operand_t exponent, operand_t *results) {
+    vdouble x, result;
+    memcpy(&x, values, sizeof(x));
+
+    switch (function) {
+        case MATH_EXP:
+            result = _vexp(x, (vdouble) {});
+            break;
+        case MATH_LOG:
+            result = _vlog(x, NULL);
+            break;
+        case MATH_SIN:
+            result = _vsin(x);
+            break;
+        case MATH_COS:
+            result = _vcos(x);
+            break;
+        case MATH_TAN:
+            result = _vtan(x);
+            break;
+        case MATH_POW: {
+            // y log(x) in precisione doppia-doppia, altrimenti exp() amplificherebbe l'errore di log()
+            vdouble log_tail;
+            vdouble log_x = _vlog(x, &log_tail);
+            vdouble product = exponent * log_x;
+            result = _vexp(product, _two_product_error(log_x, exponent, product) + exponent * log_tail);
+            break;
+        }
+        default:
+            for (int i = 0; i < MATH_VECTOR_WIDTH; i++)
+                result[i] = sqrt(x[i]);
+            break;
+    }
+
+    memcpy(results, &result, sizeof(result));
+
+    // Valori fuori dal dominio dei kernel: calcolali in modalità esatta
+    for (int i = 0; i < MATH_VECTOR_WIDTH; i++) {
+        int outside;
+        if (function == MATH_SIN || function == MATH_COS || function == MATH_TAN)
+            outside = !(fabs(x[i]) <= MATH_FAST_TRIG_LIMIT);
+        else if (function == MATH_POW)
+            outside = !(x[i] > 0) || !isfinite(x[i]) || !isfinite(exponent);
+        else
+            outside = 0;
+
+        if (outside)
+            results[i] = _exact_function(function, x[i], exponent);
+    }
+}
+
+/**
+ * Calcola una funzione su un vettore di valori.
+ *
+ * @param function Funzione da calcolare
+ * @param mode Modalità di calcolo
+ * @param values Argomenti
+ * @param exponent Esponente comune a tutti i valori, solo per pow
+ * @param results Dove scrivere i risultati, può coincidere con values
+ * @param count Numero di valori
+ */
+void calculate_function_batch(enum math_function function, enum math_mode mode, const operand_t *values,
+                              operand_t exponent, operand_t *results, size_t count) {
+    if (mode == MATH_MODE_EXACT) {
+        for (size_t i = 0; i < count; i++)
+            results[i] = _exact_function(function, values[i], exponent);
+    } else {
+        size_t i = 0;
+        for (; i + MATH_VECTOR_WIDTH <= count; i += MATH_VECTOR_WIDTH)
+            _fast_block(function, values + i, exponent, results + i);
+
+        // Ultimo blocco incompleto, completato con valori innocui
+        if (i < count) {
+            operand_t block[MATH_VECTOR_WIDTH] = {}, block_results[MATH_VECTOR_WIDTH];
+            for (size_t j = 0; j < MATH_VECTOR_WIDTH; j++)
+                block[j] = i + j < count ? values[i + j] : 1.0;
+            _fast_block(function, block, exponent, block_results);
+            memcpy(results + i, block_results, (count - i) * sizeof(operand_t));
+        }
+    }
+
+    // libm imposta errno per i risultati fuori dominio, che però sono già NaN o infinito
+    errno = 0;
+}
+
+/**
+ * Calcola una funzione su un singolo valore.
+ * I risultati fuori dominio sono NaN o infinito, come per la divisione per zero.
+ *
+ * @param function Funzione da calcolare
+ * @param mode Modalità di calcolo
+ * @param x Argomento
+ * @param y Esponente, solo per pow
+ * @return Il risultato
+ */
+operand_t calculate_function(enum math_function function, enum math_mode mode, operand_t x, operand_t y) {
+    operand_t result;
+    calculate_function_batch(function, mode, &x, y, &result, 1);
+    return result;
+}
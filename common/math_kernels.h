@@ -0,0 +1,120 @@
+#ifndef HW2_MATH_KERNELS_H
+#define HW2_MATH_KERNELS_H
+
+#include "calc_utils.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Nome della modalità veloce, da indicare dopo il nome della funzione
+ */
+#define MATH_MODE_FAST_NAME "fast"
+
+/**
+ * Nome della modalità arrotondata correttamente (predefinita)
+ */
+#define MATH_MODE_EXACT_NAME "exact"
+
+/**
+ * Numero di valori elaborati insieme dai kernel vettoriali.
+ * 2 double occupano un registro SSE2, 4 un registro AVX.
+ */
+#ifdef __AVX__
+#define MATH_VECTOR_WIDTH 4
+#else
+#define MATH_VECTOR_WIDTH 2
+#endif
+
+/**
+ * Vettori di double e di interi a 64 bit, elaborati con istruzioni SIMD.
+ * I confronti tra vdouble producono vint con ogni lane a -1 (vero) o 0 (falso).
+ */
+typedef double vdouble __attribute__((vector_size(MATH_VECTOR_WIDTH * sizeof(double))));
+typedef int64_t vint __attribute__((vector_size(MATH_VECTOR_WIDTH * sizeof(int64_t))));
+
+/**
+ * Oltre questo modulo la riduzione dell'argomento delle funzioni trigonometriche
+ * veloci perde precisione: i valori più grandi sono calcolati in modalità esatta.
+ */
+#define MATH_FAST_TRIG_LIMIT 1e5
+
+/**
+ * Funzioni matematiche disponibili.
+ *
+ * Errore massimo, in ULP, misurato con `bench.out math` contro un riferimento a 113 bit:
+ *
+ *   funzione  exact  fast   dominio della misura
+ *   sqrt      0.5    0.5    [2^-998, 2^998]
+ *   exp       0.5    1      [-700, 700]
+ *   log       0.5    1      [2^-998, 2^998]
+ *   sin, cos  0.5    1      [-1e5, 1e5]
+ *   tan       0.5    2.5    [-1e5, 1e5]
+ *   pow       0.5    1      x in [0, 1000], y = 2.5
+ *
+ * La modalità exact è arrotondata correttamente (errore <= 0.5 ULP): il valore viene
+ * calcolato in long double e, solo se è troppo vicino al punto medio tra due double,
+ * ricalcolato a 113 bit. La modalità fast usa approssimazioni polinomiali vettoriali;
+ * pow calcola y log(x) in precisione doppia-doppia, quindi il suo errore non cresce con y.
+ */
+enum math_function {
+    MATH_SQRT,
+    MATH_EXP,
+    MATH_LOG,
+    MATH_SIN,
+    MATH_COS,
+    MATH_TAN,
+    MATH_POW,
+    MATH_FUNCTIONS_COUNT
+};
+
+/**
+ * Modalità di calcolo delle funzioni
+ */
+enum math_mode {
+    MATH_MODE_EXACT,
+    MATH_MODE_FAST
+};
+
+/**
+ * Cerca una funzione dal suo nome
+ *
+ * @param name Nome della funzione, non necessariamente terminato da \0
+ * @param name_len Lunghezza del nome
+ * @return La funzione, oppure -1 se non esiste
+ */
+int find_math_function(const char *name, size_t name_len);
+
+/**
+ * Numero di argomenti di una funzione
+ *
+ * @param function Funzione
+ * @return 2 per pow (base ed esponente), 1 altrimenti
+ */
+int math_function_arity(enum math_function function);
+
+/**
+ * Calcola una funzione su un singolo valore.
+ * I risultati fuori dominio sono NaN o infinito, come per la divisione per zero.
+ *
+ * @param function Funzione da calcolare
+ * @param mode Modalità di calcolo
+ * @param x Argomento
+ * @param y Esponente, solo per pow
+ * @return Il risultato
+ */
+operand_t calculate_function(enum math_function function, enum math_mode mode, operand_t x, operand_t y);
+
+/**
+ * Calcola una funzione su un vettore di valori.
+ *
+ * @param function Funzione da calcolare
+ * @param mode Modalità di calcolo
+ * @param values Argomenti
+ * @param exponent Esponente comune a tutti i valori, solo per pow
+ * @param results Dove scrivere i risultati, può coincidere con values
+ * @param count Numero di valori
+ */
+void calculate_function_batch(enum math_function function, enum math_mode mode, const operand_t *values,
+                              operand_t exponent, operand_t *results, size_t count);
+
+#endif //HW2_MATH_KERNELS_H
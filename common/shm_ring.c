@@ -0,0 +1,257 @@
+#include "shm_ring.h"
+#include "logger.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+/**
+ * Indica alla CPU che si è in un ciclo di attesa attiva
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define _shm_cpu_relax() __builtin_ia32_pause()
+#else
+#define _shm_cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/**
+ * Attendi sul futex finché vale ancora expected.
+ * Il futex non è privato, perché la regione è condivisa tra processi.
+ *
+ * @param word Parola del futex
+ * @param expected Valore atteso
+ * @param timeout_millis Attesa massima in millisecondi
+ * @return Risultato della syscall
+ */
+long _shm_futex_wait(_Atomic uint32_t *word, uint32_t expected, unsigned int timeout_millis) {
+    struct timespec timeout = {timeout_millis / 1000, (timeout_millis % 1000) * 1000000L};
+    return syscall(SYS_futex, word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+/**
+ * Sveglia chi sta attendendo sul futex
+ *
+ * @param word Parola del futex
+ */
+void _shm_futex_wake(_Atomic uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/**
+ * Inserisci un elemento nel ring, se c'è spazio.
+ * Se il consumatore sta dormendo, viene svegliato.
+ *
+ * @param ring Ring in cui inserire
+ * @param slots Vettore delle celle del ring
+ * @param slot_size Dimensione di una cella
+ * @param item Elemento da copiare nella cella
+ * @return -1 se il ring è pieno, 0 altrimenti
+ */
+int shm_ring_push(struct shm_ring *ring, void *slots, size_t slot_size, const void *item) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head == SHM_RING_SLOTS)
+        return -1;
+
+    memcpy((char *) slots + (tail & (SHM_RING_SLOTS - 1)) * slot_size, item, slot_size);
+
+    // Pubblica la cella. Serve l'ordinamento sequenziale con la lettura di sleeping,
+    // altrimenti il consumatore potrebbe addormentarsi senza vedere il nuovo elemento.
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&ring->sleeping, memory_order_seq_cst))
+        _shm_futex_wake(&ring->tail);
+
+    return 0;
+}
+
+/**
+ * Estrai un elemento dal ring, se presente.
+ *
+ * @param ring Ring da cui estrarre
+ * @param slots Vettore delle celle del ring
+ * @param slot_size Dimensione di una cella
+ * @param item Dove copiare l'elemento estratto
+ * @return -1 se il ring è vuoto, 0 altrimenti
+ */
+int shm_ring_pop(struct shm_ring *ring, const void *slots, size_t slot_size, void *item) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail)
+        return -1;
+
+    memcpy(item, (const char *) slots + (head & (SHM_RING_SLOTS - 1)) * slot_size, slot_size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * Attendi che il ring contenga almeno un elemento.
+ * Prima prova attivamente, poi si addormenta sul futex.
+ *
+ * @param ring Ring su cui attendere, dal lato del consumatore
+ * @param timeout_millis Attesa massima sul futex in millisecondi
+ * @return 0 se il ring non è vuoto, -1 in caso di timeout o interruzione (errno impostato)
+ */
+int shm_ring_wait(struct shm_ring *ring, unsigned int timeout_millis) {
+    // Con una sola CPU l'attesa attiva ruberebbe solo tempo al produttore
+    static int spin_iterations = -1;
+    if (spin_iterations == -1)
+        spin_iterations = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_SPIN_ITERATIONS : 0;
+
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    // Attesa attiva: se il produttore è veloce, si evitano del tutto le syscall
+    for (int i = 0; i < spin_iterations; i++) {
+        if (atomic_load_explicit(&ring->tail, memory_order_acquire) != head)
+            return 0;
+        _shm_cpu_relax();
+    }
+
+    // Annuncia che si sta per dormire, poi ricontrolla per non perdere un risveglio
+    atomic_store_explicit(&ring->sleeping, 1, memory_order_seq_cst);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_seq_cst);
+    if (tail == head) {
+        // Se nel frattempo tail cambia, la syscall ritorna subito con EAGAIN
+        if (_shm_futex_wait(&ring->tail, tail, timeout_millis) == -1 && errno == EAGAIN)
+            errno = 0;
+    }
+    atomic_store_explicit(&ring->sleeping, 0, memory_order_relaxed);
+
+    if (atomic_load_explicit(&ring->tail, memory_order_acquire) != head) {
+        errno = 0;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Connettiti al server e mappa la regione di memoria condivisa che ti assegna.
+ *
+ * @param port Porta TCP del server, da cui deriva il nome della socket Unix
+ * @param session Sessione da inizializzare
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int shm_attach(uint16_t port, struct shm_session *session) {
+    // Indirizzo nel namespace astratto: il primo byte del percorso è \0
+    struct sockaddr_un server_address;
+    bzero(&server_address, sizeof(server_address));
+    server_address.sun_family = AF_UNIX;
+    int name_len = snprintf(server_address.sun_path + 1, sizeof(server_address.sun_path) - 1,
+                            SHM_SOCKET_NAME_FORMAT, port);
+    socklen_t address_len = (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + name_len);
+
+    session->unix_socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (session->unix_socket_fd == -1) {
+        log_errno(NULL, "Errore nella creazione della socket Unix");
+        return -1;
+    }
+
+    if (connect(session->unix_socket_fd, (struct sockaddr *) &server_address, address_len) == -1) {
+        log_errno(NULL, "Errore nella connect della socket Unix");
+        close(session->unix_socket_fd);
+        return -1;
+    }
+
+    // Ricevi il file descriptor della memfd come messaggio ausiliario SCM_RIGHTS
+    char data;
+    struct iovec iov = {&data, 1};
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr message;
+    bzero(&message, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg;
+    if (recvmsg(session->unix_socket_fd, &message, 0) <= 0 || (cmsg = CMSG_FIRSTHDR(&message)) == NULL ||
+        cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        log_message(NULL, "Il server non ha inviato la regione di memoria condivisa\n");
+        close(session->unix_socket_fd);
+        return -1;
+    }
+
+    int memfd;
+    memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+
+    session->region = mmap(NULL, sizeof(struct shm_region), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    close(memfd); // La mappatura resta valida anche dopo la chiusura
+    if (session->region == MAP_FAILED) {
+        log_errno(NULL, "Errore nella mmap della memoria condivisa");
+        close(session->unix_socket_fd);
+        return -1;
+    }
+
+    if (session->region->magic != SHM_REGION_MAGIC) {
+        log_message(NULL, "Formato della memoria condivisa sconosciuto\n");
+        shm_detach(session);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Invia una richiesta al server, attendendo se il ring è pieno.
+ *
+ * @param session Sessione con il server
+ * @param left Operando di sinistra
+ * @param operator Operatore
+ * @param right Operando di destra
+ * @return -1 se la sessione è chiusa, 0 altrimenti
+ */
+int shm_submit(struct shm_session *session, operand_t left, char operator, operand_t right) {
+    struct shm_request request = {left, right, operator};
+    struct shm_region *region = session->region;
+
+    while (shm_ring_push(&region->request_ring, region->requests, sizeof(request), &request) == -1) {
+        // Ring pieno: il server è indietro, lasciagli la CPU
+        if (atomic_load_explicit(&region->closed, memory_order_relaxed))
+            return -1;
+        sched_yield();
+    }
+
+    return 0;
+}
+
+/**
+ * Ricevi la prossima risposta dal server, attendendola se necessario.
+ *
+ * @param session Sessione con il server
+ * @param response Dove scrivere la risposta
+ * @return -1 se la sessione è chiusa, 0 altrimenti
+ */
+int shm_receive(struct shm_session *session, struct shm_response *response) {
+    struct shm_region *region = session->region;
+
+    while (shm_ring_pop(&region->response_ring, region->responses, sizeof(*response), response) == -1) {
+        if (atomic_load_explicit(&region->closed, memory_order_relaxed))
+            return -1;
+        shm_ring_wait(&region->response_ring, 100);
+    }
+
+    return 0;
+}
+
+/**
+ * Chiudi la sessione e rilascia la regione di memoria condivisa.
+ *
+ * @param session Sessione da chiudere
+ */
+void shm_detach(struct shm_session *session) {
+    // Avvisa il server, svegliandolo se stava dormendo
+    atomic_store(&session->region->closed, 1);
+    _shm_futex_wake(&session->region->request_ring.tail);
+
+    munmap(session->region, sizeof(struct shm_region));
+    close(session->unix_socket_fd);
+    session->region = NULL;
+    session->unix_socket_fd = -1;
+}
@@ -0,0 +1,185 @@
+#ifndef HW2_SHM_RING_H
+#define HW2_SHM_RING_H
+
+#include "calc_utils.h"
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ * Formato del nome della socket Unix (nel namespace astratto)
+ * su cui il server distribuisce le regioni di memoria condivisa.
+ * Il parametro è la porta TCP del server.
+ */
+#define SHM_SOCKET_NAME_FORMAT "calc-server-%u"
+
+/**
+ * Numero di celle di ciascun ring. Deve essere una potenza di 2.
+ */
+#define SHM_RING_SLOTS 1024
+
+/**
+ * Numero di tentativi attivi prima di addormentarsi sul futex,
+ * quando il ring da cui leggere è vuoto.
+ */
+#define SHM_SPIN_ITERATIONS 4000
+
+/**
+ * Valore magico all'inizio della regione, per riconoscerne il formato
+ */
+#define SHM_REGION_MAGIC 0x43414c43
+
+/**
+ * Richiesta di un'operazione tramite memoria condivisa
+ */
+struct shm_request {
+    operand_t left;
+    operand_t right;
+    char operator;
+};
+
+/**
+ * Risposta a una struct shm_request, nello stesso ordine delle richieste
+ */
+struct shm_response {
+    operand_t result;
+
+    /**
+     * 0 se l'operazione è andata a buon fine, altrimenti il codice errno
+     */
+    int error;
+};
+
+/**
+ * Indici di un ring single-producer single-consumer, senza lock.
+ *
+ * Ogni campo è su una linea di cache diversa, per evitare il false sharing
+ * tra il produttore (che scrive tail) e il consumatore (che scrive head).
+ */
+struct shm_ring {
+    /**
+     * Prossima cella da leggere, scritta solo dal consumatore
+     */
+    _Alignas(64) _Atomic uint32_t head;
+
+    /**
+     * Prossima cella da scrivere, scritta solo dal produttore.
+     * È anche la parola del futex su cui attende il consumatore.
+     */
+    _Alignas(64) _Atomic uint32_t tail;
+
+    /**
+     * Diverso da zero se il consumatore sta dormendo sul futex
+     */
+    _Alignas(64) _Atomic uint32_t sleeping;
+};
+
+/**
+ * Regione di memoria condivisa tra server e un singolo client
+ */
+struct shm_region {
+    uint32_t magic;
+
+    /**
+     * Diverso da zero quando una delle due parti ha chiuso la sessione
+     */
+    _Atomic uint32_t closed;
+
+    /**
+     * Ring delle richieste: il client produce, il server consuma
+     */
+    struct shm_ring request_ring;
+
+    /**
+     * Ring delle risposte: il server produce, il client consuma
+     */
+    struct shm_ring response_ring;
+
+    struct shm_request requests[SHM_RING_SLOTS];
+    struct shm_response responses[SHM_RING_SLOTS];
+};
+
+/**
+ * Sessione di un client collegato tramite memoria condivisa
+ */
+struct shm_session {
+    /**
+     * Socket Unix con il server, che resta aperta per tutta la sessione
+     */
+    int unix_socket_fd;
+
+    /**
+     * Regione mappata in memoria
+     */
+    struct shm_region *region;
+};
+
+/**
+ * Inserisci un elemento nel ring, se c'è spazio.
+ * Se il consumatore sta dormendo, viene svegliato.
+ *
+ * @param ring Ring in cui inserire
+ * @param slots Vettore delle celle del ring
+ * @param slot_size Dimensione di una cella
+ * @param item Elemento da copiare nella cella
+ * @return -1 se il ring è pieno, 0 altrimenti
+ */
+int shm_ring_push(struct shm_ring *ring, void *slots, size_t slot_size, const void *item);
+
+/**
+ * Estrai un elemento dal ring, se presente.
+ *
+ * @param ring Ring da cui estrarre
+ * @param slots Vettore delle celle del ring
+ * @param slot_size Dimensione di una cella
+ * @param item Dove copiare l'elemento estratto
+ * @return -1 se il ring è vuoto, 0 altrimenti
+ */
+int shm_ring_pop(struct shm_ring *ring, const void *slots, size_t slot_size, void *item);
+
+/**
+ * Attendi che il ring contenga almeno un elemento.
+ * Prima prova attivamente, poi si addormenta sul futex.
+ *
+ * @param ring Ring su cui attendere, dal lato del consumatore
+ * @param timeout_millis Attesa massima sul futex in millisecondi
+ * @return 0 se il ring non è vuoto, -1 in caso di timeout o interruzione (errno impostato)
+ */
+int shm_ring_wait(struct shm_ring *ring, unsigned int timeout_millis);
+
+/**
+ * Connettiti al server e mappa la regione di memoria condivisa che ti assegna.
+ *
+ * @param port Porta TCP del server, da cui deriva il nome della socket Unix
+ * @param session Sessione da inizializzare
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int shm_attach(uint16_t port, struct shm_session *session);
+
+/**
+ * Invia una richiesta al server, attendendo se il ring è pieno.
+ *
+ * @param session Sessione con il server
+ * @param left Operando di sinistra
+ * @param operator Operatore
+ * @param right Operando di destra
+ * @return -1 se la sessione è chiusa, 0 altrimenti
+ */
+int shm_submit(struct shm_session *session, operand_t left, char operator, operand_t right);
+
+/**
+ * Ricevi la prossima risposta dal server, attendendola se necessario.
+ *
+ * @param session Sessione con il server
+ * @param response Dove scrivere la risposta
+ * @return -1 se la sessione è chiusa, 0 altrimenti
+ */
+int shm_receive(struct shm_session *session, struct shm_response *response);
+
+/**
+ * Chiudi la sessione e rilascia la regione di memoria condivisa.
+ *
+ * @param session Sessione da chiudere
+ */
+void shm_detach(struct shm_session *session);
+
+#endif //HW2_SHM_RING_H
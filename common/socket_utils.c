@@ -2,6 +2,8 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 /**
  * Converti una stringa in un numero intero senza segno a 16 bit
@@ -35,3 +37,19 @@ void strip_newline(char *line, ssize_t *size) {
         (*size)--;
     }
 }
+
+/**
+ * Controlla se la linea inizia con il comando indicato, seguito da spazio o fine linea.
+ *
+ * @param line Linea ricevuta
+ * @param command Nome del comando
+ * @return Puntatore agli argomenti del comando, o NULL se la linea non è quel comando
+ */
+const char *match_command(const char *line, const char *command) {
+    size_t command_len = strlen(command);
+    if (strncmp(line, command, command_len) != 0)
+        return NULL;
+    if (line[command_len] != '\0' && !isspace((unsigned char) line[command_len]))
+        return NULL;
+    return line + command_len;
+}
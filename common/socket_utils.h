@@ -9,6 +9,12 @@
 #define BACKLOG_SIZE 128
 #define SERVER_ERROR_MESSAGE_PREFIX '-'
 
+/**
+ * Dimensione massima di una linea di risposta del server,
+ * incluso il \n finale (un double in %lf può superare i 300 caratteri).
+ */
+#define RESPONSE_LINE_MAX_SIZE 512
+
 /**
  * Raccogli le informazioni del client
  */
@@ -20,6 +26,14 @@ struct sock_info {
      */
     FILE *socket_file;
 
+    /**
+     * File pointer in sola scrittura sulla stessa socket (duplicata).
+     * Un unico FILE in "r+" non permette di scrivere mentre nel buffer di lettura
+     * ci sono ancora dati non letti (es: richieste in pipeline), perché
+     * tenterebbe una lseek() sulla socket.
+     */
+    FILE *socket_output;
+
     /**
      * Informazioni aggiuntive sul socket
      */
@@ -39,4 +53,13 @@ uint16_t str_to_uint16(const char *str);
  */
 void strip_newline(char *line, ssize_t *size);
 
+/**
+ * Controlla se la linea inizia con il comando indicato, seguito da spazio o fine linea.
+ *
+ * @param line Linea ricevuta
+ * @param command Nome del comando
+ * @return Puntatore agli argomenti del comando, o NULL se la linea non è quel comando
+ */
+const char *match_command(const char *line, const char *command);
+
 #endif //SERVER_SOCKET_UTILS_H
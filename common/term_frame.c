@@ -0,0 +1,247 @@
+#include "term_frame.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/**
+ * Celle invariate tra due cambiate oltre le quali conviene spostare il cursore invece di riscriverle
+ */
+#define TERM_FRAME_MAX_GAP 8
+
+/**
+ * Spazio massimo per una sequenza di spostamento del cursore
+ */
+#define TERM_FRAME_MOVE_SIZE 16
+
+/**
+ * Caratteri al massimo scritti da una sola term_frame_printf()
+ */
+#define TERM_FRAME_MAX_TEXT (1 << 16)
+
+/**
+ * Carattere ASCII al posto di un simbolo che la codifica del terminale non può rappresentare
+ */
+char _term_frame_fallback(wchar_t c) {
+    switch (c) {
+        case 0x2500:
+            return '-';
+        case 0x2502:
+            return '|';
+        case 0x25B2:
+            return '^';
+        default:
+            return c >= 0x2500 && c < 0x2580 ? '+' : '?';
+    }
+}
+
+int begin_term_frame(struct term_frame *frame) {
+    int rows = TERM_FRAME_DEFAULT_ROWS, columns = TERM_FRAME_DEFAULT_COLUMNS;
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        rows = size.ws_row;
+        columns = size.ws_col;
+    }
+    errno = 0;
+
+    if (frame->cells == NULL || rows != frame->rows || columns != frame->columns) {
+        // Nuova dimensione: il contenuto attuale del terminale non è più noto
+        size_t cells = (size_t) rows * columns;
+        wchar_t *current = realloc(frame->cells, cells * sizeof(wchar_t));
+        if (current != NULL)
+            frame->cells = current;
+        wchar_t *previous = realloc(frame->previous, cells * sizeof(wchar_t));
+        if (previous != NULL)
+            frame->previous = previous;
+
+        // Ogni cella: spostamento del cursore nel caso peggiore, più il carattere
+        size_t output_capacity = cells * (MB_LEN_MAX + TERM_FRAME_MOVE_SIZE) + 4 * TERM_FRAME_MOVE_SIZE;
+        char *output = realloc(frame->output, output_capacity);
+        if (output != NULL) {
+            frame->output = output;
+            frame->output_capacity = output_capacity;
+        }
+        if (current == NULL || previous == NULL || output == NULL) {
+            free_term_frame(frame);
+            return -1;
+        }
+
+        frame->rows = rows;
+        frame->columns = columns;
+        frame->redraw = 1;
+    }
+
+    wmemset(frame->cells, L' ', (size_t) rows * columns);
+    frame->row = 0;
+    frame->column = 0;
+    frame->rows_used = 0;
+    return 0;
+}
+
+void term_frame_printf(struct term_frame *frame, const wchar_t *format, ...) {
+    wchar_t stack_text[1024];
+    wchar_t *text = stack_text;
+    size_t text_size = sizeof(stack_text) / sizeof(wchar_t);
+    va_list args;
+    int length;
+
+    // vswprintf non indica quanto spazio serve: raddoppia il buffer finché il testo non ci sta
+    while (1) {
+        va_start(args, format);
+        length = vswprintf(text, text_size, format, args);
+        va_end(args);
+        if (length >= 0 || text_size >= TERM_FRAME_MAX_TEXT)
+            break;
+
+        wchar_t *larger = realloc(text == stack_text ? NULL : text, 2 * text_size * sizeof(wchar_t));
+        if (larger == NULL)
+            break;
+        text = larger;
+        text_size *= 2;
+    }
+
+    // Testo ancora troppo lungo: si usa fino al terminatore
+    if (length < 0) {
+        text[text_size - 1] = L'\0';
+        length = (int) wcslen(text);
+    }
+
+    for (int i = 0; i < length; i++) {
+        if (text[i] == L'\n') {
+            frame->row++;
+            frame->column = 0;
+            continue;
+        }
+
+        if (frame->row < frame->rows && frame->column < frame->columns) {
+            frame->cells[frame->row * frame->columns + frame->column] = text[i];
+            if (frame->row >= frame->rows_used)
+                frame->rows_used = frame->row + 1;
+        }
+        frame->column++;
+    }
+
+    if (text != stack_text)
+        free(text);
+}
+
+long term_frame_delay_millis(const struct term_frame *frame) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long elapsed = (now.tv_sec - frame->last_flush.tv_sec) * 1000 +
+                   (now.tv_nsec - frame->last_flush.tv_nsec) / 1000000;
+    long interval = 1000 / TERM_FRAME_MAX_FPS;
+    return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+/**
+ * Aggiungi una cella al buffer d'uscita, nella codifica del terminale
+ */
+size_t _encode_term_cell(char *output, wchar_t c, mbstate_t *state) {
+    if (c >= 0 && c < 0x80) {
+        *output = (char) c;
+        return 1;
+    }
+
+    size_t length = wcrtomb(output, c, state);
+    if (length == (size_t) -1) {
+        memset(state, 0, sizeof(*state));
+        *output = _term_frame_fallback(c);
+        return 1;
+    }
+    return length;
+}
+
+void flush_term_frame(struct term_frame *frame) {
+    if (frame->cells == NULL)
+        return;
+
+    size_t length = 0;
+    mbstate_t state = {};
+    if (frame->redraw)
+        length += sprintf(frame->output, "\e[1;1H\e[2J");
+
+    // Le righe sotto il contenuto vengono pulite alla fine, con una sola sequenza
+    for (int row = 0; row < frame->rows_used; row++) {
+        const wchar_t *cells = frame->cells + row * frame->columns;
+        const wchar_t *previous = frame->previous + row * frame->columns;
+
+        // Fine del contenuto della riga: dopo basta pulire
+        int end = frame->columns;
+        while (end > 0 && cells[end - 1] == L' ')
+            end--;
+
+        if (frame->redraw || row >= frame->previous_rows_used) {
+            // Contenuto del terminale non noto: riscrivi la riga, pulendo dopo l'ultimo carattere
+            length += sprintf(frame->output + length, "\e[%d;1H", row + 1);
+            for (int column = 0; column < end; column++)
+                length += _encode_term_cell(frame->output + length, cells[column], &state);
+            length += sprintf(frame->output + length, "\e[K");
+            continue;
+        }
+
+        // Contenuto precedente oltre la fine di quello nuovo: si pulisce con una sola sequenza
+        int previous_end = frame->columns;
+        while (previous_end > 0 && previous[previous_end - 1] == L' ')
+            previous_end--;
+
+        int cursor = -1; // Colonna del cursore del terminale su questa riga, -1 se altrove
+        for (int column = 0; column < end; column++) {
+            if (cells[column] == previous[column])
+                continue;
+
+            if (cursor != -1 && column > cursor && column - cursor <= TERM_FRAME_MAX_GAP) {
+                // Poche celle invariate: più breve riscriverle che spostare il cursore
+                while (cursor < column)
+                    length += _encode_term_cell(frame->output + length, cells[cursor++], &state);
+            } else if (cursor != column) {
+                length += sprintf(frame->output + length, "\e[%d;%dH", row + 1, column + 1);
+            }
+
+            length += _encode_term_cell(frame->output + length, cells[column], &state);
+            cursor = column + 1;
+        }
+
+        if (previous_end > end) {
+            if (cursor != end)
+                length += sprintf(frame->output + length, "\e[%d;%dH", row + 1, end + 1);
+            length += sprintf(frame->output + length, "\e[K");
+        }
+    }
+
+    // Cursore sotto il contenuto, e pulizia di quanto c'è sotto (es: input precedenti)
+    if (frame->rows_used < frame->rows)
+        length += sprintf(frame->output + length, "\e[%d;1H\e[J", frame->rows_used + 1);
+
+    // Quanto scritto prima con wprintf() deve arrivare prima del frame
+    fflush(stdout);
+    size_t written = 0;
+    while (written < length) {
+        ssize_t result = write(STDOUT_FILENO, frame->output + written, length - written);
+        if (result <= 0) {
+            if (result == -1 && errno == EINTR)
+                continue;
+            break;
+        }
+        written += result;
+    }
+    errno = 0;
+
+    wchar_t *swap = frame->previous;
+    frame->previous = frame->cells;
+    frame->cells = swap;
+    frame->previous_rows_used = frame->rows_used;
+    frame->redraw = 0;
+    clock_gettime(CLOCK_MONOTONIC, &frame->last_flush);
+}
+
+void free_term_frame(struct term_frame *frame) {
+    free(frame->cells);
+    free(frame->previous);
+    free(frame->output);
+    *frame = (struct term_frame) {};
+}
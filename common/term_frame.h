@@ -0,0 +1,103 @@
+#ifndef HW2_TERM_FRAME_H
+#define HW2_TERM_FRAME_H
+
+#include <stddef.h>
+#include <time.h>
+#include <wchar.h>
+
+/**
+ * Frame al secondo al massimo inviati al terminale, vedi term_frame_delay_millis()
+ */
+#define TERM_FRAME_MAX_FPS 10
+
+/**
+ * Dimensioni usate se lo stdout non è un terminale, ad esempio se rediretto su file
+ */
+#define TERM_FRAME_DEFAULT_COLUMNS 132
+#define TERM_FRAME_DEFAULT_ROWS 60
+
+/**
+ * Schermata da disegnare fuori dal terminale, in un buffer di celle.
+ * All'invio viene confrontata con quella precedente, e vengono scritte solo le celle cambiate
+ * con un'unica write(), posizionando il cursore con le sequenze ANSI.
+ *
+ * Utilizzo: begin_term_frame(), poi term_frame_printf() per il contenuto, poi flush_term_frame().
+ */
+struct term_frame {
+    int rows;
+    int columns;
+
+    /**
+     * Celle del frame in disegno, e quelle dell'ultimo frame inviato
+     */
+    wchar_t *cells;
+    wchar_t *previous;
+
+    /**
+     * Posizione di disegno, come il cursore di una printf
+     */
+    int row;
+    int column;
+
+    /**
+     * Righe con del contenuto nel frame in disegno e nell'ultimo inviato.
+     * Sotto quelle dell'ultimo frame il terminale può contenere altro (es: l'input dell'utente),
+     * quindi quelle righe vengono riscritte per intero.
+     */
+    int rows_used;
+    int previous_rows_used;
+
+    /**
+     * Diverso da zero se al prossimo invio lo schermo va pulito e ridisegnato
+     */
+    int redraw;
+
+    struct timespec last_flush;
+
+    /**
+     * Buffer della sequenza da scrivere sul terminale
+     */
+    char *output;
+    size_t output_capacity;
+};
+
+/**
+ * Inizia un nuovo frame vuoto, adattandolo alla dimensione attuale del terminale
+ *
+ * @param frame Frame, inizializzato a zero al primo utilizzo
+ * @return -1 se la memoria non è sufficiente, 0 altrimenti
+ */
+int begin_term_frame(struct term_frame *frame);
+
+/**
+ * Scrivi del testo nel frame dalla posizione di disegno, come wprintf().
+ * Gli a capo passano alla riga successiva, e quanto esce dal frame viene tagliato.
+ *
+ * @param frame Frame in disegno
+ * @param format Formato, come per wprintf()
+ * @param ... Argomenti del formato
+ */
+void term_frame_printf(struct term_frame *frame, const wchar_t *format, ...);
+
+/**
+ * Millisecondi da attendere prima di poter inviare un nuovo frame, per rispettare TERM_FRAME_MAX_FPS
+ */
+long term_frame_delay_millis(const struct term_frame *frame);
+
+/**
+ * Invia al terminale le celle cambiate dall'ultimo frame, con una sola write() sullo stdout.
+ * Il cursore viene lasciato sotto il contenuto, pulendo il resto dello schermo.
+ *
+ * Va chiamata con lo stdout bloccato se altri thread possono scriverci:
+ * lo stdout viene svuotato prima, per non mescolare le scritture.
+ *
+ * @param frame Frame disegnato
+ */
+void flush_term_frame(struct term_frame *frame);
+
+/**
+ * Libera i buffer del frame
+ */
+void free_term_frame(struct term_frame *frame);
+
+#endif //HW2_TERM_FRAME_H
@@ -0,0 +1,282 @@
+#include "typed_kernels.h"
+#include "math_kernels.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Nomi dei tipi, nell'ordine di enum operand_type
+ */
+const char *operand_type_names[OPERAND_TYPES_COUNT] = OPERAND_TYPE_NAMES;
+
+/**
+ * Byte di un registro SIMD: contiene il doppio dei float rispetto ai double
+ */
+#define VECTOR_BYTES (MATH_VECTOR_WIDTH * sizeof(double))
+
+/**
+ * Applica un operatore aritmetico di C elemento per elemento, a vettori SIMD e poi scalare per la coda.
+ * Usa le variabili left, right, results, count e i del kernel.
+ */
+#define VECTOR_LOOP(type, vector_type, operator)                                                    \
+    for (; i + sizeof(vector_type) / sizeof(type) <= count; i += sizeof(vector_type) / sizeof(type)) { \
+        vector_type a, b;                                                                           \
+        memcpy(&a, left + i, sizeof(vector_type));                                                  \
+        memcpy(&b, right + i, sizeof(vector_type));                                                 \
+        a = a operator b;                                                                           \
+        memcpy(results + i, &a, sizeof(vector_type));                                               \
+    }                                                                                               \
+    for (; i < count; i++)                                                                          \
+        results[i] = left[i] operator right[i];
+
+/**
+ * Applica un'operazione intera con controllo dell'overflow, come __builtin_add_overflow.
+ * Usa le variabili left, right, results, count e i del kernel.
+ */
+#define CHECKED_LOOP(checked_operation)                                                             \
+    for (; i < count; i++) {                                                                        \
+        if (checked_operation(left[i], right[i], &results[i])) {                                    \
+            errno = ERANGE;                                                                         \
+            return -1;                                                                              \
+        }                                                                                           \
+    }
+
+/**
+ * Kernel di un tipo in virgola mobile: le quattro operazioni a vettori SIMD,
+ * la potenza con la funzione arrotondata correttamente in doppia precisione.
+ */
+#define DEFINE_FLOAT_KERNEL(type, suffix)                                                           \
+typedef type vector_##suffix __attribute__((vector_size(VECTOR_BYTES)));                           \
+                                                                                                    \
+int _calculate_block_##suffix(const type *left, char operator, const type *right, type *results,  \
+                              size_t count) {                                                       \
+    size_t i = 0;                                                                                   \
+    switch (operator) {                                                                             \
+        case '+':                                                                                   \
+            VECTOR_LOOP(type, vector_##suffix, +)                                                   \
+            return 0;                                                                               \
+        case '-':                                                                                   \
+            VECTOR_LOOP(type, vector_##suffix, -)                                                   \
+            return 0;                                                                               \
+        case '*':                                                                                   \
+            VECTOR_LOOP(type, vector_##suffix, *)                                                   \
+            return 0;                                                                               \
+        case '/':                                                                                   \
+            VECTOR_LOOP(type, vector_##suffix, /)                                                   \
+            return 0;                                                                               \
+        case '^':                                                                                   \
+            for (; i < count; i++)                                                                  \
+                results[i] = (type) calculate_function(MATH_POW, MATH_MODE_EXACT, left[i], right[i]); \
+            return 0;                                                                               \
+        default:                                                                                    \
+            errno = EINVAL;                                                                         \
+            return -1;                                                                              \
+    }                                                                                               \
+}
+
+/**
+ * Kernel di un tipo intero con segno: overflow e divisione per zero sono errori.
+ * La potenza è per quadrati successivi; con esponente negativo è 1 / base^n troncato.
+ */
+#define DEFINE_INTEGER_KERNEL(type, suffix, type_min)                                               \
+int _integer_power_##suffix(type base, type exponent, type *result) {                              \
+    if (exponent < 0) {                                                                             \
+        if (base == 0) {                                                                            \
+            errno = EDOM;                                                                           \
+            return -1;                                                                              \
+        }                                                                                           \
+        *result = base == 1 ? 1 : base == -1 ? (exponent % 2 == 0 ? 1 : -1) : 0;                    \
+        return 0;                                                                                   \
+    }                                                                                               \
+                                                                                                    \
+    type power = 1;                                                                                 \
+    while (exponent > 0) {                                                                          \
+        if ((exponent & 1) && __builtin_mul_overflow(power, base, &power)) {                        \
+            errno = ERANGE;                                                                         \
+            return -1;                                                                              \
+        }                                                                                           \
+        exponent >>= 1;                                                                             \
+        if (exponent > 0 && __builtin_mul_overflow(base, base, &base)) {                            \
+            errno = ERANGE;                                                                         \
+            return -1;                                                                              \
+        }                                                                                           \
+    }                                                                                               \
+    *result = power;                                                                                \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+int _calculate_block_##suffix(const type *left, char operator, const type *right, type *results,  \
+                              size_t count) {                                                       \
+    size_t i = 0;                                                                                   \
+    switch (operator) {                                                                             \
+        case '+':                                                                                   \
+            CHECKED_LOOP(__builtin_add_overflow)                                                    \
+            return 0;                                                                               \
+        case '-':                                                                                   \
+            CHECKED_LOOP(__builtin_sub_overflow)                                                    \
+            return 0;                                                                               \
+        case '*':                                                                                   \
+            CHECKED_LOOP(__builtin_mul_overflow)                                                    \
+            return 0;                                                                               \
+        case '/':                                                                                   \
+        case '%':                                                                                   \
+            for (; i < count; i++) {                                                                \
+                if (right[i] == 0) {                                                                \
+                    errno = EDOM;                                                                   \
+                    return -1;                                                                      \
+                }                                                                                   \
+                /* Il minimo diviso -1 è l'unico quoziente che non sta nel tipo */                  \
+                if (left[i] == (type_min) && right[i] == -1) {                                      \
+                    if (operator == '/') {                                                          \
+                        errno = ERANGE;                                                             \
+                        return -1;                                                                  \
+                    }                                                                               \
+                    results[i] = 0;                                                                 \
+                    continue;                                                                       \
+                }                                                                                   \
+                results[i] = operator == '/' ? left[i] / right[i] : left[i] % right[i];             \
+            }                                                                                       \
+            return 0;                                                                               \
+        case '^':                                                                                   \
+            for (; i < count; i++) {                                                                \
+                if (_integer_power_##suffix(left[i], right[i], &results[i]) != 0)                   \
+                    return -1;                                                                      \
+            }                                                                                       \
+            return 0;                                                                               \
+        default:                                                                                    \
+            errno = EINVAL;                                                                         \
+            return -1;                                                                              \
+    }                                                                                               \
+}
+
+DEFINE_FLOAT_KERNEL(double, f64)
+
+DEFINE_FLOAT_KERNEL(float, f32)
+
+DEFINE_INTEGER_KERNEL(int64_t, i64, INT64_MIN)
+
+/**
+ * Cerca un tipo dal suo nome
+ *
+ * @param name Nome del tipo, non necessariamente terminato da \0
+ * @param name_len Lunghezza del nome
+ * @return Il tipo, oppure -1 se non esiste
+ */
+int find_operand_type(const char *name, size_t name_len) {
+    for (int type = 0; type < OPERAND_TYPES_COUNT; type++) {
+        if (strlen(operand_type_names[type]) == name_len && strncmp(operand_type_names[type], name, name_len) == 0)
+            return type;
+    }
+    return -1;
+}
+
+/**
+ * Dimensione in byte di un operando del tipo indicato
+ */
+size_t operand_type_size(enum operand_type type) {
+    switch (type) {
+        case OPERAND_TYPE_F32:
+            return sizeof(float);
+        case OPERAND_TYPE_I64:
+            return sizeof(int64_t);
+        default:
+            return sizeof(double);
+    }
+}
+
+/**
+ * Leggi un operando del tipo indicato. Gli interi devono essere scritti senza parte decimale.
+ *
+ * @param type Tipo dell'operando
+ * @param text Testo da leggere
+ * @param end Dove scrivere il puntatore al primo carattere non letto
+ * @param value Dove scrivere l'operando
+ * @return -1 se il testo non è un operando del tipo o è fuori intervallo, 0 altrimenti
+ */
+int parse_typed_operand(enum operand_type type, const char *text, char **end, union typed_operand *value) {
+    int status = 0;
+    errno = 0;
+    switch (type) {
+        case OPERAND_TYPE_F32:
+            value->f32 = strtof(text, end);
+            break;
+        case OPERAND_TYPE_I64:
+            value->i64 = strtoll(text, end, 10);
+            // Un intero con parte decimale o esponente non è un intero
+            status = errno == ERANGE || **end == '.' || **end == 'e' || **end == 'E' ? -1 : 0;
+            break;
+        default:
+            value->f64 = strtod(text, end);
+            break;
+    }
+    errno = 0;
+    return *end == text ? -1 : status;
+}
+
+/**
+ * Scrivi un operando con tutte le cifre necessarie a rileggerlo uguale
+ *
+ * @param type Tipo dell'operando
+ * @param value Operando
+ * @param buffer Buffer di almeno TYPED_OPERAND_STRING_SIZE caratteri
+ */
+void format_typed_operand(enum operand_type type, const union typed_operand *value, char *buffer) {
+    switch (type) {
+        case OPERAND_TYPE_F32:
+            snprintf(buffer, TYPED_OPERAND_STRING_SIZE, "%.9g", value->f32);
+            break;
+        case OPERAND_TYPE_I64:
+            snprintf(buffer, TYPED_OPERAND_STRING_SIZE, "%" PRId64, value->i64);
+            break;
+        default:
+            snprintf(buffer, TYPED_OPERAND_STRING_SIZE, "%.17g", value->f64);
+            break;
+    }
+}
+
+/**
+ * Converti un operando in double, ad esempio per il log
+ */
+operand_t typed_operand_to_double(enum operand_type type, const union typed_operand *value) {
+    switch (type) {
+        case OPERAND_TYPE_F32:
+            return value->f32;
+        case OPERAND_TYPE_I64:
+            return (operand_t) value->i64;
+        default:
+            return value->f64;
+    }
+}
+
+/**
+ * Elabora lo stesso operatore elemento per elemento su due vettori dello stesso tipo,
+ * con il kernel specifico per il tipo e l'operatore.
+ *
+ * I tipi in virgola mobile seguono IEEE 754 (la divisione per zero dà infinito);
+ * gli interi segnalano overflow e divisione per zero, e supportano anche il resto (%).
+ *
+ * Imposta errno in caso di errore: EINVAL per un operatore sconosciuto,
+ * ERANGE per un overflow intero, EDOM per una divisione intera per zero.
+ *
+ * @param type Tipo degli operandi
+ * @param left Operandi di sinistra
+ * @param operator Operatore
+ * @param right Operandi di destra
+ * @param results Dove scrivere i risultati, può coincidere con uno degli operandi
+ * @param count Numero di elementi
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int calculate_typed_block(enum operand_type type, const void *left, char operator, const void *right,
+                          void *results, size_t count) {
+    errno = 0;
+    switch (type) {
+        case OPERAND_TYPE_F32:
+            return _calculate_block_f32(left, operator, right, results, count);
+        case OPERAND_TYPE_I64:
+            return _calculate_block_i64(left, operator, right, results, count);
+        default:
+            return _calculate_block_f64(left, operator, right, results, count);
+    }
+}
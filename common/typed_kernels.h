@@ -0,0 +1,96 @@
+#ifndef HW2_TYPED_KERNELS_H
+#define HW2_TYPED_KERNELS_H
+
+#include "calc_utils.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Tipi degli operandi che il client può indicare per ogni richiesta.
+ * I nomi sono quelli da usare nel protocollo, nello stesso ordine.
+ */
+enum operand_type {
+    OPERAND_TYPE_F64,
+    OPERAND_TYPE_F32,
+    OPERAND_TYPE_I64,
+    OPERAND_TYPES_COUNT
+};
+
+#define OPERAND_TYPE_F64_NAME "f64"
+#define OPERAND_TYPE_NAMES {OPERAND_TYPE_F64_NAME, "f32", "i64"}
+
+/**
+ * Un operando di uno qualsiasi dei tipi
+ */
+union typed_operand {
+    double f64;
+    float f32;
+    int64_t i64;
+};
+
+/**
+ * Dimensione massima di un operando formattato da format_typed_operand()
+ */
+#define TYPED_OPERAND_STRING_SIZE 32
+
+/**
+ * Cerca un tipo dal suo nome
+ *
+ * @param name Nome del tipo, non necessariamente terminato da \0
+ * @param name_len Lunghezza del nome
+ * @return Il tipo, oppure -1 se non esiste
+ */
+int find_operand_type(const char *name, size_t name_len);
+
+/**
+ * Dimensione in byte di un operando del tipo indicato
+ */
+size_t operand_type_size(enum operand_type type);
+
+/**
+ * Leggi un operando del tipo indicato. Gli interi devono essere scritti senza parte decimale.
+ *
+ * @param type Tipo dell'operando
+ * @param text Testo da leggere
+ * @param end Dove scrivere il puntatore al primo carattere non letto
+ * @param value Dove scrivere l'operando
+ * @return -1 se il testo non è un operando del tipo o è fuori intervallo, 0 altrimenti
+ */
+int parse_typed_operand(enum operand_type type, const char *text, char **end, union typed_operand *value);
+
+/**
+ * Scrivi un operando con tutte le cifre necessarie a rileggerlo uguale
+ *
+ * @param type Tipo dell'operando
+ * @param value Operando
+ * @param buffer Buffer di almeno TYPED_OPERAND_STRING_SIZE caratteri
+ */
+void format_typed_operand(enum operand_type type, const union typed_operand *value, char *buffer);
+
+/**
+ * Converti un operando in double, ad esempio per il log
+ */
+operand_t typed_operand_to_double(enum operand_type type, const union typed_operand *value);
+
+/**
+ * Elabora lo stesso operatore elemento per elemento su due vettori dello stesso tipo,
+ * con il kernel specifico per il tipo e l'operatore.
+ *
+ * I tipi in virgola mobile seguono IEEE 754 (la divisione per zero dà infinito);
+ * gli interi segnalano overflow e divisione per zero, e supportano anche il resto (%).
+ *
+ * Imposta errno in caso di errore: EINVAL per un operatore sconosciuto,
+ * ERANGE per un overflow intero, EDOM per una divisione intera per zero.
+ *
+ * @param type Tipo degli operandi
+ * @param left Operandi di sinistra
+ * @param operator Operatore
+ * @param right Operandi di destra
+ * @param results Dove scrivere i risultati, può coincidere con uno degli operandi
+ * @param count Numero di elementi
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int calculate_typed_block(enum operand_type type, const void *left, char operator, const void *right,
+                          void *results, size_t count);
+
+#endif //HW2_TYPED_KERNELS_H
@@ -0,0 +1,155 @@
+#include "aggregate_request.h"
+#include "metrics.h"
+#include "../common/logger.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * Aggiungi all'aggregato i valori raccolti nel blocco
+ */
+void _flush_aggregate_block(struct aggregate_stream *stream) {
+    aggregate_add_block(&stream->aggregate, stream->block, stream->block_count);
+    stream->block_count = 0;
+}
+
+/**
+ * Raccogli i valori della linea nel blocco, aggiungendolo all'aggregato ogni volta che si riempie
+ *
+ * @param stream Aggregato della connessione
+ * @param arguments Valori separati da spazi
+ * @return -1 se c'è un valore non valido o non finito, 0 altrimenti
+ */
+int _add_aggregate_values(struct aggregate_stream *stream, const char *arguments) {
+    char *end;
+    for (operand_t value = strtod(arguments, &end); end != arguments; value = strtod(arguments, &end)) {
+        if (!isfinite(value))
+            return -1;
+
+        stream->block[stream->block_count++] = value;
+        if (stream->block_count == AGGREGATE_BLOCK_SIZE)
+            _flush_aggregate_block(stream);
+        arguments = end;
+    }
+
+    while (isspace((unsigned char) *arguments))
+        arguments++;
+    errno = 0;
+    return *arguments == '\0' ? 0 : -1;
+}
+
+/**
+ * Calcola la statistica richiesta
+ *
+ * @param stream Aggregato della connessione, con il blocco già aggiunto
+ * @param arguments Nome della statistica ed eventuale parametro
+ * @param result Dove scrivere il valore della statistica
+ * @return NULL in caso di successo, altrimenti il messaggio d'errore per il client
+ */
+const char *_aggregate_statistic(const struct aggregate_stream *stream, const char *arguments, operand_t *result) {
+    const struct aggregate *aggregate = &stream->aggregate;
+    const char *parameter;
+
+    if (stream->invalid)
+        return "Valore non valido nell'aggregato";
+
+    if (match_command(arguments, "count") != NULL) {
+        *result = (operand_t) aggregate->count;
+        return NULL;
+    }
+
+    if (aggregate->count == 0)
+        return "Aggregato vuoto";
+
+    if (match_command(arguments, "sum") != NULL) {
+        *result = aggregate_sum(aggregate);
+    } else if (match_command(arguments, "mean") != NULL) {
+        // Dalla somma compensata, più precisa della media di Welford
+        *result = aggregate_sum(aggregate) / (double) aggregate->count;
+    } else if (match_command(arguments, "var") != NULL || match_command(arguments, "stddev") != NULL) {
+        if (aggregate->count < 2)
+            return "Valori insufficienti";
+        *result = aggregate_variance(aggregate);
+        if (match_command(arguments, "stddev") != NULL)
+            *result = sqrt(*result);
+    } else if (match_command(arguments, "min") != NULL) {
+        *result = aggregate->min;
+    } else if (match_command(arguments, "max") != NULL) {
+        *result = aggregate->max;
+    } else if ((parameter = match_command(arguments, "quantile")) != NULL) {
+        char *end;
+        double quantile = strtod(parameter, &end);
+        errno = 0;
+        if (end == parameter || !(quantile >= 0 && quantile <= 1))
+            return "Quantile non valido";
+        *result = aggregate_quantile(aggregate, quantile);
+    } else {
+        return "Statistica sconosciuta";
+    }
+    return NULL;
+}
+
+/**
+ * Elabora un comando di aggregazione sulla connessione.
+ * Solo le statistiche richiedono una risposta: i valori aggiunti vengono raccolti
+ * in blocchi da AGGREGATE_BLOCK_SIZE, e gli eventuali errori segnalati alla prima statistica.
+ *
+ * @param client_info Informazioni sul client
+ * @param stream Aggregato della connessione, allocato al primo utilizzo
+ * @param arguments Argomenti del comando, dopo AGGREGATE_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_aggregate(const struct sock_info *client_info, struct aggregate_stream **stream,
+                        const char *arguments) {
+    struct timestamp start_time, end_time;
+    get_timestamp(&start_time);
+
+    while (isspace((unsigned char) *arguments))
+        arguments++;
+
+    if (*stream == NULL || match_command(arguments, "reset") != NULL) {
+        if (*stream == NULL)
+            *stream = malloc(sizeof(struct aggregate_stream));
+        aggregate_init(&(*stream)->aggregate);
+        (*stream)->block_count = 0;
+        (*stream)->invalid = 0;
+        if (match_command(arguments, "reset") != NULL)
+            return 0;
+    }
+
+    const char *values = match_command(arguments, "add");
+    if (values != NULL) {
+        // Nessuna risposta, per non rallentare il flusso: l'errore arriva con la prossima statistica
+        if (!(*stream)->invalid && _add_aggregate_values(*stream, values) != 0) {
+            log_message(client_info, "Valore non valido nell'aggregato\n");
+            (*stream)->invalid = 1;
+            return -1;
+        }
+        return 0;
+    }
+
+    operand_t result;
+    _flush_aggregate_block(*stream);
+    const char *error = _aggregate_statistic(*stream, arguments, &result);
+    if (error != NULL) {
+        log_message(client_info, "Errore nell'aggregato: %s\n", error);
+        fprintf(client_info->socket_output, "%c%s\n", SERVER_ERROR_MESSAGE_PREFIX, error);
+        return -1;
+    }
+
+    get_timestamp(&end_time);
+    char operation_line[64];
+    snprintf(operation_line, sizeof(operation_line), "%s %s", AGGREGATE_COMMAND, arguments);
+    log_result(client_info, operation_line, result, &start_time, &end_time);
+    add_metrics_operation(METRICS_AGGREGATE, &start_time, &end_time);
+
+    char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+    char end_time_str[TIMESTAMP_STRING_SIZE] = {};
+    timestamp_to_string(&start_time, start_time_str);
+    timestamp_to_string(&end_time, end_time_str);
+    fprintf(client_info->socket_output, "%s %s %.17g\n", start_time_str, end_time_str, result);
+    return 0;
+}
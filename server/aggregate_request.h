@@ -0,0 +1,43 @@
+#ifndef SERVER_AGGREGATE_REQUEST_H
+#define SERVER_AGGREGATE_REQUEST_H
+
+#include "../common/socket_utils.h"
+#include "../common/aggregate.h"
+
+/**
+ * Comando per le statistiche su un flusso di valori:
+ * agg add X1 X2 ...       aggiunge valori, senza risposta
+ * agg STATISTICA          count sum mean var stddev min max
+ * agg quantile P          quantile approssimato, P in [0, 1]
+ * agg reset               svuota l'aggregato
+ */
+#define AGGREGATE_COMMAND "agg"
+
+/**
+ * Aggregato di una connessione, con i valori ricevuti ma non ancora aggiunti
+ */
+struct aggregate_stream {
+    struct aggregate aggregate;
+    operand_t block[AGGREGATE_BLOCK_SIZE];
+    size_t block_count;
+
+    /**
+     * Vero se è arrivato un valore non valido: le statistiche restano in errore fino al reset
+     */
+    int invalid;
+};
+
+/**
+ * Elabora un comando di aggregazione sulla connessione.
+ * Solo le statistiche richiedono una risposta: i valori aggiunti vengono raccolti
+ * in blocchi da AGGREGATE_BLOCK_SIZE, e gli eventuali errori segnalati alla prima statistica.
+ *
+ * @param client_info Informazioni sul client
+ * @param stream Aggregato della connessione, allocato al primo utilizzo
+ * @param arguments Argomenti del comando, dopo AGGREGATE_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_aggregate(const struct sock_info *client_info, struct aggregate_stream **stream,
+                        const char *arguments);
+
+#endif //SERVER_AGGREGATE_REQUEST_H
@@ -0,0 +1,422 @@
+#include "async_log.h"
+#include "log_segment.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Attesa di un thread con il ring pieno e politica LOG_FULL_BLOCK, prima di ricontrollare
+ */
+#define LOG_BLOCK_WAIT_NANOS 100000
+
+/**
+ * Stato del thread di scrittura
+ */
+enum log_writer_state {
+    LOG_WRITER_IDLE,
+    LOG_WRITER_RUNNING,
+
+    /**
+     * Arrestato da flush_logging() o mai avviato: i record vengono scritti direttamente
+     */
+    LOG_WRITER_STOPPED
+};
+
+_Atomic int log_writer_state = LOG_WRITER_IDLE;
+pthread_t log_writer_thread;
+pthread_once_t log_writer_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Chiave con il distruttore che chiude il ring di un thread terminato
+ */
+pthread_key_t log_ring_key;
+
+/**
+ * Lista dei ring dei thread. Il mutex protegge la lista e il buffer del thread di scrittura,
+ * e con la condizione sveglia il thread di scrittura quando un ring si sta riempiendo.
+ */
+struct log_ring *log_rings = NULL;
+pthread_mutex_t log_rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t log_writer_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Ring del thread corrente, NULL fino al primo log
+ */
+_Thread_local struct log_ring *thread_log_ring = NULL;
+
+/**
+ * Record usato quando il thread di scrittura non è attivo, scritto direttamente alla pubblicazione
+ */
+_Thread_local struct log_record direct_log_record;
+
+/**
+ * Record scartati con la politica LOG_FULL_DROP, e quanti ne sono già stati segnalati nel log
+ */
+_Atomic unsigned long dropped_logs = 0;
+unsigned long reported_dropped_logs = 0;
+
+/**
+ * Diverso da zero per scrivere i log anche sullo stdout, vedi set_log_stdout()
+ */
+_Atomic int log_stdout_enabled = 1;
+
+/**
+ * Linee formattate, o record binari, in attesa di essere scritti
+ */
+_Alignas(8) char log_batch[LOG_BATCH_SIZE];
+size_t log_batch_length = 0;
+
+/**
+ * Inizio nel buffer degli ultimi LOGS_ARRAY_SIZE record, per aggiornare gli ultimi log
+ */
+size_t log_batch_records[LOGS_ARRAY_SIZE];
+size_t log_batch_records_count = 0;
+
+/**
+ * Distruttore della chiave: il thread è terminato, il suo ring verrà liberato una volta svuotato
+ */
+void _close_log_ring(void *ring) {
+    atomic_store_explicit(&((struct log_ring *) ring)->closed, 1, memory_order_release);
+}
+
+/**
+ * Converti un record del ring nel suo record binario
+ *
+ * @param binary Dove scrivere il record, con spazio per LOG_LINE_MAX_SIZE + 7 byte di testo
+ */
+void _encode_log_record(const struct log_record *record, struct log_binary_record *binary) {
+    *binary = (struct log_binary_record) {
+            .type = record->type == LOG_RECORD_RESULT ? LOG_BINARY_RESULT : LOG_BINARY_MESSAGE,
+            .flags = record->has_client ? LOG_BINARY_HAS_CLIENT : 0
+    };
+    if (record->has_client) {
+        binary->client_address = record->client.sin_addr.s_addr;
+        binary->client_port = record->client.sin_port;
+    }
+
+    if (record->type == LOG_RECORD_RESULT) {
+        struct tm start_time = record->start_time.time;
+        binary->start_seconds = mktime(&start_time);
+        binary->start_micros = record->start_time.microseconds;
+        binary->elapsed_micros = record->elapsed_micros < UINT32_MAX ? record->elapsed_micros : UINT32_MAX;
+        binary->operator = record->operator;
+        binary->left = record->left;
+        binary->right = record->right;
+        binary->result = record->result;
+    }
+
+    binary->text_length = record->text_length;
+    memcpy(binary + 1, record->text, record->text_length);
+
+    // Dimensione multipla di 8, così i record consecutivi restano allineati
+    binary->size = (sizeof(struct log_binary_record) + binary->text_length + 7) & ~7;
+    memset((char *) (binary + 1) + binary->text_length, 0,
+           binary->size - sizeof(struct log_binary_record) - binary->text_length);
+}
+
+/**
+ * Scrivi tutti i byte sul file descriptor
+ */
+void _write_log_batch(int fd, const char *bytes, size_t length) {
+    for (size_t written = 0; written < length;) {
+        ssize_t result = write(fd, bytes + written, length - written);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result <= 0) {
+            errno = 0;
+            return; // Disco pieno o file non scrivibile: non c'è dove segnalarlo
+        }
+        written += result;
+    }
+}
+
+/**
+ * Scrivi il buffer nel segmento di log e sullo stdout.
+ * Gli ultimi record vanno tra gli ultimi log, per la tabella. Da chiamare con log_rings_mutex.
+ *
+ * Con il formato binario sullo stdout vanno solo gli ultimi record, gli unici formattati.
+ */
+void _flush_log_batch(void) {
+    if (log_batch_length == 0)
+        return;
+
+    append_log_segment(log_batch, log_batch_length);
+
+    char lines[LOGS_ARRAY_SIZE * 2 * LOG_LINE_MAX_SIZE];
+    size_t lines_length = 0;
+
+    size_t kept = log_batch_records_count < LOGS_ARRAY_SIZE ? log_batch_records_count : LOGS_ARRAY_SIZE;
+    for (size_t i = log_batch_records_count - kept; i < log_batch_records_count; i++) {
+        size_t start = log_batch_records[i % LOGS_ARRAY_SIZE];
+        size_t end = i + 1 < log_batch_records_count ? log_batch_records[(i + 1) % LOGS_ARRAY_SIZE]
+                                                     : log_batch_length;
+        if (LOG_FILE_BINARY) {
+            end = lines_length + format_log_binary_record((const struct log_binary_record *) (log_batch + start),
+                                                          lines + lines_length, 2 * LOG_LINE_MAX_SIZE);
+            start = lines_length;
+            lines_length = end;
+        }
+
+        push_recent_log((LOG_FILE_BINARY ? lines : log_batch) + start, end - start);
+    }
+
+    // Le linee sono già multibyte: scrivile direttamente, dopo quanto è ancora nel buffer dello stdout
+    if (atomic_load_explicit(&log_stdout_enabled, memory_order_relaxed)) {
+        flockfile(stdout);
+        fflush(stdout);
+        if (LOG_FILE_BINARY)
+            _write_log_batch(STDOUT_FILENO, lines, lines_length);
+        else
+            _write_log_batch(STDOUT_FILENO, log_batch, log_batch_length);
+        funlockfile(stdout);
+    }
+
+    log_batch_length = 0;
+    log_batch_records_count = 0;
+}
+
+/**
+ * Aggiungi un record al buffer, formattato o binario, scrivendolo prima se non ha abbastanza spazio.
+ * Da chiamare con log_rings_mutex.
+ */
+void _append_log_record(const struct log_record *record) {
+    if (LOG_BATCH_SIZE - log_batch_length < 2 * LOG_LINE_MAX_SIZE + sizeof(struct log_binary_record))
+        _flush_log_batch();
+
+    _Alignas(8) char encoded[sizeof(struct log_binary_record) + LOG_LINE_MAX_SIZE + 7];
+    struct log_binary_record *binary = (struct log_binary_record *) encoded;
+    _encode_log_record(record, binary);
+
+    log_batch_records[log_batch_records_count++ % LOGS_ARRAY_SIZE] = log_batch_length;
+    if (LOG_FILE_BINARY) {
+        memcpy(log_batch + log_batch_length, binary, binary->size);
+        log_batch_length += binary->size;
+    } else {
+        log_batch_length += format_log_binary_record(binary, log_batch + log_batch_length,
+                                                     LOG_BATCH_SIZE - log_batch_length);
+    }
+}
+
+/**
+ * Svuota tutti i ring nel buffer, liberando quelli dei thread terminati.
+ *
+ * @return Numero di record estratti
+ */
+size_t _drain_log_rings(void) {
+    size_t drained = 0;
+    pthread_mutex_lock(&log_rings_mutex);
+
+    for (struct log_ring **link = &log_rings; *link != NULL;) {
+        struct log_ring *ring = *link;
+        // Letto prima di svuotare: se il thread era terminato, dopo non può aggiungere altro
+        int closed = atomic_load_explicit(&ring->closed, memory_order_acquire);
+
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        for (; head != tail; head++, drained++) {
+            _append_log_record(&ring->records[head & (LOG_RING_SLOTS - 1)]);
+            atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+        }
+
+        if (closed) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+
+    unsigned long dropped = atomic_load_explicit(&dropped_logs, memory_order_relaxed);
+    if (dropped != reported_dropped_logs) {
+        struct log_record record = {.type = LOG_RECORD_MESSAGE};
+        record.text_length = snprintf(record.text, LOG_LINE_MAX_SIZE, "%lu messaggi di log persi, ring pieni\n",
+                                      dropped - reported_dropped_logs);
+        _append_log_record(&record);
+        reported_dropped_logs = dropped;
+    }
+
+    if (drained == 0)
+        _flush_log_batch();
+    pthread_mutex_unlock(&log_rings_mutex);
+    return drained;
+}
+
+/**
+ * Controlla se qualche thread sta compilando un record
+ */
+int _log_rings_writing(void) {
+    int writing = 0;
+    pthread_mutex_lock(&log_rings_mutex);
+    for (const struct log_ring *ring = log_rings; ring != NULL && !writing; ring = ring->next)
+        writing = atomic_load(&ring->writing);
+    pthread_mutex_unlock(&log_rings_mutex);
+    return writing;
+}
+
+/**
+ * Thread di scrittura: svuota i ring, formatta i record e li scrive a blocchi.
+ * All'arresto attende i record in compilazione e svuota tutto.
+ */
+void *_log_writer(void *argument) {
+    while (atomic_load(&log_writer_state) == LOG_WRITER_RUNNING) {
+        if (_drain_log_rings() > 0)
+            continue;
+
+        struct timespec time_to_wait;
+        clock_gettime(CLOCK_REALTIME, &time_to_wait);
+        time_to_wait.tv_nsec += LOG_FLUSH_INTERVAL_MILLIS * 1000000L;
+        time_to_wait.tv_sec += time_to_wait.tv_nsec / 1000000000L;
+        time_to_wait.tv_nsec %= 1000000000L;
+        pthread_mutex_lock(&log_rings_mutex);
+        if (atomic_load(&log_writer_state) == LOG_WRITER_RUNNING)
+            pthread_cond_timedwait(&log_writer_cond, &log_rings_mutex, &time_to_wait);
+        pthread_mutex_unlock(&log_rings_mutex);
+    }
+
+    // I thread che hanno visto lo stato prima dell'arresto pubblicheranno ancora nel ring:
+    // svuotarlo intanto sblocca anche quelli in attesa con LOG_FULL_BLOCK
+    while (_log_rings_writing()) {
+        _drain_log_rings();
+        sched_yield();
+    }
+    while (_drain_log_rings() > 0);
+    return argument;
+}
+
+/**
+ * Avvia il thread di scrittura, al primo log
+ */
+void _start_log_writer(void) {
+    int expected = LOG_WRITER_IDLE;
+    if (!atomic_compare_exchange_strong(&log_writer_state, &expected, LOG_WRITER_RUNNING))
+        return; // Già arrestato da flush_logging()
+
+    if (pthread_key_create(&log_ring_key, _close_log_ring) != 0 ||
+        pthread_create(&log_writer_thread, NULL, _log_writer, NULL) != 0) {
+        errno = 0;
+        atomic_store(&log_writer_state, LOG_WRITER_STOPPED);
+    }
+}
+
+/**
+ * Ring del thread corrente, allocato e registrato al primo utilizzo
+ *
+ * @return Il ring, o NULL se manca la memoria
+ */
+struct log_ring *_get_thread_log_ring(void) {
+    if (thread_log_ring != NULL)
+        return thread_log_ring;
+
+    struct log_ring *ring = aligned_alloc(_Alignof(struct log_ring), sizeof(struct log_ring));
+    if (ring == NULL) {
+        errno = 0;
+        return NULL;
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->writing, 0);
+    atomic_init(&ring->closed, 0);
+
+    pthread_mutex_lock(&log_rings_mutex);
+    ring->next = log_rings;
+    log_rings = ring;
+    pthread_mutex_unlock(&log_rings_mutex);
+
+    pthread_setspecific(log_ring_key, ring);
+    thread_log_ring = ring;
+    return ring;
+}
+
+/**
+ * Imposta i campi comuni del record
+ */
+struct log_record *_init_log_record(struct log_record *record, const struct sock_info *client_info,
+                                    enum log_record_type type) {
+    record->type = type;
+    record->has_client = client_info != NULL;
+    if (client_info != NULL)
+        record->client = client_info->client_info;
+    record->operator = '\0';
+    record->text_length = 0;
+    return record;
+}
+
+struct log_record *begin_log_record(const struct sock_info *client_info, enum log_record_type type) {
+    pthread_once(&log_writer_once, _start_log_writer);
+
+    struct log_ring *ring = atomic_load(&log_writer_state) == LOG_WRITER_RUNNING ? _get_thread_log_ring() : NULL;
+    if (ring != NULL) {
+        // Dichiara la scrittura prima di controllare lo stato: all'arresto
+        // il thread di scrittura vede il flag, oppure qui si vede l'arresto
+        atomic_store(&ring->writing, 1);
+        if (atomic_load(&log_writer_state) == LOG_WRITER_RUNNING) {
+            uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            while (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == LOG_RING_SLOTS) {
+                if (LOG_FULL_POLICY == LOG_FULL_DROP) {
+                    atomic_fetch_add_explicit(&dropped_logs, 1, memory_order_relaxed);
+                    atomic_store_explicit(&ring->writing, 0, memory_order_release);
+                    return NULL;
+                }
+
+                pthread_cond_signal(&log_writer_cond);
+                nanosleep(&(struct timespec) {0, LOG_BLOCK_WAIT_NANOS}, NULL);
+            }
+            return _init_log_record(&ring->records[tail & (LOG_RING_SLOTS - 1)], client_info, type);
+        }
+        atomic_store(&ring->writing, 0);
+    }
+
+    return _init_log_record(&direct_log_record, client_info, type);
+}
+
+void commit_log_record(struct log_record *record) {
+    if (record == &direct_log_record) {
+        // Senza il thread di scrittura nessuno chiuderebbe il segmento: chiudilo subito
+        pthread_mutex_lock(&log_rings_mutex);
+        _append_log_record(record);
+        _flush_log_batch();
+        close_log_segment();
+        pthread_mutex_unlock(&log_rings_mutex);
+        return;
+    }
+
+    struct log_ring *ring = thread_log_ring;
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed) + 1;
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    atomic_store_explicit(&ring->writing, 0, memory_order_release);
+
+    // Sveglia il thread di scrittura solo se il ring si sta riempiendo, altrimenti attende il suo intervallo
+    if (tail - atomic_load_explicit(&ring->head, memory_order_relaxed) >= LOG_RING_SLOTS / 2)
+        pthread_cond_signal(&log_writer_cond);
+}
+
+void set_log_stdout(int enabled) {
+    atomic_store_explicit(&log_stdout_enabled, enabled, memory_order_relaxed);
+}
+
+unsigned long get_dropped_logs() {
+    return atomic_load_explicit(&dropped_logs, memory_order_relaxed);
+}
+
+/**
+ * Arresta il thread di scrittura dopo aver scritto tutti i record pubblicati.
+ * I log successivi vengono scritti direttamente.
+ */
+void flush_logging() {
+    if (atomic_exchange(&log_writer_state, LOG_WRITER_STOPPED) != LOG_WRITER_RUNNING)
+        return;
+
+    pthread_mutex_lock(&log_rings_mutex);
+    pthread_cond_signal(&log_writer_cond);
+    pthread_mutex_unlock(&log_rings_mutex);
+    pthread_join(log_writer_thread, NULL);
+
+    pthread_mutex_lock(&log_rings_mutex);
+    close_log_segment();
+    pthread_mutex_unlock(&log_rings_mutex);
+}
@@ -0,0 +1,149 @@
+#ifndef SERVER_ASYNC_LOG_H
+#define SERVER_ASYNC_LOG_H
+
+#include "../common/logger.h"
+#include "../common/log_format.h"
+#include <netinet/in.h>
+#include <stdatomic.h>
+
+/**
+ * Record per ogni ring di un thread. Deve essere una potenza di 2.
+ */
+#define LOG_RING_SLOTS 128
+
+/**
+ * Dimensione del buffer con cui il thread di scrittura raccoglie le linee formattate
+ * (o i record binari, vedi LOG_FILE_BINARY), scritte con una sola write() quando è pieno o i ring sono vuoti
+ */
+#define LOG_BATCH_SIZE (64 * 1024)
+
+/**
+ * Attesa massima del thread di scrittura tra due controlli dei ring
+ */
+#define LOG_FLUSH_INTERVAL_MILLIS 20
+
+/**
+ * Comportamento di un thread che trova il suo ring pieno
+ */
+enum log_full_policy {
+    /**
+     * Scarta il record, contandolo: il thread non attende mai il disco
+     */
+    LOG_FULL_DROP,
+
+    /**
+     * Attendi che il thread di scrittura liberi spazio: nessun record viene perso
+     */
+    LOG_FULL_BLOCK
+};
+
+/**
+ * Politica usata con i ring pieni
+ */
+#define LOG_FULL_POLICY LOG_FULL_BLOCK
+
+/**
+ * Tipo di record di log, che decide come viene formattato
+ */
+enum log_record_type {
+    /**
+     * Messaggio già formattato da log_message()
+     */
+    LOG_RECORD_MESSAGE,
+
+    /**
+     * Risultato di un'operazione, da log_result(): formattato solo dal thread di scrittura
+     */
+    LOG_RECORD_RESULT
+};
+
+/**
+ * Record di dimensione fissa in un ring. I campi grezzi vengono formattati dal thread di scrittura.
+ */
+struct log_record {
+    enum log_record_type type;
+
+    /**
+     * Diverso da zero se client contiene l'indirizzo del client, altrimenti il log è del processo
+     */
+    int has_client;
+    struct sockaddr_in client;
+
+    /**
+     * Solo per LOG_RECORD_RESULT: inizio, durata e risultato del calcolo
+     */
+    struct timestamp start_time;
+    uint64_t elapsed_micros;
+    operand_t result;
+
+    /**
+     * Solo per LOG_RECORD_RESULT: operatore e operandi, o '\0' se l'operazione è solo nel testo
+     */
+    char operator;
+    operand_t left;
+    operand_t right;
+
+    /**
+     * Messaggio, oppure linea dell'operazione per LOG_RECORD_RESULT. Non terminato da \0.
+     */
+    uint16_t text_length;
+    char text[LOG_LINE_MAX_SIZE];
+};
+
+/**
+ * Ring single-producer single-consumer di un thread: il thread produce, il thread di scrittura consuma.
+ * Gli indici sono su linee di cache diverse, come in struct shm_ring.
+ */
+struct log_ring {
+    _Alignas(64) _Atomic uint32_t head;
+    _Alignas(64) _Atomic uint32_t tail;
+
+    /**
+     * Diverso da zero tra begin_log_record() e commit_log_record()
+     */
+    _Atomic int writing;
+
+    /**
+     * Diverso da zero quando il thread è terminato: il ring verrà liberato una volta svuotato
+     */
+    _Atomic int closed;
+
+    struct log_ring *next;
+    struct log_record records[LOG_RING_SLOTS];
+};
+
+/**
+ * Riserva il prossimo record nel ring del thread chiamante, creandolo al primo utilizzo.
+ * Il record va completato e poi pubblicato con commit_log_record().
+ *
+ * Dopo flush_logging(), o se il thread di scrittura non è disponibile,
+ * il record viene scritto direttamente alla pubblicazione.
+ *
+ * @param client_info Informazioni sul client, può essere NULL
+ * @param type Tipo di record
+ * @return Il record da compilare, o NULL se il ring è pieno e la politica è LOG_FULL_DROP
+ */
+struct log_record *begin_log_record(const struct sock_info *client_info, enum log_record_type type);
+
+/**
+ * Pubblica il record riservato con begin_log_record()
+ *
+ * @param record Record compilato
+ */
+void commit_log_record(struct log_record *record);
+
+/**
+ * Abilita o disabilita la scrittura dei log sullo stdout. Il file di log e gli ultimi log
+ * (read_recent_logs()) vengono aggiornati comunque: la tabella di stato disabilita lo stdout
+ * mentre è visualizzata, perché i suoi frame aggiornano solo le celle cambiate.
+ *
+ * @param enabled Diverso da zero per scrivere sullo stdout
+ */
+void set_log_stdout(int enabled);
+
+/**
+ * Numero di record scartati perché il ring del loro thread era pieno
+ */
+unsigned long get_dropped_logs();
+
+#endif //SERVER_ASYNC_LOG_H
@@ -0,0 +1,223 @@
+#include "bignum_request.h"
+#include "metrics.h"
+#include "../common/bignum.h"
+#include "../common/logger.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * Numero decimale a precisione arbitraria: vale mantissa * 10^-scale
+ */
+struct big_decimal {
+    struct bignum mantissa;
+    size_t scale;
+};
+
+/**
+ * Leggi la parola successiva degli argomenti
+ *
+ * @param arguments Puntatore agli argomenti, avanzato oltre la parola
+ * @param word_len Dove scrivere la lunghezza della parola
+ * @return Inizio della parola, NULL se non ce ne sono altre
+ */
+const char *_next_word(const char **arguments, size_t *word_len) {
+    const char *word = *arguments;
+    while (isspace((unsigned char) *word))
+        word++;
+
+    const char *end = word;
+    while (*end != '\0' && !isspace((unsigned char) *end))
+        end++;
+
+    *arguments = end;
+    *word_len = end - word;
+    return *word_len > 0 ? word : NULL;
+}
+
+/**
+ * Leggi un numero decimale con segno e punto opzionali, es: -123.4500
+ *
+ * @param number Dove scrivere il numero, già inizializzato
+ * @param text Testo del numero
+ * @param text_len Lunghezza del testo
+ * @return -1 se il testo non è un numero o è troppo lungo, 0 altrimenti
+ */
+int _parse_big_decimal(struct big_decimal *number, const char *text, size_t text_len) {
+    if (text_len > BIGNUM_MAX_DIGITS)
+        return -1;
+
+    const char *point = memchr(text, '.', text_len);
+    if (point == NULL) {
+        number->scale = 0;
+        return bignum_from_string(&number->mantissa, text, text_len);
+    }
+
+    // Togli il punto: le cifre dopo diventano la scala
+    size_t integer_len = point - text;
+    number->scale = text_len - integer_len - 1;
+    char *digits = malloc(text_len);
+    memcpy(digits, text, integer_len);
+    memcpy(digits + integer_len, point + 1, number->scale);
+
+    // Almeno una cifra, come in "5." o ".5", ma non solo il punto
+    int digits_before = integer_len > 0 && isdigit((unsigned char) text[integer_len - 1]);
+    int status = number->scale == 0 && !digits_before ? -1
+                                                      : bignum_from_string(&number->mantissa, digits, text_len - 1);
+    free(digits);
+    return status;
+}
+
+/**
+ * Porta un numero alla scala indicata, maggiore o uguale a quella attuale
+ */
+void _rescale(struct big_decimal *number, size_t scale) {
+    bignum_shift_decimal(&number->mantissa, &number->mantissa, scale - number->scale);
+    number->scale = scale;
+}
+
+/**
+ * Esegui l'operazione tra i due numeri
+ *
+ * @param result Dove scrivere il risultato
+ * @param left Operando sinistro, può venire modificato
+ * @param operator Operatore
+ * @param right Operando destro, può venire modificato
+ * @param division_scale Cifre decimali del quoziente
+ * @return NULL in caso di successo, altrimenti il messaggio d'errore per il client
+ */
+const char *_calculate_big(struct big_decimal *result, struct big_decimal *left, char operator,
+                           struct big_decimal *right, size_t division_scale) {
+    size_t left_digits = bignum_digits(&left->mantissa), right_digits = bignum_digits(&right->mantissa);
+
+    switch (operator) {
+        case '+':
+        case '-':
+            // Allinea le scale prima di sommare
+            if (left->scale < right->scale)
+                _rescale(left, right->scale);
+            else
+                _rescale(right, left->scale);
+            result->scale = left->scale;
+            if (operator == '+')
+                bignum_add(&result->mantissa, &left->mantissa, &right->mantissa);
+            else
+                bignum_subtract(&result->mantissa, &left->mantissa, &right->mantissa);
+            return NULL;
+        case '*':
+            if (left_digits + right_digits > BIGNUM_MAX_DIGITS)
+                return "Risultato troppo grande";
+            result->scale = left->scale + right->scale;
+            bignum_multiply(&result->mantissa, &left->mantissa, &right->mantissa);
+            return NULL;
+        case '/':
+            if (right->mantissa.size == 0)
+                return "Divisione per zero";
+            // (ml / 10^sl) / (mr / 10^sr) * 10^S = ml * 10^(S + sr) / (mr * 10^sl)
+            if (left_digits + division_scale + right->scale > BIGNUM_MAX_DIGITS ||
+                right_digits + left->scale > BIGNUM_MAX_DIGITS)
+                return "Risultato troppo grande";
+            bignum_shift_decimal(&left->mantissa, &left->mantissa, division_scale + right->scale);
+            bignum_shift_decimal(&right->mantissa, &right->mantissa, left->scale);
+            result->scale = division_scale;
+            bignum_divide(&result->mantissa, NULL, &left->mantissa, &right->mantissa);
+            return NULL;
+        case '%':
+            if (left->scale != 0 || right->scale != 0)
+                return "Resto solo tra interi";
+            if (right->mantissa.size == 0)
+                return "Divisione per zero";
+            result->scale = 0;
+            bignum_divide(NULL, &result->mantissa, &left->mantissa, &right->mantissa);
+            return NULL;
+        case '^': {
+            // L'esponente è un intero non negativo che sta in una cifra
+            if (right->scale != 0 || right->mantissa.negative || right->mantissa.size > 1)
+                return "Esponente non valido";
+            uint64_t exponent = right->mantissa.size == 1 ? right->mantissa.limbs[0] : 0;
+            if (left->mantissa.size > 0 &&
+                ((left_digits - 1) * exponent > BIGNUM_MAX_DIGITS || left->scale * exponent > BIGNUM_MAX_DIGITS))
+                return "Risultato troppo grande";
+            result->scale = left->scale * exponent;
+            bignum_power(&result->mantissa, &left->mantissa, exponent);
+            return NULL;
+        }
+        default:
+            return "Operazione sconosciuta";
+    }
+}
+
+/**
+ * Calcola un'operazione tra interi o decimali a precisione arbitraria, inviando al client
+ * la linea di risposta col risultato completo: [timestamp ricezione, timestamp fine, risultato].
+ *
+ * Gli operatori sono + - * / % ^. La divisione è troncata a CIFRE_DECIMALI cifre dopo la virgola,
+ * di default il massimo tra quelle degli operandi (quindi intera tra interi).
+ * Il resto è definito solo tra interi, e l'esponente deve essere un intero non negativo.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo BIGNUM_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_bignum(const struct sock_info *client_info, const char *arguments) {
+    struct timestamp start_time, end_time;
+    get_timestamp(&start_time);
+
+    struct big_decimal left = {}, right = {}, result = {};
+    bignum_init(&left.mantissa);
+    bignum_init(&right.mantissa);
+    bignum_init(&result.mantissa);
+
+    const char *error = NULL;
+    size_t operator_len, left_len, right_len, scale_len, extra_len;
+    const char *operator = _next_word(&arguments, &operator_len);
+    const char *left_text = _next_word(&arguments, &left_len);
+    const char *right_text = _next_word(&arguments, &right_len);
+    const char *scale_text = _next_word(&arguments, &scale_len);
+
+    if (operator == NULL || operator_len != 1 || left_text == NULL || right_text == NULL ||
+        _parse_big_decimal(&left, left_text, left_len) != 0 ||
+        _parse_big_decimal(&right, right_text, right_len) != 0 || _next_word(&arguments, &extra_len) != NULL) {
+        error = "Numero non valido";
+    }
+
+    // Le cifre decimali del quoziente, se non indicate, sono quelle dell'operando più preciso
+    size_t division_scale = left.scale > right.scale ? left.scale : right.scale;
+    if (error == NULL && scale_text != NULL) {
+        char *end;
+        long scale = strtol(scale_text, &end, 10);
+        if (end != scale_text + scale_len || scale < 0 || scale > BIGNUM_MAX_DIGITS)
+            error = "Cifre decimali non valide";
+        division_scale = scale;
+    }
+
+    if (error == NULL)
+        error = _calculate_big(&result, &left, *operator, &right, division_scale);
+
+    char *result_text = error == NULL ? bignum_to_string(&result.mantissa, result.scale) : NULL;
+    bignum_free(&left.mantissa);
+    bignum_free(&right.mantissa);
+    bignum_free(&result.mantissa);
+    errno = 0;
+
+    if (error != NULL) {
+        log_message(client_info, "Errore nell'operazione a precisione arbitraria: %s\n", error);
+        fprintf(client_info->socket_output, "%c%s\n", SERVER_ERROR_MESSAGE_PREFIX, error);
+        return -1;
+    }
+
+    get_timestamp(&end_time);
+    log_result(client_info, BIGNUM_COMMAND, strtod(result_text, NULL), &start_time, &end_time);
+    add_metrics_operation(METRICS_BIGNUM, &start_time, &end_time);
+    errno = 0;
+
+    char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+    char end_time_str[TIMESTAMP_STRING_SIZE] = {};
+    timestamp_to_string(&start_time, start_time_str);
+    timestamp_to_string(&end_time, end_time_str);
+    fprintf(client_info->socket_output, "%s %s %s\n", start_time_str, end_time_str, result_text);
+    free(result_text);
+    return 0;
+}
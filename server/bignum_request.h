@@ -0,0 +1,26 @@
+#ifndef SERVER_BIGNUM_REQUEST_H
+#define SERVER_BIGNUM_REQUEST_H
+
+#include "../common/socket_utils.h"
+
+/**
+ * Comando per un'operazione a precisione arbitraria:
+ * big OPERATORE SINISTRO DESTRO [CIFRE_DECIMALI]
+ */
+#define BIGNUM_COMMAND "big"
+
+/**
+ * Calcola un'operazione tra interi o decimali a precisione arbitraria, inviando al client
+ * la linea di risposta col risultato completo: [timestamp ricezione, timestamp fine, risultato].
+ *
+ * Gli operatori sono + - * / % ^. La divisione è troncata a CIFRE_DECIMALI cifre dopo la virgola,
+ * di default il massimo tra quelle degli operandi (quindi intera tra interi).
+ * Il resto è definito solo tra interi, e l'esponente deve essere un intero non negativo.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo BIGNUM_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_bignum(const struct sock_info *client_info, const char *arguments);
+
+#endif //SERVER_BIGNUM_REQUEST_H
@@ -0,0 +1,456 @@
+#include "calculus.h"
+#include "thread_pool.h"
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Nodi di Kronrod a 15 punti su [-1, 1] (positivi, l'ultimo è il centro):
+ * quelli di indice dispari sono anche i nodi di Gauss a 7 punti
+ */
+const double kronrod_nodes[8] = {
+        0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+        0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+        0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+        0.207784955007898467600689403773245, 0.000000000000000000000000000000000,
+};
+
+const double kronrod_weights[8] = {
+        0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+        0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+        0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+        0.204432940075298892414161999234649, 0.209482141084727828012999174891714,
+};
+
+/**
+ * Pesi di Gauss a 7 punti, per i nodi di Kronrod 1, 3, 5 e il centro
+ */
+const double gauss_weights[4] = {
+        0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+        0.381830050505118944950369775488975, 0.417959183673469387755102040816327,
+};
+
+/**
+ * Punto in cui valutare la funzione, come contesto del resolver
+ */
+struct calculus_point {
+    const struct calculus_function *function;
+    operand_t x;
+};
+
+/**
+ * Somma compensata (Neumaier) dei contributi di un thread, su una propria linea di cache
+ */
+struct integration_partial {
+    _Alignas(64) operand_t sum;
+    operand_t compensation;
+};
+
+/**
+ * Integrale in corso, condiviso tra i task
+ */
+struct integration {
+    const struct calculus_function *function;
+
+    /**
+     * Tolleranza per unità di lunghezza: ogni intervallo ha la sua quota
+     */
+    operand_t tolerance_density;
+
+    _Atomic size_t intervals;
+    _Atomic int exhausted;
+    struct integration_partial partials[THREAD_POOL_MAX_THREADS];
+};
+
+/**
+ * Sotto-intervallo da integrare in un nuovo task
+ */
+struct integration_interval {
+    struct integration *integration;
+    operand_t a;
+    operand_t b;
+    unsigned int depth;
+};
+
+/**
+ * Ricerca di una radice in corso, condivisa tra i task
+ */
+struct root_search {
+    const struct calculus_function *function;
+    operand_t a;
+    operand_t b;
+    operand_t step;
+
+    /**
+     * Blocco più a sinistra in cui è stata trovata una radice: i blocchi alla sua destra sono inutili
+     */
+    _Atomic size_t first_block;
+    operand_t roots[ROOT_SCAN_INTERVALS / ROOT_SCAN_BLOCK];
+
+    /**
+     * Argomenti dei task, uno per blocco
+     */
+    struct root_block {
+        struct root_search *search;
+        size_t index;
+    } blocks[ROOT_SCAN_INTERVALS / ROOT_SCAN_BLOCK];
+};
+
+/**
+ * Resolver che fornisce la variabile indipendente e delega le altre al resolver della funzione
+ */
+int _resolve_calculus_variable(void *context, const char *name, operand_t *value) {
+    const struct calculus_point *point = context;
+    if (strcmp(name, CALCULUS_VARIABLE) == 0) {
+        *value = point->x;
+        return 0;
+    }
+    const struct calculus_function *function = point->function;
+    return function->resolver != NULL ? function->resolver(function->context, name, value) : -1;
+}
+
+/**
+ * Valuta la funzione in un punto
+ *
+ * @return NAN se l'espressione usa una variabile sconosciuta
+ */
+operand_t _evaluate_function(const struct calculus_function *function, operand_t x) {
+    struct calculus_point point = {function, x};
+    operand_t value;
+    return run_program(function->program, _resolve_calculus_variable, &point, &value) == 0 ? value : NAN;
+}
+
+/**
+ * Controlla che tutte le variabili dell'espressione, tranne quella indipendente, siano risolvibili
+ */
+int _check_function(const struct calculus_function *function) {
+    struct calculus_point point = {function, 0};
+    operand_t value;
+    return run_program(function->program, _resolve_calculus_variable, &point, &value);
+}
+
+/**
+ * Regola di Gauss-Kronrod 7-15 su [a, b]
+ *
+ * @param error Dove scrivere l'errore stimato, come differenza tra le due regole
+ * @return Integrale stimato con la regola di Kronrod
+ */
+operand_t _gauss_kronrod(const struct calculus_function *function, operand_t a, operand_t b, operand_t *error) {
+    operand_t center = (a + b) / 2, half_length = (b - a) / 2;
+    operand_t center_value = _evaluate_function(function, center);
+    operand_t kronrod = center_value * kronrod_weights[7];
+    operand_t gauss = center_value * gauss_weights[3];
+
+    for (int i = 0; i < 7; i++) {
+        operand_t offset = half_length * kronrod_nodes[i];
+        operand_t pair = _evaluate_function(function, center - offset) +
+                         _evaluate_function(function, center + offset);
+        kronrod += kronrod_weights[i] * pair;
+        if (i % 2 == 1)
+            gauss += gauss_weights[i / 2] * pair;
+    }
+
+    *error = fabs((kronrod - gauss) * half_length);
+    return kronrod * half_length;
+}
+
+void _integration_task(struct task_group *group, void *argument);
+
+/**
+ * Integra [a, b], dividendolo finché l'errore stimato non rientra nella sua quota di tolleranza.
+ * La metà destra va in un nuovo task (finché l'intervallo è abbastanza grande), la sinistra
+ * resta a questo task, così il thread continua sui dati più recenti.
+ */
+void _integrate_interval(struct task_group *group, struct integration *integration, operand_t a, operand_t b,
+                         unsigned int depth) {
+    while (1) {
+        operand_t error;
+        operand_t estimate = _gauss_kronrod(integration->function, a, b, &error);
+        size_t intervals = atomic_fetch_add_explicit(&integration->intervals, 1, memory_order_relaxed) + 1;
+
+        // Un valore non finito non migliora dividendo: viene restituito così com'è
+        int converged = error <= integration->tolerance_density * (b - a) || !isfinite(estimate);
+        if (converged || depth >= INTEGRATION_MAX_DEPTH || intervals >= INTEGRATION_MAX_INTERVALS) {
+            if (!converged)
+                atomic_store_explicit(&integration->exhausted, 1, memory_order_relaxed);
+
+            struct integration_partial *partial = &integration->partials[task_group_participant()];
+            operand_t sum = partial->sum + estimate;
+            if (fabs(partial->sum) >= fabs(estimate))
+                partial->compensation += (partial->sum - sum) + estimate;
+            else
+                partial->compensation += (estimate - sum) + partial->sum;
+            partial->sum = sum;
+            return;
+        }
+
+        operand_t middle = (a + b) / 2;
+        depth++;
+        struct integration_interval *right = NULL;
+        if (depth <= INTEGRATION_SPAWN_DEPTH)
+            right = malloc(sizeof(struct integration_interval));
+        if (right != NULL) {
+            *right = (struct integration_interval) {integration, middle, b, depth};
+            spawn_task(group, _integration_task, right);
+        } else {
+            _integrate_interval(group, integration, middle, b, depth);
+        }
+        b = middle;
+    }
+}
+
+/**
+ * Task che integra un sotto-intervallo
+ */
+void _integration_task(struct task_group *group, void *argument) {
+    struct integration_interval interval = *(struct integration_interval *) argument;
+    free(argument);
+    _integrate_interval(group, interval.integration, interval.a, interval.b, interval.depth);
+}
+
+/**
+ * Integra la funzione su [a, b] con quadratura adattiva di Gauss-Kronrod (7-15 punti).
+ *
+ * Gli intervalli il cui errore stimato supera la loro quota di tolleranza vengono divisi a metà,
+ * e le metà sono distribuite tra i thread con run_task_group().
+ *
+ * Imposta errno in caso di errore: EINVAL se l'espressione usa una variabile sconosciuta,
+ * ERANGE se l'integrale non converge (il risultato è comunque la stima migliore).
+ *
+ * @param function Funzione da integrare
+ * @param a Estremo inferiore
+ * @param b Estremo superiore
+ * @param max_threads Numero massimo di thread, 0 per tutti quelli del pool
+ * @param result Dove scrivere l'integrale
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int integrate_function(const struct calculus_function *function, operand_t a, operand_t b, size_t max_threads,
+                       operand_t *result) {
+    if (_check_function(function) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *result = 0;
+    if (a == b)
+        return 0;
+
+    // Si integra sempre da sinistra a destra, invertendo il segno alla fine
+    operand_t sign = 1;
+    if (a > b) {
+        operand_t swap = a;
+        a = b;
+        b = swap;
+        sign = -1;
+    }
+
+    // Allineato per le somme parziali di ogni thread, ciascuna sulla sua linea di cache
+    struct integration *integration = aligned_alloc(64, sizeof(struct integration));
+    if (integration == NULL)
+        return -1;
+    memset(integration, 0, sizeof(struct integration));
+
+    // Tolleranza relativa alla stima sull'intero intervallo, ripartita in proporzione alla lunghezza
+    operand_t error;
+    operand_t tolerance = fabs(_gauss_kronrod(function, a, b, &error)) * INTEGRATION_RELATIVE_TOLERANCE;
+    if (!(tolerance > INTEGRATION_ABSOLUTE_TOLERANCE))
+        tolerance = INTEGRATION_ABSOLUTE_TOLERANCE;
+    integration->function = function;
+    integration->tolerance_density = tolerance / (b - a);
+
+    struct integration_interval *interval = malloc(sizeof(struct integration_interval));
+    if (interval == NULL) {
+        free(integration);
+        return -1;
+    }
+    *interval = (struct integration_interval) {integration, a, b, 0};
+    run_task_group(_integration_task, interval, max_threads);
+
+    operand_t sum = 0;
+    for (size_t i = 0; i < THREAD_POOL_MAX_THREADS; i++)
+        sum += integration->partials[i].sum + integration->partials[i].compensation;
+    *result = sign * sum;
+
+    int exhausted = atomic_load_explicit(&integration->exhausted, memory_order_relaxed);
+    free(integration);
+    errno = exhausted ? ERANGE : 0;
+    return exhausted ? -1 : 0;
+}
+
+/**
+ * Raffina una radice in [a, b], dove la funzione cambia segno, col metodo di Brent:
+ * interpolazione quadratica inversa o secanti quando convergono, bisezione altrimenti
+ */
+operand_t _brent_root(const struct calculus_function *function, operand_t a, operand_t b, operand_t fa,
+                      operand_t fb) {
+    operand_t c = b, fc = fb, d = b - a, e = d;
+
+    for (int iteration = 0; iteration < ROOT_MAX_ITERATIONS; iteration++) {
+        if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0)) {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (fabs(fc) < fabs(fb)) {
+            a = b;
+            b = c;
+            c = a;
+            fa = fb;
+            fb = fc;
+            fc = fa;
+        }
+
+        operand_t tolerance = 2 * DBL_EPSILON * fabs(b) + DBL_MIN;
+        operand_t middle = (c - b) / 2;
+        if (fabs(middle) <= tolerance || fb == 0)
+            return b;
+
+        if (fabs(e) >= tolerance && fabs(fa) > fabs(fb)) {
+            operand_t p, q, s = fb / fa;
+            if (a == c) {
+                p = 2 * middle * s;
+                q = 1 - s;
+            } else {
+                operand_t r = fb / fc;
+                q = fa / fc;
+                p = s * (2 * middle * q * (q - r) - (b - a) * (r - 1));
+                q = (q - 1) * (r - 1) * (s - 1);
+            }
+            if (p > 0)
+                q = -q;
+            p = fabs(p);
+
+            operand_t interpolation_limit = 3 * middle * q - fabs(tolerance * q);
+            operand_t step_limit = fabs(e * q);
+            if (2 * p < (interpolation_limit < step_limit ? interpolation_limit : step_limit)) {
+                e = d;
+                d = p / q;
+            } else {
+                d = middle;
+                e = d;
+            }
+        } else {
+            d = middle;
+            e = d;
+        }
+
+        a = b;
+        fa = fb;
+        b += fabs(d) > tolerance ? d : copysign(tolerance, middle);
+        fb = _evaluate_function(function, b);
+    }
+    return b;
+}
+
+/**
+ * Task che cerca la prima radice nei sotto-intervalli di un blocco
+ */
+void _root_block_task(struct task_group *group, void *argument) {
+    struct root_block *block = argument;
+    struct root_search *search = block->search;
+
+    // C'è già una radice più a sinistra
+    if (block->index > atomic_load_explicit(&search->first_block, memory_order_relaxed))
+        return;
+
+    size_t first = block->index * ROOT_SCAN_BLOCK;
+    operand_t left = search->a + (operand_t) first * search->step;
+    operand_t left_value = _evaluate_function(search->function, left);
+    int found = 0;
+    operand_t root = 0;
+
+    for (size_t i = first; i < first + ROOT_SCAN_BLOCK && !found; i++) {
+        operand_t right = i + 1 == ROOT_SCAN_INTERVALS ? search->b : search->a + (operand_t) (i + 1) * search->step;
+        operand_t right_value = _evaluate_function(search->function, right);
+
+        if (left_value == 0) {
+            found = 1;
+            root = left;
+        } else if ((left_value < 0 && right_value > 0) || (left_value > 0 && right_value < 0)) {
+            found = 1;
+            root = _brent_root(search->function, left, right, left_value, right_value);
+        } else if (i + 1 == ROOT_SCAN_INTERVALS && right_value == 0) {
+            found = 1;
+            root = right;
+        }
+        left = right;
+        left_value = right_value;
+    }
+    if (!found)
+        return;
+
+    search->roots[block->index] = root;
+    size_t first_block = atomic_load_explicit(&search->first_block, memory_order_relaxed);
+    while (block->index < first_block &&
+           !atomic_compare_exchange_weak_explicit(&search->first_block, &first_block, block->index,
+                                                  memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * Task iniziale della ricerca: genera un task per blocco, dall'ultimo al primo,
+ * così il thread che li genera parte dal blocco più a sinistra e gli altri rubano da destra
+ */
+void _root_search_task(struct task_group *group, void *argument) {
+    struct root_search *search = argument;
+    size_t blocks = ROOT_SCAN_INTERVALS / ROOT_SCAN_BLOCK;
+    for (size_t i = blocks; i > 1; i--)
+        spawn_task(group, _root_block_task, &search->blocks[i - 1]);
+    _root_block_task(group, &search->blocks[0]);
+}
+
+/**
+ * Cerca la radice più a sinistra della funzione in [a, b].
+ *
+ * L'intervallo viene diviso in ROOT_SCAN_INTERVALS parti, esaminate in parallelo a blocchi:
+ * in ogni blocco il primo cambio di segno viene raffinato col metodo di Brent.
+ * Si trovano solo le radici con cambio di segno, o dove la funzione vale esattamente zero.
+ *
+ * Imposta errno in caso di errore: EINVAL se l'espressione usa una variabile sconosciuta,
+ * EDOM se non c'è alcuna radice.
+ *
+ * @param function Funzione di cui cercare la radice
+ * @param a Estremo inferiore
+ * @param b Estremo superiore
+ * @param max_threads Numero massimo di thread, 0 per tutti quelli del pool
+ * @param root Dove scrivere la radice
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int find_function_root(const struct calculus_function *function, operand_t a, operand_t b, size_t max_threads,
+                       operand_t *root) {
+    if (_check_function(function) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (a > b) {
+        operand_t swap = a;
+        a = b;
+        b = swap;
+    }
+
+    struct root_search *search = malloc(sizeof(struct root_search));
+    if (search == NULL)
+        return -1;
+
+    size_t blocks = ROOT_SCAN_INTERVALS / ROOT_SCAN_BLOCK;
+    search->function = function;
+    search->a = a;
+    search->b = b;
+    search->step = (b - a) / ROOT_SCAN_INTERVALS;
+    atomic_store_explicit(&search->first_block, blocks, memory_order_relaxed);
+    for (size_t i = 0; i < blocks; i++)
+        search->blocks[i] = (struct root_block) {search, i};
+
+    run_task_group(_root_search_task, search, max_threads);
+
+    size_t first_block = atomic_load_explicit(&search->first_block, memory_order_acquire);
+    if (first_block < blocks)
+        *root = search->roots[first_block];
+    free(search);
+
+    errno = first_block < blocks ? 0 : EDOM;
+    return first_block < blocks ? 0 : -1;
+}
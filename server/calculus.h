@@ -0,0 +1,96 @@
+#ifndef SERVER_CALCULUS_H
+#define SERVER_CALCULUS_H
+
+#include "expression.h"
+
+/**
+ * Nome della variabile indipendente nelle espressioni da integrare o di cui cercare le radici
+ */
+#define CALCULUS_VARIABLE "x"
+
+/**
+ * Tolleranze sull'integrale: l'errore stimato deve essere entro la maggiore delle due
+ */
+#define INTEGRATION_ABSOLUTE_TOLERANCE 1e-10
+#define INTEGRATION_RELATIVE_TOLERANCE 1e-10
+
+/**
+ * Profondità massima di suddivisione di un intervallo
+ */
+#define INTEGRATION_MAX_DEPTH 50
+
+/**
+ * Oltre questa profondità i sotto-intervalli vengono elaborati dallo stesso task,
+ * perché sono troppo piccoli per compensare il costo di un nuovo task
+ */
+#define INTEGRATION_SPAWN_DEPTH 12
+
+/**
+ * Numero massimo di sotto-intervalli valutati, oltre il quale l'integrale non converge
+ */
+#define INTEGRATION_MAX_INTERVALS (1 << 16)
+
+/**
+ * Sotto-intervalli in cui viene cercato un cambio di segno, e quanti ne elabora ogni task
+ */
+#define ROOT_SCAN_INTERVALS 4096
+#define ROOT_SCAN_BLOCK 64
+
+/**
+ * Iterazioni massime del metodo di Brent in un intervallo
+ */
+#define ROOT_MAX_ITERATIONS 200
+
+/**
+ * Funzione di una variabile, definita da un'espressione compilata
+ */
+struct calculus_function {
+    const struct expr_program *program;
+
+    /**
+     * Resolver delle altre variabili dell'espressione, può essere NULL
+     */
+    expr_resolver_t resolver;
+    void *context;
+};
+
+/**
+ * Integra la funzione su [a, b] con quadratura adattiva di Gauss-Kronrod (7-15 punti).
+ *
+ * Gli intervalli il cui errore stimato supera la loro quota di tolleranza vengono divisi a metà,
+ * e le metà sono distribuite tra i thread con run_task_group().
+ *
+ * Imposta errno in caso di errore: EINVAL se l'espressione usa una variabile sconosciuta,
+ * ERANGE se l'integrale non converge (il risultato è comunque la stima migliore).
+ *
+ * @param function Funzione da integrare
+ * @param a Estremo inferiore
+ * @param b Estremo superiore
+ * @param max_threads Numero massimo di thread, 0 per tutti quelli del pool
+ * @param result Dove scrivere l'integrale
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int integrate_function(const struct calculus_function *function, operand_t a, operand_t b, size_t max_threads,
+                       operand_t *result);
+
+/**
+ * Cerca la radice più a sinistra della funzione in [a, b].
+ *
+ * L'intervallo viene diviso in ROOT_SCAN_INTERVALS parti, esaminate in parallelo a blocchi:
+ * in ogni blocco il primo cambio di segno viene raffinato col metodo di Brent.
+ * Si trovano solo le radici con cambio di segno, o dove la funzione vale esattamente zero.
+ *
+ * Imposta errno in caso di errore: EINVAL se l'espressione usa una variabile sconosciuta,
+ * EDOM se non c'è alcuna radice.
+ *
+ * @param function Funzione di cui cercare la radice
+ * @param a Estremo inferiore
+ * @param b Estremo superiore
+ * @param max_threads Numero massimo di thread, 0 per tutti quelli del pool
+ * @param root Dove scrivere la radice
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int find_function_root(const struct calculus_function *function, operand_t a, operand_t b, size_t max_threads,
+                       operand_t *root);
+
+#endif //SERVER_CALCULUS_H
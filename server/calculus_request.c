@@ -0,0 +1,69 @@
+#include "calculus_request.h"
+#include "calculus.h"
+#include "expr_cache.h"
+#include "../common/logger.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+
+/**
+ * Messaggio per il client di un errore di integrate_function() o find_function_root()
+ */
+const char *_calculus_error_message(int error) {
+    switch (error) {
+        case EINVAL:
+            return "Variabile sconosciuta";
+        case ERANGE:
+            return "Integrale non convergente";
+        case EDOM:
+            return "Nessuna radice";
+        default:
+            return "Memoria insufficiente";
+    }
+}
+
+/**
+ * Calcola l'integrale o la radice di un'espressione, distribuendo il lavoro tra i thread del pool.
+ * Gli estremi e le altre variabili dell'espressione possono essere variabili della sessione.
+ *
+ * @param client_info Informazioni sul client
+ * @param session Sessione della connessione
+ * @param is_root Diverso da zero per ROOT_COMMAND, zero per INTEGRATE_COMMAND
+ * @param arguments Argomenti, dopo il nome del comando
+ * @param result Integrale o radice
+ * @param response Buffer della risposta, dove scrivere l'eventuale linea di errore
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int evaluate_calculus(const struct sock_info *client_info, struct session *session, int is_root,
+                      const char *arguments, operand_t *result, char *response) {
+    operand_t a, b;
+    if (parse_session_operand(session, arguments, &arguments, &a) != 0 ||
+        parse_session_operand(session, arguments, &arguments, &b) != 0 || !isfinite(a) || !isfinite(b)) {
+        log_message(client_info, "Estremi non validi\n");
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%cEstremi non validi\n", SERVER_ERROR_MESSAGE_PREFIX);
+        return -1;
+    }
+
+    const char *error = NULL;
+    struct expr_program *program = acquire_program(arguments, &error);
+    if (program == NULL) {
+        log_message(client_info, "Errore nell'espressione: %s\n", error);
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%c%s\n", SERVER_ERROR_MESSAGE_PREFIX, error);
+        return -1;
+    }
+
+    // Le variabili diverse da x vengono dalla sessione, che non cambia durante il calcolo
+    struct calculus_function function = {program, resolve_session_variable, session};
+    int status = is_root ? find_function_root(&function, a, b, 0, result)
+                         : integrate_function(&function, a, b, 0, result);
+    release_program(program);
+
+    if (status != 0) {
+        error = _calculus_error_message(errno);
+        log_message(client_info, "Errore nel calcolo: %s\n", error);
+        errno = 0;
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%c%s\n", SERVER_ERROR_MESSAGE_PREFIX, error);
+        return -1;
+    }
+    return 0;
+}
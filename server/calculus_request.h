@@ -0,0 +1,32 @@
+#ifndef SERVER_CALCULUS_REQUEST_H
+#define SERVER_CALCULUS_REQUEST_H
+
+#include "../common/socket_utils.h"
+#include "session.h"
+
+/**
+ * Comando per l'integrale di un'espressione nella variabile x: integrate A B ESPRESSIONE
+ */
+#define INTEGRATE_COMMAND "integrate"
+
+/**
+ * Comando per la radice più a sinistra di un'espressione nella variabile x: root A B ESPRESSIONE
+ */
+#define ROOT_COMMAND "root"
+
+/**
+ * Calcola l'integrale o la radice di un'espressione, distribuendo il lavoro tra i thread del pool.
+ * Gli estremi e le altre variabili dell'espressione possono essere variabili della sessione.
+ *
+ * @param client_info Informazioni sul client
+ * @param session Sessione della connessione
+ * @param is_root Diverso da zero per ROOT_COMMAND, zero per INTEGRATE_COMMAND
+ * @param arguments Argomenti, dopo il nome del comando
+ * @param result Integrale o radice
+ * @param response Buffer della risposta, dove scrivere l'eventuale linea di errore
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int evaluate_calculus(const struct sock_info *client_info, struct session *session, int is_root,
+                      const char *arguments, operand_t *result, char *response);
+
+#endif //SERVER_CALCULUS_REQUEST_H
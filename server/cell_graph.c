@@ -0,0 +1,433 @@
+#include "cell_graph.h"
+#include "session.h"
+#include "metrics.h"
+#include "../common/logger.h"
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Cerca lo slot della tabella di una cella: quello che la contiene, oppure il primo libero
+ */
+size_t *_find_cell_slot(const struct cell_graph *graph, const char *name, size_t name_len) {
+    size_t mask = graph->table_capacity - 1;
+    for (size_t index = hash_variable_name(name, name_len) & mask;; index = (index + 1) & mask) {
+        size_t *slot = &graph->table[index];
+        if (*slot == 0)
+            return slot;
+        const char *slot_name = graph->cells[*slot - 1].name;
+        if (strncmp(slot_name, name, name_len) == 0 && slot_name[name_len] == '\0')
+            return slot;
+    }
+}
+
+/**
+ * Cerca una cella dal nome
+ *
+ * @return Indice della cella, -1 se non esiste
+ */
+long _find_cell(const struct cell_graph *graph, const char *name, size_t name_len) {
+    if (graph->count == 0)
+        return -1;
+    size_t slot = *_find_cell_slot(graph, name, name_len);
+    return slot == 0 ? -1 : (long) slot - 1;
+}
+
+/**
+ * Raddoppia le celle, l'heap e la pila (o li alloca la prima volta), e ricostruisci la tabella
+ * con capacità doppia rispetto alle celle
+ *
+ * @return -1 se manca la memoria, 0 altrimenti
+ */
+int _grow_cell_graph(struct cell_graph *graph) {
+    size_t capacity = graph->capacity == 0 ? CELL_GRAPH_INITIAL_CAPACITY : graph->capacity * 2;
+    struct cell *cells = realloc(graph->cells, capacity * sizeof(struct cell));
+    if (cells == NULL)
+        return -1;
+    graph->cells = cells;
+
+    size_t *heap = realloc(graph->heap, capacity * sizeof(size_t));
+    if (heap == NULL)
+        return -1;
+    graph->heap = heap;
+
+    size_t *stack = realloc(graph->stack, capacity * sizeof(size_t));
+    if (stack == NULL)
+        return -1;
+    graph->stack = stack;
+
+    size_t *table = calloc(capacity * 2, sizeof(size_t));
+    if (table == NULL)
+        return -1;
+    free(graph->table);
+    graph->table = table;
+    graph->table_capacity = capacity * 2;
+    graph->capacity = capacity;
+
+    for (size_t i = 0; i < graph->count; i++)
+        *_find_cell_slot(graph, graph->cells[i].name, strlen(graph->cells[i].name)) = i + 1;
+    return 0;
+}
+
+/**
+ * Cerca una cella dal nome, creandola non definita se non esiste.
+ * Può spostare le celle in memoria.
+ *
+ * @return Indice della cella, -1 se il grafo è pieno
+ */
+long _find_or_add_cell(struct cell_graph *graph, const char *name, size_t name_len) {
+    long index = _find_cell(graph, name, name_len);
+    if (index != -1)
+        return index;
+
+    if (graph->count == CELL_GRAPH_MAX_CELLS || (graph->count == graph->capacity && _grow_cell_graph(graph) != 0))
+        return -1;
+
+    struct cell *cell = &graph->cells[graph->count];
+    memset(cell, 0, sizeof(struct cell));
+    memcpy(cell->name, name, name_len);
+    cell->name[name_len] = '\0';
+    cell->value = NAN;
+    *_find_cell_slot(graph, name, name_len) = graph->count + 1;
+    return (long) graph->count++;
+}
+
+/**
+ * Aggiungi un arco verso una cella che dipende da questa
+ *
+ * @return -1 se manca la memoria, 0 altrimenti
+ */
+int _add_dependent(struct cell *cell, size_t dependent) {
+    if (cell->dependents_count == cell->dependents_capacity) {
+        size_t capacity = cell->dependents_capacity == 0 ? 4 : cell->dependents_capacity * 2;
+        size_t *dependents = realloc(cell->dependents, capacity * sizeof(size_t));
+        if (dependents == NULL)
+            return -1;
+        cell->dependents = dependents;
+        cell->dependents_capacity = capacity;
+    }
+    cell->dependents[cell->dependents_count++] = dependent;
+    return 0;
+}
+
+/**
+ * Rimuovi l'arco verso una cella che non dipende più da questa
+ */
+void _remove_dependent(struct cell *cell, size_t dependent) {
+    for (size_t i = 0; i < cell->dependents_count; i++) {
+        if (cell->dependents[i] == dependent) {
+            cell->dependents[i] = cell->dependents[--cell->dependents_count];
+            return;
+        }
+    }
+}
+
+/**
+ * Resolver per run_program(), con il grafo come contesto
+ */
+int _resolve_cell(void *context, const char *name, operand_t *value) {
+    const struct cell_graph *graph = context;
+    long index = _find_cell(graph, name, strlen(name));
+    if (index == -1 || graph->cells[index].program == NULL)
+        return -1;
+    *value = graph->cells[index].value;
+    return 0;
+}
+
+/**
+ * Accoda una cella da elaborare, in ordine di livello
+ */
+void _push_cell(struct cell_graph *graph, size_t index) {
+    if (graph->cells[index].queued)
+        return;
+    graph->cells[index].queued = 1;
+
+    size_t position = graph->heap_count++;
+    size_t level = graph->cells[index].level;
+    while (position > 0 && graph->cells[graph->heap[(position - 1) / 2]].level > level) {
+        graph->heap[position] = graph->heap[(position - 1) / 2];
+        position = (position - 1) / 2;
+    }
+    graph->heap[position] = index;
+}
+
+/**
+ * Estrai la cella accodata con il livello minore
+ */
+size_t _pop_cell(struct cell_graph *graph) {
+    size_t index = graph->heap[0];
+    size_t last = graph->heap[--graph->heap_count];
+    size_t level = graph->cells[last].level;
+    size_t position = 0, child;
+
+    while ((child = position * 2 + 1) < graph->heap_count) {
+        if (child + 1 < graph->heap_count &&
+            graph->cells[graph->heap[child + 1]].level < graph->cells[graph->heap[child]].level)
+            child++;
+        if (graph->cells[graph->heap[child]].level >= level)
+            break;
+        graph->heap[position] = graph->heap[child];
+        position = child;
+    }
+    if (graph->heap_count > 0)
+        graph->heap[position] = last;
+
+    graph->cells[index].queued = 0;
+    return index;
+}
+
+/**
+ * Controlla se una delle celle indicate dipende, anche indirettamente, dalla cella di partenza:
+ * in tal caso usarle nella sua formula creerebbe un ciclo
+ */
+int _reaches_any(struct cell_graph *graph, size_t start, const size_t *targets, size_t targets_count) {
+    size_t stack_count = 0;
+    unsigned int visit = ++graph->visit;
+    graph->cells[start].visit = visit;
+    graph->stack[stack_count++] = start;
+
+    while (stack_count > 0) {
+        const struct cell *cell = &graph->cells[graph->stack[--stack_count]];
+        for (size_t i = 0; i < cell->dependents_count; i++) {
+            size_t dependent = cell->dependents[i];
+            if (graph->cells[dependent].visit == visit)
+                continue;
+            for (size_t j = 0; j < targets_count; j++) {
+                if (targets[j] == dependent)
+                    return 1;
+            }
+            graph->cells[dependent].visit = visit;
+            graph->stack[stack_count++] = dependent;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Riporta il livello delle celle dipendenti sopra quello della cella, dopo che è aumentato.
+ * Le celle sono elaborate in ordine di livello, e si visita solo dove il livello deve cambiare.
+ */
+void _raise_levels(struct cell_graph *graph, size_t index) {
+    _push_cell(graph, index);
+    while (graph->heap_count > 0) {
+        const struct cell *cell = &graph->cells[_pop_cell(graph)];
+        for (size_t i = 0; i < cell->dependents_count; i++) {
+            struct cell *dependent = &graph->cells[cell->dependents[i]];
+            if (dependent->level <= cell->level) {
+                // Se è già accodata verrà comunque rielaborata col nuovo livello
+                dependent->level = cell->level + 1;
+                _push_cell(graph, cell->dependents[i]);
+            }
+        }
+    }
+}
+
+/**
+ * Ricalcola la cella e, solo se il suo valore cambia, le celle che ne dipendono, in ordine topologico.
+ * Invia il nuovo valore delle celle sottoscritte che sono cambiate.
+ *
+ * @return Numero di celle ricalcolate
+ */
+size_t _recalculate_cells(const struct sock_info *client_info, struct cell_graph *graph, size_t index) {
+    size_t recalculated = 0;
+    _push_cell(graph, index);
+
+    while (graph->heap_count > 0) {
+        struct cell *cell = &graph->cells[_pop_cell(graph)];
+        operand_t value = NAN;
+        if (cell->program != NULL && run_program(cell->program, _resolve_cell, graph, &value) != 0)
+            value = NAN;
+        recalculated++;
+
+        if (value == cell->value || (isnan(value) && isnan(cell->value)))
+            continue;
+        cell->value = value;
+        if (cell->subscribed)
+            fprintf(client_info->socket_output, "%c%s %.17g\n", CELL_UPDATE_PREFIX, cell->name, value);
+        for (size_t i = 0; i < cell->dependents_count; i++)
+            _push_cell(graph, cell->dependents[i]);
+    }
+
+    errno = 0;
+    return recalculated;
+}
+
+/**
+ * Definisci o ridefinisci una cella, aggiornando il grafo
+ *
+ * @param client_info Informazioni sul client
+ * @param graph Grafo della connessione
+ * @param name Nome della cella
+ * @param formula Testo dell'espressione
+ * @param recalculated Dove scrivere il numero di celle ricalcolate
+ * @return NULL in caso di successo, altrimenti il messaggio d'errore per il client
+ */
+const char *_define_cell(const struct sock_info *client_info, struct cell_graph *graph, const char *name,
+                         const char *formula, size_t *recalculated) {
+    const char *error = NULL;
+    struct expr_program *program = compile_expression(formula, &error);
+    if (program == NULL)
+        return error;
+
+    // Le celle usate ma non ancora definite vengono create vuote
+    long index = _find_or_add_cell(graph, name, strlen(name));
+    size_t *dependencies = malloc((program->variables_count + 1) * sizeof(size_t));
+    int is_cyclic = 0;
+    for (size_t i = 0; index != -1 && dependencies != NULL && i < program->variables_count; i++) {
+        long dependency = _find_or_add_cell(graph, program->variables[i], strlen(program->variables[i]));
+        if (dependency == -1)
+            index = -1;
+        is_cyclic |= dependency == index;
+        dependencies[i] = (size_t) dependency;
+    }
+    if (index == -1 || dependencies == NULL) {
+        free(dependencies);
+        free_program(program);
+        return "Troppe celle";
+    }
+
+    // Ciclo: la cella stessa è una dipendenza, oppure una dipendenza dipende già dalla cella
+    if (is_cyclic || _reaches_any(graph, index, dependencies, program->variables_count)) {
+        free(dependencies);
+        free_program(program);
+        return "Dipendenza circolare";
+    }
+
+    struct cell *cell = &graph->cells[index];
+    for (size_t i = 0; i < cell->dependencies_count; i++)
+        _remove_dependent(&graph->cells[cell->dependencies[i]], index);
+    free(cell->dependencies);
+    if (cell->program != NULL)
+        free_program(cell->program);
+
+    cell->program = program;
+    cell->dependencies = dependencies;
+    cell->dependencies_count = program->variables_count;
+
+    size_t level = 0;
+    for (size_t i = 0; i < cell->dependencies_count; i++) {
+        struct cell *dependency = &graph->cells[dependencies[i]];
+        if (_add_dependent(dependency, index) != 0) {
+            // Senza l'arco la cella non verrebbe aggiornata: meglio lasciarla non definita
+            cell->dependencies_count = i;
+            free_program(cell->program);
+            cell->program = NULL;
+            return "Memoria insufficiente";
+        }
+        if (dependency->level + 1 > level)
+            level = dependency->level + 1;
+    }
+
+    // Un livello più basso resta valido per le celle dipendenti, uno più alto va propagato
+    size_t previous_level = cell->level;
+    cell->level = level;
+    if (level > previous_level)
+        _raise_levels(graph, index);
+
+    *recalculated = _recalculate_cells(client_info, graph, index);
+    return NULL;
+}
+
+/**
+ * Elabora un comando sulle celle della connessione.
+ *
+ * Quando una cella viene ridefinita, vengono ricalcolate solo le celle che ne dipendono,
+ * in ordine topologico, fermandosi dove il valore non cambia. Per ogni cella sottoscritta
+ * il cui valore è cambiato viene inviata una linea =NOME VALORE, poi la normale linea di risposta
+ * con il numero di celle ricalcolate.
+ *
+ * @param client_info Informazioni sul client
+ * @param graph Grafo della connessione, allocato al primo utilizzo
+ * @param arguments Argomenti del comando, dopo CELL_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_cell(const struct sock_info *client_info, struct cell_graph **graph, const char *arguments) {
+    struct timestamp start_time, end_time;
+    get_timestamp(&start_time);
+
+    while (isspace((unsigned char) *arguments))
+        arguments++;
+
+    if (*graph == NULL)
+        *graph = calloc(1, sizeof(struct cell_graph));
+
+    char name[EXPRESSION_MAX_NAME_SIZE];
+    const char *formula, *parameter;
+    const char *error = NULL;
+    operand_t result = 0;
+    size_t recalculated = 0;
+    long index;
+
+    if (*graph == NULL) {
+        error = "Memoria insufficiente";
+    } else if ((formula = match_assignment(arguments, name)) != NULL) {
+        error = _define_cell(client_info, *graph, name, formula, &recalculated);
+        result = (operand_t) recalculated;
+    } else if ((parameter = match_command(arguments, "watch")) != NULL) {
+        // Si può sottoscrivere anche una cella non ancora definita
+        if (sscanf(parameter, "%31s", name) != 1 || (index = _find_or_add_cell(*graph, name, strlen(name))) == -1) {
+            error = "Cella non valida";
+        } else {
+            struct cell *cell = &(*graph)->cells[index];
+            cell->subscribed = 1;
+            fprintf(client_info->socket_output, "%c%s %.17g\n", CELL_UPDATE_PREFIX, cell->name, cell->value);
+            result = cell->value;
+        }
+    } else if ((parameter = match_command(arguments, "unwatch")) != NULL ||
+               (parameter = match_command(arguments, "get")) != NULL) {
+        if (sscanf(parameter, "%31s", name) != 1 || (index = _find_cell(*graph, name, strlen(name))) == -1) {
+            error = "Cella sconosciuta";
+        } else {
+            if (match_command(arguments, "unwatch") != NULL)
+                (*graph)->cells[index].subscribed = 0;
+            result = (*graph)->cells[index].value;
+        }
+    } else {
+        error = "Comando non valido";
+    }
+
+    if (error != NULL) {
+        log_message(client_info, "Errore nelle celle: %s\n", error);
+        errno = 0;
+        fprintf(client_info->socket_output, "%c%s\n", SERVER_ERROR_MESSAGE_PREFIX, error);
+        return -1;
+    }
+
+    get_timestamp(&end_time);
+    char operation_line[128];
+    snprintf(operation_line, sizeof(operation_line), "%s %s", CELL_COMMAND, arguments);
+    log_result(client_info, operation_line, result, &start_time, &end_time);
+    add_metrics_operation(METRICS_CELL, &start_time, &end_time);
+
+    char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+    char end_time_str[TIMESTAMP_STRING_SIZE] = {};
+    timestamp_to_string(&start_time, start_time_str);
+    timestamp_to_string(&end_time, end_time_str);
+    fprintf(client_info->socket_output, "%s %s %.17g\n", start_time_str, end_time_str, result);
+    return 0;
+}
+
+/**
+ * Libera il grafo e tutte le sue celle
+ *
+ * @param graph Grafo da liberare, può essere NULL
+ */
+void free_cell_graph(struct cell_graph *graph) {
+    if (graph == NULL)
+        return;
+
+    for (size_t i = 0; i < graph->count; i++) {
+        if (graph->cells[i].program != NULL)
+            free_program(graph->cells[i].program);
+        free(graph->cells[i].dependencies);
+        free(graph->cells[i].dependents);
+    }
+    free(graph->cells);
+    free(graph->table);
+    free(graph->heap);
+    free(graph->stack);
+    free(graph);
+}
@@ -0,0 +1,114 @@
+#ifndef SERVER_CELL_GRAPH_H
+#define SERVER_CELL_GRAPH_H
+
+#include "../common/socket_utils.h"
+#include "expression.h"
+
+/**
+ * Comando per le celle di un foglio di calcolo della connessione:
+ * cell NOME = ESPRESSIONE  definisce (o ridefinisce) una cella, l'espressione può usare altre celle
+ * cell watch NOME          sottoscrive la cella, il cui valore verrà inviato a ogni cambiamento
+ * cell unwatch NOME        annulla la sottoscrizione
+ * cell get NOME            valore attuale della cella
+ */
+#define CELL_COMMAND "cell"
+
+/**
+ * Prefisso delle linee con il nuovo valore di una cella sottoscritta: =NOME VALORE
+ */
+#define CELL_UPDATE_PREFIX '='
+
+/**
+ * Numero massimo di celle di una connessione
+ */
+#define CELL_GRAPH_MAX_CELLS 65536
+
+/**
+ * Capacità iniziale del grafo. Deve essere una potenza di 2.
+ */
+#define CELL_GRAPH_INITIAL_CAPACITY 16
+
+/**
+ * Cella: una formula sulle altre celle e il suo ultimo valore.
+ * Il valore è NAN se la cella non è definita o dipende da una cella non definita.
+ */
+struct cell {
+    char name[EXPRESSION_MAX_NAME_SIZE];
+
+    /**
+     * Formula compilata, NULL se la cella è solo referenziata da altre
+     */
+    struct expr_program *program;
+    operand_t value;
+
+    /**
+     * Celle usate dalla formula e celle che usano questa, come indici nel grafo
+     */
+    size_t *dependencies;
+    size_t dependencies_count;
+    size_t *dependents;
+    size_t dependents_count;
+    size_t dependents_capacity;
+
+    /**
+     * Livello topologico: sempre maggiore di quello delle dipendenze
+     */
+    size_t level;
+
+    /**
+     * Ultima visita durante la ricerca dei cicli
+     */
+    unsigned int visit;
+
+    int queued;
+    int subscribed;
+};
+
+/**
+ * Grafo delle dipendenze tra le celle di una connessione.
+ * Appartiene a un solo thread, quindi non ha lock.
+ */
+struct cell_graph {
+    struct cell *cells;
+    size_t count;
+    size_t capacity;
+
+    /**
+     * Tabella hash a indirizzamento aperto dal nome all'indice della cella + 1 (0 se libera)
+     */
+    size_t *table;
+    size_t table_capacity;
+
+    /**
+     * Min-heap per livello delle celle da ricalcolare, e pila per le visite del grafo
+     */
+    size_t *heap;
+    size_t heap_count;
+    size_t *stack;
+
+    unsigned int visit;
+};
+
+/**
+ * Elabora un comando sulle celle della connessione.
+ *
+ * Quando una cella viene ridefinita, vengono ricalcolate solo le celle che ne dipendono,
+ * in ordine topologico, fermandosi dove il valore non cambia. Per ogni cella sottoscritta
+ * il cui valore è cambiato viene inviata una linea =NOME VALORE, poi la normale linea di risposta
+ * con il numero di celle ricalcolate.
+ *
+ * @param client_info Informazioni sul client
+ * @param graph Grafo della connessione, allocato al primo utilizzo
+ * @param arguments Argomenti del comando, dopo CELL_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_cell(const struct sock_info *client_info, struct cell_graph **graph, const char *arguments);
+
+/**
+ * Libera il grafo e tutte le sue celle
+ *
+ * @param graph Grafo da liberare, può essere NULL
+ */
+void free_cell_graph(struct cell_graph *graph);
+
+#endif //SERVER_CELL_GRAPH_H
@@ -0,0 +1,197 @@
+#include "expr_cache.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Elemento della cache: è sia in una lista di collisione della tabella hash,
+ * sia nella lista doppiamente concatenata in ordine di utilizzo (LRU).
+ */
+struct expr_cache_entry {
+    char *text;
+    uint64_t hash;
+    struct expr_program *program;
+
+    /**
+     * Elemento successivo nello stesso bucket
+     */
+    struct expr_cache_entry *bucket_next;
+
+    /**
+     * Vicini nella lista LRU: in testa il più recente
+     */
+    struct expr_cache_entry *lru_prev;
+    struct expr_cache_entry *lru_next;
+};
+
+/**
+ * Tabella hash con liste di collisione
+ */
+struct expr_cache_entry *expr_cache_buckets[EXPR_CACHE_BUCKETS] = {};
+
+/**
+ * Estremi della lista LRU
+ */
+struct expr_cache_entry *expr_cache_lru_head = NULL;
+struct expr_cache_entry *expr_cache_lru_tail = NULL;
+
+/**
+ * Numero di elementi in cache
+ */
+size_t expr_cache_size = 0;
+
+/**
+ * Mutua esclusione su tutta la cache, compresi i riferimenti dei programmi.
+ * La sezione critica è breve: la compilazione avviene fuori dal lock.
+ */
+pthread_mutex_t expr_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Hash FNV-1a del testo dell'espressione
+ */
+uint64_t _expr_hash(const char *text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (; *text != '\0'; text++) {
+        hash ^= (unsigned char) *text;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * Stacca l'elemento dalla lista LRU
+ */
+void _lru_unlink(struct expr_cache_entry *entry) {
+    if (entry->lru_prev != NULL) entry->lru_prev->lru_next = entry->lru_next;
+    else expr_cache_lru_head = entry->lru_next;
+    if (entry->lru_next != NULL) entry->lru_next->lru_prev = entry->lru_prev;
+    else expr_cache_lru_tail = entry->lru_prev;
+}
+
+/**
+ * Inserisci l'elemento in testa alla lista LRU
+ */
+void _lru_push_front(struct expr_cache_entry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = expr_cache_lru_head;
+    if (expr_cache_lru_head != NULL) expr_cache_lru_head->lru_prev = entry;
+    expr_cache_lru_head = entry;
+    if (expr_cache_lru_tail == NULL) expr_cache_lru_tail = entry;
+}
+
+/**
+ * Rilascia un riferimento al programma.
+ * Da chiamare con expr_cache_mutex acquisito.
+ */
+void _unref_program(struct expr_program *program) {
+    if (--program->references == 0)
+        free_program(program);
+}
+
+/**
+ * Rimuovi l'elemento dalla cache.
+ * Da chiamare con expr_cache_mutex acquisito.
+ */
+void _evict_entry(struct expr_cache_entry *entry) {
+    struct expr_cache_entry **link = &expr_cache_buckets[entry->hash & (EXPR_CACHE_BUCKETS - 1)];
+    while (*link != entry)
+        link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+
+    _lru_unlink(entry);
+    _unref_program(entry->program);
+    free(entry->text);
+    free(entry);
+    expr_cache_size--;
+}
+
+/**
+ * Cerca il testo nella cache, spostandolo in testa alla LRU se presente.
+ * Da chiamare con expr_cache_mutex acquisito.
+ */
+struct expr_cache_entry *_lookup_entry(const char *text, uint64_t hash) {
+    for (struct expr_cache_entry *entry = expr_cache_buckets[hash & (EXPR_CACHE_BUCKETS - 1)];
+         entry != NULL; entry = entry->bucket_next) {
+        if (entry->hash == hash && strcmp(entry->text, text) == 0) {
+            _lru_unlink(entry);
+            _lru_push_front(entry);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Ottieni il programma compilato per il testo dell'espressione,
+ * dalla cache o compilandolo e inserendolo in cache.
+ *
+ * Il programma va rilasciato con release_program() dopo l'uso:
+ * nel frattempo resta valido anche se viene rimosso dalla cache.
+ *
+ * @param text Testo dell'espressione
+ * @param error In caso di errore di compilazione, dove scrivere il messaggio
+ * @return Il programma, o NULL in caso di errore
+ */
+struct expr_program *acquire_program(const char *text, const char **error) {
+    uint64_t hash = _expr_hash(text);
+
+    pthread_mutex_lock(&expr_cache_mutex);
+    struct expr_cache_entry *entry = _lookup_entry(text, hash);
+    if (entry != NULL) {
+        entry->program->references++;
+        pthread_mutex_unlock(&expr_cache_mutex);
+        return entry->program;
+    }
+    pthread_mutex_unlock(&expr_cache_mutex);
+
+    // Compila fuori dal lock, per non bloccare gli altri thread
+    struct expr_program *program = compile_expression(text, error);
+    if (program == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&expr_cache_mutex);
+    entry = _lookup_entry(text, hash);
+    if (entry != NULL) {
+        // Un altro thread l'ha compilata nel frattempo: usa la sua
+        free_program(program);
+        program = entry->program;
+    } else {
+        entry = malloc(sizeof(struct expr_cache_entry));
+        entry->text = strdup(text);
+        entry->hash = hash;
+        entry->program = program;
+        entry->bucket_next = expr_cache_buckets[hash & (EXPR_CACHE_BUCKETS - 1)];
+        expr_cache_buckets[hash & (EXPR_CACHE_BUCKETS - 1)] = entry;
+        _lru_push_front(entry);
+        expr_cache_size++;
+
+        // Rimuovi l'elemento usato meno di recente
+        if (expr_cache_size > EXPR_CACHE_CAPACITY)
+            _evict_entry(expr_cache_lru_tail);
+    }
+    program->references++;
+    pthread_mutex_unlock(&expr_cache_mutex);
+
+    return program;
+}
+
+/**
+ * Rilascia un programma ottenuto con acquire_program()
+ *
+ * @param program Programma da rilasciare
+ */
+void release_program(struct expr_program *program) {
+    pthread_mutex_lock(&expr_cache_mutex);
+    _unref_program(program);
+    pthread_mutex_unlock(&expr_cache_mutex);
+}
+
+/**
+ * Svuota la cache, liberando i programmi non più in uso
+ */
+void clear_expr_cache() {
+    pthread_mutex_lock(&expr_cache_mutex);
+    while (expr_cache_lru_tail != NULL)
+        _evict_entry(expr_cache_lru_tail);
+    pthread_mutex_unlock(&expr_cache_mutex);
+}
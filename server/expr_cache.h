@@ -0,0 +1,41 @@
+#ifndef SERVER_EXPR_CACHE_H
+#define SERVER_EXPR_CACHE_H
+
+#include "expression.h"
+
+/**
+ * Numero massimo di programmi compilati tenuti in cache
+ */
+#define EXPR_CACHE_CAPACITY 1024
+
+/**
+ * Numero di bucket della tabella hash della cache. Deve essere una potenza di 2.
+ */
+#define EXPR_CACHE_BUCKETS 2048
+
+/**
+ * Ottieni il programma compilato per il testo dell'espressione,
+ * dalla cache o compilandolo e inserendolo in cache.
+ *
+ * Il programma va rilasciato con release_program() dopo l'uso:
+ * nel frattempo resta valido anche se viene rimosso dalla cache.
+ *
+ * @param text Testo dell'espressione
+ * @param error In caso di errore di compilazione, dove scrivere il messaggio
+ * @return Il programma, o NULL in caso di errore
+ */
+struct expr_program *acquire_program(const char *text, const char **error);
+
+/**
+ * Rilascia un programma ottenuto con acquire_program()
+ *
+ * @param program Programma da rilasciare
+ */
+void release_program(struct expr_program *program);
+
+/**
+ * Svuota la cache, liberando i programmi non più in uso
+ */
+void clear_expr_cache();
+
+#endif //SERVER_EXPR_CACHE_H
@@ -0,0 +1,416 @@
+#include "expression.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Valore di una sotto-espressione durante la compilazione:
+ * una costante già calcolata, oppure un registro della macchina virtuale.
+ */
+struct expr_value {
+    int is_constant;
+    operand_t constant;
+    uint8_t reg;
+};
+
+/**
+ * Stato del compilatore, a singola passata: il parsing a discesa ricorsiva
+ * emette direttamente il bytecode, senza costruire un albero sintattico.
+ *
+ * I registri sono allocati a pila: ogni sotto-espressione lascia il suo
+ * risultato nel primo registro libero, e un'operazione binaria libera quello di destra.
+ */
+struct expr_compiler {
+    const char *cursor;
+    const char *error;
+
+    struct expr_instruction *instructions;
+    size_t instructions_count;
+    size_t instructions_capacity;
+
+    operand_t *constants;
+    size_t constants_count;
+    size_t constants_capacity;
+
+    char (*variables)[EXPRESSION_MAX_NAME_SIZE];
+    size_t variables_count;
+
+    uint8_t next_register;
+
+    /**
+     * Livello di annidamento attuale, al massimo EXPRESSION_MAX_DEPTH
+     */
+    unsigned int depth;
+};
+
+int _parse_expression(struct expr_compiler *compiler, struct expr_value *value);
+
+/**
+ * Salta gli spazi prima del prossimo token
+ *
+ * @param compiler Compilatore
+ */
+void _skip_spaces(struct expr_compiler *compiler) {
+    while (isspace((unsigned char) *compiler->cursor))
+        compiler->cursor++;
+}
+
+/**
+ * Aggiungi un'istruzione al programma
+ */
+void _emit(struct expr_compiler *compiler, enum expr_opcode opcode, uint8_t dst, uint8_t a, uint8_t b) {
+    if (compiler->instructions_count == compiler->instructions_capacity) {
+        compiler->instructions_capacity = compiler->instructions_capacity == 0 ? 8 : compiler->instructions_capacity * 2;
+        compiler->instructions = realloc(compiler->instructions,
+                                         compiler->instructions_capacity * sizeof(struct expr_instruction));
+    }
+    compiler->instructions[compiler->instructions_count++] = (struct expr_instruction) {opcode, dst, a, b};
+}
+
+/**
+ * Aggiungi una costante al programma, riusandola se già presente
+ *
+ * @return Indice della costante, o -1 se sono troppe
+ */
+int _add_constant(struct expr_compiler *compiler, operand_t constant) {
+    for (size_t i = 0; i < compiler->constants_count; i++) {
+        if (memcmp(&compiler->constants[i], &constant, sizeof(operand_t)) == 0)
+            return (int) i;
+    }
+
+    if (compiler->constants_count > UINT8_MAX) {
+        compiler->error = "Troppe costanti nell'espressione";
+        return -1;
+    }
+
+    if (compiler->constants_count == compiler->constants_capacity) {
+        compiler->constants_capacity = compiler->constants_capacity == 0 ? 8 : compiler->constants_capacity * 2;
+        compiler->constants = realloc(compiler->constants, compiler->constants_capacity * sizeof(operand_t));
+    }
+    compiler->constants[compiler->constants_count] = constant;
+    return (int) compiler->constants_count++;
+}
+
+/**
+ * Alloca il prossimo registro libero
+ *
+ * @return Il registro, o -1 se sono esauriti
+ */
+int _alloc_register(struct expr_compiler *compiler) {
+    if (compiler->next_register >= EXPRESSION_MAX_REGISTERS) {
+        compiler->error = "Espressione troppo complessa";
+        return -1;
+    }
+    return compiler->next_register++;
+}
+
+/**
+ * Combina due valori con un operatore binario.
+ * Se entrambi sono costanti, il risultato viene calcolato subito (constant folding).
+ *
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int _emit_binary(struct expr_compiler *compiler, char operator, struct expr_value *left,
+                 const struct expr_value *right) {
+    if (left->is_constant && right->is_constant) {
+        left->constant = calculate_operation(left->constant, operator, right->constant);
+        return 0;
+    }
+
+    enum expr_opcode opcode_rr, opcode_rk, opcode_kr;
+    switch (operator) {
+        case '+':
+            opcode_rr = OP_ADD, opcode_rk = OP_ADDK, opcode_kr = OP_ADDK;
+            break;
+        case '-':
+            opcode_rr = OP_SUB, opcode_rk = OP_SUBK, opcode_kr = OP_RSUBK;
+            break;
+        case '*':
+            opcode_rr = OP_MUL, opcode_rk = OP_MULK, opcode_kr = OP_MULK;
+            break;
+        default:
+            opcode_rr = OP_DIV, opcode_rk = OP_DIVK, opcode_kr = OP_RDIVK;
+            break;
+    }
+
+    if (right->is_constant) {
+        // registro OP costante
+        int constant = _add_constant(compiler, right->constant);
+        if (constant == -1) return -1;
+        _emit(compiler, opcode_rk, left->reg, left->reg, constant);
+    } else if (left->is_constant) {
+        // costante OP registro: il risultato resta nel registro di destra
+        int constant = _add_constant(compiler, left->constant);
+        if (constant == -1) return -1;
+        _emit(compiler, opcode_kr, right->reg, right->reg, constant);
+        left->is_constant = 0;
+        left->reg = right->reg;
+    } else {
+        // registro OP registro: il registro di destra è in cima alla pila, liberalo
+        _emit(compiler, opcode_rr, left->reg, left->reg, right->reg);
+        compiler->next_register = right->reg;
+    }
+
+    return 0;
+}
+
+/**
+ * primario := NUMERO | NOME | '(' espressione ')'
+ */
+int _parse_primary(struct expr_compiler *compiler, struct expr_value *value) {
+    _skip_spaces(compiler);
+    char current = *compiler->cursor;
+
+    if (current == '(') {
+        compiler->cursor++;
+        if (_parse_expression(compiler, value) == -1)
+            return -1;
+        _skip_spaces(compiler);
+        if (*compiler->cursor != ')') {
+            compiler->error = "Parentesi non chiusa";
+            return -1;
+        }
+        compiler->cursor++;
+        return 0;
+    }
+
+    if (isdigit((unsigned char) current) || current == '.') {
+        char *end;
+        value->is_constant = 1;
+        value->constant = strtod(compiler->cursor, &end);
+        if (end == compiler->cursor) {
+            compiler->error = "Numero non valido";
+            return -1;
+        }
+        compiler->cursor = end;
+        return 0;
+    }
+
+    if (isalpha((unsigned char) current) || current == '_') {
+        // Nome di variabile
+        char name[EXPRESSION_MAX_NAME_SIZE];
+        size_t name_len = 0;
+        while (isalnum((unsigned char) *compiler->cursor) || *compiler->cursor == '_') {
+            if (name_len == EXPRESSION_MAX_NAME_SIZE - 1) {
+                compiler->error = "Nome di variabile troppo lungo";
+                return -1;
+            }
+            name[name_len++] = *compiler->cursor++;
+        }
+        name[name_len] = '\0';
+
+        size_t variable = 0;
+        while (variable < compiler->variables_count && strcmp(compiler->variables[variable], name) != 0)
+            variable++;
+        if (variable == compiler->variables_count) {
+            if (variable == EXPRESSION_MAX_VARIABLES) {
+                compiler->error = "Troppe variabili nell'espressione";
+                return -1;
+            }
+            strcpy(compiler->variables[compiler->variables_count++], name);
+        }
+
+        int reg = _alloc_register(compiler);
+        if (reg == -1)
+            return -1;
+        _emit(compiler, OP_LOADV, reg, variable, 0);
+        value->is_constant = 0;
+        value->reg = reg;
+        return 0;
+    }
+
+    compiler->error = current == '\0' ? "Espressione incompleta" : "Carattere inatteso";
+    return -1;
+}
+
+int _parse_unary_nested(struct expr_compiler *compiler, struct expr_value *value);
+
+/**
+ * unario, contando l'annidamento: ogni livello, di parentesi o di operatori unari, passa da qui
+ */
+int _parse_unary(struct expr_compiler *compiler, struct expr_value *value) {
+    if (compiler->depth == EXPRESSION_MAX_DEPTH) {
+        compiler->error = "Espressione troppo complessa";
+        return -1;
+    }
+
+    compiler->depth++;
+    int result = _parse_unary_nested(compiler, value);
+    compiler->depth--;
+    return result;
+}
+
+/**
+ * unario := ('-' | '+') unario | primario
+ */
+int _parse_unary_nested(struct expr_compiler *compiler, struct expr_value *value) {
+    _skip_spaces(compiler);
+    char current = *compiler->cursor;
+
+    if (current == '-' || current == '+') {
+        compiler->cursor++;
+        if (_parse_unary(compiler, value) == -1)
+            return -1;
+        if (current == '+')
+            return 0;
+
+        if (value->is_constant)
+            value->constant = -value->constant;
+        else
+            _emit(compiler, OP_NEG, value->reg, value->reg, 0);
+        return 0;
+    }
+
+    return _parse_primary(compiler, value);
+}
+
+/**
+ * termine := unario (('*' | '/') unario)*
+ */
+int _parse_term(struct expr_compiler *compiler, struct expr_value *value) {
+    if (_parse_unary(compiler, value) == -1)
+        return -1;
+
+    while (1) {
+        _skip_spaces(compiler);
+        char operator = *compiler->cursor;
+        if (operator != '*' && operator != '/')
+            return 0;
+        compiler->cursor++;
+
+        struct expr_value right;
+        if (_parse_unary(compiler, &right) == -1 || _emit_binary(compiler, operator, value, &right) == -1)
+            return -1;
+    }
+}
+
+/**
+ * espressione := termine (('+' | '-') termine)*
+ */
+int _parse_expression(struct expr_compiler *compiler, struct expr_value *value) {
+    if (_parse_term(compiler, value) == -1)
+        return -1;
+
+    while (1) {
+        _skip_spaces(compiler);
+        char operator = *compiler->cursor;
+        if (operator != '+' && operator != '-')
+            return 0;
+        compiler->cursor++;
+
+        struct expr_value right;
+        if (_parse_term(compiler, &right) == -1 || _emit_binary(compiler, operator, value, &right) == -1)
+            return -1;
+    }
+}
+
+/**
+ * Compila un'espressione aritmetica in bytecode, riducendo le sotto-espressioni costanti.
+ *
+ * Supporta + - * /, parentesi, meno unario, numeri e nomi di variabili.
+ *
+ * @param text Testo dell'espressione
+ * @param error In caso di errore, dove scrivere il messaggio statico che lo descrive
+ * @return Il programma compilato, o NULL in caso di errore
+ */
+struct expr_program *compile_expression(const char *text, const char **error) {
+    struct expr_compiler compiler = {};
+    compiler.cursor = text;
+    compiler.variables = calloc(EXPRESSION_MAX_VARIABLES, EXPRESSION_MAX_NAME_SIZE);
+
+    struct expr_value value;
+    int result = _parse_expression(&compiler, &value);
+    _skip_spaces(&compiler);
+    if (result == 0 && *compiler.cursor != '\0') {
+        compiler.error = *compiler.cursor == ')' ? "Parentesi chiusa in eccesso" : "Carattere inatteso";
+        result = -1;
+    }
+
+    int constant_index = 0;
+    if (result == 0 && value.is_constant && (constant_index = _add_constant(&compiler, value.constant)) == -1)
+        result = -1;
+
+    if (result == -1) {
+        *error = compiler.error;
+        free(compiler.instructions);
+        free(compiler.constants);
+        free(compiler.variables);
+        return NULL;
+    }
+
+    struct expr_program *program = malloc(sizeof(struct expr_program));
+    program->instructions = compiler.instructions;
+    program->instructions_count = compiler.instructions_count;
+    program->constants = compiler.constants;
+    program->constants_count = compiler.constants_count;
+    program->variables = compiler.variables;
+    program->variables_count = compiler.variables_count;
+    program->is_constant = value.is_constant;
+    program->result = value.is_constant ? constant_index : value.reg;
+    program->references = 1;
+    return program;
+}
+
+/**
+ * Esegui un programma compilato.
+ *
+ * @param program Programma da eseguire
+ * @param resolver Funzione per risolvere le variabili, può essere NULL se non ce ne sono
+ * @param context Contesto passato al resolver
+ * @param result Dove scrivere il risultato
+ * @return -1 se una variabile non può essere risolta, 0 altrimenti
+ */
+int run_program(const struct expr_program *program, expr_resolver_t resolver, void *context, operand_t *result) {
+    if (program->is_constant) {
+        *result = program->constants[program->result];
+        return 0;
+    }
+
+    // Risolvi ogni variabile una sola volta, prima di eseguire
+    operand_t variables[EXPRESSION_MAX_VARIABLES];
+    for (size_t i = 0; i < program->variables_count; i++) {
+        if (resolver == NULL || resolver(context, program->variables[i], &variables[i]) == -1)
+            return -1;
+    }
+
+    operand_t registers[EXPRESSION_MAX_REGISTERS];
+    const operand_t *constants = program->constants;
+    const struct expr_instruction *instruction = program->instructions;
+    const struct expr_instruction *end = instruction + program->instructions_count;
+
+    for (; instruction < end; instruction++) {
+        operand_t *dst = &registers[instruction->dst];
+        switch (instruction->opcode) {
+            case OP_LOADK: *dst = constants[instruction->a]; break;
+            case OP_LOADV: *dst = variables[instruction->a]; break;
+            case OP_NEG:   *dst = -registers[instruction->a]; break;
+            case OP_ADD:   *dst = registers[instruction->a] + registers[instruction->b]; break;
+            case OP_SUB:   *dst = registers[instruction->a] - registers[instruction->b]; break;
+            case OP_MUL:   *dst = registers[instruction->a] * registers[instruction->b]; break;
+            case OP_DIV:   *dst = registers[instruction->a] / registers[instruction->b]; break;
+            case OP_ADDK:  *dst = registers[instruction->a] + constants[instruction->b]; break;
+            case OP_SUBK:  *dst = registers[instruction->a] - constants[instruction->b]; break;
+            case OP_MULK:  *dst = registers[instruction->a] * constants[instruction->b]; break;
+            case OP_DIVK:  *dst = registers[instruction->a] / constants[instruction->b]; break;
+            case OP_RSUBK: *dst = constants[instruction->b] - registers[instruction->a]; break;
+            case OP_RDIVK: *dst = constants[instruction->b] / registers[instruction->a]; break;
+        }
+    }
+
+    *result = registers[program->result];
+    return 0;
+}
+
+/**
+ * Libera la memoria di un programma compilato
+ *
+ * @param program Programma da liberare
+ */
+void free_program(struct expr_program *program) {
+    if (program == NULL)
+        return;
+    free(program->instructions);
+    free(program->constants);
+    free(program->variables);
+    free(program);
+}
@@ -0,0 +1,137 @@
+#ifndef SERVER_EXPRESSION_H
+#define SERVER_EXPRESSION_H
+
+#include "../common/calc_utils.h"
+#include <stdint.h>
+
+/**
+ * Comando per valutare un'espressione completa: expr ESPRESSIONE
+ */
+#define EXPRESSION_COMMAND "expr"
+
+/**
+ * Numero massimo di registri della macchina virtuale
+ */
+#define EXPRESSION_MAX_REGISTERS 32
+
+/**
+ * Numero massimo di variabili distinte in un'espressione
+ */
+#define EXPRESSION_MAX_VARIABLES 16
+
+/**
+ * Lunghezza massima del nome di una variabile, incluso il \0
+ */
+#define EXPRESSION_MAX_NAME_SIZE 32
+
+/**
+ * Annidamento massimo di parentesi e operatori unari: il compilatore è ricorsivo,
+ * e senza limite un'espressione lunga esaurirebbe lo stack del thread
+ */
+#define EXPRESSION_MAX_DEPTH 256
+
+/**
+ * Codici operativi del bytecode a registri.
+ * Le varianti K hanno come operando destro una costante invece di un registro,
+ * le varianti RK hanno la costante a sinistra (per gli operatori non commutativi).
+ */
+enum expr_opcode {
+    OP_LOADK,   // dst = k[a]
+    OP_LOADV,   // dst = variabile[a]
+    OP_NEG,     // dst = -r[a]
+    OP_ADD,     // dst = r[a] + r[b]
+    OP_SUB,     // dst = r[a] - r[b]
+    OP_MUL,     // dst = r[a] * r[b]
+    OP_DIV,     // dst = r[a] / r[b]
+    OP_ADDK,    // dst = r[a] + k[b]
+    OP_SUBK,    // dst = r[a] - k[b]
+    OP_MULK,    // dst = r[a] * k[b]
+    OP_DIVK,    // dst = r[a] / k[b]
+    OP_RSUBK,   // dst = k[b] - r[a]
+    OP_RDIVK,   // dst = k[b] / r[a]
+};
+
+/**
+ * Singola istruzione: 4 byte
+ */
+struct expr_instruction {
+    uint8_t opcode;
+    uint8_t dst;
+    uint8_t a;
+    uint8_t b;
+};
+
+/**
+ * Programma compilato da un'espressione.
+ * Non viene mai modificato dopo la compilazione, quindi può essere
+ * eseguito da più thread contemporaneamente.
+ */
+struct expr_program {
+    struct expr_instruction *instructions;
+    size_t instructions_count;
+
+    operand_t *constants;
+    size_t constants_count;
+
+    /**
+     * Nomi delle variabili referenziate, risolti a ogni esecuzione
+     */
+    char (*variables)[EXPRESSION_MAX_NAME_SIZE];
+    size_t variables_count;
+
+    /**
+     * Diverso da zero se l'espressione è stata interamente ridotta a costante
+     */
+    int is_constant;
+
+    /**
+     * Registro che contiene il risultato (o indice della costante, se is_constant)
+     */
+    uint8_t result;
+
+    /**
+     * Riferimenti attivi al programma, gestiti dalla cache dei programmi
+     */
+    unsigned int references;
+};
+
+/**
+ * Risolve il valore di una variabile durante l'esecuzione.
+ *
+ * @param context Contesto fornito a run_program()
+ * @param name Nome della variabile
+ * @param value Dove scrivere il valore
+ * @return -1 se la variabile non esiste, 0 altrimenti
+ */
+typedef int (*expr_resolver_t)(void *context, const char *name, operand_t *value);
+
+/**
+ * Compila un'espressione aritmetica in bytecode, riducendo le sotto-espressioni costanti.
+ *
+ * Supporta + - * /, parentesi, meno unario, numeri e nomi di variabili.
+ *
+ * @param text Testo dell'espressione
+ * @param error In caso di errore, dove scrivere il messaggio statico che lo descrive
+ * @return Il programma compilato, o NULL in caso di errore
+ */
+struct expr_program *compile_expression(const char *text, const char **error);
+
+/**
+ * Esegui un programma compilato.
+ *
+ * @param program Programma da eseguire
+ * @param resolver Funzione per risolvere le variabili, può essere NULL se non ce ne sono
+ * @param context Contesto passato al resolver
+ * @param result Dove scrivere il risultato
+ * @return -1 se una variabile non può essere risolta, 0 altrimenti
+ */
+int run_program(const struct expr_program *program, expr_resolver_t resolver, void *context, operand_t *result);
+
+/**
+ * Libera la memoria di un programma compilato
+ *
+ * @param program Programma da liberare
+ */
+void free_program(struct expr_program *program);
+
+#endif //SERVER_EXPRESSION_H
@@ -0,0 +1,97 @@
+#include "latency_histogram.h"
+#include <stdio.h>
+
+/**
+ * Sotto-intervalli di ogni potenza di 2 oltre quelle esatte
+ */
+#define LATENCY_HALF_SUB_BUCKETS (1 << (LATENCY_SUB_BUCKET_BITS - 1))
+
+/**
+ * Intervallo di una durata: i bit oltre i LATENCY_SUB_BUCKET_BITS più significativi vengono scartati
+ */
+int _latency_bucket(uint64_t nanos) {
+    if (nanos >= (1ull << LATENCY_MAX_BITS))
+        nanos = (1ull << LATENCY_MAX_BITS) - 1;
+
+    int bits = nanos == 0 ? 0 : 64 - __builtin_clzll(nanos);
+    int shift = bits > LATENCY_SUB_BUCKET_BITS ? bits - LATENCY_SUB_BUCKET_BITS : 0;
+    return (shift << (LATENCY_SUB_BUCKET_BITS - 1)) + (int) (nanos >> shift);
+}
+
+/**
+ * Valore più alto di un intervallo
+ */
+uint64_t _latency_bucket_highest(int bucket) {
+    if (bucket < 2 * LATENCY_HALF_SUB_BUCKETS)
+        return bucket;
+
+    int shift = bucket / LATENCY_HALF_SUB_BUCKETS - 1;
+    uint64_t sub_bucket = bucket - shift * LATENCY_HALF_SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void record_latency(struct latency_histogram *histogram, uint64_t nanos) {
+    add_single_writer(&histogram->counts[_latency_bucket(nanos)], 1);
+    if (nanos > atomic_load_explicit(&histogram->max, memory_order_relaxed))
+        atomic_store_explicit(&histogram->max, nanos, memory_order_relaxed);
+}
+
+void reset_latency_histogram(struct latency_histogram *histogram) {
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+        atomic_store_explicit(&histogram->counts[i], 0, memory_order_relaxed);
+    atomic_store_explicit(&histogram->max, 0, memory_order_relaxed);
+}
+
+void add_latency_snapshot(struct latency_snapshot *snapshot, const struct latency_histogram *histogram) {
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        uint64_t count = atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+        snapshot->counts[i] += count;
+        snapshot->count += count;
+    }
+
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    if (max > snapshot->max)
+        snapshot->max = max;
+}
+
+uint64_t latency_percentile(const struct latency_snapshot *snapshot, double percentile) {
+    if (snapshot->count == 0)
+        return 0;
+
+    // Posizione della durata cercata tra quelle ordinate, arrotondata per eccesso e almeno la prima
+    double position = percentile / 100.0 * (double) snapshot->count;
+    uint64_t target = (uint64_t) position;
+    if (target < position || target == 0)
+        target++;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += snapshot->counts[i];
+        if (seen >= target) {
+            uint64_t highest = _latency_bucket_highest(i);
+            return highest < snapshot->max ? highest : snapshot->max;
+        }
+    }
+    return snapshot->max;
+}
+
+uint64_t latency_count_below(const struct latency_snapshot *snapshot, int bits) {
+    if (bits >= LATENCY_MAX_BITS)
+        return snapshot->count;
+
+    uint64_t count = 0;
+    for (int i = 0; i < _latency_bucket(1ull << bits); i++)
+        count += snapshot->counts[i];
+    return count;
+}
+
+void format_latency(uint64_t nanos, char *buffer) {
+    if (nanos < 1000)
+        snprintf(buffer, LATENCY_STRING_SIZE, "%luns", (unsigned long) nanos);
+    else if (nanos < 1000000)
+        snprintf(buffer, LATENCY_STRING_SIZE, "%.1fus", (double) nanos / 1e3);
+    else if (nanos < 1000000000)
+        snprintf(buffer, LATENCY_STRING_SIZE, "%.2fms", (double) nanos / 1e6);
+    else
+        snprintf(buffer, LATENCY_STRING_SIZE, "%.2fs", (double) nanos / 1e9);
+}
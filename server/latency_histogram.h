@@ -0,0 +1,110 @@
+#ifndef SERVER_LATENCY_HISTOGRAM_H
+#define SERVER_LATENCY_HISTOGRAM_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bit dei sotto-intervalli: ogni potenza di 2 è divisa in 2^(LATENCY_SUB_BUCKET_BITS - 1) intervalli uguali,
+ * quindi l'errore relativo di un valore è al massimo 1 / 2^(LATENCY_SUB_BUCKET_BITS - 1) (con 5, circa il 6%).
+ * I valori sotto 2^LATENCY_SUB_BUCKET_BITS sono esatti.
+ */
+#define LATENCY_SUB_BUCKET_BITS 5
+
+/**
+ * Valori registrabili fino a 2^LATENCY_MAX_BITS - 1 nanosecondi (circa 18 minuti), i più grandi vengono limitati
+ */
+#define LATENCY_MAX_BITS 40
+
+/**
+ * Intervalli dell'istogramma: quelli esatti, più mezza sotto-divisione per ogni potenza di 2 successiva
+ */
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS + 2) << (LATENCY_SUB_BUCKET_BITS - 1))
+
+/**
+ * Spazio per una durata formattata da format_latency(), es: "123.4ms"
+ */
+#define LATENCY_STRING_SIZE 16
+
+/**
+ * Aggiungi a un contatore che ha un solo scrittore, mentre altri thread possono leggerlo in qualsiasi momento:
+ * basta leggere e scrivere relaxed, senza un'istruzione atomica con lock.
+ * Inline perché è chiamata a ogni operazione, da istogrammi, metriche e tabella di stato.
+ *
+ * @param counter Contatore, scritto solo dal thread chiamante
+ * @param value Valore da aggiungere
+ */
+static inline void add_single_writer(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+                          memory_order_relaxed);
+}
+
+/**
+ * Istogramma log-lineare (HDR) di durate in nanosecondi.
+ *
+ * Ha un solo scrittore, che registra con add_single_writer(),
+ * mentre altri thread possono leggerlo e sommarlo in qualsiasi momento con add_latency_snapshot().
+ */
+struct latency_histogram {
+    _Atomic uint64_t counts[LATENCY_BUCKETS];
+    _Atomic uint64_t max;
+};
+
+/**
+ * Copia di uno o più istogrammi sommati, da cui calcolare i percentili
+ */
+struct latency_snapshot {
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t count;
+    uint64_t max;
+};
+
+/**
+ * Registra una durata. Da chiamare solo dallo scrittore dell'istogramma.
+ *
+ * @param histogram Istogramma
+ * @param nanos Durata in nanosecondi
+ */
+void record_latency(struct latency_histogram *histogram, uint64_t nanos);
+
+/**
+ * Azzera l'istogramma, prima di passarlo a un nuovo scrittore
+ */
+void reset_latency_histogram(struct latency_histogram *histogram);
+
+/**
+ * Somma un istogramma alla copia, che va azzerata prima del primo utilizzo
+ *
+ * @param snapshot Copia a cui sommare
+ * @param histogram Istogramma da leggere, anche mentre viene scritto
+ */
+void add_latency_snapshot(struct latency_snapshot *snapshot, const struct latency_histogram *histogram);
+
+/**
+ * Durata al percentile richiesto: il valore più alto dell'intervallo che lo contiene, senza superare il massimo
+ *
+ * @param snapshot Copia dell'istogramma
+ * @param percentile Percentile in [0, 100]
+ * @return La durata in nanosecondi, 0 se l'istogramma è vuoto
+ */
+uint64_t latency_percentile(const struct latency_snapshot *snapshot, double percentile);
+
+/**
+ * Numero di durate registrate minori di una potenza di 2, esatto perché è l'inizio di un intervallo
+ *
+ * @param snapshot Copia dell'istogramma
+ * @param bits Esponente della potenza di 2, in nanosecondi
+ * @return Numero di durate minori di 2^bits
+ */
+uint64_t latency_count_below(const struct latency_snapshot *snapshot, int bits);
+
+/**
+ * Scrivi una durata in nanosecondi con l'unità più adatta, es: "850ns", "12.3us", "4.56ms", "1.20s"
+ *
+ * @param nanos Durata
+ * @param buffer Dove scrivere, di almeno LATENCY_STRING_SIZE caratteri
+ */
+void format_latency(uint64_t nanos, char *buffer);
+
+#endif //SERVER_LATENCY_HISTOGRAM_H
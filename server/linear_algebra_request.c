@@ -0,0 +1,294 @@
+#include "linear_algebra_request.h"
+#include "thread_pool.h"
+#include "typed_operations.h"
+#include "metrics.h"
+#include "../common/linear_algebra.h"
+#include "../common/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * Elementi di un vettore elaborati da ogni parte del lavoro parallelo
+ */
+#define VECTOR_PARALLEL_CHUNK 65536
+
+/**
+ * Operazione elemento per elemento divisa tra i thread
+ */
+struct vector_operation {
+    enum operand_type type;
+    const char *left;
+    const char *right;
+    char *results;
+    char operator;
+    size_t count;
+
+    /**
+     * errno del primo chunk fallito, 0 se tutti sono riusciti
+     */
+    int error;
+};
+
+/**
+ * Prodotto tra matrici diviso tra i thread per blocchi di righe
+ */
+struct matrix_product {
+    const operand_t *a;
+    const operand_t *b;
+    operand_t *c;
+    size_t rows;
+    size_t depth;
+    size_t cols;
+};
+
+/**
+ * Calcola i chunk [begin, end) dell'operazione tra vettori
+ */
+void _vector_operation_task(void *context, size_t begin, size_t end) {
+    struct vector_operation *operation = context;
+    size_t first = begin * VECTOR_PARALLEL_CHUNK;
+    size_t last = end * VECTOR_PARALLEL_CHUNK < operation->count ? end * VECTOR_PARALLEL_CHUNK : operation->count;
+    size_t offset = first * operand_type_size(operation->type);
+
+    // errno è di ogni thread: l'errore viene riportato nella struttura condivisa
+    if (calculate_typed_block(operation->type, operation->left + offset, operation->operator,
+                              operation->right + offset, operation->results + offset, last - first) != 0) {
+        int no_error = 0;
+        __atomic_compare_exchange_n(&operation->error, &no_error, errno, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        errno = 0;
+    }
+}
+
+/**
+ * Calcola i blocchi di righe [begin, end) del prodotto
+ */
+void _matrix_product_task(void *context, size_t begin, size_t end) {
+    struct matrix_product *product = context;
+    size_t row_end = end * MATRIX_BLOCK_ROWS < product->rows ? end * MATRIX_BLOCK_ROWS : product->rows;
+    matrix_multiply_rows(product->a, product->b, product->c, product->depth, product->cols,
+                         begin * MATRIX_BLOCK_ROWS, row_end);
+}
+
+/**
+ * Leggi dalla connessione gli operandi binari
+ *
+ * @param client_info Informazioni sul client
+ * @param count Numero di valori da leggere
+ * @param size Dimensione in byte di ogni valore
+ * @return Valori da liberare con free(), NULL se la connessione si è interrotta prima
+ */
+void *_read_operands(const struct sock_info *client_info, size_t count, size_t size) {
+    void *values = malloc(count * size);
+    if (values != NULL && fread(values, size, count, client_info->socket_file) != count) {
+        free(values);
+        values = NULL;
+    }
+    return values;
+}
+
+/**
+ * Scarta gli operandi binari di una richiesta non valida,
+ * così la linea successiva viene letta dal punto giusto
+ *
+ * @param client_info Informazioni sul client
+ * @param bytes Byte da scartare
+ */
+void _skip_operands(const struct sock_info *client_info, size_t bytes) {
+    char buffer[8192];
+    while (bytes > 0) {
+        size_t chunk = bytes < sizeof(buffer) ? bytes : sizeof(buffer);
+        if (fread(buffer, 1, chunk, client_info->socket_file) != chunk)
+            return;
+        bytes -= chunk;
+    }
+}
+
+/**
+ * Segnala un errore al client, inviando una linea che inizia per SERVER_ERROR_MESSAGE_PREFIX
+ *
+ * @return -1, da restituire al chiamante
+ */
+int _linear_algebra_error(const struct sock_info *client_info, const char *error) {
+    log_message(client_info, "Errore nell'operazione tra vettori o matrici: %s\n", error);
+    errno = 0;
+    fprintf(client_info->socket_output, "%c%s\n", SERVER_ERROR_MESSAGE_PREFIX, error);
+    return -1;
+}
+
+/**
+ * Invia al client l'eventuale blocco binario dei risultati e la linea di risposta
+ *
+ * @param client_info Informazioni sul client
+ * @param operation_line Linea del comando, per il log
+ * @param results Risultati da inviare in binario, NULL se c'è solo il risultato scalare
+ * @param result_size Dimensione in byte di ogni risultato
+ * @param result Risultato della linea di risposta, il numero di valori se sono inviati in binario
+ * @param start_time Istante di ricezione della richiesta
+ */
+void _send_linear_algebra_result(const struct sock_info *client_info, const char *operation_line,
+                                 const void *results, size_t result_size, operand_t result,
+                                 const struct timestamp *start_time) {
+    struct timestamp end_time;
+    get_timestamp(&end_time);
+    log_result(client_info, operation_line, result, start_time, &end_time);
+    add_metrics_operation(match_command(operation_line, VECTOR_COMMAND) != NULL ? METRICS_VECTOR : METRICS_MATRIX,
+                          start_time, &end_time);
+
+    if (results != NULL) {
+        fprintf(client_info->socket_output, "%c%zu\n", BINARY_BLOCK_PREFIX, (size_t) result);
+        fwrite(results, result_size, (size_t) result, client_info->socket_output);
+    }
+
+    char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+    char end_time_str[TIMESTAMP_STRING_SIZE] = {};
+    timestamp_to_string(start_time, start_time_str);
+    timestamp_to_string(&end_time, end_time_str);
+    fprintf(client_info->socket_output, "%s %s %.17g\n", start_time_str, end_time_str, result);
+}
+
+/**
+ * Calcola un'operazione tra vettori, leggendo gli operandi binari dalla connessione.
+ *
+ * I vettori risultato vengono inviati come blocco binario, seguito dalla normale linea di risposta
+ * con la lunghezza come risultato; i risultati scalari solo con la linea di risposta.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo VECTOR_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_vector(const struct sock_info *client_info, const char *arguments) {
+    struct timestamp start_time;
+    get_timestamp(&start_time);
+
+    char operation[16] = "", type_name[16] = OPERAND_TYPE_F64_NAME;
+    size_t count;
+    int parsed_len = 0;
+    if (sscanf(arguments, "%15s %zu %n%15s %n", operation, &count, &parsed_len, type_name, &parsed_len) < 2 ||
+        arguments[parsed_len] != '\0')
+        return _linear_algebra_error(client_info, "Comando non valido");
+
+    int type = find_operand_type(type_name, strlen(type_name));
+    if (type == -1)
+        return _linear_algebra_error(client_info, "Tipo sconosciuto");
+
+    size_t size = operand_type_size(type);
+    size_t operands = strncmp(operation, "norm", 4) == 0 ? 1 : 2;
+    if (count == 0 || count > LINEAR_ALGEBRA_MAX_VALUES / operands) {
+        _skip_operands(client_info, count <= LINEAR_ALGEBRA_MAX_VALUES ? count * operands * size : 0);
+        return _linear_algebra_error(client_info, "Dimensione non valida");
+    }
+
+    char *values = _read_operands(client_info, count * operands, size);
+    if (values == NULL)
+        return _linear_algebra_error(client_info, "Operandi incompleti");
+    operand_t *left = (operand_t *) values, *right = (operand_t *) values + count;
+
+    char operation_line[64];
+    snprintf(operation_line, sizeof(operation_line), "%s %s %zu %s", VECTOR_COMMAND, operation, count, type_name);
+
+    int status = 0;
+    if (strlen(operation) == 1) {
+        // Risultati al posto dell'operando sinistro, a chunk tra i thread
+        struct vector_operation vector_operation = {type, values, values + count * size, values, operation[0], count};
+        parallel_for((count + VECTOR_PARALLEL_CHUNK - 1) / VECTOR_PARALLEL_CHUNK, 1, _vector_operation_task,
+                     &vector_operation);
+        if (vector_operation.error != 0)
+            status = _linear_algebra_error(client_info, typed_error_message(vector_operation.error));
+        else
+            _send_linear_algebra_result(client_info, operation_line, values, size, (operand_t) count, &start_time);
+    } else if (type != OPERAND_TYPE_F64) {
+        status = _linear_algebra_error(client_info, "Tipo non supportato");
+    } else if (strcmp(operation, "dot") == 0) {
+        _send_linear_algebra_result(client_info, operation_line, NULL, 0, vector_dot(left, right, count),
+                                    &start_time);
+    } else if (strcmp(operation, "norm1") == 0) {
+        _send_linear_algebra_result(client_info, operation_line, NULL, 0, vector_norm(left, count, VECTOR_NORM_1),
+                                    &start_time);
+    } else if (strcmp(operation, "norm2") == 0) {
+        _send_linear_algebra_result(client_info, operation_line, NULL, 0, vector_norm(left, count, VECTOR_NORM_2),
+                                    &start_time);
+    } else if (strcmp(operation, "norminf") == 0) {
+        _send_linear_algebra_result(client_info, operation_line, NULL, 0,
+                                    vector_norm(left, count, VECTOR_NORM_INF), &start_time);
+    } else {
+        status = _linear_algebra_error(client_info, "Operazione sconosciuta");
+    }
+
+    free(values);
+    return status;
+}
+
+/**
+ * Calcola un prodotto tra matrici o risolvi un sistema lineare, leggendo gli operandi binari
+ * dalla connessione. Il risultato viene inviato come blocco binario, seguito dalla normale
+ * linea di risposta con il numero di valori come risultato.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo MATRIX_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_matrix(const struct sock_info *client_info, const char *arguments) {
+    struct timestamp start_time;
+    get_timestamp(&start_time);
+
+    // mul M K N: A è M x K e B è K x N; solve N R: A è N x N e B è N x R
+    char operation[16] = "";
+    size_t dimensions[3] = {};
+    int parsed_len = 0;
+    int parsed = sscanf(arguments, "%15s %zu %zu %n%zu %n", operation, &dimensions[0], &dimensions[1], &parsed_len,
+                        &dimensions[2], &parsed_len);
+    int solve = strcmp(operation, "solve") == 0;
+    if (parsed < 3 || (!solve && strcmp(operation, "mul") != 0) || parsed != (solve ? 3 : 4) ||
+        arguments[parsed_len] != '\0')
+        return _linear_algebra_error(client_info, "Comando non valido");
+
+    size_t rows = dimensions[0], depth = solve ? dimensions[0] : dimensions[1];
+    size_t cols = solve ? dimensions[1] : dimensions[2];
+    if (rows > LINEAR_ALGEBRA_MAX_VALUES || depth > LINEAR_ALGEBRA_MAX_VALUES || cols > LINEAR_ALGEBRA_MAX_VALUES)
+        return _linear_algebra_error(client_info, "Dimensione non valida");
+
+    // Con dimensioni sotto 2^24 i prodotti non vanno in overflow
+    size_t a_count = rows * depth, b_count = depth * cols;
+    if (rows == 0 || depth == 0 || cols == 0 || a_count + b_count > LINEAR_ALGEBRA_MAX_VALUES ||
+        rows * cols > LINEAR_ALGEBRA_MAX_VALUES) {
+        if (a_count + b_count <= LINEAR_ALGEBRA_MAX_VALUES)
+            _skip_operands(client_info, (a_count + b_count) * sizeof(operand_t));
+        return _linear_algebra_error(client_info, "Dimensione non valida");
+    }
+
+    operand_t *values = _read_operands(client_info, a_count + b_count, sizeof(operand_t));
+    if (values == NULL)
+        return _linear_algebra_error(client_info, "Operandi incompleti");
+    operand_t *a = values, *b = values + a_count;
+
+    char operation_line[96];
+    snprintf(operation_line, sizeof(operation_line), "%s %s %zu %zu %zu", MATRIX_COMMAND, operation, rows, depth,
+             cols);
+
+    int status = 0;
+    if (solve) {
+        // La soluzione prende il posto dei termini noti
+        if (matrix_solve(a, b, rows, cols) != 0)
+            status = _linear_algebra_error(client_info, "Matrice singolare");
+        else
+            _send_linear_algebra_result(client_info, operation_line, b, sizeof(operand_t), (operand_t) b_count,
+                                        &start_time);
+    } else {
+        operand_t *c = malloc(rows * cols * sizeof(operand_t));
+        struct matrix_product product = {a, b, c, rows, depth, cols};
+        size_t row_blocks = (rows + MATRIX_BLOCK_ROWS - 1) / MATRIX_BLOCK_ROWS;
+        double flops = 2.0 * (double) rows * (double) depth * (double) cols;
+
+        // I prodotti piccoli restano nel thread della connessione
+        parallel_for(row_blocks, flops < MATRIX_PARALLEL_MIN_FLOPS ? row_blocks : 1, _matrix_product_task,
+                     &product);
+        _send_linear_algebra_result(client_info, operation_line, c, sizeof(operand_t), (operand_t) (rows * cols),
+                                    &start_time);
+        free(c);
+    }
+
+    free(values);
+    return status;
+}
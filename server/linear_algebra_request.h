@@ -0,0 +1,61 @@
+#ifndef SERVER_LINEAR_ALGEBRA_REQUEST_H
+#define SERVER_LINEAR_ALGEBRA_REQUEST_H
+
+#include "../common/socket_utils.h"
+
+/**
+ * Comando per un'operazione tra vettori: vec OPERATORE N [TIPO],
+ * seguito da N valori binari del tipo (f64 se assente) per ogni operando.
+ * Gli operatori sono quelli di calculate_typed_block() elemento per elemento,
+ * dot (prodotto scalare) e norm1, norm2, norminf (con un solo operando, solo f64).
+ */
+#define VECTOR_COMMAND "vec"
+
+/**
+ * Comando per un'operazione tra matrici, in ordine per righe:
+ * mat mul M K N, seguito da A (M x K) e B (K x N) binari
+ * mat solve N R, seguito da A (N x N) e B (N x R) binari, per risolvere A X = B
+ */
+#define MATRIX_COMMAND "mat"
+
+/**
+ * Prefisso della linea che annuncia un blocco binario di risultati: #NUMERO_VALORI,
+ * seguita da NUMERO_VALORI double binari
+ */
+#define BINARY_BLOCK_PREFIX '#'
+
+/**
+ * Numero massimo di valori di tutti gli operandi di una richiesta (128 MiB)
+ */
+#define LINEAR_ALGEBRA_MAX_VALUES (1 << 24)
+
+/**
+ * Operazioni di prodotto tra matrici (moltiplicazioni e somme) sotto le quali
+ * non conviene dividere il lavoro tra i thread
+ */
+#define MATRIX_PARALLEL_MIN_FLOPS (1 << 22)
+
+/**
+ * Calcola un'operazione tra vettori, leggendo gli operandi binari dalla connessione.
+ *
+ * I vettori risultato vengono inviati come blocco binario, seguito dalla normale linea di risposta
+ * con la lunghezza come risultato; i risultati scalari solo con la linea di risposta.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo VECTOR_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_vector(const struct sock_info *client_info, const char *arguments);
+
+/**
+ * Calcola un prodotto tra matrici o risolvi un sistema lineare, leggendo gli operandi binari
+ * dalla connessione. Il risultato viene inviato come blocco binario, seguito dalla normale
+ * linea di risposta con il numero di valori come risultato.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo MATRIX_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_matrix(const struct sock_info *client_info, const char *arguments);
+
+#endif //SERVER_LINEAR_ALGEBRA_REQUEST_H
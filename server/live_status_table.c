@@ -2,12 +2,20 @@
 #include "../common/calc_utils.h"
 #include "../common/logger.h"
 #include "../common/main_init.h"
+#include "udp_listener.h"
+#include "result_cache.h"
+#include "async_log.h"
+#include "../common/term_frame.h"
 #include <stdlib.h>
+#include <string.h>
 #include <wchar.h>
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <signal.h>
 #include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
 
 /**
  * Simboli Unicode per disegnare la tabella
@@ -25,18 +33,100 @@
 #define BOTTOM_DIVIDER ((wchar_t) 0x252C)
 
 /**
- * Array degli elementi in visualizzazione nella tabella
+ * Blocchi di posizioni delle connessioni. Un blocco, una volta allocato, non viene mai liberato
+ * fino alla chiusura: una posizione resta valida anche dopo la rimozione del suo client.
  */
-struct live_status_item **connection_items = NULL;
+_Atomic(struct live_status_slot *) status_chunks[STATUS_MAX_CHUNKS] = {};
 
 /**
- * Dimensione allocata del vettore.
+ * Posizioni mai usate finora: le nuove vengono prese da qui se non ce ne sono di libere
  */
-size_t connection_items_size = 1;
+_Atomic uint32_t status_slots_count = 0;
 
 /**
- * Mutua esclusione nella sezione critica.
- * Regola l'accesso al vettore e alla pthread_cond_t.
+ * Lista delle posizioni libere, come pila senza lock: indice + 1 della prima nei 32 bit bassi
+ * (0 se vuota), e nei 32 alti un contatore che cambia a ogni modifica, contro il problema ABA
+ */
+_Atomic uint64_t status_free_head = 0;
+
+/**
+ * Copia di una riga della tabella, letta da una posizione
+ */
+struct live_status_row {
+    struct sockaddr_in address;
+    unsigned long operations;
+    uint64_t start_seconds;
+
+    /**
+     * Operazioni al secondo nell'ultimo intervallo misurato, o in media dal primo datagramma per i peer UDP
+     */
+    double rate;
+
+    /**
+     * Posizione letta e la sua epoca, per leggere le latenze solo delle righe mostrate. NULL per i peer UDP.
+     */
+    struct live_status_slot *slot;
+    uint64_t epoch;
+
+    /**
+     * Tempi di risposta ai STATUS_LATENCY_PERCENTILES e massimo, se latency_count è maggiore di zero
+     */
+    uint64_t latency[STATUS_LATENCY_COLUMNS];
+    uint64_t latency_count;
+};
+
+/**
+ * Colonna secondo cui ordinare la tabella
+ */
+enum status_sort_key {
+    STATUS_SORT_OPERATIONS,
+    STATUS_SORT_RATE,
+    STATUS_SORT_AGE,
+    STATUS_SORT_LATENCY,
+    STATUS_SORT_KEYS
+};
+
+/**
+ * Tasti e nomi degli ordinamenti, nell'ordine di enum status_sort_key
+ */
+const char status_sort_keys[STATUS_SORT_KEYS] = {'o', 'v', 't', 'l'};
+const char *status_sort_names[STATUS_SORT_KEYS] = {"operazioni", "velocità", "tempo", "latenza p99"};
+
+/**
+ * Ordinamento scelto con i tasti, e pagina mostrata. Scritti dal thread dei tasti, letti dalla tabella.
+ */
+_Atomic int status_sort_key = STATUS_SORT_OPERATIONS;
+_Atomic int status_sort_reverse = 0;
+_Atomic size_t status_page = 0;
+
+/**
+ * Ordinamento usato per un refresh
+ */
+struct status_order {
+    enum status_sort_key key;
+    int reverse;
+    uint64_t current_seconds;
+};
+
+/**
+ * Operazioni di una posizione all'ultima misura della velocità, valide solo se l'epoca è la stessa
+ */
+struct status_rate {
+    uint64_t epoch;
+    unsigned long operations;
+    double rate;
+};
+
+/**
+ * Misure della velocità per indice di posizione, usate solo dal thread della tabella
+ */
+struct status_rate *status_rates = NULL;
+size_t status_rates_size = 0;
+struct timespec status_rates_time = {};
+
+/**
+ * Mutua esclusione per l'attesa della tabella sulla pthread_cond_t.
+ * Le posizioni delle connessioni non ne hanno bisogno.
  */
 pthread_mutex_t mutex;
 
@@ -46,11 +136,376 @@ pthread_mutex_t mutex;
  */
 pthread_cond_t refresh_cond;
 
+/**
+ * Frame della tabella, confrontato con il precedente a ogni aggiornamento
+ */
+struct term_frame table_frame = {};
+
 /**
  * Thread per la visualizzazione della tabella
  */
 pthread_t table_thread;
 
+/**
+ * Connessioni gestite dal percorso rapido, senza una live_status_item.
+ * Atomiche, per non prendere il mutex nel percorso rapido.
+ */
+_Atomic unsigned long one_shot_connections = 0;
+
+/**
+ * Operazioni eseguite dalle connessioni del percorso rapido
+ */
+_Atomic unsigned long one_shot_operations = 0;
+
+/**
+ * Thread che legge i tasti, se lo stdin è un terminale, e impostazioni del terminale da ripristinare
+ */
+pthread_t keys_thread;
+int keys_thread_active = 0;
+struct termios original_termios;
+
+/**
+ * Larghezza delle colonne delle latenze
+ */
+#define LATENCY_COLUMN_WIDTH 8
+
+/**
+ * Mostra un divisore orizzontale della tabella
+ *
+ * @param frame Frame in disegno
+ * @param left Simbolo a sinistra
+ * @param middle Simbolo tra due colonne
+ * @param right Simbolo a destra
+ */
+void _print_divider(struct term_frame *frame, wchar_t left, wchar_t middle, wchar_t right) {
+    int widths[] = {15, 5, 8, 7, 5};
+    int columns = sizeof(widths) / sizeof(int);
+    term_frame_printf(frame, L"%lc", left);
+    for (int i = 0; i < columns + STATUS_LATENCY_COLUMNS; i++) {
+        if (i > 0)
+            term_frame_printf(frame, L"%lc", middle);
+        int width = i < columns ? widths[i] : LATENCY_COLUMN_WIDTH;
+        for (int j = 0; j < width; j++) term_frame_printf(frame, L"%lc", HORIZONTAL_BAR);
+    }
+    term_frame_printf(frame, L"%lc\n", right);
+}
+
+/**
+ * Mostra una riga della tabella, preceduta dal suo divisore
+ *
+ * @param frame Frame in disegno
+ * @param row Riga da mostrare
+ * @param current_seconds Orario attuale, per il tempo trascorsi dalla connessione
+ */
+void _print_row(struct term_frame *frame, const struct live_status_row *row, uint64_t current_seconds) {
+    _print_divider(frame, RIGHT_DIVIDER, CROSS_CORNER, LEFT_DIVIDER);
+
+    term_frame_printf(frame, L"%lc%-15s%lc%-5u%lc%-8lu%lc%-7.1f%lc%-5lu",
+            VERTICAL_BAR,
+            inet_ntoa(row->address.sin_addr),
+            VERTICAL_BAR,
+            htons(row->address.sin_port),
+            VERTICAL_BAR,
+            row->operations,
+            VERTICAL_BAR,
+            row->rate,
+            VERTICAL_BAR,
+            (unsigned long) (current_seconds - row->start_seconds));
+    for (int i = 0; i < STATUS_LATENCY_COLUMNS; i++) {
+        char text[LATENCY_STRING_SIZE] = "-";
+        if (row->latency_count > 0)
+            format_latency(row->latency[i], text);
+        term_frame_printf(frame, L"%lc%-*s", VERTICAL_BAR, LATENCY_COLUMN_WIDTH, text);
+    }
+    term_frame_printf(frame, L"%lc\n", VERTICAL_BAR);
+}
+
+/**
+ * Mostra i tempi di risposta di ogni tipo di operazione eseguita finora, sotto la tabella
+ *
+ * @param frame Frame in disegno
+ * @param snapshot Spazio per la copia degli istogrammi, due elementi
+ */
+void _print_operation_latencies(struct term_frame *frame, struct latency_snapshot *snapshot) {
+    double percentiles[] = STATUS_LATENCY_PERCENTILES;
+    for (int i = 0; i < METRICS_OPERATIONS; i++) {
+        memset(snapshot, 0, 2 * sizeof(struct latency_snapshot));
+        get_operation_latency(i, &snapshot[0], &snapshot[1]);
+        if (snapshot[1].count == 0)
+            continue;
+
+        term_frame_printf(frame, L"Risposta %-10s %8lu op", metrics_operation_name(i),
+                          (unsigned long) snapshot[1].count);
+        for (size_t j = 0; j < sizeof(percentiles) / sizeof(double); j++) {
+            char text[LATENCY_STRING_SIZE];
+            format_latency(latency_percentile(&snapshot[1], percentiles[j]), text);
+            term_frame_printf(frame, L"  p%g %-8s", percentiles[j], text);
+        }
+        char max[LATENCY_STRING_SIZE];
+        format_latency(snapshot[1].max, max);
+        term_frame_printf(frame, L"  max %s\n", max);
+    }
+}
+
+/**
+ * Posizione di un indice, NULL se il suo blocco non è ancora allocato
+ */
+struct live_status_slot *_status_slot(uint32_t index) {
+    struct live_status_slot *chunk = atomic_load_explicit(&status_chunks[index / STATUS_SLOTS_PER_CHUNK],
+                                                          memory_order_acquire);
+    return chunk != NULL ? &chunk[index % STATUS_SLOTS_PER_CHUNK] : NULL;
+}
+
+/**
+ * Leggi le connessioni attive senza bloccarle, seguite dai peer UDP. Una posizione liberata o riutilizzata
+ * durante la lettura cambia epoca, e viene saltata.
+ * Le latenze non vengono lette qui, ma solo per le righe che servono, con _read_row_latency().
+ *
+ * @param rows Dove copiare le righe, NULL se la memoria non è sufficiente
+ * @param current_seconds Orario attuale
+ * @param tcp_rows Dove scrivere il numero di righe delle connessioni TCP, le prime
+ * @return Numero di righe copiate
+ */
+size_t _snapshot_status_rows(struct live_status_row **rows, uint64_t current_seconds, size_t *tcp_rows) {
+    *tcp_rows = 0;
+    uint32_t count = atomic_load_explicit(&status_slots_count, memory_order_acquire);
+    if (count > STATUS_SLOTS_PER_CHUNK * STATUS_MAX_CHUNKS)
+        count = STATUS_SLOTS_PER_CHUNK * STATUS_MAX_CHUNKS;
+    *rows = malloc((count + UDP_PEERS_MAX) * sizeof(struct live_status_row));
+    struct udp_peer_stats *udp_peers = malloc(UDP_PEERS_MAX * sizeof(struct udp_peer_stats));
+    if (*rows == NULL || udp_peers == NULL) {
+        free(*rows);
+        free(udp_peers);
+        *rows = NULL;
+        return 0;
+    }
+
+    // Velocità aggiornate non più di una volta al secondo: tra due frame vicini sarebbero solo rumore
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (double) (now.tv_sec - status_rates_time.tv_sec) +
+                     (double) (now.tv_nsec - status_rates_time.tv_nsec) / 1e9;
+    int update_rates = elapsed >= 1;
+    if (update_rates && count > status_rates_size) {
+        struct status_rate *rates = realloc(status_rates, count * sizeof(struct status_rate));
+        if (rates != NULL) {
+            memset(rates + status_rates_size, 0, (count - status_rates_size) * sizeof(struct status_rate));
+            status_rates = rates;
+            status_rates_size = count;
+        }
+    }
+
+    size_t rows_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        struct live_status_slot *slot = _status_slot(i);
+        if (slot == NULL)
+            continue;
+
+        uint64_t epoch = atomic_load_explicit(&slot->epoch, memory_order_acquire);
+        if (epoch % 2 == 0)
+            continue; // Libera
+
+        struct live_status_row *row = &(*rows)[rows_count];
+        row->address = slot->address;
+        row->start_seconds = slot->start_seconds;
+        row->operations = atomic_load_explicit(&slot->operations, memory_order_relaxed);
+        row->slot = slot;
+        row->epoch = epoch;
+        row->latency_count = 0;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->epoch, memory_order_relaxed) != epoch)
+            continue;
+
+        row->rate = 0;
+        if (i < status_rates_size) {
+            struct status_rate *rate = &status_rates[i];
+            if (update_rates) {
+                // Connessione nuova dall'ultima misura: media dall'inizio
+                uint64_t seconds = current_seconds > row->start_seconds ? current_seconds - row->start_seconds : 1;
+                rate->rate = rate->epoch == epoch ? (double) (row->operations - rate->operations) / elapsed
+                                                  : (double) row->operations / (double) seconds;
+                rate->epoch = epoch;
+                rate->operations = row->operations;
+            }
+            if (rate->epoch == epoch)
+                row->rate = rate->rate;
+        }
+        rows_count++;
+    }
+    if (update_rates)
+        status_rates_time = now;
+    *tcp_rows = rows_count;
+
+    // I peer UDP non hanno una live_status_slot: la loro velocità è la media dal primo datagramma
+    size_t udp_peers_count = get_udp_peers(udp_peers, UDP_PEERS_MAX);
+    for (size_t i = 0; i < udp_peers_count; i++) {
+        struct live_status_row *row = &(*rows)[rows_count++];
+        uint64_t seconds = current_seconds > udp_peers[i].first_seen_seconds
+                           ? current_seconds - udp_peers[i].first_seen_seconds : 1;
+        row->address = udp_peers[i].address;
+        row->operations = udp_peers[i].operations;
+        row->start_seconds = udp_peers[i].first_seen_seconds;
+        row->rate = (double) udp_peers[i].operations / (double) seconds;
+        row->slot = NULL;
+        row->latency_count = 0;
+    }
+    free(udp_peers);
+    return rows_count;
+}
+
+/**
+ * Leggi i tempi di risposta di una riga dalla sua posizione, se è ancora della stessa connessione
+ *
+ * @param row Riga letta da _snapshot_status_rows()
+ * @param snapshot Spazio per la copia dell'istogramma
+ */
+void _read_row_latency(struct live_status_row *row, struct latency_snapshot *snapshot) {
+    row->latency_count = 0;
+    if (row->slot == NULL || row->slot->latency == NULL)
+        return;
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    add_latency_snapshot(snapshot, &row->slot->latency->response);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&row->slot->epoch, memory_order_relaxed) != row->epoch)
+        return;
+
+    double percentiles[] = STATUS_LATENCY_PERCENTILES;
+    for (int i = 0; i < STATUS_LATENCY_COLUMNS - 1; i++)
+        row->latency[i] = latency_percentile(snapshot, percentiles[i]);
+    row->latency[STATUS_LATENCY_COLUMNS - 1] = snapshot->max;
+    row->latency_count = snapshot->count;
+}
+
+/**
+ * Valore di una riga per l'ordinamento scelto
+ */
+double _row_sort_value(const struct live_status_row *row, const struct status_order *order) {
+    switch (order->key) {
+        case STATUS_SORT_RATE:
+            return row->rate;
+        case STATUS_SORT_AGE:
+            return (double) (order->current_seconds - row->start_seconds);
+        case STATUS_SORT_LATENCY:
+            // p99, le righe senza latenze vanno in fondo
+            return row->latency_count > 0 ? (double) row->latency[1] : -1;
+        default:
+            return (double) row->operations;
+    }
+}
+
+/**
+ * Confronta due righe nell'ordine scelto: decrescente, o crescente se invertito.
+ * A parità si ordina per indirizzo e porta, così le righe non si scambiano tra un frame e l'altro.
+ *
+ * @return Diverso da zero se la prima riga va mostrata prima della seconda
+ */
+int _row_before(const struct live_status_row *first, const struct live_status_row *second,
+                const struct status_order *order) {
+    double first_value = _row_sort_value(first, order), second_value = _row_sort_value(second, order);
+    if (first_value != second_value)
+        return order->reverse ? first_value < second_value : first_value > second_value;
+
+    uint32_t first_ip = ntohl(first->address.sin_addr.s_addr), second_ip = ntohl(second->address.sin_addr.s_addr);
+    if (first_ip != second_ip)
+        return first_ip < second_ip;
+    return ntohs(first->address.sin_port) < ntohs(second->address.sin_port);
+}
+
+/**
+ * Riporta in basso un elemento dell'heap delle righe selezionate, che ha in cima l'ultima nell'ordine
+ */
+void _sift_down_rows(const struct live_status_row *rows, size_t *heap, size_t heap_size, size_t index,
+                     const struct status_order *order) {
+    while (2 * index + 1 < heap_size) {
+        size_t child = 2 * index + 1;
+        if (child + 1 < heap_size && _row_before(&rows[heap[child]], &rows[heap[child + 1]], order))
+            child++;
+        if (!_row_before(&rows[heap[index]], &rows[heap[child]], order))
+            break;
+
+        size_t swap = heap[index];
+        heap[index] = heap[child];
+        heap[child] = swap;
+        index = child;
+    }
+}
+
+/**
+ * Seleziona le prime righe nell'ordine scelto, con un heap di al massimo limit righe:
+ * O(n log limit) invece di ordinarle tutte.
+ *
+ * @param rows Righe lette
+ * @param rows_count Numero di righe lette
+ * @param limit Numero di righe da selezionare
+ * @param top Dove scrivere gli indici delle righe selezionate, in ordine, di almeno limit elementi
+ * @param order Ordinamento
+ * @return Numero di righe selezionate
+ */
+size_t _select_top_rows(const struct live_status_row *rows, size_t rows_count, size_t limit, size_t *top,
+                        const struct status_order *order) {
+    size_t heap_size = 0;
+    for (size_t i = 0; i < rows_count; i++) {
+        if (heap_size < limit) {
+            // Risali finché il genitore viene prima nell'ordine
+            size_t index = heap_size++;
+            top[index] = i;
+            while (index > 0 && _row_before(&rows[top[(index - 1) / 2]], &rows[top[index]], order)) {
+                size_t parent = (index - 1) / 2, swap = top[parent];
+                top[parent] = top[index];
+                top[index] = swap;
+                index = parent;
+            }
+        } else if (limit > 0 && _row_before(&rows[i], &rows[top[0]], order)) {
+            // Prima dell'ultima selezionata: la sostituisce
+            top[0] = i;
+            _sift_down_rows(rows, top, heap_size, 0, order);
+        }
+    }
+
+    // Estrai dalla cima l'ultima rimasta, mettendola in fondo: l'heap diventa ordinato
+    for (size_t size = heap_size; size > 1; size--) {
+        size_t swap = top[0];
+        top[0] = top[size - 1];
+        top[size - 1] = swap;
+        _sift_down_rows(rows, top, size - 1, 0, order);
+    }
+    return heap_size;
+}
+
+void write_client_latencies(FILE *output) {
+    struct latency_snapshot *snapshot = malloc(2 * sizeof(struct latency_snapshot));
+    if (snapshot == NULL)
+        return;
+
+    uint32_t count = atomic_load_explicit(&status_slots_count, memory_order_acquire);
+    if (count > STATUS_SLOTS_PER_CHUNK * STATUS_MAX_CHUNKS)
+        count = STATUS_SLOTS_PER_CHUNK * STATUS_MAX_CHUNKS;
+    for (uint32_t i = 0; i < count; i++) {
+        struct live_status_slot *slot = _status_slot(i);
+        if (slot == NULL)
+            continue;
+
+        uint64_t epoch = atomic_load_explicit(&slot->epoch, memory_order_acquire);
+        if (epoch % 2 == 0 || slot->latency == NULL)
+            continue;
+
+        char label[32];
+        snprintf(label, sizeof(label), "%s:%u", inet_ntoa(slot->address.sin_addr), ntohs(slot->address.sin_port));
+        memset(snapshot, 0, 2 * sizeof(struct latency_snapshot));
+        add_latency_snapshot(&snapshot[0], &slot->latency->compute);
+        add_latency_snapshot(&snapshot[1], &slot->latency->response);
+
+        // Come per la tabella: scarta la copia se la posizione è cambiata nel frattempo
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->epoch, memory_order_relaxed) != epoch || snapshot[1].count == 0)
+            continue;
+        write_latency_summary(output, label, "calcolo", &snapshot[0]);
+        write_latency_summary(output, label, "risposta", &snapshot[1]);
+    }
+    free(snapshot);
+}
+
 /**
  * Procedura in background per mostrare la tabella.
  * Si aggiorna ogni intervallo di millisecondi.
@@ -70,28 +525,83 @@ void show_table(void) {
             continue;
         }
 
+        // Non più di TERM_FRAME_MAX_FPS frame al secondo: le modifiche nel frattempo finiscono nel prossimo
+        long delay_millis = term_frame_delay_millis(&table_frame);
+        if (delay_millis > 0) {
+            struct timespec delay = {0, delay_millis * 1000000};
+            nanosleep(&delay, NULL);
+        }
+
         // Leggi orario attuale
         struct timestamp current_time;
         get_timestamp(&current_time);
         uint64_t current_seconds = timestamp_to_micros(&current_time) / 1000000;
 
-        flockfile(stdout);
+        // Copia le statistiche prima di disegnare il frame
+        struct result_cache_stats cache_stats;
+        get_result_cache_stats(&cache_stats);
+        size_t tcp_rows;
+        struct live_status_row *rows;
+        size_t rows_count = _snapshot_status_rows(&rows, current_seconds, &tcp_rows);
+        unsigned long udp_peers_evicted = get_udp_peers_evicted();
+        struct latency_snapshot *latency = malloc(2 * sizeof(struct latency_snapshot));
+
+        // Gli ultimi log vengono copiati senza bloccare il thread di scrittura
+        char recent_logs_text[LOGS_ARRAY_SIZE * RECENT_LOG_LINE_SIZE + 1];
+        size_t recent_logs_length = read_recent_logs(recent_logs_text);
+        recent_logs_text[recent_logs_length] = '\0';
+
+        // Seleziona solo le righe fino alla pagina mostrata.
+        // Le latenze servono per tutte le righe solo se sono l'ordinamento, altrimenti solo per quelle mostrate.
+        struct status_order order = {atomic_load(&status_sort_key), atomic_load(&status_sort_reverse), current_seconds};
+        if (order.key == STATUS_SORT_LATENCY && latency != NULL) {
+            for (size_t i = 0; i < tcp_rows; i++)
+                _read_row_latency(&rows[i], latency);
+        }
+
+        size_t pages = rows_count > 0 ? (rows_count + STATUS_TOP_ROWS - 1) / STATUS_TOP_ROWS : 1;
+        size_t page = atomic_load(&status_page);
+        if (page >= pages) {
+            page = pages - 1;
+            atomic_store(&status_page, page);
+        }
+        size_t *top = malloc((page + 1) * STATUS_TOP_ROWS * sizeof(size_t));
+        size_t top_count = 0;
+        if (top != NULL)
+            top_count = _select_top_rows(rows, rows_count, (page + 1) * STATUS_TOP_ROWS, top, &order);
+
+        // Disegna fuori dallo schermo: solo le celle cambiate verranno scritte
+        if (begin_term_frame(&table_frame) != 0) {
+            free(rows);
+            free(latency);
+            free(top);
+            pthread_mutex_unlock(&mutex);
+            continue;
+        }
 
-        // Pulisci schermo
-        wprintf(L"\e[1;1H\e[2J");
+        // Totali di tutte le righe, non solo di quelle mostrate
+        unsigned long total_operations = 0;
+        double total_rate = 0;
+        for (size_t i = 0; i < rows_count; i++) {
+            total_operations += rows[i].operations;
+            total_rate += rows[i].rate;
+        }
+        term_frame_printf(&table_frame, L"Connessioni: %zu TCP, %zu peer UDP", tcp_rows, rows_count - tcp_rows);
+        if (udp_peers_evicted > 0)
+            term_frame_printf(&table_frame, L" (%lu rimossi)", udp_peers_evicted);
+        term_frame_printf(&table_frame, L"   Operazioni: %lu   %.1f op/s\n", total_operations, total_rate);
+        term_frame_printf(&table_frame, L"Ordine: %s%s   Pagina %zu/%zu   ", status_sort_names[order.key],
+                          order.reverse ? " (crescente)" : "", page + 1, pages);
+        if (keys_thread_active) {
+            for (int i = 0; i < STATUS_SORT_KEYS; i++)
+                term_frame_printf(&table_frame, L"%c %s, ", status_sort_keys[i], status_sort_names[i]);
+            term_frame_printf(&table_frame, L"R inverti, n/p pagina");
+        }
+        term_frame_printf(&table_frame, L"\n");
 
         // Mostra intestazione tabella
-        wprintf(L"%lc", CORNER_TOP_LEFT);
-        for (int i = 0; i < 15; i++) wprintf(L"%lc", HORIZONTAL_BAR);
-        wprintf(L"%lc", BOTTOM_DIVIDER);
-        for (int i = 0; i < 5; i++) wprintf(L"%lc", HORIZONTAL_BAR);
-        wprintf(L"%lc", BOTTOM_DIVIDER);
-        for (int i = 0; i < 6; i++) wprintf(L"%lc", HORIZONTAL_BAR);
-        wprintf(L"%lc", BOTTOM_DIVIDER);
-        for (int i = 0; i < 5; i++) wprintf(L"%lc", HORIZONTAL_BAR);
-        wprintf(L"%lc\n", CORNER_TOP_RIGHT);
-
-        wprintf(L"%lc%-15s%lc%-5s%lc%-6s%lc%-5s%lc\n",
+        _print_divider(&table_frame, CORNER_TOP_LEFT, BOTTOM_DIVIDER, CORNER_TOP_RIGHT);
+        term_frame_printf(&table_frame, L"%lc%-15s%lc%-5s%lc%-8s%lc%-7s%lc%-5s",
                 VERTICAL_BAR,
                 "Indirizzo IP",
                 VERTICAL_BAR,
@@ -99,60 +609,116 @@ void show_table(void) {
                 VERTICAL_BAR,
                 "Op num",
                 VERTICAL_BAR,
-                "Tempo",
-                VERTICAL_BAR);
-
-        // Mostra le righe
-        for (size_t i = 0; i < connection_items_size; i++) {
-            if (connection_items[i] == NULL)
-                continue;
-
-            wprintf(L"%lc", RIGHT_DIVIDER);
-            for (int j = 0; j < 15; j++) wprintf(L"%lc", HORIZONTAL_BAR);
-            wprintf(L"%lc", CROSS_CORNER);
-            for (int j = 0; j < 5; j++) wprintf(L"%lc", HORIZONTAL_BAR);
-            wprintf(L"%lc", CROSS_CORNER);
-            for (int j = 0; j < 6; j++) wprintf(L"%lc", HORIZONTAL_BAR);
-            wprintf(L"%lc", CROSS_CORNER);
-            for (int j = 0; j < 5; j++) wprintf(L"%lc", HORIZONTAL_BAR);
-            wprintf(L"%lc\n", LEFT_DIVIDER);
-
-            wprintf(L"%lc%-15s%lc%-5u%lc%-6u%lc%-5u%lc\n",
-                    VERTICAL_BAR,
-                    inet_ntoa(connection_items[i]->client->client_info.sin_addr),
-                    VERTICAL_BAR,
-                    htons(connection_items[i]->client->client_info.sin_port),
-                    VERTICAL_BAR,
-                    connection_items[i]->operations,
-                    VERTICAL_BAR,
-                    current_seconds - connection_items[i]->start_seconds,
-                    VERTICAL_BAR);
+                "Op/s",
+                VERTICAL_BAR,
+                "Tempo");
+        double percentiles[] = STATUS_LATENCY_PERCENTILES;
+        for (int i = 0; i < STATUS_LATENCY_COLUMNS - 1; i++) {
+            char header[16];
+            snprintf(header, sizeof(header), "p%g", percentiles[i]);
+            term_frame_printf(&table_frame, L"%lc%-*s", VERTICAL_BAR, LATENCY_COLUMN_WIDTH, header);
+        }
+        term_frame_printf(&table_frame, L"%lc%-*s%lc\n", VERTICAL_BAR, LATENCY_COLUMN_WIDTH, "max", VERTICAL_BAR);
+
+        // Mostra le righe della pagina, TCP e peer UDP insieme
+        for (size_t i = page * STATUS_TOP_ROWS; i < top_count; i++) {
+            struct live_status_row *row = &rows[top[i]];
+            if (order.key != STATUS_SORT_LATENCY && latency != NULL)
+                _read_row_latency(row, latency);
+            _print_row(&table_frame, row, current_seconds);
         }
 
         // Chiudi la tabella
-        wprintf(L"%lc", CORNER_BOTTOM_LEFT);
-        for (int i = 0; i < 15; i++) wprintf(L"%lc", HORIZONTAL_BAR);
-        wprintf(L"%lc", TOP_DIVIDER);
-        for (int i = 0; i < 5; i++) wprintf(L"%lc", HORIZONTAL_BAR);
-        wprintf(L"%lc", TOP_DIVIDER);
-        for (int i = 0; i < 6; i++) wprintf(L"%lc", HORIZONTAL_BAR);
-        wprintf(L"%lc", TOP_DIVIDER);
-        for (int i = 0; i < 5; i++) wprintf(L"%lc", HORIZONTAL_BAR);
-        wprintf(L"%lc\n", CORNER_BOTTOM_RIGHT);
+        _print_divider(&table_frame, CORNER_BOTTOM_LEFT, TOP_DIVIDER, CORNER_BOTTOM_RIGHT);
+        if (latency != NULL)
+            _print_operation_latencies(&table_frame, latency);
 
-        // Scrivi le ultime righe del log
-        for (int i = 0; i < LOGS_ARRAY_SIZE; i++) {
-            // Leggi dal vettore circolare
-            int real_index = (logs_index + i) % LOGS_ARRAY_SIZE;
-            if (logs_array[real_index] != NULL)
-                wprintf(L"%s", logs_array[real_index]);
+        if (one_shot_connections > 0) {
+            term_frame_printf(&table_frame, L"Connessioni rapide: %lu (%lu operazioni)\n",
+                    (unsigned long) one_shot_connections, (unsigned long) one_shot_operations);
+        }
+
+        if (cache_stats.hits + cache_stats.misses > 0) {
+            term_frame_printf(&table_frame, L"Cache risultati: %lu hit, %lu miss (%.1f%% hit), memoria %zu/%zu KiB\n",
+                    cache_stats.hits, cache_stats.misses,
+                    100.0 * (double) cache_stats.hits / (double) (cache_stats.hits + cache_stats.misses),
+                    cache_stats.memory / 1024, cache_stats.max_memory / 1024);
         }
+
+        // Scrivi le ultime righe del log
+        term_frame_printf(&table_frame, L"%s", recent_logs_text);
+        free(rows);
+        free(latency);
+        free(top);
+
+        flockfile(stdout);
+        flush_term_frame(&table_frame);
         funlockfile(stdout);
 
         pthread_mutex_unlock(&mutex);
     }
 
-    wprintf(L"\n");
+    free_term_frame(&table_frame);
+    free(status_rates);
+}
+
+/**
+ * Applica un tasto premuto sul terminale del server
+ *
+ * @param key Tasto
+ */
+void _handle_table_key(char key) {
+    for (int i = 0; i < STATUS_SORT_KEYS; i++) {
+        if (key == status_sort_keys[i]) {
+            atomic_store(&status_sort_key, i);
+            atomic_store(&status_page, 0);
+            return;
+        }
+    }
+
+    size_t page = atomic_load(&status_page);
+    switch (key) {
+        case 'R':
+            atomic_store(&status_sort_reverse, !atomic_load(&status_sort_reverse));
+            atomic_store(&status_page, 0);
+            break;
+        case 'n':
+        case ' ':
+            // Oltre l'ultima pagina viene riportata indietro dalla tabella
+            atomic_store(&status_page, page + 1);
+            break;
+        case 'p':
+            if (page > 0)
+                atomic_store(&status_page, page - 1);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Procedura in background che legge i tasti dallo stdin, senza attendere l'invio
+ */
+void _read_table_keys(void) {
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    while (socket_fd > 0) {
+        // Controlla periodicamente la chiusura del server
+        if (poll(&input, 1, STATUS_KEYS_POLL_MILLIS) <= 0) {
+            errno = 0;
+            continue;
+        }
+
+        char keys[16];
+        ssize_t keys_count = read(STDIN_FILENO, keys, sizeof(keys));
+        if (keys_count <= 0) {
+            // Stdin chiuso: non ci saranno altri tasti
+            errno = 0;
+            break;
+        }
+        for (ssize_t i = 0; i < keys_count; i++)
+            _handle_table_key(keys[i]);
+        pthread_cond_signal(&refresh_cond);
+    }
 }
 
 /**
@@ -161,85 +727,152 @@ void show_table(void) {
 void init_status_table() {
     pthread_mutex_init(&mutex, NULL);
     pthread_cond_init(&refresh_cond, NULL);
+    // I log restano visibili nel frame, tra gli ultimi: scritti sullo stdout sposterebbero lo schermo
+    set_log_stdout(0);
     pthread_create(&table_thread, NULL, (void *(*)(void *)) show_table, NULL);
-    connection_items = calloc(connection_items_size, sizeof(struct live_status_item *));
+
+    // Tasti senza invio né eco, solo da un terminale
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &original_termios) == 0) {
+        struct termios keys_termios = original_termios;
+        keys_termios.c_lflag &= ~(ICANON | ECHO);
+        keys_termios.c_cc[VMIN] = 1;
+        keys_termios.c_cc[VTIME] = 0;
+        if (tcsetattr(STDIN_FILENO, TCSANOW, &keys_termios) == 0) {
+            if (pthread_create(&keys_thread, NULL, (void *(*)(void *)) _read_table_keys, NULL) == 0)
+                keys_thread_active = 1;
+            else
+                tcsetattr(STDIN_FILENO, TCSANOW, &original_termios);
+        }
+    }
+    errno = 0;
+}
+
+/**
+ * Prendi una posizione dalla lista delle libere
+ *
+ * @return La posizione, o NULL se la lista è vuota
+ */
+struct live_status_slot *_pop_free_status_slot(void) {
+    uint64_t head = atomic_load_explicit(&status_free_head, memory_order_acquire);
+    while ((uint32_t) head != 0) {
+        struct live_status_slot *slot = _status_slot((uint32_t) head - 1);
+        uint64_t next = ((head >> 32) + 1) << 32 | atomic_load_explicit(&slot->next_free, memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&status_free_head, &head, next,
+                                                  memory_order_acquire, memory_order_acquire))
+            return slot;
+    }
+    return NULL;
+}
+
+/**
+ * Prendi una posizione mai usata, allocando il suo blocco se è la prima
+ *
+ * @return La posizione, o NULL se la tabella è piena
+ */
+struct live_status_slot *_new_status_slot(void) {
+    uint32_t index = atomic_fetch_add_explicit(&status_slots_count, 1, memory_order_relaxed);
+    if (index >= STATUS_SLOTS_PER_CHUNK * STATUS_MAX_CHUNKS)
+        return NULL;
+
+    _Atomic(struct live_status_slot *) *chunk = &status_chunks[index / STATUS_SLOTS_PER_CHUNK];
+    if (atomic_load_explicit(chunk, memory_order_acquire) == NULL) {
+        // Più thread possono allocare lo stesso blocco: lo pubblica il primo, gli altri liberano il loro
+        struct live_status_slot *allocated = aligned_alloc(64, STATUS_SLOTS_PER_CHUNK * sizeof(*allocated));
+        if (allocated == NULL)
+            return NULL;
+        memset(allocated, 0, STATUS_SLOTS_PER_CHUNK * sizeof(*allocated));
+        for (uint32_t i = 0; i < STATUS_SLOTS_PER_CHUNK; i++)
+            allocated[i].index = index - index % STATUS_SLOTS_PER_CHUNK + i;
+
+        struct live_status_slot *expected = NULL;
+        if (!atomic_compare_exchange_strong_explicit(chunk, &expected, allocated,
+                                                     memory_order_acq_rel, memory_order_acquire))
+            free(allocated);
+    }
+    return _status_slot(index);
 }
 
 /**
- * Registra un nuovo client in questa tabella
+ * Registra un nuovo client in questa tabella, prendendo una posizione libera senza lock
  *
  * @param client Informazioni sul client
  * @param thread_id ID POSIX del thread che lo sta gestendo
+ * @return Posizione del client, da passare alle altre funzioni, o NULL se la tabella è piena
  */
-void register_client(const struct sock_info *client, pthread_t thread_id) {
-    pthread_mutex_lock(&mutex);
+struct live_status_slot *register_client(const struct sock_info *client, pthread_t thread_id) {
+    struct live_status_slot *slot = _pop_free_status_slot();
+    if (slot == NULL && (slot = _new_status_slot()) == NULL)
+        return NULL;
 
     // Leggi orario attuale
     struct timestamp current_time;
     get_timestamp(&current_time);
-    uint64_t current_seconds = timestamp_to_micros(&current_time) / 1000000;
-
-    // Crea la struttura
-    struct live_status_item *item = malloc(sizeof(struct live_status_item));
-    item->client = client;
-    item->operations = 0;
-    item->start_seconds = current_seconds;
-    item->thread_id = thread_id;
-
-    // Inserisci nella prima cella libera
-    size_t i = 0;
-    while (i < connection_items_size && connection_items[i] != NULL) { i++; }
-    if (i == connection_items_size) {
-        // Aumenta lo spazio allocato
-        connection_items_size *= 2;
-        connection_items = realloc(connection_items, connection_items_size * sizeof(struct live_status_item *));
+
+    // La posizione è ancora pari, quindi ignorata dalla tabella, mentre viene compilata
+    slot->address = client->client_info;
+    slot->thread_id = thread_id;
+    slot->start_seconds = timestamp_to_micros(&current_time) / 1000000;
+    atomic_store_explicit(&slot->operations, 0, memory_order_relaxed);
+    if (slot->latency == NULL)
+        slot->latency = calloc(1, sizeof(struct connection_latency));
+    else {
+        reset_latency_histogram(&slot->latency->compute);
+        reset_latency_histogram(&slot->latency->response);
     }
-    connection_items[i] = item;
+    atomic_fetch_add_explicit(&slot->epoch, 1, memory_order_release);
 
     pthread_cond_signal(&refresh_cond);
-    pthread_mutex_unlock(&mutex);
+    return slot;
 }
 
 /**
  * Rimuovi un client. Solitamente, quando il thread che lo gestiva sta terminando
  *
- * @param client Informazioni sul client gestito
- */
-void remove_client(const struct sock_info *client) {
-    pthread_mutex_lock(&mutex);
-
-    // Trova il client nell'elenco
-    for (size_t i = 0; i < connection_items_size; i++) {
-        if (connection_items[i] != NULL && connection_items[i]->client == client) {
-            // Rimuovi elemento
-            void *item = connection_items[i];
-            connection_items[i] = NULL;
-            free(item);
-        }
-    }
+ * @param slot Posizione del client gestito, può essere NULL
+ */
+void remove_client(struct live_status_slot *slot) {
+    if (slot == NULL)
+        return;
+
+    atomic_fetch_add_explicit(&slot->epoch, 1, memory_order_release);
+
+    // Rimetti la posizione in cima alla lista delle libere
+    uint64_t head = atomic_load_explicit(&status_free_head, memory_order_relaxed);
+    do {
+        atomic_store_explicit(&slot->next_free, (uint32_t) head, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&status_free_head, &head,
+                                                    ((head >> 32) + 1) << 32 | (slot->index + 1),
+                                                    memory_order_release, memory_order_relaxed));
 
     pthread_cond_signal(&refresh_cond);
-    pthread_mutex_unlock(&mutex);
 }
 
 /**
- * Aggiungi una nuova operazione effettuata dal client
+ * Aggiungi una nuova operazione effettuata dal client.
+ * Da chiamare solo dal thread della connessione: è un incremento relaxed, senza lock né attese.
  *
- * @param client Client che effettua l'operazione
+ * @param slot Posizione del client che effettua l'operazione, può essere NULL
  */
-void add_client_operation(const struct sock_info *client) {
-    pthread_mutex_lock(&mutex);
+void add_client_operation(struct live_status_slot *slot) {
+    if (slot == NULL)
+        return;
 
-    // Trova il client nell'elenco
-    for (size_t i = 0; i < connection_items_size; i++) {
-        if (connection_items[i] != NULL && connection_items[i]->client == client) {
-            // Aggiungi una nuova operazione
-            connection_items[i]->operations++;
-        }
-    }
+    add_single_writer(&slot->operations, 1);
+}
 
-    pthread_cond_signal(&refresh_cond);
-    pthread_mutex_unlock(&mutex);
+struct connection_latency *get_client_latency(struct live_status_slot *slot) {
+    return slot != NULL ? slot->latency : NULL;
+}
+
+/**
+ * Conteggia una connessione gestita tramite il percorso rapido,
+ * che non è mai stata registrata in questa tabella.
+ *
+ * @param operations Operazioni eseguite nella connessione
+ */
+void add_one_shot_connection(unsigned int operations) {
+    one_shot_connections++;
+    one_shot_operations += operations;
 }
 
 /**
@@ -253,29 +886,46 @@ void stop_status_table() {
 
     // Chiudi tutti i file descriptor
     // Join tutti i thread
-    for (size_t i = 0; i < connection_items_size; i++) {
-        struct live_status_item *item = connection_items[i];
-        if (item == NULL)
+    uint32_t count = atomic_load(&status_slots_count);
+    if (count > STATUS_SLOTS_PER_CHUNK * STATUS_MAX_CHUNKS)
+        count = STATUS_SLOTS_PER_CHUNK * STATUS_MAX_CHUNKS;
+    for (uint32_t i = 0; i < count; i++) {
+        struct live_status_slot *slot = _status_slot(i);
+        if (slot == NULL || atomic_load(&slot->epoch) % 2 == 0)
             continue;
 
         // Sblocca il thread se era impegnato in una syscall bloccante (es: I/O con socket).
         // Queste due funzioni, come scritto nel man, restituiscono il numero di errore,
         // non restituendo -1 e poi sta in errno direttamente.
-        if ((errno = pthread_kill(item->thread_id, SIGINT)) != 0)
+        pthread_t thread_id = slot->thread_id;
+        if ((errno = pthread_kill(thread_id, SIGINT)) != 0)
             perror("pthread_kill in chiusura");
 
         // Attendi la sua fine
-        if ((errno = pthread_join(item->thread_id, NULL)) != 0)
+        if ((errno = pthread_join(thread_id, NULL)) != 0)
             perror("pthread_join in chiusura");
 
-        // La free degli elementi del vettore viene fatto dal thread,
+        // La posizione viene liberata dal thread,
         // che quando finisci invoca la remove_client()
     }
-    free(connection_items);
 
     // Attendi anche l'interruzione della tabella
     pthread_join(table_thread, NULL);
+    if (keys_thread_active) {
+        pthread_join(keys_thread, NULL);
+        tcsetattr(STDIN_FILENO, TCSANOW, &original_termios);
+    }
+    set_log_stdout(1);
 
     pthread_cond_destroy(&refresh_cond);
     pthread_mutex_destroy(&mutex);
+
+    for (size_t i = 0; i < STATUS_MAX_CHUNKS; i++) {
+        struct live_status_slot *chunk = atomic_load(&status_chunks[i]);
+        if (chunk == NULL)
+            continue;
+        for (size_t j = 0; j < STATUS_SLOTS_PER_CHUNK; j++)
+            free(chunk[j].latency);
+        free(chunk);
+    }
 }
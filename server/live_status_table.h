@@ -2,17 +2,67 @@
 #define SERVER_LIVE_STATUS_TABLE_H
 
 #include "../common/socket_utils.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
 
 /**
- * Informazioni riguardo una connessione con un client,
- * e tutti i dettagli che verranno visualizzati
- * nella tabella di stato del server, come panoramica.
+ * Posizioni per ogni blocco della tabella delle connessioni, allocato alla prima richiesta
  */
-struct live_status_item {
+#define STATUS_SLOTS_PER_CHUNK 64
+
+/**
+ * Blocchi al massimo: oltre STATUS_SLOTS_PER_CHUNK * STATUS_MAX_CHUNKS connessioni contemporanee,
+ * le nuove non compaiono nella tabella
+ */
+#define STATUS_MAX_CHUNKS 1024
+
+/**
+ * Percentili del tempo di risposta mostrati per ogni connessione, seguiti dal massimo
+ */
+#define STATUS_LATENCY_PERCENTILES {50, 99, 99.9}
+#define STATUS_LATENCY_COLUMNS 4
+
+/**
+ * Righe per pagina della tabella: vengono mostrate solo le prime nell'ordine scelto,
+ * selezionate con un heap, così il costo di un refresh non dipende dalle righe disegnate
+ */
+#define STATUS_TOP_ROWS 10
+
+/**
+ * Intervallo di controllo dei tasti, e quindi attesa massima della chiusura del thread che li legge
+ */
+#define STATUS_KEYS_POLL_MILLIS 250
+
+/**
+ * Posizione di una connessione nella tabella di stato del server.
+ * Ogni connessione riceve la sua alla registrazione, e la aggiorna direttamente senza lock:
+ * è su una linea di cache propria, e solo il thread della connessione la scrive.
+ */
+struct live_status_slot {
+    /**
+     * Epoca della posizione: dispari mentre è di una connessione, pari quando è libera.
+     * Cambia a ogni registrazione e rimozione, così la tabella riconosce una posizione riutilizzata
+     * mentre la sta leggendo.
+     */
+    _Alignas(64) _Atomic uint64_t epoch;
+
+    /**
+     * Numero di operazioni eseguite finora dal client
+     */
+    _Atomic uint64_t operations;
+
+    /**
+     * Latenze delle operazioni del client. Allocate alla prima registrazione della posizione,
+     * poi azzerate a ogni riutilizzo e liberate solo alla chiusura, come i blocchi.
+     */
+    struct connection_latency *latency;
+
     /**
-     * Informazioni sulla connessione col client
+     * Indirizzo del client
      */
-    const struct sock_info *client;
+    struct sockaddr_in address;
 
     /**
      * ID del thread. L'ID pthread POSIX non verrà riciclato su altri thread nuovi.
@@ -25,37 +75,65 @@ struct live_status_item {
     uint64_t start_seconds;
 
     /**
-     * Numero di operazioni eseguite finora dal client
+     * Indice della posizione, e indice + 1 della prossima libera quando è nella lista delle libere
      */
-    unsigned int operations;
+    uint32_t index;
+    _Atomic uint32_t next_free;
 };
 
 /**
- * Inizializza la tabella
+ * Inizializza la tabella.
+ * Se lo stdin è un terminale, i suoi tasti cambiano l'ordinamento e la pagina, come in top:
+ * o operazioni, v velocità, t tempo, l latenza (p99), R inverte l'ordine, n e p pagina successiva e precedente.
  */
 void init_status_table();
 
 /**
- * Registra un nuovo client in questa tabella
+ * Registra un nuovo client in questa tabella, prendendo una posizione libera senza lock
  *
  * @param client Informazioni sul client
  * @param thread_id ID POSIX del thread che lo sta gestendo
+ * @return Posizione del client, da passare alle altre funzioni, o NULL se la tabella è piena
  */
-void register_client(const struct sock_info *client, pthread_t thread_id);
+struct live_status_slot *register_client(const struct sock_info *client, pthread_t thread_id);
 
 /**
  * Rimuovi un client. Solitamente, quando il thread che lo gestiva sta terminando
  *
- * @param client Informazioni sul client gestito
+ * @param slot Posizione del client gestito, può essere NULL
+ */
+void remove_client(struct live_status_slot *slot);
+
+/**
+ * Aggiungi una nuova operazione effettuata dal client.
+ * Da chiamare solo dal thread della connessione: è un incremento relaxed, senza lock né attese.
+ *
+ * @param slot Posizione del client che effettua l'operazione, può essere NULL
+ */
+void add_client_operation(struct live_status_slot *slot);
+
+/**
+ * Latenze del client, da passare a add_metrics_response()
+ *
+ * @param slot Posizione del client, può essere NULL
+ * @return Le latenze, o NULL se il client non ne ha
+ */
+struct connection_latency *get_client_latency(struct live_status_slot *slot);
+
+/**
+ * Scrivi i percentili dei tempi di calcolo e di risposta di ogni connessione attiva, senza bloccarle
+ *
+ * @param output Dove scrivere
  */
-void remove_client(const struct sock_info *client);
+void write_client_latencies(FILE *output);
 
 /**
- * Aggiungi una nuova operazione effettuata dal client
+ * Conteggia una connessione gestita tramite il percorso rapido,
+ * che non è mai stata registrata in questa tabella.
  *
- * @param client Client che effettua l'operazione
+ * @param operations Operazioni eseguite nella connessione
  */
-void add_client_operation(const struct sock_info *client);
+void add_one_shot_connection(unsigned int operations);
 
 /**
  * Termina la visualizzazione della tabella,
@@ -0,0 +1,43 @@
+#ifndef SERVER_LOG_POLICY_H
+#define SERVER_LOG_POLICY_H
+
+/**
+ * Politiche di log per categoria, applicate da log_message(), log_result() e log_operation()
+ * prima di riservare il record, così che i log scartati non costino quasi nulla.
+ * I contatori sono del thread, quindi i limiti valgono per ogni thread che gestisce client.
+ */
+
+/**
+ * Registra un risultato ogni LOG_RESULT_SAMPLE_EVERY operazioni riuscite: 1 per registrarli tutti
+ */
+#define LOG_RESULT_SAMPLE_EVERY 1
+
+/**
+ * Risultati registrati al massimo ogni secondo, dopo il campionamento: 0 per nessun limite.
+ * I risultati esclusi vengono riassunti in un messaggio, al più uno al secondo.
+ */
+#define LOG_RESULT_MAX_PER_SECOND 1000
+
+/**
+ * Durata in microsecondi oltre la quale un risultato viene sempre registrato, senza campionamento né limite
+ */
+#define LOG_SLOW_MICROS 10000
+
+/**
+ * Secondi entro cui un messaggio identico dallo stesso client viene solo contato.
+ * Le ripetizioni vengono riassunte al primo messaggio diverso, o allo scadere dell'intervallo.
+ * 0 per registrare tutti i messaggi.
+ */
+#define LOG_REPEAT_WINDOW_SECONDS 10
+
+struct sock_info;
+
+/**
+ * Scrivi i riepiloghi in sospeso del thread: ripetizioni dell'ultimo messaggio e risultati esclusi.
+ * Da chiamare alla fine di una connessione, dopo cui il thread può servire altri client.
+ *
+ * @param client_info Informazioni sul client della connessione
+ */
+void flush_log_policy(const struct sock_info *client_info);
+
+#endif //SERVER_LOG_POLICY_H
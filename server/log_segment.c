@@ -0,0 +1,255 @@
+#include "log_segment.h"
+#include "../common/logger.h"
+#include "../common/log_format.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+/**
+ * Segmento di log aperto: il file è preallocato fino a capacity byte e mappato per intero,
+ * e i byte vengono aggiunti dal cursore. Alla chiusura il file viene ridotto al cursore.
+ */
+struct log_segment {
+    int fd;
+    char *map;
+    size_t capacity;
+    size_t cursor;
+    time_t opened_seconds;
+
+    /**
+     * Percorso del segmento: quello del file di log, o quello ruotato se la rotazione è fallita
+     */
+    char path[LOG_FILE_PATH_SIZE];
+};
+
+struct log_segment log_segment = {.fd = -1};
+
+/**
+ * Processi di compressione dei segmenti ruotati non ancora raccolti
+ */
+pid_t log_compressions[LOG_MAX_COMPRESSIONS];
+size_t log_compressions_count = 0;
+
+/**
+ * Prealloca il segmento fino a capacity byte e mappalo, sostituendo la mappatura precedente
+ *
+ * @return -1 in caso di errore (anche se il disco è pieno), 0 altrimenti
+ */
+int _map_log_segment(size_t capacity) {
+    // Con lo spazio già allocato, le scritture nella mappatura non possono fallire per disco pieno
+    int error = posix_fallocate(log_segment.fd, 0, (off_t) capacity);
+    if (error == EOPNOTSUPP || error == EINVAL)
+        error = ftruncate(log_segment.fd, (off_t) capacity) == 0 ? 0 : errno;
+    if (error != 0) {
+        errno = 0;
+        return -1;
+    }
+
+    char *map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, log_segment.fd, 0);
+    if (map == MAP_FAILED) {
+        errno = 0;
+        return -1;
+    }
+
+    if (log_segment.map != NULL)
+        munmap(log_segment.map, log_segment.capacity);
+    log_segment.map = map;
+    log_segment.capacity = capacity;
+    return 0;
+}
+
+/**
+ * Trova la fine dei dati scritti in un segmento riaperto.
+ * Dopo una chiusura non pulita il file termina con lo spazio preallocato, pieno di zeri.
+ *
+ * @param size Dimensione del file
+ * @return Posizione del cursore
+ */
+size_t _find_log_segment_end(size_t size) {
+    if (!LOG_FILE_BINARY) {
+        // Il testo non contiene mai \0
+        while (size > 0 && log_segment.map[size - 1] == '\0')
+            size--;
+        return size;
+    }
+
+    // Nei record binari anche gli ultimi byte possono essere zero: segui le dimensioni dei record
+    if (size < sizeof(struct log_binary_header))
+        return 0;
+    size_t cursor = sizeof(struct log_binary_header);
+    while (cursor + sizeof(struct log_binary_record) <= size) {
+        const struct log_binary_record *record = (const struct log_binary_record *) (log_segment.map + cursor);
+        if (record->size == 0 || cursor + record->size > size)
+            break;
+        cursor += record->size;
+    }
+    return cursor;
+}
+
+/**
+ * Apri un segmento, riprendendo dalla fine dei dati se esiste già
+ *
+ * @param path Percorso del segmento
+ * @param lock Diverso da zero per acquisire il lock del file, come _open_log_file()
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int _open_log_segment(const char *path, int lock) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat segment_stat;
+    if (fd == -1 || (lock && flock(fd, LOCK_EX | LOCK_NB) == -1) || fstat(fd, &segment_stat) == -1) {
+        if (fd != -1) close(fd);
+        errno = 0;
+        return -1;
+    }
+
+    log_segment.fd = fd;
+    size_t size = segment_stat.st_size;
+    if (_map_log_segment(size > LOG_SEGMENT_MAX_BYTES ? size : LOG_SEGMENT_MAX_BYTES) != 0) {
+        close(fd);
+        log_segment.fd = -1;
+        return -1;
+    }
+
+    log_segment.cursor = _find_log_segment_end(size);
+    log_segment.opened_seconds = time(NULL);
+    strcpy(log_segment.path, path);
+
+    // Ogni segmento binario è leggibile da solo, quindi inizia con l'intestazione
+    if (LOG_FILE_BINARY && log_segment.cursor == 0) {
+        struct log_binary_header header = {
+                .magic = LOG_BINARY_MAGIC,
+                .version = LOG_BINARY_VERSION,
+                .record_size = sizeof(struct log_binary_record)
+        };
+        memcpy(log_segment.map, &header, sizeof(header));
+        log_segment.cursor = sizeof(header);
+    }
+    return 0;
+}
+
+/**
+ * Chiudi il segmento, togliendo lo spazio preallocato e non usato
+ */
+void _close_log_segment(void) {
+    munmap(log_segment.map, log_segment.capacity);
+    if (ftruncate(log_segment.fd, (off_t) log_segment.cursor) == -1)
+        errno = 0;
+    close(log_segment.fd);
+    log_segment.fd = -1;
+    log_segment.map = NULL;
+}
+
+/**
+ * Comprimi un segmento ruotato in un processo a parte, raccogliendo quelli già terminati
+ */
+void _compress_log_segment(const char *path) {
+    size_t running = 0;
+    for (size_t i = 0; i < log_compressions_count; i++) {
+        if (waitpid(log_compressions[i], NULL, WNOHANG) == 0)
+            log_compressions[running++] = log_compressions[i];
+    }
+    log_compressions_count = running;
+    if (log_compressions_count == LOG_MAX_COMPRESSIONS)
+        return;
+
+    pid_t pid;
+    char *argv[] = {LOG_COMPRESS_COMMAND, (char *) path, NULL};
+    if (posix_spawnp(&pid, LOG_COMPRESS_COMMAND, NULL, NULL, argv, environ) == 0)
+        log_compressions[log_compressions_count++] = pid;
+}
+
+/**
+ * Nome del segmento ruotato: il file di log con l'orario prima dell'estensione,
+ * e un contatore se esiste già, anche compresso
+ *
+ * @param path Percorso del file di log
+ * @param rotated Dove scrivere il nome, grande almeno LOG_FILE_PATH_SIZE
+ */
+void _rotated_log_segment_path(const char *path, char *rotated) {
+    size_t base_len = strlen(path) - strlen(LOG_FILE_EXTENSION);
+    time_t now = time(NULL);
+    struct tm now_tm;
+    localtime_r(&now, &now_tm);
+
+    char compressed[LOG_FILE_PATH_SIZE + sizeof(LOG_COMPRESS_EXTENSION)];
+    for (int counter = 0; counter == 0 || access(rotated, F_OK) == 0 || access(compressed, F_OK) == 0; counter++) {
+        int length = snprintf(rotated, LOG_FILE_PATH_SIZE, "%.*s.%04d%02d%02d-%02d%02d%02d", (int) base_len, path,
+                              now_tm.tm_year + 1900, now_tm.tm_mon + 1, now_tm.tm_mday,
+                              now_tm.tm_hour, now_tm.tm_min, now_tm.tm_sec);
+        if (counter > 0)
+            length += snprintf(rotated + length, LOG_FILE_PATH_SIZE - length, "-%d", counter);
+        snprintf(rotated + length, LOG_FILE_PATH_SIZE - length, "%s", LOG_FILE_EXTENSION);
+        snprintf(compressed, sizeof(compressed), "%s%s", rotated, LOG_COMPRESS_EXTENSION);
+    }
+}
+
+/**
+ * Ruota il segmento: rinominalo e aprine uno nuovo con il nome del file di log.
+ * Se un altro processo prende il nome nel frattempo, si continua nel segmento ruotato.
+ */
+void _rotate_log_segment(void) {
+    const char *path = get_log_file_path();
+    char rotated[LOG_FILE_PATH_SIZE];
+    if (strcmp(log_segment.path, path) == 0) {
+        _rotated_log_segment_path(path, rotated);
+        if (rename(path, rotated) == -1) {
+            errno = 0;
+            log_segment.opened_seconds = time(NULL); // Riprova solo al prossimo intervallo
+            return;
+        }
+    } else {
+        strcpy(rotated, log_segment.path); // Già ruotato da una rotazione fallita
+    }
+
+    _close_log_segment();
+    if (_open_log_segment(path, 1) != 0) {
+        _open_log_segment(rotated, 0);
+        return;
+    }
+
+    if (LOG_SEGMENT_COMPRESS)
+        _compress_log_segment(rotated);
+}
+
+int append_log_segment(const char *bytes, size_t length) {
+    if (log_segment.fd == -1) {
+        const char *path = get_log_file_path();
+        if (path == NULL || _open_log_segment(path, 0) != 0)
+            return -1; // Il lock è già del file aperto da _open_log_file()
+    }
+
+    // Un segmento vuoto non viene ruotato, anche se una sola scrittura non ci sta
+    size_t empty = LOG_FILE_BINARY ? sizeof(struct log_binary_header) : 0;
+    if (log_segment.cursor > empty && (log_segment.cursor + length > log_segment.capacity ||
+                                       time(NULL) - log_segment.opened_seconds >= LOG_SEGMENT_MAX_SECONDS))
+        _rotate_log_segment();
+
+    if (log_segment.fd == -1)
+        return -1;
+
+    // Rotazione fallita o scrittura più grande di un segmento: estendi quello attuale
+    if (log_segment.cursor + length > log_segment.capacity) {
+        size_t growth = length > LOG_SEGMENT_MAX_BYTES ? length : LOG_SEGMENT_MAX_BYTES;
+        if (_map_log_segment(log_segment.capacity + growth) != 0)
+            return -1;
+    }
+
+    memcpy(log_segment.map + log_segment.cursor, bytes, length);
+    log_segment.cursor += length;
+    return 0;
+}
+
+void close_log_segment() {
+    if (log_segment.fd != -1)
+        _close_log_segment();
+}
@@ -0,0 +1,46 @@
+#ifndef SERVER_LOG_SEGMENT_H
+#define SERVER_LOG_SEGMENT_H
+
+#include <stddef.h>
+
+/**
+ * Dimensione di un segmento di log, preallocata all'apertura: oltre questa il segmento viene ruotato
+ */
+#define LOG_SEGMENT_MAX_BYTES (64 << 20)
+
+/**
+ * Età massima di un segmento in secondi, oltre la quale viene ruotato alla prossima scrittura
+ */
+#define LOG_SEGMENT_MAX_SECONDS 3600
+
+/**
+ * Diverso da zero per comprimere i segmenti ruotati con LOG_COMPRESS_COMMAND, in un processo a parte
+ */
+#define LOG_SEGMENT_COMPRESS 1
+#define LOG_COMPRESS_COMMAND "gzip"
+#define LOG_COMPRESS_EXTENSION ".gz"
+
+/**
+ * Compressioni in corso al massimo: oltre, i segmenti ruotati restano non compressi
+ */
+#define LOG_MAX_COMPRESSIONS 8
+
+/**
+ * Aggiungi dei byte al segmento di log attuale, tramite il cursore sulla sua mappatura in memoria.
+ *
+ * Il segmento è il file di log scelto all'avvio (server.log): quando supera LOG_SEGMENT_MAX_BYTES
+ * o LOG_SEGMENT_MAX_SECONDS viene rinominato in server.AAAAMMGG-HHMMSS.log e sostituito da uno nuovo.
+ * Da chiamare da un solo thread alla volta.
+ *
+ * @param bytes Byte da scrivere
+ * @param length Numero di byte
+ * @return -1 se il file di log non è disponibile, 0 altrimenti
+ */
+int append_log_segment(const char *bytes, size_t length);
+
+/**
+ * Chiudi il segmento attuale, riducendo il file ai byte effettivamente scritti
+ */
+void close_log_segment();
+
+#endif //SERVER_LOG_SEGMENT_H
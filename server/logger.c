@@ -1,33 +1,258 @@
 #include "../common/logger.h"
+#include "async_log.h"
+#include "log_policy.h"
 #include <stdarg.h>
-#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+/**
+ * Stato delle politiche di log del thread, vedi log_policy.h
+ */
+struct log_policy_state {
+    /**
+     * Risultati visti per il campionamento, e registrati o esclusi nel secondo attuale
+     */
+    unsigned long results_seen;
+    time_t results_second;
+    unsigned long results_logged;
+    unsigned long results_skipped;
+
+    /**
+     * Ultimo messaggio registrato con un client, e quante volte è stato ripetuto da allora
+     */
+    int has_last_message;
+    struct sockaddr_in last_client;
+    uint16_t last_length;
+    char last_text[LOG_LINE_MAX_SIZE];
+    unsigned long repeated;
+    time_t repeated_since;
+};
+
+_Thread_local struct log_policy_state log_policy = {};
+
+/**
+ * Scrivi un messaggio già formattato nel ring del thread
+ */
+void _push_log_message(const struct sock_info *client_info, const char *text, size_t length) {
+    struct log_record *record = begin_log_record(client_info, LOG_RECORD_MESSAGE);
+    if (record == NULL)
+        return; // Ring pieno, il record è stato contato tra quelli persi
+
+    memcpy(record->text, text, length);
+    record->text_length = length;
+    commit_log_record(record);
+}
+
+/**
+ * Scrivi un messaggio di riepilogo, formattato come in log_message() ma senza politiche
+ */
+void _push_log_summary(const struct sock_info *client_info, const char *restrict format, unsigned long count) {
+    char text[LOG_LINE_MAX_SIZE];
+    int length = snprintf(text, sizeof(text), format, count);
+    _push_log_message(client_info, text, length < (int) sizeof(text) ? length : sizeof(text) - 1);
+}
+
+/**
+ * Riassumi le ripetizioni dell'ultimo messaggio, se ce ne sono
+ */
+void _flush_repeated_message(void) {
+    if (log_policy.repeated == 0)
+        return;
+
+    // Il riepilogo riporta il messaggio, perché nel frattempo possono essere stati registrati dei risultati
+    struct sock_info last_client_info = {.client_info = log_policy.last_client};
+    char text[LOG_LINE_MAX_SIZE];
+    int length = snprintf(text, sizeof(text), "Ripetuto altre %lu volte: %.*s", log_policy.repeated,
+                          (int) log_policy.last_length, log_policy.last_text);
+    _push_log_message(&last_client_info, text, length < (int) sizeof(text) ? length : sizeof(text) - 1);
+    log_policy.repeated = 0;
+}
+
+/**
+ * Controlla se un messaggio ripete l'ultimo dello stesso client, e in quel caso contalo soltanto
+ *
+ * @return Diverso da zero se il messaggio non va registrato
+ */
+int _collapse_log_message(const struct sock_info *client_info, const char *text, size_t length) {
+    if (LOG_REPEAT_WINDOW_SECONDS <= 0 || client_info == NULL)
+        return 0;
+
+    const struct sockaddr_in *client = &client_info->client_info;
+    if (log_policy.has_last_message && length == log_policy.last_length &&
+        client->sin_addr.s_addr == log_policy.last_client.sin_addr.s_addr &&
+        client->sin_port == log_policy.last_client.sin_port && memcmp(text, log_policy.last_text, length) == 0) {
+        time_t now = time(NULL);
+        if (log_policy.repeated++ == 0)
+            log_policy.repeated_since = now;
+        if (now - log_policy.repeated_since >= LOG_REPEAT_WINDOW_SECONDS)
+            _flush_repeated_message(); // Il client continua: riassumi ogni intervallo
+        return 1;
+    }
+
+    _flush_repeated_message();
+    log_policy.has_last_message = 1;
+    log_policy.last_client = *client;
+    log_policy.last_length = length;
+    memcpy(log_policy.last_text, text, length);
+    return 0;
+}
+
+/**
+ * Durata del calcolo in microsecondi, dai timestamp completi:
+ * i soli microsecondi ripartono da zero ogni secondo, e una richiesta di 1.000005 s durerebbe 5 us.
+ * timestamp_to_micros() riparte da zero a mezzanotte: una fine precedente all'inizio l'ha attraversata.
+ */
+uint64_t _elapsed_micros(const struct timestamp *start_time, const struct timestamp *end_time) {
+    uint64_t start_micros = timestamp_to_micros(start_time), end_micros = timestamp_to_micros(end_time);
+    if (end_micros >= start_micros)
+        return end_micros - start_micros;
+    return end_micros + 24ull * 3600 * 1000000 - start_micros;
+}
+
+/**
+ * Decidi se registrare un risultato secondo campionamento e limite al secondo.
+ * I risultati lenti vengono sempre registrati.
+ *
+ * @param client_info Informazioni sul client, per il riepilogo dei risultati esclusi
+ * @param elapsed_micros Durata del calcolo
+ * @return Diverso da zero se il risultato va registrato
+ */
+int _should_log_result(const struct sock_info *client_info, uint64_t elapsed_micros) {
+    if (LOG_RESULT_SAMPLE_EVERY <= 1 && LOG_RESULT_MAX_PER_SECOND <= 0)
+        return 1;
+
+    // Al cambio di secondo, riassumi i risultati esclusi in quello precedente
+    time_t now = time(NULL);
+    if (now != log_policy.results_second) {
+        if (log_policy.results_skipped > 0)
+            _push_log_summary(client_info, "%lu risultati non registrati per campionamento o limite al secondo\n",
+                              log_policy.results_skipped);
+        log_policy.results_second = now;
+        log_policy.results_logged = 0;
+        log_policy.results_skipped = 0;
+    }
+
+    if (elapsed_micros >= LOG_SLOW_MICROS)
+        return 1;
+
+    if ((LOG_RESULT_SAMPLE_EVERY > 1 && ++log_policy.results_seen % LOG_RESULT_SAMPLE_EVERY != 0) ||
+        (LOG_RESULT_MAX_PER_SECOND > 0 && log_policy.results_logged >= LOG_RESULT_MAX_PER_SECOND)) {
+        log_policy.results_skipped++;
+        return 0;
+    }
+
+    log_policy.results_logged++;
+    return 1;
+}
+
+void flush_log_policy(const struct sock_info *client_info) {
+    _flush_repeated_message();
+    log_policy.has_last_message = 0;
+
+    if (log_policy.results_skipped > 0) {
+        _push_log_summary(client_info, "%lu risultati non registrati per campionamento o limite al secondo\n",
+                          log_policy.results_skipped);
+        log_policy.results_skipped = 0;
+    }
+}
 
 /**
  * Esegui il log, inserendo anche le informazioni sul client.
  *
+ * Il messaggio viene scritto nel ring del thread: prefisso, file di log e stdout
+ * sono compito del thread di scrittura, fuori dal percorso della richiesta.
+ * Un messaggio identico al precedente dello stesso client viene solo contato (LOG_REPEAT_WINDOW_SECONDS).
+ *
  * @param client_info Informazioni sul client
  * @param format Formato della stringa di log, nel formato printf
  * @param ... Argomenti della stringa di log
  */
 void log_message(const struct sock_info *client_info, const char *restrict format, ...) {
     // Leggi i variadic parameters dai ..., da passare per creare il messaggio di log
+    char text[LOG_LINE_MAX_SIZE];
     va_list args;
     va_start(args, format);
-    char *log_line = calloc(LOG_LINE_MAX_SIZE, sizeof(char));
-    get_prefix(client_info, log_line);
-    vsnprintf(log_line + strlen(log_line), LOG_LINE_MAX_SIZE, format, args);
+    int length = vsnprintf(text, LOG_LINE_MAX_SIZE, format, args);
     va_end(args);
 
-    // Conserva negli ultimi log in memoria per mostrarlo nella tabella
-    flockfile(stdout);
-    free(logs_array[logs_index]);
-    logs_array[logs_index] = log_line;
-    logs_index = (logs_index + 1) % LOGS_ARRAY_SIZE;
-    funlockfile(stdout); // Accesso ai dati che riguardano l'output (come il log), sono in mutex
-
-    // Stampa il messaggio nel file di log
-    fwrite(log_line, sizeof(char), strlen(log_line), open_log_file());
-    fflush(open_log_file());
-    wprintf(L"%s", log_line);
+    size_t text_length = length < 0 ? 0 : length < LOG_LINE_MAX_SIZE ? length : LOG_LINE_MAX_SIZE - 1;
+    if (_collapse_log_message(client_info, text, text_length))
+        return;
+    _push_log_message(client_info, text, text_length);
+}
+
+/**
+ * Esegui il log di un risultato ottenuto con successo.
+ * I campi vengono copiati grezzi nel record, e formattati dal thread di scrittura.
+ * Il risultato può essere escluso da campionamento e limite al secondo, tranne se lento (log_policy.h).
+ *
+ * @param client_info Informazioni sul client che ha provocato l'errore
+ * @param operation_line Linea di input dell'operazione effettuata
+ * @param result Risultato dell'operazione
+ * @param start Tempo di inizio del calcolo
+ * @param end Tempo di fine del calcolo
+ */
+void log_result(const struct sock_info *client_info,
+                const char *operation_line,
+                operand_t result,
+                const struct timestamp *start_time,
+                const struct timestamp *end_time) {
+    uint64_t elapsed_micros = _elapsed_micros(start_time, end_time);
+    if (!_should_log_result(client_info, elapsed_micros))
+        return;
+
+    struct log_record *record = begin_log_record(client_info, LOG_RECORD_RESULT);
+    if (record == NULL)
+        return;
+
+    record->text_length = strnlen(operation_line, LOG_LINE_MAX_SIZE);
+    memcpy(record->text, operation_line, record->text_length);
+    record->result = result;
+    record->start_time = *start_time;
+    record->elapsed_micros = elapsed_micros;
+    commit_log_record(record);
+}
+
+
+/**
+ * Esegui il log di un'operazione binaria calcolata con successo.
+ * Nel formato binario vengono salvati solo operatore e operandi, senza la linea.
+ *
+ * @param client_info Informazioni sul client
+ * @param operation_line Linea di input dell'operazione effettuata
+ * @param operator Operatore
+ * @param left Operando di sinistra
+ * @param right Operando di destra
+ * @param result Risultato dell'operazione
+ * @param start_time Tempo di inizio del calcolo
+ * @param end_time Tempo di fine del calcolo
+ */
+void log_operation(const struct sock_info *client_info,
+                   const char *operation_line,
+                   char operator,
+                   operand_t left,
+                   operand_t right,
+                   operand_t result,
+                   const struct timestamp *start_time,
+                   const struct timestamp *end_time) {
+    uint64_t elapsed_micros = _elapsed_micros(start_time, end_time);
+    if (!_should_log_result(client_info, elapsed_micros))
+        return;
+
+    struct log_record *record = begin_log_record(client_info, LOG_RECORD_RESULT);
+    if (record == NULL)
+        return;
+
+    // La linea serve solo al log di testo, che la riporta così come è stata ricevuta
+    if (!LOG_FILE_BINARY) {
+        record->text_length = strnlen(operation_line, LOG_LINE_MAX_SIZE);
+        memcpy(record->text, operation_line, record->text_length);
+    }
+    record->operator = operator;
+    record->left = left;
+    record->right = right;
+    record->result = result;
+    record->start_time = *start_time;
+    record->elapsed_micros = elapsed_micros;
+    commit_log_record(record);
 }
\ No newline at end of file
@@ -4,11 +4,20 @@
 #include <netinet/in.h>
 #include <pthread.h>
 #include <wchar.h>
+#include <unistd.h>
 #include "socket_utils.h"
 #include "request_worker.h"
 #include "../common/logger.h"
 #include "../common/main_init.h"
 #include "live_status_table.h"
+#include "udp_listener.h"
+#include "shm_transport.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "expr_cache.h"
+#include "result_cache.h"
+#include "../common/bignum.h"
+#include <signal.h>
 
 /**
  * Gestisci una richiesta in arrivo, inviandola a un altro Thread,
@@ -21,9 +30,27 @@ void handle_request(int client_socket, const struct sockaddr_in *client);
 
 int main(int argc, const char **argv) {
     // Inizializza
-    if (main_init(argc, argv, "server", bind_server, NULL, NULL) != 0)
+    const char *ip;
+    uint16_t port;
+    if (main_init(argc, argv, "server", bind_server, &ip, &port) != 0)
         return EXIT_FAILURE;
 
+    // Un client che chiude durante l'invio di una risposta non deve terminare il server
+    handle_signal(SIGPIPE, SIG_IGN);
+
+    // Accetta anche datagrammi UDP sulla stessa porta.
+    // In caso di errore, il server TCP resta comunque utilizzabile.
+    if (start_udp_listener(ip, port) == -1)
+        log_message(NULL, "Modalità UDP non disponibile\n");
+
+    // Offri la memoria condivisa ai client sullo stesso host
+    if (start_shm_listener(port) == -1)
+        log_message(NULL, "Modalità in memoria condivisa non disponibile\n");
+
+    // Metriche per Prometheus, se attive
+    if (start_metrics_listener(port) == -1)
+        log_message(NULL, "Endpoint delle metriche non disponibile\n");
+
     // Mostra lo stato in live su stdout
     init_status_table();
 
@@ -35,7 +62,14 @@ int main(int argc, const char **argv) {
         handle_request(client_socket, &client);
     }
 
+    stop_udp_listener();
+    stop_shm_listener();
+    stop_metrics_listener();
     stop_status_table();
+    stop_thread_pool();
+    clear_expr_cache();
+    clear_result_cache();
+    clear_limb_pool();
     close_logging();
 
     return EXIT_SUCCESS;
@@ -47,24 +81,35 @@ void handle_request(int client_socket, const struct sockaddr_in *client) {
     } else if (client_socket == -1) {
         // Errore nell'accettazione della richiesta
         log_errno(NULL, "Accettazione nuova richiesta TCP");
+    } else if (elaborate_one_shot(client_socket, client) == 0) {
+        return; // Connessione one-shot già servita e chiusa
     } else {
         // Gestisci la richiesta su un nuovo thread
         pthread_t request_thread;
         struct sock_info *socket_info = malloc(sizeof(struct sock_info));
-        FILE *socket_file = fdopen(client_socket, "r+");
+        // Come fdopen(), ma i byte letti e scritti vengono contati nelle metriche
+        FILE *socket_file = open_metered_socket(client_socket, "r");
+        int output_socket = dup(client_socket);
+        FILE *socket_output = output_socket == -1 ? NULL : open_metered_socket(output_socket, "w");
         socket_info->socket_file = socket_file; // Vedasi doc di struct sock_info
+        socket_info->socket_output = socket_output;
         socket_info->client_info = *client;
 
-        if (socket_file == NULL) {
-            // Errore nell'apertura del socket file descriptor in r+
+        if (socket_file == NULL || socket_output == NULL) {
+            // Errore nell'apertura del socket file descriptor in lettura o scrittura
             log_errno(NULL, "Errore nell'apertura del file descriptor della socket");
+            if (socket_file != NULL) fclose(socket_file); else close(client_socket);
+            if (socket_output != NULL) fclose(socket_output); else if (output_socket != -1) close(output_socket);
+            free(socket_info);
         } else if (pthread_create(&request_thread,
                                   NULL,
                                   (void *(*)(void *)) elaborate_request,
                                   (void *) socket_info) != 0) {
             // Errore nella creazione del thread
             log_errno(socket_info, "Errore nella creazione del thread per la gestione della connessione TCP");
+            fclose(socket_output);
             fclose(socket_file);
+            free(socket_info);
         }
     }
 }
\ No newline at end of file
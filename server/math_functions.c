@@ -0,0 +1,233 @@
+#include "math_functions.h"
+#include "range_stream.h"
+#include "thread_pool.h"
+#include "result_cache.h"
+#include "metrics.h"
+#include "../common/logger.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * Dimensione massima di una linea di chunk: intestazione e valori in %.17g
+ */
+#define BATCH_CHUNK_MAX_BYTES (64 + RANGE_CHUNK_SIZE * 26)
+
+/**
+ * Valori di una richiesta batch, calcolati e formattati in parallelo
+ */
+struct function_batch {
+    enum math_function function;
+    enum math_mode mode;
+    operand_t exponent;
+
+    /**
+     * Argomenti, sovrascritti dai risultati
+     */
+    operand_t *values;
+    size_t count;
+
+    /**
+     * Linee formattate di ogni chunk, e la loro lunghezza
+     */
+    char *output;
+    size_t *lengths;
+};
+
+/**
+ * Leggi la parola successiva e, se è una modalità, consumala.
+ *
+ * @param arguments Puntatore agli argomenti, avanzato oltre la modalità se presente
+ * @return La modalità indicata, oppure MATH_MODE_EXACT
+ */
+enum math_mode _parse_math_mode(const char **arguments) {
+    const char *mode_arguments;
+    while (isspace((unsigned char) **arguments))
+        (*arguments)++;
+
+    if ((mode_arguments = match_command(*arguments, MATH_MODE_FAST_NAME)) != NULL) {
+        *arguments = mode_arguments;
+        return MATH_MODE_FAST;
+    } else if ((mode_arguments = match_command(*arguments, MATH_MODE_EXACT_NAME)) != NULL) {
+        *arguments = mode_arguments;
+    }
+    return MATH_MODE_EXACT;
+}
+
+/**
+ * Riconosci una linea che inizia col nome di una funzione matematica:
+ * FUNZIONE [MODALITÀ] X [Y]
+ *
+ * @param line Linea ricevuta dal client
+ * @param arguments Dove scrivere il puntatore agli argomenti, dopo il nome
+ * @return La funzione, oppure -1 se la linea non inizia con una funzione
+ */
+int match_math_function(const char *line, const char **arguments) {
+    size_t name_len = 0;
+    while (isalpha((unsigned char) line[name_len]))
+        name_len++;
+    if (line[name_len] != '\0' && !isspace((unsigned char) line[name_len]))
+        return -1;
+
+    *arguments = line + name_len;
+    return find_math_function(line, name_len);
+}
+
+/**
+ * Calcola una funzione su un singolo valore
+ *
+ * @param client_info Informazioni sul client
+ * @param session Sessione della connessione, per gli operandi che sono variabili
+ * @param function Funzione riconosciuta da match_math_function()
+ * @param arguments Argomenti, dopo il nome della funzione
+ * @param result Risultato della funzione
+ * @param response Buffer della risposta, dove scrivere l'eventuale linea di errore
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int evaluate_function(const struct sock_info *client_info, const struct session *session, enum math_function function,
+                      const char *arguments, operand_t *result, char *response) {
+    enum math_mode mode = _parse_math_mode(&arguments);
+    operand_t x, y = 0;
+
+    if (parse_session_operand(session, arguments, &arguments, &x) != 0 ||
+        (math_function_arity(function) == 2 && parse_session_operand(session, arguments, &arguments, &y) != 0)) {
+        log_message(client_info, "Errore nel parsing della funzione\n");
+        errno = 0;
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%cErrore del client\n", SERVER_ERROR_MESSAGE_PREFIX);
+        return -1;
+    }
+
+    *result = cached_function(function, mode, x, y);
+    return 0;
+}
+
+/**
+ * Calcola e formatta i chunk [begin, end) del batch
+ *
+ * @param context Batch da elaborare
+ * @param begin Primo chunk
+ * @param end Chunk successivo all'ultimo
+ */
+void _batch_chunk_task(void *context, size_t begin, size_t end) {
+    struct function_batch *batch = context;
+
+    for (size_t chunk = begin; chunk < end; chunk++) {
+        size_t first_value = chunk * RANGE_CHUNK_SIZE;
+        size_t values = batch->count - first_value < RANGE_CHUNK_SIZE ? batch->count - first_value
+                                                                       : RANGE_CHUNK_SIZE;
+        operand_t *chunk_values = batch->values + first_value;
+        calculate_function_batch(batch->function, batch->mode, chunk_values, batch->exponent, chunk_values, values);
+
+        char *buffer = batch->output + chunk * BATCH_CHUNK_MAX_BYTES;
+        int length = sprintf(buffer, "%c%zu %zu", RANGE_CHUNK_PREFIX, first_value, values);
+        for (size_t i = 0; i < values; i++)
+            length += sprintf(buffer + length, " %.17g", chunk_values[i]);
+
+        buffer[length++] = '\n';
+        batch->lengths[chunk] = length;
+    }
+}
+
+/**
+ * Leggi tutti i valori rimasti sulla linea
+ *
+ * @param arguments Valori separati da spazi
+ * @param count Dove scrivere il numero di valori letti
+ * @return Vettore dei valori da liberare con free(), NULL se non ce ne sono o in caso di errore
+ */
+operand_t *_parse_batch_values(const char *arguments, size_t *count) {
+    size_t capacity = 64;
+    operand_t *values = malloc(capacity * sizeof(operand_t));
+    *count = 0;
+
+    char *end;
+    for (operand_t value = strtod(arguments, &end); end != arguments; value = strtod(arguments, &end)) {
+        if (*count == capacity) {
+            capacity *= 2;
+            values = realloc(values, capacity * sizeof(operand_t));
+        }
+        values[(*count)++] = value;
+        arguments = end;
+    }
+
+    // Ci dev'essere almeno un valore, e nient'altro dopo l'ultimo
+    while (isspace((unsigned char) *arguments))
+        arguments++;
+    errno = 0;
+    if (*count == 0 || *arguments != '\0') {
+        free(values);
+        return NULL;
+    }
+    return values;
+}
+
+/**
+ * Calcola una funzione su tutti i valori della linea, in parallelo a blocchi,
+ * inviando i risultati in chunk come per gli intervalli.
+ *
+ * Al termine viene inviata la normale linea di risposta, col numero di valori come risultato.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo BATCH_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_batch(const struct sock_info *client_info, const char *arguments) {
+    struct timestamp start_time, end_time;
+    get_timestamp(&start_time);
+
+    while (isspace((unsigned char) *arguments))
+        arguments++;
+
+    struct function_batch batch = {};
+    int function = match_math_function(arguments, &arguments);
+    if (function == -1) {
+        log_message(client_info, "Funzione sconosciuta nel batch\n");
+        fprintf(client_info->socket_output, "%cFunzione sconosciuta\n", SERVER_ERROR_MESSAGE_PREFIX);
+        return -1;
+    }
+    batch.function = function;
+    batch.mode = _parse_math_mode(&arguments);
+
+    // Per pow, l'esponente comune precede i valori
+    const char *values_start = arguments;
+    if (batch.function == MATH_POW) {
+        char *end;
+        batch.exponent = strtod(arguments, &end);
+        values_start = end != arguments ? end : NULL;
+    }
+    batch.values = values_start != NULL ? _parse_batch_values(values_start, &batch.count) : NULL;
+
+    if (batch.values == NULL) {
+        log_message(client_info, "Errore nel parsing del batch\n");
+        fprintf(client_info->socket_output, "%cBatch non valido\n", SERVER_ERROR_MESSAGE_PREFIX);
+        return -1;
+    }
+
+    // Tutti i valori sono già in memoria, quindi lo è anche l'output: non servono crediti
+    size_t chunks = (batch.count + RANGE_CHUNK_SIZE - 1) / RANGE_CHUNK_SIZE;
+    batch.output = malloc(chunks * BATCH_CHUNK_MAX_BYTES);
+    batch.lengths = malloc(chunks * sizeof(size_t));
+
+    parallel_for(chunks, 1, _batch_chunk_task, &batch);
+
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+        fwrite(batch.output + chunk * BATCH_CHUNK_MAX_BYTES, sizeof(char), batch.lengths[chunk],
+               client_info->socket_output);
+
+    free(batch.output);
+    free(batch.lengths);
+    free(batch.values);
+
+    get_timestamp(&end_time);
+    log_result(client_info, BATCH_COMMAND, (operand_t) batch.count, &start_time, &end_time);
+    add_metrics_operation(METRICS_BATCH, &start_time, &end_time);
+
+    char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+    char end_time_str[TIMESTAMP_STRING_SIZE] = {};
+    timestamp_to_string(&start_time, start_time_str);
+    timestamp_to_string(&end_time, end_time_str);
+    fprintf(client_info->socket_output, "%s %s %lf\n", start_time_str, end_time_str, (operand_t) batch.count);
+    return 0;
+}
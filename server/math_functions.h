@@ -0,0 +1,50 @@
+#ifndef SERVER_MATH_FUNCTIONS_H
+#define SERVER_MATH_FUNCTIONS_H
+
+#include "../common/socket_utils.h"
+#include "../common/math_kernels.h"
+#include "session.h"
+
+/**
+ * Comando per calcolare una funzione su più valori:
+ * batch FUNZIONE [MODALITÀ] [ESPONENTE] X1 X2 ...
+ */
+#define BATCH_COMMAND "batch"
+
+/**
+ * Riconosci una linea che inizia col nome di una funzione matematica:
+ * FUNZIONE [MODALITÀ] X [Y]
+ *
+ * @param line Linea ricevuta dal client
+ * @param arguments Dove scrivere il puntatore agli argomenti, dopo il nome
+ * @return La funzione, oppure -1 se la linea non inizia con una funzione
+ */
+int match_math_function(const char *line, const char **arguments);
+
+/**
+ * Calcola una funzione su un singolo valore
+ *
+ * @param client_info Informazioni sul client
+ * @param session Sessione della connessione, per gli operandi che sono variabili
+ * @param function Funzione riconosciuta da match_math_function()
+ * @param arguments Argomenti, dopo il nome della funzione
+ * @param result Risultato della funzione
+ * @param response Buffer della risposta, dove scrivere l'eventuale linea di errore
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int evaluate_function(const struct sock_info *client_info, const struct session *session, enum math_function function,
+                      const char *arguments, operand_t *result, char *response);
+
+/**
+ * Calcola una funzione su tutti i valori della linea, in parallelo a blocchi,
+ * inviando i risultati in chunk come per gli intervalli.
+ *
+ * Al termine viene inviata la normale linea di risposta, col numero di valori come risultato.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo BATCH_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_batch(const struct sock_info *client_info, const char *arguments);
+
+#endif //SERVER_MATH_FUNCTIONS_H
@@ -0,0 +1,630 @@
+#define _GNU_SOURCE
+#include "metrics.h"
+#include "result_cache.h"
+#include "expression.h"
+#include "calculus_request.h"
+#include "range_stream.h"
+#include "math_functions.h"
+#include "bignum_request.h"
+#include "linear_algebra_request.h"
+#include "aggregate_request.h"
+#include "cell_graph.h"
+#include "live_status_table.h"
+#include "../common/logger.h"
+#include "../common/main_init.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+
+/**
+ * Nomi delle etichette, nell'ordine delle enum
+ */
+const char *metrics_transport_names[METRICS_TRANSPORTS] = {"tcp", "one_shot", "udp", "shm"};
+const char *metrics_operation_names[METRICS_OPERATIONS] = {
+        "+", "-", "*", "/", "^",
+        EXPRESSION_COMMAND, INTEGRATE_COMMAND, ROOT_COMMAND, "function", "typed",
+        RANGE_COMMAND, BATCH_COMMAND, BIGNUM_COMMAND, VECTOR_COMMAND, MATRIX_COMMAND, AGGREGATE_COMMAND, CELL_COMMAND
+};
+
+/**
+ * Contatori di un thread.
+ * Hanno un solo scrittore, il thread che li possiede, che li aggiorna con semplici load e store;
+ * gli scrape li leggono in qualsiasi momento.
+ */
+struct metrics_shard {
+    _Atomic uint64_t operations[METRICS_OPERATIONS];
+
+    /**
+     * Istogrammi dei tempi di calcolo e di risposta per tipo di operazione,
+     * allocati dal thread al primo utilizzo: di solito un thread ne usa pochi
+     */
+    _Atomic(struct latency_histogram *) compute_latency[METRICS_OPERATIONS];
+    _Atomic(struct latency_histogram *) response_latency[METRICS_OPERATIONS];
+
+    /**
+     * Somme esatte delle durate, per Prometheus
+     */
+    _Atomic uint64_t compute_sum_nanos[METRICS_OPERATIONS];
+    _Atomic uint64_t response_sum_nanos[METRICS_OPERATIONS];
+    _Atomic uint64_t errors[METRICS_TRANSPORTS];
+    _Atomic uint64_t connections_opened[METRICS_TRANSPORTS];
+    _Atomic uint64_t connections_closed[METRICS_TRANSPORTS];
+    _Atomic uint64_t received_bytes[METRICS_TRANSPORTS];
+    _Atomic uint64_t sent_bytes[METRICS_TRANSPORTS];
+
+    /**
+     * Diverso da zero finché il thread che lo possiede è in esecuzione.
+     * Alla sua terminazione passa a un nuovo thread, con i contatori accumulati fin lì.
+     */
+    _Atomic int in_use;
+
+    /**
+     * Prossimo elemento della lista di tutti i contatori, in cui vengono solo aggiunti
+     */
+    struct metrics_shard *next;
+
+    /**
+     * Ultima operazione contata e il suo tempo di calcolo (-1 se non misurato), per add_metrics_response().
+     * Usati solo dal thread che possiede i contatori.
+     */
+    int last_operation;
+    int64_t last_compute_nanos;
+};
+
+/**
+ * Somma dei contatori di tutti i thread, calcolata allo scrape
+ */
+struct metrics_totals {
+    uint64_t operations[METRICS_OPERATIONS];
+    uint64_t compute_sum_nanos[METRICS_OPERATIONS];
+    uint64_t response_sum_nanos[METRICS_OPERATIONS];
+    uint64_t errors[METRICS_TRANSPORTS];
+    uint64_t connections_opened[METRICS_TRANSPORTS];
+    uint64_t connections_closed[METRICS_TRANSPORTS];
+    uint64_t received_bytes[METRICS_TRANSPORTS];
+    uint64_t sent_bytes[METRICS_TRANSPORTS];
+};
+
+/**
+ * Lista dei contatori di tutti i thread
+ */
+_Atomic(struct metrics_shard *) metrics_shards = NULL;
+
+/**
+ * Contatori del thread corrente, NULL finché non conta qualcosa
+ */
+_Thread_local struct metrics_shard *metrics_shard = NULL;
+
+/**
+ * Chiave con cui i contatori vengono liberati alla terminazione del thread
+ */
+pthread_key_t metrics_shard_key;
+pthread_once_t metrics_shard_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Socket dell'endpoint e thread che risponde agli scrape
+ */
+int metrics_listener_fd = -1;
+pthread_t metrics_listener_thread;
+
+/**
+ * Cedi i contatori di un thread che termina
+ */
+void _release_metrics_shard(struct metrics_shard *shard) {
+    atomic_store_explicit(&shard->in_use, 0, memory_order_release);
+}
+
+void _create_metrics_shard_key(void) {
+    pthread_key_create(&metrics_shard_key, (void (*)(void *)) _release_metrics_shard);
+}
+
+/**
+ * Contatori del thread corrente: alla prima chiamata ne riusa di liberi, o ne crea di nuovi
+ *
+ * @return I contatori, o NULL se la memoria non è sufficiente
+ */
+struct metrics_shard *_metrics_shard(void) {
+    if (metrics_shard != NULL)
+        return metrics_shard;
+
+    pthread_once(&metrics_shard_key_once, _create_metrics_shard_key);
+
+    // Contatori di un thread terminato: i valori restano, perché sono sommati a tutti gli altri
+    struct metrics_shard *shard = atomic_load_explicit(&metrics_shards, memory_order_acquire);
+    for (; shard != NULL; shard = shard->next) {
+        int expected = 0;
+        if (atomic_load_explicit(&shard->in_use, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_strong_explicit(&shard->in_use, &expected, 1,
+                                                    memory_order_acquire, memory_order_relaxed))
+            break;
+    }
+
+    if (shard == NULL) {
+        // Dimensione multipla della linea di cache, per non condividerla con altri contatori
+        size_t size = (sizeof(struct metrics_shard) + 63) / 64 * 64;
+        shard = aligned_alloc(64, size);
+        if (shard == NULL)
+            return NULL;
+        memset(shard, 0, size);
+        atomic_init(&shard->in_use, 1);
+
+        shard->next = atomic_load_explicit(&metrics_shards, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&metrics_shards, &shard->next, shard,
+                                                      memory_order_release, memory_order_relaxed));
+    }
+
+    shard->last_operation = -1;
+    pthread_setspecific(metrics_shard_key, shard);
+    metrics_shard = shard;
+    return shard;
+}
+
+/**
+ * Istogramma del thread corrente, allocato se è il primo utilizzo
+ *
+ * @param histogram Puntatore all'istogramma nei contatori del thread
+ * @return L'istogramma, o NULL se la memoria non è sufficiente
+ */
+struct latency_histogram *_shard_histogram(_Atomic(struct latency_histogram *) *histogram) {
+    // Solo questo thread lo scrive: la lettura relaxed basta
+    struct latency_histogram *current = atomic_load_explicit(histogram, memory_order_relaxed);
+    if (current == NULL && (current = calloc(1, sizeof(struct latency_histogram))) != NULL)
+        atomic_store_explicit(histogram, current, memory_order_release);
+    return current;
+}
+
+const char *metrics_operation_name(enum metrics_operation operation) {
+    return metrics_operation_names[operation];
+}
+
+int metrics_operator(char operator) {
+    const char *operators = "+-*/^";
+    const char *found = operator == '\0' ? NULL : strchr(operators, operator);
+    return found == NULL ? -1 : (int) (found - operators);
+}
+
+void add_metrics_operation(enum metrics_operation operation, const struct timestamp *start_time,
+                           const struct timestamp *end_time) {
+    struct metrics_shard *shard = _metrics_shard();
+    if (shard == NULL)
+        return;
+
+    add_single_writer(&shard->operations[operation], 1);
+    shard->last_operation = operation;
+    shard->last_compute_nanos = -1;
+    if (start_time == NULL)
+        return;
+
+    // Il tempo di calcolo è quello del log, con la risoluzione dei microsecondi
+    uint64_t start_micros = timestamp_to_micros(start_time), end_micros = timestamp_to_micros(end_time);
+    uint64_t nanos = end_micros > start_micros ? (end_micros - start_micros) * 1000 : 0;
+    struct latency_histogram *histogram = _shard_histogram(&shard->compute_latency[operation]);
+    if (histogram != NULL)
+        record_latency(histogram, nanos);
+    add_single_writer(&shard->compute_sum_nanos[operation], nanos);
+    shard->last_compute_nanos = (int64_t) nanos;
+}
+
+uint64_t metrics_now_nanos(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void add_metrics_response(struct connection_latency *connection, uint64_t received_nanos) {
+    struct metrics_shard *shard = _metrics_shard();
+    if (shard == NULL || shard->last_operation == -1)
+        return;
+
+    uint64_t now = metrics_now_nanos();
+    uint64_t nanos = now > received_nanos ? now - received_nanos : 0;
+    struct latency_histogram *histogram = _shard_histogram(&shard->response_latency[shard->last_operation]);
+    if (histogram != NULL)
+        record_latency(histogram, nanos);
+    add_single_writer(&shard->response_sum_nanos[shard->last_operation], nanos);
+
+    if (connection != NULL) {
+        if (shard->last_compute_nanos != -1)
+            record_latency(&connection->compute, shard->last_compute_nanos);
+        record_latency(&connection->response, nanos);
+    }
+    shard->last_operation = -1;
+}
+
+void get_operation_latency(enum metrics_operation operation, struct latency_snapshot *compute,
+                           struct latency_snapshot *response) {
+    struct metrics_shard *shard = atomic_load_explicit(&metrics_shards, memory_order_acquire);
+    for (; shard != NULL; shard = shard->next) {
+        struct latency_histogram *histogram = atomic_load_explicit(&shard->compute_latency[operation],
+                                                                   memory_order_acquire);
+        if (histogram != NULL)
+            add_latency_snapshot(compute, histogram);
+        histogram = atomic_load_explicit(&shard->response_latency[operation], memory_order_acquire);
+        if (histogram != NULL)
+            add_latency_snapshot(response, histogram);
+    }
+}
+
+void add_metrics_error(enum metrics_transport transport) {
+    struct metrics_shard *shard = _metrics_shard();
+    if (shard != NULL)
+        add_single_writer(&shard->errors[transport], 1);
+}
+
+void add_metrics_connection(enum metrics_transport transport, int opened) {
+    struct metrics_shard *shard = _metrics_shard();
+    if (shard != NULL)
+        add_single_writer(opened ? &shard->connections_opened[transport] : &shard->connections_closed[transport], 1);
+}
+
+void add_metrics_bytes(enum metrics_transport transport, size_t received, size_t sent) {
+    struct metrics_shard *shard = _metrics_shard();
+    if (shard == NULL)
+        return;
+
+    if (received > 0)
+        add_single_writer(&shard->received_bytes[transport], received);
+    if (sent > 0)
+        add_single_writer(&shard->sent_bytes[transport], sent);
+}
+
+ssize_t _metered_socket_read(void *cookie, char *buffer, size_t size) {
+    ssize_t result = read((int) (intptr_t) cookie, buffer, size);
+    if (result > 0)
+        add_metrics_bytes(METRICS_TCP, result, 0);
+    return result;
+}
+
+/**
+ * Scrivi tutto il buffer: al contrario di un FILE da fdopen(), stdio non ripete le scritture parziali
+ *
+ * @return Byte scritti, meno di size in caso di errore
+ */
+ssize_t _metered_socket_write(void *cookie, const char *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t result = write((int) (intptr_t) cookie, buffer + written, size - written);
+        if (result <= 0)
+            break;
+        written += result;
+    }
+
+    add_metrics_bytes(METRICS_TCP, 0, written);
+    return (ssize_t) written;
+}
+
+int _metered_socket_close(void *cookie) {
+    return close((int) (intptr_t) cookie);
+}
+
+FILE *open_metered_socket(int socket, const char *mode) {
+    cookie_io_functions_t functions = {_metered_socket_read, _metered_socket_write, NULL, _metered_socket_close};
+    return fopencookie((void *) (intptr_t) socket, mode, functions);
+}
+
+/**
+ * Somma i contatori di tutti i thread
+ */
+void _sum_metrics(struct metrics_totals *totals) {
+    bzero(totals, sizeof(*totals));
+    struct metrics_shard *shard = atomic_load_explicit(&metrics_shards, memory_order_acquire);
+    for (; shard != NULL; shard = shard->next) {
+        for (int i = 0; i < METRICS_OPERATIONS; i++) {
+            totals->operations[i] += atomic_load_explicit(&shard->operations[i], memory_order_relaxed);
+            totals->compute_sum_nanos[i] += atomic_load_explicit(&shard->compute_sum_nanos[i], memory_order_relaxed);
+            totals->response_sum_nanos[i] += atomic_load_explicit(&shard->response_sum_nanos[i],
+                                                                  memory_order_relaxed);
+        }
+
+        for (int i = 0; i < METRICS_TRANSPORTS; i++) {
+            totals->errors[i] += atomic_load_explicit(&shard->errors[i], memory_order_relaxed);
+            totals->connections_opened[i] += atomic_load_explicit(&shard->connections_opened[i], memory_order_relaxed);
+            totals->connections_closed[i] += atomic_load_explicit(&shard->connections_closed[i], memory_order_relaxed);
+            totals->received_bytes[i] += atomic_load_explicit(&shard->received_bytes[i], memory_order_relaxed);
+            totals->sent_bytes[i] += atomic_load_explicit(&shard->sent_bytes[i], memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Scrivi una metrica con un valore per trasporto
+ */
+void _write_transport_metric(FILE *output, const char *name, const char *type, const char *help,
+                             const uint64_t *values) {
+    fprintf(output, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    for (int i = 0; i < METRICS_TRANSPORTS; i++)
+        fprintf(output, "%s{transport=\"%s\"} %lu\n", name, metrics_transport_names[i], (unsigned long) values[i]);
+}
+
+/**
+ * Scrivi un istogramma per tipo di operazione, con gli intervalli cumulativi di Prometheus
+ *
+ * @param output Dove scrivere
+ * @param name Nome della metrica
+ * @param help Descrizione della metrica
+ * @param snapshots Istogrammi di ogni tipo di operazione
+ * @param sums_nanos Somme delle durate di ogni tipo di operazione
+ */
+void _write_latency_metric(FILE *output, const char *name, const char *help,
+                           const struct latency_snapshot *snapshots, const uint64_t *sums_nanos) {
+    fprintf(output, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    for (int i = 0; i < METRICS_OPERATIONS; i++) {
+        if (snapshots[i].count == 0)
+            continue;
+
+        for (int j = 0; j < METRICS_PROMETHEUS_BUCKETS; j++) {
+            int bits = 10 + 2 * j;
+            fprintf(output, "%s_bucket{operator=\"%s\",le=\"%.9g\"} %lu\n", name, metrics_operation_names[i],
+                    (double) (1ull << bits) / 1e9, (unsigned long) latency_count_below(&snapshots[i], bits));
+        }
+        fprintf(output, "%s_bucket{operator=\"%s\",le=\"+Inf\"} %lu\n", name, metrics_operation_names[i],
+                (unsigned long) snapshots[i].count);
+        fprintf(output, "%s_sum{operator=\"%s\"} %.9f\n", name, metrics_operation_names[i],
+                (double) sums_nanos[i] / 1e9);
+        fprintf(output, "%s_count{operator=\"%s\"} %lu\n", name, metrics_operation_names[i],
+                (unsigned long) snapshots[i].count);
+    }
+}
+
+void write_latency_summary(FILE *output, const char *label, const char *kind, const struct latency_snapshot *snapshot) {
+    double percentiles[] = METRICS_LATENCY_PERCENTILES;
+    fprintf(output, "%-21s %-8s %10lu", label, kind, (unsigned long) snapshot->count);
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(double); i++) {
+        char latency[LATENCY_STRING_SIZE];
+        format_latency(latency_percentile(snapshot, percentiles[i]), latency);
+        fprintf(output, " %9s", latency);
+    }
+
+    char max[LATENCY_STRING_SIZE];
+    format_latency(snapshot->max, max);
+    fprintf(output, " %9s\n", max);
+}
+
+/**
+ * Scrivi i percentili di ogni tipo di operazione e di ogni connessione, per GET /latency
+ */
+void _write_latency_report(FILE *output) {
+    double percentiles[] = METRICS_LATENCY_PERCENTILES;
+    fprintf(output, "%-21s %-8s %10s", "Operatore/client", "Tempo", "Conteggio");
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(double); i++) {
+        char header[16];
+        snprintf(header, sizeof(header), "p%g", percentiles[i]);
+        fprintf(output, " %9s", header);
+    }
+    fprintf(output, " %9s\n", "max");
+
+    struct latency_snapshot *compute = malloc(2 * sizeof(struct latency_snapshot));
+    if (compute == NULL)
+        return;
+    struct latency_snapshot *response = compute + 1;
+    for (int i = 0; i < METRICS_OPERATIONS; i++) {
+        bzero(compute, 2 * sizeof(struct latency_snapshot));
+        get_operation_latency(i, compute, response);
+        if (compute->count > 0)
+            write_latency_summary(output, metrics_operation_names[i], "calcolo", compute);
+        if (response->count > 0)
+            write_latency_summary(output, metrics_operation_names[i], "risposta", response);
+    }
+    free(compute);
+
+    write_client_latencies(output);
+}
+
+/**
+ * Scrivi tutte le metriche nel formato di esposizione di Prometheus
+ */
+void _write_metrics(FILE *output) {
+    struct metrics_totals totals;
+    _sum_metrics(&totals);
+
+    uint64_t active[METRICS_TRANSPORTS];
+    for (int i = 0; i < METRICS_TRANSPORTS; i++) {
+        // Letti in momenti diversi: la chiusura può essere già contata e l'apertura non ancora
+        active[i] = totals.connections_opened[i] > totals.connections_closed[i]
+                    ? totals.connections_opened[i] - totals.connections_closed[i] : 0;
+    }
+
+    _write_transport_metric(output, "calc_connections_total", "counter", "Connessioni accettate",
+                            totals.connections_opened);
+    _write_transport_metric(output, "calc_connections_active", "gauge", "Connessioni aperte", active);
+    _write_transport_metric(output, "calc_errors_total", "counter", "Richieste con risposta di errore", totals.errors);
+    _write_transport_metric(output, "calc_received_bytes_total", "counter", "Byte ricevuti dai client",
+                            totals.received_bytes);
+    _write_transport_metric(output, "calc_sent_bytes_total", "counter", "Byte inviati ai client", totals.sent_bytes);
+
+    fprintf(output, "# HELP calc_operations_total Operazioni riuscite\n# TYPE calc_operations_total counter\n");
+    for (int i = 0; i < METRICS_OPERATIONS; i++) {
+        if (totals.operations[i] > 0)
+            fprintf(output, "calc_operations_total{operator=\"%s\"} %lu\n", metrics_operation_names[i],
+                    (unsigned long) totals.operations[i]);
+    }
+
+    // Istogrammi di tutti i tipi di operazione, sommati tra i thread
+    struct latency_snapshot *compute = calloc(METRICS_OPERATIONS, sizeof(struct latency_snapshot));
+    struct latency_snapshot *response = calloc(METRICS_OPERATIONS, sizeof(struct latency_snapshot));
+    if (compute != NULL && response != NULL) {
+        for (int i = 0; i < METRICS_OPERATIONS; i++)
+            get_operation_latency(i, &compute[i], &response[i]);
+        _write_latency_metric(output, "calc_operation_duration_seconds", "Tempo di calcolo delle operazioni riuscite",
+                              compute, totals.compute_sum_nanos);
+        _write_latency_metric(output, "calc_response_duration_seconds",
+                              "Tempo dalla lettura della richiesta alla scrittura della risposta",
+                              response, totals.response_sum_nanos);
+    }
+    free(compute);
+    free(response);
+
+    struct result_cache_stats cache_stats;
+    get_result_cache_stats(&cache_stats);
+    fprintf(output, "# HELP calc_result_cache_hits_total Risultati letti dalla cache\n"
+                    "# TYPE calc_result_cache_hits_total counter\n"
+                    "calc_result_cache_hits_total %lu\n", cache_stats.hits);
+    fprintf(output, "# HELP calc_result_cache_misses_total Risultati non trovati in cache\n"
+                    "# TYPE calc_result_cache_misses_total counter\n"
+                    "calc_result_cache_misses_total %lu\n", cache_stats.misses);
+    fprintf(output, "# HELP calc_result_cache_memory_bytes Memoria allocata dalla cache dei risultati\n"
+                    "# TYPE calc_result_cache_memory_bytes gauge\n"
+                    "calc_result_cache_memory_bytes %zu\n", cache_stats.memory);
+}
+
+/**
+ * Invia tutto il buffer sulla socket
+ *
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int _send_all(int socket, const char *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(socket, buffer, length, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return -1;
+        buffer += sent;
+        length -= sent;
+    }
+    return 0;
+}
+
+/**
+ * Rispondi a uno scrape: GET /metrics (o /) con le metriche, GET /latency con i percentili, 404 per il resto
+ *
+ * @param client_socket Socket dello scrape, chiusa dal chiamante
+ */
+void _serve_scrape(int client_socket) {
+    // Basta la riga della richiesta, gli header vengono ignorati
+    char request[METRICS_REQUEST_MAX_SIZE];
+    size_t request_len = 0;
+    while (request_len < sizeof(request) - 1 && memchr(request, '\n', request_len) == NULL) {
+        ssize_t received = recv(client_socket, request + request_len, sizeof(request) - 1 - request_len, 0);
+        if (received <= 0)
+            return;
+        request_len += received;
+    }
+    request[request_len] = '\0';
+
+    char *body = NULL;
+    size_t body_len = 0;
+    const char *status = "404 Not Found";
+    void (*write_body)(FILE *) = NULL;
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0)
+        write_body = _write_metrics;
+    else if (strncmp(request, "GET /latency ", 13) == 0)
+        write_body = _write_latency_report;
+
+    if (write_body != NULL) {
+        FILE *body_file = open_memstream(&body, &body_len);
+        if (body_file == NULL) {
+            log_errno(NULL, "Errore nella creazione della risposta delle metriche");
+            return;
+        }
+        write_body(body_file);
+        fclose(body_file);
+        status = "200 OK";
+    }
+
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: %zu\r\nConnection: close\r\n\r\n", status, body_len);
+    if (_send_all(client_socket, header, header_len) == -1 || _send_all(client_socket, body, body_len) == -1)
+        errno = 0; // Lo scrape ha chiuso prima della fine: nulla da fare
+    free(body);
+}
+
+/**
+ * Procedura del thread che risponde agli scrape, uno alla volta
+ */
+void _metrics_accept_loop(void) {
+    // Uno scrape che non invia la richiesta non blocca i successivi
+    struct timeval timeout = {1, 0};
+
+    while (socket_fd > 0) {
+        // Può essere interrotto con SIGINT al thread
+        int client_socket = accept(metrics_listener_fd, NULL, NULL);
+        if (client_socket == -1) {
+            if (errno != EINTR)
+                log_errno(NULL, "Accettazione nuovo scrape delle metriche");
+            errno = 0;
+            continue;
+        }
+
+        setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        _serve_scrape(client_socket);
+        close(client_socket);
+        errno = 0;
+    }
+}
+
+int start_metrics_listener(uint16_t port) {
+    if (METRICS_PORT == 0 && !METRICS_UNIX_SOCKET)
+        return 0;
+
+    if (METRICS_UNIX_SOCKET) {
+        // Indirizzo nel namespace astratto, come per la memoria condivisa
+        struct sockaddr_un address;
+        bzero(&address, sizeof(address));
+        address.sun_family = AF_UNIX;
+        int name_len = snprintf(address.sun_path + 1, sizeof(address.sun_path) - 1, METRICS_SOCKET_NAME_FORMAT, port);
+        socklen_t address_len = (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + name_len);
+
+        metrics_listener_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (metrics_listener_fd != -1 && bind(metrics_listener_fd, (struct sockaddr *) &address, address_len) == -1) {
+            close(metrics_listener_fd);
+            metrics_listener_fd = -1;
+        }
+    } else {
+        struct sockaddr_in address;
+        bzero(&address, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(METRICS_PORT);
+        inet_pton(AF_INET, METRICS_ADDRESS, &address.sin_addr);
+
+        int reuse = 1;
+        metrics_listener_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (metrics_listener_fd != -1 &&
+            (setsockopt(metrics_listener_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1 ||
+             bind(metrics_listener_fd, (struct sockaddr *) &address, sizeof(address)) == -1)) {
+            close(metrics_listener_fd);
+            metrics_listener_fd = -1;
+        }
+    }
+
+    if (metrics_listener_fd == -1 || listen(metrics_listener_fd, BACKLOG_SIZE) == -1) {
+        log_errno(NULL, "Errore nella creazione della socket delle metriche");
+        if (metrics_listener_fd != -1)
+            close(metrics_listener_fd);
+        metrics_listener_fd = -1;
+        return -1;
+    }
+
+    if ((errno = pthread_create(&metrics_listener_thread, NULL, (void *(*)(void *)) _metrics_accept_loop, NULL)) != 0) {
+        log_errno(NULL, "Errore nella creazione del thread delle metriche");
+        close(metrics_listener_fd);
+        metrics_listener_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+void stop_metrics_listener() {
+    if (metrics_listener_fd == -1)
+        return;
+
+    // Sblocca il thread dalla accept, socket_fd è già a zero a questo punto
+    if ((errno = pthread_kill(metrics_listener_thread, SIGINT)) != 0)
+        perror("pthread_kill in chiusura");
+    if ((errno = pthread_join(metrics_listener_thread, NULL)) != 0)
+        perror("pthread_join in chiusura");
+
+    close(metrics_listener_fd);
+    metrics_listener_fd = -1;
+}
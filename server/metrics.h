@@ -0,0 +1,197 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include "latency_histogram.h"
+#include "../common/timestamp.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Porta TCP locale dell'endpoint delle metriche, su METRICS_ADDRESS. 0 per disattivarlo.
+ */
+#define METRICS_PORT 9464
+#define METRICS_ADDRESS "127.0.0.1"
+
+/**
+ * Se diverso da zero, le metriche sono offerte su una socket Unix nel namespace astratto
+ * invece che sulla porta TCP, con un nome derivato dalla porta del server
+ * (es: curl --abstract-unix-socket calc-metrics-12345 http://localhost/metrics).
+ */
+#define METRICS_UNIX_SOCKET 0
+#define METRICS_SOCKET_NAME_FORMAT "calc-metrics-%u"
+
+/**
+ * Dimensione massima della richiesta HTTP di uno scrape, di cui si legge solo la prima riga
+ */
+#define METRICS_REQUEST_MAX_SIZE 4096
+
+/**
+ * Intervalli degli istogrammi delle durate esposti a Prometheus: il limite dell'intervallo i è 2^(10 + 2i)
+ * nanosecondi (da 1.024 us a circa 4.3 s), più l'intervallo senza limite.
+ * Sono ricavati dagli istogrammi HDR, di cui sono inizi di intervallo, quindi senza approssimazioni.
+ */
+#define METRICS_PROMETHEUS_BUCKETS 12
+
+/**
+ * Percentili mostrati da GET /latency
+ */
+#define METRICS_LATENCY_PERCENTILES {50, 90, 99, 99.9, 99.99}
+
+/**
+ * Trasporto da cui arriva una richiesta
+ */
+enum metrics_transport {
+    METRICS_TCP,
+
+    /**
+     * Connessioni TCP servite dal percorso rapido, vedi elaborate_one_shot()
+     */
+    METRICS_ONE_SHOT,
+    METRICS_UDP,
+    METRICS_SHM,
+    METRICS_TRANSPORTS
+};
+
+/**
+ * Tipo di operazione, l'etichetta "operator" delle metriche.
+ * I primi sono gli operatori binari, gli altri i comandi.
+ */
+enum metrics_operation {
+    METRICS_ADD,
+    METRICS_SUBTRACT,
+    METRICS_MULTIPLY,
+    METRICS_DIVIDE,
+    METRICS_POWER,
+    METRICS_EXPRESSION,
+    METRICS_INTEGRATE,
+    METRICS_ROOT,
+    METRICS_FUNCTION,
+    METRICS_TYPED,
+    METRICS_RANGE,
+    METRICS_BATCH,
+    METRICS_BIGNUM,
+    METRICS_VECTOR,
+    METRICS_MATRIX,
+    METRICS_AGGREGATE,
+    METRICS_CELL,
+    METRICS_OPERATIONS
+};
+
+/**
+ * Latenze di una connessione, registrate solo dal suo thread
+ */
+struct connection_latency {
+    /**
+     * Tempo di calcolo di ogni operazione, come nel log
+     */
+    struct latency_histogram compute;
+
+    /**
+     * Tempo nel server: dalla lettura della richiesta alla scrittura della risposta sulla socket
+     */
+    struct latency_histogram response;
+};
+
+/**
+ * Nome di un tipo di operazione, come nell'etichetta "operator"
+ */
+const char *metrics_operation_name(enum metrics_operation operation);
+
+/**
+ * Tipo di operazione di un operatore binario
+ *
+ * @param operator Operatore
+ * @return Il tipo, o -1 se l'operatore non è conosciuto
+ */
+int metrics_operator(char operator);
+
+/**
+ * Conta un'operazione riuscita e registra il suo tempo di calcolo nell'istogramma del suo tipo.
+ *
+ * Come tutte le funzioni di aggiornamento, scrive solo nei contatori del thread chiamante,
+ * senza lock né istruzioni atomiche di lettura e scrittura: vengono sommati solo allo scrape.
+ *
+ * @param operation Tipo di operazione
+ * @param start_time Istante di ricezione, NULL se la durata non è misurata (es: memoria condivisa)
+ * @param end_time Istante di fine
+ */
+void add_metrics_operation(enum metrics_operation operation, const struct timestamp *start_time,
+                           const struct timestamp *end_time);
+
+/**
+ * Istante attuale in nanosecondi, per misurare il tempo di risposta con add_metrics_response()
+ */
+uint64_t metrics_now_nanos(void);
+
+/**
+ * Registra il tempo di risposta dell'ultima operazione contata da add_metrics_operation() nel thread,
+ * e i suoi tempi nelle latenze della connessione.
+ *
+ * @param connection Latenze della connessione, NULL se non ne ha
+ * @param received_nanos Istante di lettura della richiesta, da metrics_now_nanos()
+ */
+void add_metrics_response(struct connection_latency *connection, uint64_t received_nanos);
+
+/**
+ * Somma gli istogrammi di tutti i thread per un tipo di operazione
+ *
+ * @param operation Tipo di operazione
+ * @param compute Copia dei tempi di calcolo, azzerata prima
+ * @param response Copia dei tempi di risposta, azzerata prima
+ */
+void get_operation_latency(enum metrics_operation operation, struct latency_snapshot *compute,
+                           struct latency_snapshot *response);
+
+/**
+ * Scrivi una riga con conteggio, percentili (METRICS_LATENCY_PERCENTILES) e massimo di un istogramma
+ *
+ * @param output Dove scrivere
+ * @param label Operatore o client
+ * @param kind Tempo misurato, es: "calcolo"
+ * @param snapshot Istogramma
+ */
+void write_latency_summary(FILE *output, const char *label, const char *kind, const struct latency_snapshot *snapshot);
+
+/**
+ * Conta una richiesta a cui è stato risposto con un errore
+ */
+void add_metrics_error(enum metrics_transport transport);
+
+/**
+ * Conta l'apertura o la chiusura di una connessione
+ *
+ * @param transport Trasporto della connessione
+ * @param opened Diverso da zero per l'apertura, zero per la chiusura
+ */
+void add_metrics_connection(enum metrics_transport transport, int opened);
+
+/**
+ * Conta i byte ricevuti e inviati
+ */
+void add_metrics_bytes(enum metrics_transport transport, size_t received, size_t sent);
+
+/**
+ * Apri la socket di una connessione TCP come FILE, contando i byte letti o scritti
+ *
+ * @param socket Socket della connessione, chiusa insieme al FILE
+ * @param mode "r" o "w", come per fdopen()
+ * @return Il FILE, o NULL in caso di errore
+ */
+FILE *open_metered_socket(int socket, const char *mode);
+
+/**
+ * Avvia il thread che risponde agli scrape, se l'endpoint è attivo.
+ * GET /metrics restituisce le metriche per Prometheus, GET /latency i percentili
+ * di ogni tipo di operazione e di ogni connessione, leggibili direttamente.
+ *
+ * @param port Porta del server, da cui deriva il nome della socket Unix
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int start_metrics_listener(uint16_t port);
+
+/**
+ * Termina il thread degli scrape e chiudi la sua socket
+ */
+void stop_metrics_listener();
+
+#endif //SERVER_METRICS_H
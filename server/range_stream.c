@@ -0,0 +1,196 @@
+#include "range_stream.h"
+#include "thread_pool.h"
+#include "metrics.h"
+#include "../common/calc_utils.h"
+#include "../common/logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/**
+ * Dimensione massima di una linea di chunk: intestazione e valori in %.17g
+ */
+#define RANGE_CHUNK_MAX_BYTES (64 + RANGE_CHUNK_SIZE * 26)
+
+/**
+ * Finestra di chunk calcolati e formattati in parallelo
+ */
+struct range_window {
+    char operator;
+    operand_t operand;
+    operand_t start;
+    operand_t step;
+
+    /**
+     * Numero totale di valori dell'intervallo
+     */
+    size_t count;
+
+    /**
+     * Indice, nell'intervallo, del primo chunk della finestra
+     */
+    size_t first_chunk;
+
+    /**
+     * Linee formattate di ogni chunk della finestra, e la loro lunghezza
+     */
+    char *buffers[RANGE_WINDOW_CHUNKS];
+    size_t lengths[RANGE_WINDOW_CHUNKS];
+};
+
+/**
+ * Calcola e formatta i chunk [begin, end) della finestra
+ *
+ * @param context Finestra da elaborare
+ * @param begin Primo chunk nella finestra
+ * @param end Chunk successivo all'ultimo
+ */
+void _range_chunk_task(void *context, size_t begin, size_t end) {
+    struct range_window *window = context;
+
+    for (size_t chunk = begin; chunk < end; chunk++) {
+        size_t first_value = (window->first_chunk + chunk) * RANGE_CHUNK_SIZE;
+        size_t values = window->count - first_value < RANGE_CHUNK_SIZE ? window->count - first_value
+                                                                        : RANGE_CHUNK_SIZE;
+        char *buffer = window->buffers[chunk];
+        int length = sprintf(buffer, "%c%zu %zu", RANGE_CHUNK_PREFIX, first_value, values);
+
+        for (size_t i = 0; i < values; i++) {
+            operand_t x = window->start + (operand_t) (first_value + i) * window->step;
+            length += sprintf(buffer + length, " %.17g", calculate_operation(x, window->operator, window->operand));
+        }
+
+        buffer[length++] = '\n';
+        window->lengths[chunk] = length;
+    }
+}
+
+/**
+ * Attendi dal client la concessione di nuovi crediti.
+ * Si legge dallo stesso stream delle richieste: non serve un altro canale.
+ *
+ * @param client_info Informazioni sul client
+ * @param credits Dove aggiungere i crediti ricevuti
+ * @return -1 in caso di errore o disconnessione, 0 altrimenti
+ */
+int _wait_credits(const struct sock_info *client_info, size_t *credits) {
+    char *line = NULL;
+    size_t line_size = 0;
+    int result = -1;
+
+    // Può essere interrotto con SIGINT al thread
+    if (getline(&line, &line_size, client_info->socket_file) > 0) {
+        const char *arguments = match_command(line, CREDIT_COMMAND);
+        unsigned long new_credits;
+        if (arguments != NULL && sscanf(arguments, "%lu", &new_credits) == 1 && new_credits > 0) {
+            *credits += new_credits;
+            result = 0;
+        }
+    }
+
+    free(line);
+    return result;
+}
+
+/**
+ * Valuta l'operatore con operando fisso su tutti i valori dell'intervallo,
+ * inviando i risultati in chunk man mano che il client concede crediti.
+ *
+ * Al termine viene inviata la normale linea di risposta, col numero di valori come risultato.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo RANGE_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_range(const struct sock_info *client_info, const char *arguments) {
+    struct timestamp start_time, end_time;
+    get_timestamp(&start_time);
+
+    struct range_window window = {};
+    if (sscanf(arguments, " %c %lf %lf %lf %zu", &window.operator, &window.operand, // NOLINT(cert-err34-c)
+               &window.start, &window.step, &window.count) < 5) {
+        log_message(client_info, "Errore nel parsing dell'intervallo\n");
+        errno = 0;
+        fprintf(client_info->socket_output, "%cIntervallo non valido\n", SERVER_ERROR_MESSAGE_PREFIX);
+        return -1;
+    }
+
+    calculate_operation(0, window.operator, 0);
+    if (errno == EINVAL) {
+        log_errno(client_info, "Operazione sconosciuta");
+        errno = 0;
+        fprintf(client_info->socket_output, "%cOperazione sconosciuta\n", SERVER_ERROR_MESSAGE_PREFIX);
+        return -1;
+    }
+
+    // Memoria limitata dalla finestra, indipendentemente dalla dimensione dell'intervallo
+    size_t total_chunks = (window.count + RANGE_CHUNK_SIZE - 1) / RANGE_CHUNK_SIZE;
+    size_t window_capacity = total_chunks < RANGE_WINDOW_CHUNKS ? total_chunks : RANGE_WINDOW_CHUNKS;
+    for (size_t i = 0; i < window_capacity; i++) {
+        if ((window.buffers[i] = malloc(RANGE_CHUNK_MAX_BYTES)) == NULL) {
+            log_errno(client_info, "Errore nell'allocazione della finestra dell'intervallo");
+            errno = 0;
+            fprintf(client_info->socket_output, "%cMemoria insufficiente\n", SERVER_ERROR_MESSAGE_PREFIX);
+            while (i > 0)
+                free(window.buffers[--i]);
+            return -1;
+        }
+    }
+
+    size_t credits = RANGE_INITIAL_CREDITS;
+    int result = 0;
+    errno = 0;
+
+    while (window.first_chunk < total_chunks) {
+        // Senza crediti non si calcola nulla: un client lento non fa crescere la memoria
+        if (credits == 0) {
+            fflush(client_info->socket_output);
+            if (_wait_credits(client_info, &credits) == -1) {
+                log_message(client_info, "Credito non valido, intervallo interrotto\n");
+                fprintf(client_info->socket_output, "%cCredito non valido\n", SERVER_ERROR_MESSAGE_PREFIX);
+                errno = 0;
+                result = -1;
+                break;
+            }
+        }
+
+        size_t window_chunks = total_chunks - window.first_chunk;
+        if (window_chunks > credits) window_chunks = credits;
+        if (window_chunks > window_capacity) window_chunks = window_capacity;
+
+        // Ogni chunk è abbastanza grande da valere un thread a sè
+        parallel_for(window_chunks, 1, _range_chunk_task, &window);
+        errno = 0; // calculate_operation() lo imposta nei thread, l'operatore è già stato verificato
+
+        for (size_t i = 0; i < window_chunks; i++)
+            fwrite(window.buffers[i], sizeof(char), window.lengths[i], client_info->socket_output);
+        fflush(client_info->socket_output);
+
+        if (ferror(client_info->socket_output)) {
+            log_errno(client_info, "Invio dell'intervallo interrotto");
+            result = -1;
+            break;
+        }
+
+        credits -= window_chunks;
+        window.first_chunk += window_chunks;
+    }
+
+    for (size_t i = 0; i < window_capacity; i++)
+        free(window.buffers[i]);
+
+    if (result == 0) {
+        get_timestamp(&end_time);
+        log_result(client_info, RANGE_COMMAND, (operand_t) window.count, &start_time, &end_time);
+        add_metrics_operation(METRICS_RANGE, &start_time, &end_time);
+
+        char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+        char end_time_str[TIMESTAMP_STRING_SIZE] = {};
+        timestamp_to_string(&start_time, start_time_str);
+        timestamp_to_string(&end_time, end_time_str);
+        fprintf(client_info->socket_output, "%s %s %lf\n", start_time_str, end_time_str, (operand_t) window.count);
+    }
+
+    return result;
+}
@@ -0,0 +1,50 @@
+#ifndef SERVER_RANGE_STREAM_H
+#define SERVER_RANGE_STREAM_H
+
+#include "../common/socket_utils.h"
+
+/**
+ * Comando per la valutazione di un intervallo:
+ * range OPERATORE OPERANDO INIZIO PASSO QUANTITÀ
+ */
+#define RANGE_COMMAND "range"
+
+/**
+ * Comando con cui il client concede altri chunk al server: credit N
+ */
+#define CREDIT_COMMAND "credit"
+
+/**
+ * Prefisso di una linea di chunk: >INDICE_PRIMO_VALORE NUMERO_VALORI V1 V2 ...
+ */
+#define RANGE_CHUNK_PREFIX '>'
+
+/**
+ * Numero di valori in un chunk
+ */
+#define RANGE_CHUNK_SIZE 1024
+
+/**
+ * Chunk che il server può inviare prima di attendere un credit dal client
+ */
+#define RANGE_INITIAL_CREDITS 4
+
+/**
+ * Numero massimo di chunk calcolati insieme in parallelo.
+ * Limita la memoria usata per ogni richiesta, anche con molti crediti.
+ */
+#define RANGE_WINDOW_CHUNKS 16
+
+/**
+ * Valuta l'operatore con operando fisso su tutti i valori dell'intervallo,
+ * inviando i risultati in chunk man mano che il client concede crediti.
+ *
+ * Al termine viene inviata la normale linea di risposta, col numero di valori come risultato.
+ *
+ * @param client_info Informazioni sul client
+ * @param arguments Argomenti del comando, dopo RANGE_COMMAND
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_range(const struct sock_info *client_info, const char *arguments);
+
+#endif //SERVER_RANGE_STREAM_H
@@ -1,15 +1,75 @@
+#define _GNU_SOURCE
 #include "request_worker.h"
 #include "../common/logger.h"
 #include "../common/main_init.h"
 #include "live_status_table.h"
+#include "range_stream.h"
+#include "expr_cache.h"
+#include "math_functions.h"
+#include "bignum_request.h"
+#include "aggregate_request.h"
+#include "linear_algebra_request.h"
+#include "typed_operations.h"
+#include "session.h"
+#include "cell_graph.h"
+#include "calculus_request.h"
+#include "result_cache.h"
+#include "log_policy.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
 
-int parse_client_line(const struct sock_info *client_info, char *line, char *operator, operand_t *left_operand,
-                      operand_t *right_operand, operand_t *result);
+int parse_client_line(const struct sock_info *client_info, const struct session *session, const char *line,
+                      char *operator, operand_t *left_operand, operand_t *right_operand, operand_t *result,
+                      char *response);
+
+int evaluate_expression(const struct sock_info *client_info, struct session *session, const char *expression,
+                        operand_t *result, char *response);
+
+/**
+ * Comandi legati alla connessione, gestiti da elaborate_request() e mai dal percorso rapido
+ */
+enum connection_command {
+    CONNECTION_RANGE,
+    CONNECTION_BATCH,
+    CONNECTION_BIGNUM,
+    CONNECTION_VECTOR,
+    CONNECTION_MATRIX,
+    CONNECTION_AGGREGATE,
+    CONNECTION_CELL,
+    CONNECTION_CREDIT,
+    CONNECTION_COMMANDS
+};
+
+/**
+ * Nomi dei comandi della connessione, nell'ordine di enum connection_command
+ */
+const char *connection_command_names[CONNECTION_COMMANDS] = {
+        RANGE_COMMAND, BATCH_COMMAND, BIGNUM_COMMAND, VECTOR_COMMAND, MATRIX_COMMAND,
+        AGGREGATE_COMMAND, CELL_COMMAND, CREDIT_COMMAND
+};
+
+/**
+ * Riconosci un comando della connessione
+ *
+ * @param line Linea ricevuta dal client
+ * @param arguments Dove scrivere il puntatore agli argomenti del comando
+ * @return Il comando, o CONNECTION_COMMANDS se la linea non è un comando della connessione
+ */
+enum connection_command _match_connection_command(const char *line, const char **arguments) {
+    for (int command = 0; command < CONNECTION_COMMANDS; command++) {
+        if ((*arguments = match_command(line, connection_command_names[command])) != NULL)
+            return command;
+    }
+    return CONNECTION_COMMANDS;
+}
 
 /**
  * Elabora la connessione / richiesta ricevuta dal client.
@@ -25,91 +85,538 @@ void elaborate_request(const struct sock_info *client_info) {
     char *line = NULL;
     size_t line_size = 0;
     ssize_t chars_read;
+    struct aggregate_stream *aggregate = NULL;
+    struct cell_graph *cells = NULL;
+    struct session session;
+    init_session(&session);
 
     // Mostra il nuovo client nella tabella di stato
-    register_client(client_info, pthread_self());
+    struct live_status_slot *status_slot = register_client(client_info, pthread_self());
+    add_metrics_connection(METRICS_TCP, 1);
 
     do {
         // Ottieni la riga dell'operazione, può essere interrotto con SIGINT al thread
         chars_read = getline(&line, &line_size, client_info->socket_file);
         if (chars_read < 0) break;
+        uint64_t received_nanos = metrics_now_nanos();
 
         // Rimuovi il \n o \r\n finale
         strip_newline(line, &chars_read);
 
-        // Inizia a calcolare il tempo
-        struct timestamp start_time, end_time;
-        get_timestamp(&start_time);
-
-        // Effettua il parsing della linea e calcola l'operazione
-        char operator;
-        operand_t left_operand, right_operand;
-        operand_t result;
-
-        if (parse_client_line(client_info, line, &operator, &left_operand, &right_operand, &result) == 0) {
-            // Conteggia una nuova operazione nel live status
-            add_client_operation(client_info);
-
-            // Termina il conteggio del tempo
-            get_timestamp(&end_time);
-
-            // Tieni traccia nel log
-            log_result(client_info, line, result, &start_time, &end_time);
-
-            // Invia la risposta al client
-            // [timestamp ricezione richiesta, timestamp invio risposta, risultato operazione]
-            char start_time_str[TIMESTAMP_STRING_SIZE] = {};
-            char end_time_str[TIMESTAMP_STRING_SIZE] = {};
-            timestamp_to_string(&start_time, start_time_str);
-            timestamp_to_string(&end_time, end_time_str);
-            fprintf(client_info->socket_file, "%s %s %lf\n", start_time_str, end_time_str, result);
+        const char *arguments;
+        int status; // -1 se al client è stato risposto con un errore
+        switch (_match_connection_command(line, &arguments)) {
+            case CONNECTION_RANGE:
+                // Intervallo con risultati in streaming, disponibile solo su connessione
+                status = elaborate_range(client_info, arguments);
+                break;
+            case CONNECTION_BATCH:
+                // Funzione su più valori, con risultati in chunk come per gli intervalli
+                status = elaborate_batch(client_info, arguments);
+                break;
+            case CONNECTION_BIGNUM:
+                // Precisione arbitraria: il risultato può essere più lungo di una normale risposta
+                status = elaborate_bignum(client_info, arguments);
+                break;
+            case CONNECTION_VECTOR:
+                // Operandi binari che seguono la linea, letti dalla stessa connessione
+                status = elaborate_vector(client_info, arguments);
+                break;
+            case CONNECTION_MATRIX:
+                status = elaborate_matrix(client_info, arguments);
+                break;
+            case CONNECTION_AGGREGATE:
+                // Statistiche su un flusso di valori, con stato legato alla connessione
+                status = elaborate_aggregate(client_info, &aggregate, arguments);
+                break;
+            case CONNECTION_CELL:
+                // Celle con dipendenze, i cui aggiornamenti sono inviati alla stessa connessione
+                status = elaborate_cell(client_info, &cells, arguments);
+                break;
+            case CONNECTION_CREDIT:
+                // Crediti avanzati dall'ultimo intervallo: non richiedono risposta né sono un'operazione
+                continue;
+            default: {
+                // Elabora l'operazione e invia la risposta (o l'errore) al client
+                char response[RESPONSE_LINE_MAX_SIZE];
+                status = elaborate_operation(client_info, &session, line, response);
+                fputs(response, client_info->socket_output);
+            }
         }
+        fflush(client_info->socket_output);
+        add_metrics_response(get_client_latency(status_slot), received_nanos);
 
-        fflush(client_info->socket_file);
+        // Conteggia una nuova operazione nel live status, o l'errore nelle metriche
+        if (status == 0)
+            add_client_operation(status_slot);
+        else
+            add_metrics_error(METRICS_TCP);
     } while (chars_read > 0 && errno == 0);
 
     if (errno != 0 && working) {
         log_errno(client_info, "Impossibile leggere la linea");
     }
 
-    remove_client(client_info);
+    flush_log_policy(client_info);
+    remove_client(status_slot);
+    add_metrics_connection(METRICS_TCP, 0);
+    free(aggregate);
+    free_cell_graph(cells);
+    free_session(&session);
     free(line);
-    fflush(client_info->socket_file);
+    fclose(client_info->socket_output);
     fclose(client_info->socket_file);
     free((struct sock_info *) client_info);
     pthread_detach(pthread_self());
 }
 
+/**
+ * Calcola l'operazione di una linea e scrivi la linea di risposta
+ *
+ * @param client_info Informazioni sul client
+ * @param session Sessione della connessione
+ * @param line Linea completa, per il log
+ * @param operation Operazione da calcolare, dopo l'eventuale assegnazione
+ * @param result Dove scrivere il risultato, per la sessione
+ * @param response Buffer di almeno RESPONSE_LINE_MAX_SIZE caratteri dove scrivere la risposta
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int _calculate_line(const struct sock_info *client_info, struct session *session, const char *line,
+                    const char *operation, operand_t *result, char *response) {
+    // Inizia a calcolare il tempo
+    struct timestamp start_time, end_time;
+    get_timestamp(&start_time);
+
+    // Effettua il parsing della linea e calcola l'operazione
+    char operator = '\0';
+    operand_t left_operand, right_operand;
+    const char *arguments;
+    int function, type = -1;
+    union typed_operand typed_result;
+    enum metrics_operation metrics_operation;
+
+    if ((arguments = match_command(operation, EXPRESSION_COMMAND)) != NULL) {
+        if (evaluate_expression(client_info, session, arguments, result, response) != 0)
+            return -1;
+        metrics_operation = METRICS_EXPRESSION;
+    } else if ((arguments = match_command(operation, INTEGRATE_COMMAND)) != NULL) {
+        if (evaluate_calculus(client_info, session, 0, arguments, result, response) != 0)
+            return -1;
+        metrics_operation = METRICS_INTEGRATE;
+    } else if ((arguments = match_command(operation, ROOT_COMMAND)) != NULL) {
+        if (evaluate_calculus(client_info, session, 1, arguments, result, response) != 0)
+            return -1;
+        metrics_operation = METRICS_ROOT;
+    } else if ((function = match_math_function(operation, &arguments)) != -1) {
+        if (evaluate_function(client_info, session, function, arguments, result, response) != 0)
+            return -1;
+        metrics_operation = METRICS_FUNCTION;
+    } else if ((type = match_operand_type(operation, &arguments)) != -1) {
+        if (evaluate_typed_operation(client_info, type, arguments, &typed_result, response) != 0)
+            return -1;
+        *result = typed_operand_to_double(type, &typed_result);
+        metrics_operation = METRICS_TYPED;
+    } else if (parse_client_line(client_info, session, operation, &operator, &left_operand, &right_operand, result,
+                                 response) != 0) {
+        return -1;
+    } else {
+        // L'operatore è valido, altrimenti il calcolo sarebbe fallito
+        metrics_operation = metrics_operator(operator);
+    }
+
+    // Termina il conteggio del tempo
+    get_timestamp(&end_time);
+    add_metrics_operation(metrics_operation, &start_time, &end_time);
+
+    // Tieni traccia nel log: per le operazioni binarie senza assegnazione bastano gli operandi
+    if (operator != '\0' && line == operation)
+        log_operation(client_info, line, operator, left_operand, right_operand, *result, &start_time, &end_time);
+    else
+        log_result(client_info, line, *result, &start_time, &end_time);
+
+    // [timestamp ricezione richiesta, timestamp invio risposta, risultato operazione]
+    char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+    char end_time_str[TIMESTAMP_STRING_SIZE] = {};
+    timestamp_to_string(&start_time, start_time_str);
+    timestamp_to_string(&end_time, end_time_str);
+    if (type == -1) {
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%s %s %lf\n", start_time_str, end_time_str, *result);
+        return 0;
+    }
+
+    // I risultati tipizzati hanno tutte le cifre del loro tipo, es: interi oltre 2^53
+    char result_str[TYPED_OPERAND_STRING_SIZE];
+    format_typed_operand(type, &typed_result, result_str);
+    snprintf(response, RESPONSE_LINE_MAX_SIZE, "%s %s %s\n", start_time_str, end_time_str, result_str);
+    return 0;
+}
+
+/**
+ * Elabora una singola linea di operazione ricevuta dal client,
+ * scrivendo nel buffer la linea di risposta da inviargli.
+ *
+ * La risposta è nel formato [timestamp ricezione, timestamp fine, risultato],
+ * oppure una linea di errore che inizia con SERVER_ERROR_MESSAGE_PREFIX.
+ *
+ * @param client_info Informazioni sul client
+ * @param session Sessione della connessione, aggiornata con ans e l'eventuale assegnazione
+ * @param line Linea ricevuta dal client, senza \n finale
+ * @param response Buffer di almeno RESPONSE_LINE_MAX_SIZE caratteri dove scrivere la risposta
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_operation(const struct sock_info *client_info, struct session *session, char *line, char *response) {
+    // NOME = OPERAZIONE: il risultato viene salvato anche nella variabile
+    char variable[EXPRESSION_MAX_NAME_SIZE] = "";
+    const char *operation = match_assignment(line, variable);
+    if (operation == NULL)
+        operation = line;
+
+    operand_t result;
+    if (_calculate_line(client_info, session, line, operation, &result, response) != 0) {
+        // Le operazioni successive di una catena in pipeline non devono usare un ans vecchio
+        session->has_answer = 0;
+        return -1;
+    }
+
+    if (variable[0] != '\0' && set_session_variable(session, variable, result) != 0) {
+        log_message(client_info, "Impossibile assegnare la variabile %s\n", variable);
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%cTroppe variabili\n", SERVER_ERROR_MESSAGE_PREFIX);
+        session->has_answer = 0;
+        return -1;
+    }
+    set_session_variable(session, SESSION_ANSWER_NAME, result);
+    return 0;
+}
+
+/**
+ * Controlla se una linea può essere servita dal percorso rapido. Richiedono quello completo
+ * i comandi della connessione (enum connection_command, gli stessi su cui smista elaborate_request()),
+ * e le operazioni dalla durata non limitata (espressioni, integrali, radici), che bloccherebbero il thread di accept.
+ *
+ * @param line Linea della richiesta, senza \n finale
+ * @return Diverso da zero se basta elaborate_operation()
+ */
+int _is_one_shot_line(const char *line) {
+    const char *arguments;
+    if (_match_connection_command(line, &arguments) != CONNECTION_COMMANDS)
+        return 0;
+
+    char variable[EXPRESSION_MAX_NAME_SIZE];
+    const char *operation = match_assignment(line, variable);
+    if (operation == NULL)
+        operation = line;
+    const char *expensive[] = {EXPRESSION_COMMAND, INTEGRATE_COMMAND, ROOT_COMMAND};
+    for (size_t i = 0; i < sizeof(expensive) / sizeof(expensive[0]); i++) {
+        if (match_command(operation, expensive[i]) != NULL)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Numero di thread che stanno completando una risposta rapida, limitato a ONE_SHOT_MAX_DEFERRED_REPLIES
+ */
+_Atomic unsigned int one_shot_deferred_replies = 0;
+
+/**
+ * Risposta rapida che non è stato possibile inviare senza bloccare, completata da un thread a parte
+ */
+struct one_shot_reply {
+    int socket;
+    struct sockaddr_in client;
+    size_t received;
+    size_t sent;
+    size_t length;
+    char data[];
+};
+
+/**
+ * Chiudi una connessione one-shot, contando i byte nelle metriche
+ */
+void _close_one_shot(int client_socket, size_t received, size_t sent) {
+    close(client_socket);
+    add_metrics_bytes(METRICS_ONE_SHOT, received, sent);
+    add_metrics_connection(METRICS_ONE_SHOT, 0);
+}
+
+/**
+ * Procedura del thread che invia il resto di una risposta rapida e chiude la connessione.
+ * L'invio si blocca al massimo per ONE_SHOT_SEND_TIMEOUT_SECONDS, e il thread è registrato
+ * nella tabella di stato, così che stop_status_table() possa interromperlo e attenderlo.
+ */
+void _finish_one_shot_reply(struct one_shot_reply *reply) {
+    struct sock_info client_info = {NULL, NULL, reply->client};
+    struct live_status_slot *status_slot = register_client(&client_info, pthread_self());
+
+    while (reply->sent < reply->length && socket_fd > 0) {
+        // Può essere interrotto con SIGINT al thread, anche dopo aver inviato una parte
+        ssize_t result = send(reply->socket, reply->data + reply->sent, reply->length - reply->sent, MSG_NOSIGNAL);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result <= 0) {
+            if (errno != EINTR)
+                log_errno(&client_info, "Errore nell'invio della risposta rapida");
+            break;
+        }
+        reply->sent += result;
+    }
+
+    remove_client(status_slot);
+    _close_one_shot(reply->socket, reply->received, reply->sent);
+    free(reply);
+    one_shot_deferred_replies--;
+    errno = 0;
+    pthread_detach(pthread_self());
+}
+
+/**
+ * Affida il resto di una risposta rapida a un thread, per non bloccare il thread di accept.
+ * Con già ONE_SHOT_MAX_DEFERRED_REPLIES thread attivi la risposta non viene affidata.
+ *
+ * @param client_socket Socket della connessione, chiusa dal thread
+ * @param client Indirizzo del client
+ * @param received Byte ricevuti, per le metriche
+ * @param response Risposta completa
+ * @param length Lunghezza della risposta
+ * @param sent Byte già inviati
+ * @return -1 in caso di errore (la connessione resta da chiudere), 0 altrimenti
+ */
+int _defer_one_shot_reply(int client_socket, const struct sockaddr_in *client, size_t received,
+                          const char *response, size_t length, size_t sent) {
+    // Client che non leggono le risposte non devono poter creare thread senza limite
+    if (++one_shot_deferred_replies > ONE_SHOT_MAX_DEFERRED_REPLIES) {
+        one_shot_deferred_replies--;
+        errno = EAGAIN;
+        return -1;
+    }
+
+    struct timeval timeout = {ONE_SHOT_SEND_TIMEOUT_SECONDS, 0};
+    struct one_shot_reply *reply = malloc(sizeof(struct one_shot_reply) + length);
+    if (reply == NULL || setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == -1) {
+        free(reply);
+        one_shot_deferred_replies--;
+        return -1;
+    }
+    reply->socket = client_socket;
+    reply->client = *client;
+    reply->received = received;
+    reply->sent = sent;
+    reply->length = length;
+    memcpy(reply->data, response, length);
+
+    pthread_t reply_thread;
+    if ((errno = pthread_create(&reply_thread, NULL, (void *(*)(void *)) _finish_one_shot_reply, reply)) != 0) {
+        free(reply);
+        one_shot_deferred_replies--;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Connessioni accettate tra un controllo del percorso rapido e il successivo.
+ * Usata solo dal thread di accept.
+ */
+unsigned int one_shot_probe_interval = 1;
+
+/**
+ * Connessioni da accettare ancora senza controllare il percorso rapido.
+ * Usata solo dal thread di accept.
+ */
+unsigned int one_shot_probe_countdown = 0;
+
+/**
+ * Servi la connessione dal percorso rapido, se il client ha già chiuso la scrittura
+ *
+ * @return 0 se la connessione è stata gestita e chiusa, -1 se serve il percorso completo
+ */
+int _serve_one_shot(int client_socket, const struct sockaddr_in *client) {
+    // Il client deve aver già chiuso la scrittura: allora tutti i dati sono già arrivati
+    struct pollfd poll_fd = {client_socket, POLLIN | POLLRDHUP, 0};
+    if (poll(&poll_fd, 1, 0) != 1 || !(poll_fd.revents & POLLRDHUP) || !(poll_fd.revents & POLLIN))
+        return -1;
+
+    // Sbircia senza consumare, così in caso contrario il percorso completo trova tutto intatto
+    char request[ONE_SHOT_REQUEST_MAX_SIZE];
+    ssize_t request_len = recv(client_socket, request, sizeof(request) - 1, MSG_PEEK | MSG_DONTWAIT);
+    if (request_len <= 0 || request_len == sizeof(request) - 1 || request[request_len - 1] != '\n') {
+        errno = 0;
+        return -1;
+    }
+
+    // Con un comando della connessione, tutta la richiesta passa dal percorso completo:
+    // la risposta non deve dipendere da quando il client ha chiuso la scrittura
+    char lines[ONE_SHOT_REQUEST_MAX_SIZE];
+    memcpy(lines, request, request_len);
+    lines[request_len] = '\0';
+    char *lines_save_ptr = NULL;
+    for (char *line = strtok_r(lines, "\n", &lines_save_ptr); line != NULL;
+         line = strtok_r(NULL, "\n", &lines_save_ptr)) {
+        if (!_is_one_shot_line(line))
+            return -1;
+    }
+
+    // È davvero una richiesta one-shot: consumala
+    if (recv(client_socket, request, request_len, MSG_DONTWAIT) != request_len) {
+        errno = 0;
+        return -1;
+    }
+    request[request_len] = '\0';
+    uint64_t received_nanos = metrics_now_nanos();
+
+    struct sock_info client_info = {NULL, NULL, *client};
+    add_metrics_connection(METRICS_ONE_SHOT, 1);
+    struct session session;
+    init_session(&session);
+    char response[ONE_SHOT_REQUEST_MAX_SIZE * 32];
+    size_t response_len = 0;
+    unsigned int operations = 0;
+    char *save_ptr = NULL;
+
+    for (char *line = strtok_r(request, "\n", &save_ptr); line != NULL; line = strtok_r(NULL, "\n", &save_ptr)) {
+        ssize_t line_len = (ssize_t) strlen(line);
+        strip_newline(line, &line_len);
+
+        char line_response[RESPONSE_LINE_MAX_SIZE];
+        if (elaborate_operation(&client_info, &session, line, line_response) == 0)
+            operations++;
+        else
+            add_metrics_error(METRICS_ONE_SHOT);
+        // Le risposte partono insieme alla fine: si misura fino a quella di questa operazione pronta
+        add_metrics_response(NULL, received_nanos);
+
+        size_t line_response_len = strlen(line_response);
+        if (response_len + line_response_len > sizeof(response))
+            break;
+        memcpy(response + response_len, line_response, line_response_len);
+        response_len += line_response_len;
+    }
+
+    // Senza bloccare: un client che non legge non deve fermare il thread di accept
+    ssize_t sent = send(client_socket, response, response_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        sent = 0;
+    if (sent >= 0 && (size_t) sent < response_len) {
+        if (_defer_one_shot_reply(client_socket, client, request_len, response, response_len, sent) != 0) {
+            log_errno(&client_info, "Impossibile completare la risposta rapida");
+            _close_one_shot(client_socket, request_len, sent);
+        }
+    } else {
+        if (sent == -1)
+            log_errno(&client_info, "Errore nell'invio della risposta rapida");
+        _close_one_shot(client_socket, request_len, sent > 0 ? sent : 0);
+    }
+    free_session(&session);
+    errno = 0;
+
+    add_one_shot_connection(operations);
+    return 0;
+}
+
+/**
+ * Percorso rapido per le connessioni "one-shot": il client ha già inviato
+ * tutte le sue operazioni e chiuso la scrittura (es: con TCP Fast Open, nel SYN).
+ *
+ * In questo caso si risponde direttamente, senza FILE*, malloc, thread
+ * né registrazione nella tabella di stato, e si chiude la connessione.
+ * Altrimenti, o se una linea è un comando della connessione (es: range) o un calcolo di durata non limitata
+ * (es: expr), non viene letto nulla dalla socket. La risposta che non si può inviare subito passa a un thread.
+ *
+ * Il controllo costa una poll() per connessione: se non arrivano client one-shot, viene fatto
+ * sempre più di rado, fino a una connessione ogni ONE_SHOT_PROBE_MAX_INTERVAL.
+ *
+ * @param client_socket Socket appena accettata
+ * @param client Indirizzo del client
+ * @return 0 se la connessione è stata gestita e chiusa, -1 se serve il percorso completo
+ */
+int elaborate_one_shot(int client_socket, const struct sockaddr_in *client) {
+    if (one_shot_probe_countdown > 0) {
+        one_shot_probe_countdown--;
+        return -1;
+    }
+
+    if (_serve_one_shot(client_socket, client) == 0) {
+        one_shot_probe_interval = 1;
+        return 0;
+    }
+
+    // Nessun client one-shot: il prossimo controllo è più lontano
+    if (one_shot_probe_interval < ONE_SHOT_PROBE_MAX_INTERVAL)
+        one_shot_probe_interval *= 2;
+    one_shot_probe_countdown = one_shot_probe_interval - 1;
+    return -1;
+}
+
 /**
  * Esegui il parsing della stringa del client, gestendo gli errori e i calcoli
  *
  * @param client_info Informazioni sul client
+ * @param session Sessione della connessione, per gli operandi che sono variabili
  * @param line Linea ricevuta dal client
  * @param operator Operatore estratto dalla stringa
  * @param left_operand Operando sinistro estratto dalla stringa
  * @param right_operand Operando destro estratto dalla stringa
  * @param result Risultato dell'operazione
+ * @param response Buffer della risposta, dove scrivere l'eventuale linea di errore
  * @return -1 in caso di errore, 0 altrimenti
  */
-int parse_client_line(const struct sock_info *client_info, char *line, char *operator, operand_t *left_operand,
-                      operand_t *right_operand, operand_t *result) {
+int parse_client_line(const struct sock_info *client_info, const struct session *session, const char *line,
+                      char *operator, operand_t *left_operand, operand_t *right_operand, operand_t *result,
+                      char *response) {
 
-    if (sscanf(line, "%c %lf %lf", operator, left_operand, right_operand) < 3) { // NOLINT(cert-err34-c)
+    // Gli operandi possono essere numeri o variabili della sessione, come ans
+    *operator = line[0];
+    if (*operator == '\0' || parse_session_operand(session, line + 1, &line, left_operand) != 0 ||
+        parse_session_operand(session, line, &line, right_operand) != 0) {
         // Errore nella lettura
         log_message(client_info, "Errore nel parsing dell'operazione\n");
         errno = 0;
         // Segnala l'errore al client, inviando una linea col solo errore
-        fprintf(client_info->socket_file, "%cErrore del client\n", SERVER_ERROR_MESSAGE_PREFIX);
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%cErrore del client\n", SERVER_ERROR_MESSAGE_PREFIX);
         return -1;
     }
 
-    // Esegui il calcolo
-    *result = calculate_operation(*left_operand, *operator, *right_operand);
+    // Esegui il calcolo, dalla cache se l'operatore è costoso
+    *result = cached_operation(*left_operand, *operator, *right_operand);
     if (errno == EINVAL) {
         log_errno(client_info, "Operazione sconosciuta");
         errno = 0;
         // Segnala l'errore al client, inviando una linea che inizia per -
-        fprintf(client_info->socket_file, "%cOperazione sconosciuta\n", SERVER_ERROR_MESSAGE_PREFIX);
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%cOperazione sconosciuta\n", SERVER_ERROR_MESSAGE_PREFIX);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Valuta un'espressione completa, usando il programma compilato in cache
+ * o compilandolo alla prima occorrenza del testo.
+ *
+ * @param client_info Informazioni sul client
+ * @param session Sessione della connessione, che risolve le variabili dell'espressione
+ * @param expression Testo dell'espressione
+ * @param result Risultato dell'espressione
+ * @param response Buffer della risposta, dove scrivere l'eventuale linea di errore
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int evaluate_expression(const struct sock_info *client_info, struct session *session, const char *expression,
+                        operand_t *result, char *response) {
+    const char *error = NULL;
+    struct expr_program *program = acquire_program(expression, &error);
+    if (program == NULL) {
+        log_message(client_info, "Errore nell'espressione: %s\n", error);
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%c%s\n", SERVER_ERROR_MESSAGE_PREFIX, error);
+        return -1;
+    }
+
+    int status = run_program(program, resolve_session_variable, session, result);
+    release_program(program);
+    errno = 0;
+
+    if (status != 0) {
+        log_message(client_info, "Variabile sconosciuta nell'espressione\n");
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%cVariabile sconosciuta\n", SERVER_ERROR_MESSAGE_PREFIX);
         return -1;
     }
 
@@ -2,6 +2,29 @@
 #define SERVER_REQUEST_WORKER_H
 
 #include "../common/socket_utils.h"
+#include "session.h"
+
+/**
+ * Dimensione massima di una richiesta gestita tramite il percorso rapido
+ */
+#define ONE_SHOT_REQUEST_MAX_SIZE 1024
+
+/**
+ * Con solo connessioni normali, il percorso rapido viene controllato al più
+ * una volta ogni ONE_SHOT_PROBE_MAX_INTERVAL connessioni accettate (potenza di 2)
+ */
+#define ONE_SHOT_PROBE_MAX_INTERVAL 64
+
+/**
+ * Numero massimo di risposte rapide completate in contemporanea da un thread a parte.
+ * Oltre, la risposta che non si può inviare subito viene scartata e la connessione chiusa.
+ */
+#define ONE_SHOT_MAX_DEFERRED_REPLIES 64
+
+/**
+ * Secondi dopo cui si rinuncia a completare una risposta rapida che il client non legge
+ */
+#define ONE_SHOT_SEND_TIMEOUT_SECONDS 5
 
 /**
  * Elabora la connessione / richiesta ricevuta dal client.
@@ -15,5 +38,39 @@
  */
 void elaborate_request(const struct sock_info *client_info);
 
+/**
+ * Elabora una singola linea di operazione ricevuta dal client,
+ * scrivendo nel buffer la linea di risposta da inviargli.
+ *
+ * La risposta è nel formato [timestamp ricezione, timestamp fine, risultato],
+ * oppure una linea di errore che inizia con SERVER_ERROR_MESSAGE_PREFIX.
+ *
+ * Il risultato diventa ans nella sessione, e con NOME = OPERAZIONE anche il valore della variabile.
+ *
+ * @param client_info Informazioni sul client
+ * @param session Sessione della connessione (o del datagramma)
+ * @param line Linea ricevuta dal client, senza \n finale
+ * @param response Buffer di almeno RESPONSE_LINE_MAX_SIZE caratteri dove scrivere la risposta
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int elaborate_operation(const struct sock_info *client_info, struct session *session, char *line, char *response);
+
+/**
+ * Percorso rapido per le connessioni "one-shot": il client ha già inviato
+ * tutte le sue operazioni e chiuso la scrittura (es: con TCP Fast Open, nel SYN).
+ *
+ * In questo caso si risponde direttamente, senza FILE*, malloc, thread
+ * né registrazione nella tabella di stato, e si chiude la connessione.
+ * Altrimenti, o se una linea è un comando della connessione (es: range) o un calcolo di durata non limitata
+ * (es: expr), non viene letto nulla dalla socket. La risposta che non si può inviare subito passa a un thread.
+ *
+ * Il controllo costa una poll() per connessione: se non arrivano client one-shot, viene fatto
+ * sempre più di rado, fino a una connessione ogni ONE_SHOT_PROBE_MAX_INTERVAL.
+ *
+ * @param client_socket Socket appena accettata
+ * @param client Indirizzo del client
+ * @return 0 se la connessione è stata gestita e chiusa, -1 se serve il percorso completo
+ */
+int elaborate_one_shot(int client_socket, const struct sockaddr_in *client);
 
 #endif //SERVER_REQUEST_WORKER_H
@@ -0,0 +1,273 @@
+#include "result_cache.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Codice delle funzioni nella chiave: gli operatori sono caratteri ASCII, quindi minori
+ */
+#define RESULT_CACHE_FUNCTION_BASE 128
+
+/**
+ * Elemento della cache. La chiave sono i bit degli operandi, non il loro valore:
+ * così -0 e 0 restano distinti e anche un NaN può essere una chiave.
+ */
+struct result_cache_entry {
+    uint64_t left;
+    uint64_t right;
+    operand_t result;
+
+    /**
+     * Elemento successivo nello stesso bucket, come indice + 1 (0 alla fine della lista)
+     */
+    uint32_t next;
+
+    /**
+     * Operatore o RESULT_CACHE_FUNCTION_BASE + funzione
+     */
+    uint8_t operation;
+
+    /**
+     * Bit di riferimento dell'algoritmo CLOCK: impostato a ogni hit, azzerato dalla lancetta
+     */
+    uint8_t referenced;
+};
+
+/**
+ * Shard della cache: tabella hash con liste di collisione su un vettore di elementi
+ * di capacità fissa, allocato al primo inserimento
+ */
+struct result_cache_shard {
+    _Alignas(64) pthread_mutex_t mutex;
+    struct result_cache_entry *entries;
+
+    /**
+     * Primo elemento di ogni bucket, come indice + 1
+     */
+    uint32_t *buckets;
+    uint32_t count;
+
+    /**
+     * Lancetta dell'algoritmo CLOCK, sull'elemento da esaminare per il prossimo rimpiazzo
+     */
+    uint32_t hand;
+
+    _Atomic unsigned long hits;
+    _Atomic unsigned long misses;
+};
+
+struct result_cache_shard result_cache_shards[RESULT_CACHE_SHARDS] = {
+        [0 ... RESULT_CACHE_SHARDS - 1] = {.mutex = PTHREAD_MUTEX_INITIALIZER}
+};
+
+/**
+ * Memoria allocata da tutti gli shard, in byte
+ */
+_Atomic size_t result_cache_memory = 0;
+
+/**
+ * Elementi per shard, calcolati una sola volta: 0 se la cache è disattivata
+ */
+uint32_t result_cache_capacity = 0;
+pthread_once_t result_cache_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Scegli gli elementi per shard: la massima potenza di 2 che, con altrettanti bucket,
+ * sta nella quota di memoria dello shard
+ */
+void _init_shard_capacity(void) {
+    size_t shard_bytes = RESULT_CACHE_MAX_BYTES / RESULT_CACHE_SHARDS;
+    size_t entry_bytes = sizeof(struct result_cache_entry) + sizeof(uint32_t);
+    if (shard_bytes < entry_bytes)
+        return;
+
+    result_cache_capacity = 1;
+    while ((size_t) result_cache_capacity * 2 * entry_bytes <= shard_bytes)
+        result_cache_capacity *= 2;
+}
+
+/**
+ * Hash della chiave: i bit alti scelgono lo shard, i bassi il bucket
+ */
+uint64_t _result_hash(uint8_t operation, uint64_t left, uint64_t right) {
+    uint64_t hash = (left ^ (right * 0x9E3779B97F4A7C15ull)) + operation;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+/**
+ * Alloca gli elementi e i bucket dello shard. Da chiamare col lock dello shard.
+ *
+ * @return -1 se manca la memoria, 0 altrimenti
+ */
+int _alloc_shard(struct result_cache_shard *shard, uint32_t capacity) {
+    shard->entries = malloc(capacity * sizeof(struct result_cache_entry));
+    shard->buckets = calloc(capacity, sizeof(uint32_t));
+    if (shard->entries == NULL || shard->buckets == NULL) {
+        free(shard->entries);
+        free(shard->buckets);
+        shard->entries = NULL;
+        shard->buckets = NULL;
+        errno = 0;
+        return -1;
+    }
+
+    atomic_fetch_add_explicit(&result_cache_memory,
+                              capacity * (sizeof(struct result_cache_entry) + sizeof(uint32_t)),
+                              memory_order_relaxed);
+    return 0;
+}
+
+/**
+ * Scegli l'elemento da rimpiazzare con l'algoritmo CLOCK, staccandolo dal suo bucket.
+ * La lancetta salta gli elementi usati dall'ultimo passaggio, azzerandone il bit di riferimento.
+ *
+ * @return Indice dell'elemento libero
+ */
+uint32_t _evict_result_entry(struct result_cache_shard *shard, uint32_t capacity) {
+    while (shard->entries[shard->hand].referenced) {
+        shard->entries[shard->hand].referenced = 0;
+        shard->hand = (shard->hand + 1) & (capacity - 1);
+    }
+
+    uint32_t victim = shard->hand;
+    shard->hand = (shard->hand + 1) & (capacity - 1);
+
+    const struct result_cache_entry *entry = &shard->entries[victim];
+    uint32_t *link = &shard->buckets[_result_hash(entry->operation, entry->left, entry->right) & (capacity - 1)];
+    while (*link != victim + 1)
+        link = &shard->entries[*link - 1].next;
+    *link = entry->next;
+    return victim;
+}
+
+/**
+ * Cerca il risultato in cache, o calcolalo con la funzione e inseriscilo
+ *
+ * @param operation Operatore o RESULT_CACHE_FUNCTION_BASE + funzione
+ * @param calculate Calcolo da eseguire in caso di miss, fuori dal lock
+ */
+operand_t _cached_result(uint8_t operation, operand_t left, operand_t right,
+                         operand_t (*calculate)(uint8_t operation, operand_t left, operand_t right)) {
+    pthread_once(&result_cache_once, _init_shard_capacity);
+    uint32_t capacity = result_cache_capacity;
+    if (capacity == 0)
+        return calculate(operation, left, right);
+
+    uint64_t left_bits, right_bits;
+    memcpy(&left_bits, &left, sizeof(uint64_t));
+    memcpy(&right_bits, &right, sizeof(uint64_t));
+    uint64_t hash = _result_hash(operation, left_bits, right_bits);
+    struct result_cache_shard *shard = &result_cache_shards[hash >> 60 & (RESULT_CACHE_SHARDS - 1)];
+    uint32_t bucket = hash & (capacity - 1);
+
+    pthread_mutex_lock(&shard->mutex);
+    if (shard->entries != NULL) {
+        for (uint32_t index = shard->buckets[bucket]; index != 0; index = shard->entries[index - 1].next) {
+            struct result_cache_entry *entry = &shard->entries[index - 1];
+            if (entry->left == left_bits && entry->right == right_bits && entry->operation == operation) {
+                entry->referenced = 1;
+                operand_t result = entry->result;
+                pthread_mutex_unlock(&shard->mutex);
+                atomic_fetch_add_explicit(&shard->hits, 1, memory_order_relaxed);
+                return result;
+            }
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    atomic_fetch_add_explicit(&shard->misses, 1, memory_order_relaxed);
+
+    // Calcola fuori dal lock: due thread con la stessa chiave possono calcolarla entrambi,
+    // ma l'inserimento qui sotto evita i duplicati
+    operand_t result = calculate(operation, left, right);
+
+    pthread_mutex_lock(&shard->mutex);
+    if (shard->entries == NULL && _alloc_shard(shard, capacity) != 0) {
+        pthread_mutex_unlock(&shard->mutex);
+        return result;
+    }
+
+    for (uint32_t index = shard->buckets[bucket]; index != 0; index = shard->entries[index - 1].next) {
+        const struct result_cache_entry *entry = &shard->entries[index - 1];
+        if (entry->left == left_bits && entry->right == right_bits && entry->operation == operation) {
+            pthread_mutex_unlock(&shard->mutex);
+            return result;
+        }
+    }
+
+    uint32_t index = shard->count < capacity ? shard->count++ : _evict_result_entry(shard, capacity);
+    shard->entries[index] = (struct result_cache_entry) {
+            .left = left_bits,
+            .right = right_bits,
+            .result = result,
+            .next = shard->buckets[bucket],
+            .operation = operation,
+            .referenced = 0
+    };
+    shard->buckets[bucket] = index + 1;
+    pthread_mutex_unlock(&shard->mutex);
+    return result;
+}
+
+/**
+ * Calcolo di un operatore, per _cached_result()
+ */
+operand_t _calculate_cached_operation(uint8_t operation, operand_t left, operand_t right) {
+    return calculate_operation(left, (char) operation, right);
+}
+
+/**
+ * Calcolo esatto di una funzione, per _cached_result()
+ */
+operand_t _calculate_cached_function(uint8_t operation, operand_t left, operand_t right) {
+    return calculate_function(operation - RESULT_CACHE_FUNCTION_BASE, MATH_MODE_EXACT, left, right);
+}
+
+operand_t cached_operation(operand_t left, char operator, operand_t right) {
+    if (operator != '^')
+        return calculate_operation(left, operator, right);
+
+    operand_t result = _cached_result((uint8_t) operator, left, right, _calculate_cached_operation);
+    errno = 0; // Il calcolo potrebbe essere avvenuto in un'altra chiamata
+    return result;
+}
+
+operand_t cached_function(enum math_function function, enum math_mode mode, operand_t x, operand_t y) {
+    if (mode == MATH_MODE_FAST || function == MATH_SQRT)
+        return calculate_function(function, mode, x, y);
+
+    // Le funzioni di un solo argomento ignorano y: non deve far parte della chiave
+    if (math_function_arity(function) == 1)
+        y = 0;
+    return _cached_result(RESULT_CACHE_FUNCTION_BASE + function, x, y, _calculate_cached_function);
+}
+
+void get_result_cache_stats(struct result_cache_stats *stats) {
+    stats->hits = 0;
+    stats->misses = 0;
+    for (size_t i = 0; i < RESULT_CACHE_SHARDS; i++) {
+        stats->hits += atomic_load_explicit(&result_cache_shards[i].hits, memory_order_relaxed);
+        stats->misses += atomic_load_explicit(&result_cache_shards[i].misses, memory_order_relaxed);
+    }
+    stats->memory = atomic_load_explicit(&result_cache_memory, memory_order_relaxed);
+    stats->max_memory = RESULT_CACHE_MAX_BYTES;
+}
+
+void clear_result_cache() {
+    for (size_t i = 0; i < RESULT_CACHE_SHARDS; i++) {
+        struct result_cache_shard *shard = &result_cache_shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        free(shard->entries);
+        free(shard->buckets);
+        shard->entries = NULL;
+        shard->buckets = NULL;
+        shard->count = 0;
+        shard->hand = 0;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    atomic_store_explicit(&result_cache_memory, 0, memory_order_relaxed);
+}
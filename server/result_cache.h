@@ -0,0 +1,68 @@
+#ifndef SERVER_RESULT_CACHE_H
+#define SERVER_RESULT_CACHE_H
+
+#include "../common/calc_utils.h"
+#include "../common/math_kernels.h"
+
+/**
+ * Memoria massima della cache dei risultati, in byte. Con 0 la cache è disattivata.
+ */
+#define RESULT_CACHE_MAX_BYTES (4 << 20)
+
+/**
+ * Numero di shard della cache, ognuno col suo lock. Deve essere una potenza di 2.
+ */
+#define RESULT_CACHE_SHARDS 16
+
+/**
+ * Statistiche della cache dei risultati
+ */
+struct result_cache_stats {
+    unsigned long hits;
+    unsigned long misses;
+
+    /**
+     * Memoria allocata dagli shard e memoria massima, in byte
+     */
+    size_t memory;
+    size_t max_memory;
+};
+
+/**
+ * Come calculate_operation(), ma gli operatori costosi (^) passano dalla cache dei risultati.
+ * Gli altri operatori costano meno di una ricerca in cache e la saltano.
+ *
+ * Imposta errno in caso di errore.
+ *
+ * @param left Operando di sinistra
+ * @param operator Operatore
+ * @param right Operando di destra
+ * @return Il risultato dell'operazione, oppure 0 in caso di errore impostando errno.
+ */
+operand_t cached_operation(operand_t left, char operator, operand_t right);
+
+/**
+ * Come calculate_function(), ma le funzioni esatte passano dalla cache dei risultati.
+ * La modalità veloce e sqrt costano meno di una ricerca in cache e la saltano.
+ *
+ * @param function Funzione da calcolare
+ * @param mode Modalità di calcolo
+ * @param x Argomento
+ * @param y Esponente, solo per pow
+ * @return Il risultato
+ */
+operand_t cached_function(enum math_function function, enum math_mode mode, operand_t x, operand_t y);
+
+/**
+ * Leggi le statistiche della cache, senza bloccare gli shard
+ *
+ * @param stats Dove scrivere le statistiche
+ */
+void get_result_cache_stats(struct result_cache_stats *stats);
+
+/**
+ * Svuota la cache e libera la memoria degli shard
+ */
+void clear_result_cache();
+
+#endif //SERVER_RESULT_CACHE_H
@@ -0,0 +1,225 @@
+#include "session.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Hash FNV-1a di un nome, per le tabelle indicizzate per nome
+ *
+ * @param name Nome, non necessariamente terminato da \0
+ * @param name_len Lunghezza del nome
+ */
+size_t hash_variable_name(const char *name, size_t name_len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < name_len; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) hash;
+}
+
+/**
+ * Lunghezza del nome di variabile all'inizio del testo: lettera o _, poi lettere, cifre o _
+ *
+ * @return Lunghezza del nome, 0 se il testo non inizia con un nome valido
+ */
+size_t _variable_name_length(const char *text) {
+    if (!isalpha((unsigned char) text[0]) && text[0] != '_')
+        return 0;
+
+    size_t name_len = 1;
+    while (isalnum((unsigned char) text[name_len]) || text[name_len] == '_')
+        name_len++;
+    return name_len < EXPRESSION_MAX_NAME_SIZE ? name_len : 0;
+}
+
+/**
+ * Cerca lo slot di una variabile: quello che la contiene, oppure il primo libero dove inserirla
+ *
+ * @param variables Tabella, con almeno uno slot libero
+ * @param capacity Capacità della tabella, potenza di 2
+ */
+struct session_variable *_find_variable_slot(struct session_variable *variables, size_t capacity, const char *name,
+                                             size_t name_len) {
+    size_t mask = capacity - 1;
+    for (size_t index = hash_variable_name(name, name_len) & mask;; index = (index + 1) & mask) {
+        struct session_variable *variable = &variables[index];
+        if (variable->name[0] == '\0' ||
+            (strncmp(variable->name, name, name_len) == 0 && variable->name[name_len] == '\0'))
+            return variable;
+    }
+}
+
+/**
+ * Raddoppia la tabella (o la alloca la prima volta), reinserendo le variabili
+ *
+ * @return -1 se manca la memoria, 0 altrimenti
+ */
+int _grow_session(struct session *session) {
+    size_t capacity = session->capacity == 0 ? SESSION_INITIAL_CAPACITY : session->capacity * 2;
+    struct session_variable *variables = calloc(capacity, sizeof(struct session_variable));
+    if (variables == NULL)
+        return -1;
+
+    for (size_t i = 0; i < session->capacity; i++) {
+        const struct session_variable *variable = &session->variables[i];
+        if (variable->name[0] != '\0')
+            *_find_variable_slot(variables, capacity, variable->name, strlen(variable->name)) = *variable;
+    }
+
+    free(session->variables);
+    session->variables = variables;
+    session->capacity = capacity;
+    return 0;
+}
+
+/**
+ * Inizializza una sessione vuota, senza allocare memoria
+ */
+void init_session(struct session *session) {
+    memset(session, 0, sizeof(struct session));
+}
+
+/**
+ * Libera la memoria delle variabili della sessione
+ */
+void free_session(struct session *session) {
+    free(session->variables);
+    init_session(session);
+}
+
+/**
+ * Cerca il valore di una variabile o di ans
+ *
+ * @param session Sessione, può essere NULL
+ * @param name Nome della variabile, non necessariamente terminato da \0
+ * @param name_len Lunghezza del nome
+ * @param value Dove scrivere il valore
+ * @return -1 se la variabile non esiste, 0 altrimenti
+ */
+int get_session_variable(const struct session *session, const char *name, size_t name_len, operand_t *value) {
+    if (session == NULL)
+        return -1;
+
+    if (name_len == strlen(SESSION_ANSWER_NAME) && strncmp(name, SESSION_ANSWER_NAME, name_len) == 0) {
+        *value = session->answer;
+        return session->has_answer ? 0 : -1;
+    }
+
+    if (session->count == 0)
+        return -1;
+    const struct session_variable *variable = _find_variable_slot(session->variables, session->capacity, name,
+                                                                  name_len);
+    if (variable->name[0] == '\0')
+        return -1;
+    *value = variable->value;
+    return 0;
+}
+
+/**
+ * Assegna una variabile, creandola se non esiste. Assegnare ans cambia solo il registro.
+ *
+ * @param session Sessione
+ * @param name Nome della variabile, terminato da \0
+ * @param value Valore
+ * @return -1 se la sessione ha già SESSION_MAX_VARIABLES variabili o manca la memoria, 0 altrimenti
+ */
+int set_session_variable(struct session *session, const char *name, operand_t value) {
+    if (strcmp(name, SESSION_ANSWER_NAME) == 0) {
+        session->answer = value;
+        session->has_answer = 1;
+        return 0;
+    }
+
+    size_t name_len = strlen(name);
+    struct session_variable *variable = NULL;
+    if (session->count > 0) {
+        variable = _find_variable_slot(session->variables, session->capacity, name, name_len);
+        if (variable->name[0] != '\0') {
+            variable->value = value;
+            return 0;
+        }
+    }
+
+    // Nuova variabile: il limite vale indipendentemente da quando la tabella cresce
+    if (session->count >= SESSION_MAX_VARIABLES) {
+        errno = 0;
+        return -1;
+    }
+
+    // Fattore di carico massimo 3/4: le scansioni restano corte
+    if (variable == NULL || (session->count + 1) * 4 > session->capacity * 3) {
+        if (_grow_session(session) != 0) {
+            errno = 0;
+            return -1;
+        }
+        variable = _find_variable_slot(session->variables, session->capacity, name, name_len);
+    }
+
+    memcpy(variable->name, name, name_len + 1);
+    variable->value = value;
+    session->count++;
+    return 0;
+}
+
+/**
+ * Resolver per run_program(), con la sessione come contesto
+ */
+int resolve_session_variable(void *context, const char *name, operand_t *value) {
+    return get_session_variable(context, name, strlen(name), value);
+}
+
+/**
+ * Leggi un operando: un numero, oppure il nome di una variabile della sessione
+ *
+ * @param session Sessione, può essere NULL se ci sono solo numeri
+ * @param text Testo da leggere, gli spazi iniziali vengono saltati
+ * @param end Dove scrivere il puntatore al primo carattere non letto
+ * @param value Dove scrivere l'operando
+ * @return -1 se non è un numero né una variabile esistente, 0 altrimenti
+ */
+int parse_session_operand(const struct session *session, const char *text, const char **end, operand_t *value) {
+    while (isspace((unsigned char) *text))
+        text++;
+
+    // Le variabili hanno la precedenza sui nomi che strtod() leggerebbe come numeri (inf, nan)
+    size_t name_len = _variable_name_length(text);
+    if (name_len > 0 && get_session_variable(session, text, name_len, value) == 0) {
+        *end = text + name_len;
+        return 0;
+    }
+
+    char *number_end;
+    *value = strtod(text, &number_end);
+    *end = number_end;
+    errno = 0;
+    return number_end == text ? -1 : 0;
+}
+
+/**
+ * Riconosci un'assegnazione NOME = OPERAZIONE
+ *
+ * @param line Linea ricevuta
+ * @param name Dove copiare il nome della variabile
+ * @return Puntatore all'operazione da assegnare, o NULL se la linea non è un'assegnazione
+ */
+const char *match_assignment(const char *line, char name[EXPRESSION_MAX_NAME_SIZE]) {
+    size_t name_len = _variable_name_length(line);
+    if (name_len == 0)
+        return NULL;
+
+    const char *operation = line + name_len;
+    while (*operation == ' ' || *operation == '\t')
+        operation++;
+    if (*operation != '=')
+        return NULL;
+    operation++;
+    while (*operation == ' ' || *operation == '\t')
+        operation++;
+
+    memcpy(name, line, name_len);
+    name[name_len] = '\0';
+    return operation;
+}
@@ -0,0 +1,115 @@
+#ifndef SERVER_SESSION_H
+#define SERVER_SESSION_H
+
+#include "expression.h"
+#include <stddef.h>
+
+/**
+ * Nome del registro con il risultato dell'ultima operazione riuscita
+ */
+#define SESSION_ANSWER_NAME "ans"
+
+/**
+ * Numero massimo di variabili di una sessione
+ */
+#define SESSION_MAX_VARIABLES 4096
+
+/**
+ * Capacità iniziale della tabella delle variabili. Deve essere una potenza di 2.
+ */
+#define SESSION_INITIAL_CAPACITY 16
+
+/**
+ * Variabile della sessione, libera se il nome è vuoto
+ */
+struct session_variable {
+    char name[EXPRESSION_MAX_NAME_SIZE];
+    operand_t value;
+};
+
+/**
+ * Stato di una connessione: il risultato dell'ultima operazione (ans)
+ * e le variabili assegnate con NOME = OPERAZIONE, riutilizzabili come operandi.
+ *
+ * Le variabili sono in una tabella hash a indirizzamento aperto con scansione lineare,
+ * allocata alla prima assegnazione. Appartiene a un solo thread, quindi non ha lock.
+ */
+struct session {
+    struct session_variable *variables;
+    size_t capacity;
+    size_t count;
+
+    operand_t answer;
+
+    /**
+     * Zero se non c'è ancora un risultato, o se l'ultima operazione è fallita:
+     * così una catena inviata in pipeline si interrompe al primo errore
+     */
+    int has_answer;
+};
+
+/**
+ * Hash FNV-1a di un nome, per le tabelle indicizzate per nome
+ *
+ * @param name Nome, non necessariamente terminato da \0
+ * @param name_len Lunghezza del nome
+ */
+size_t hash_variable_name(const char *name, size_t name_len);
+
+/**
+ * Inizializza una sessione vuota, senza allocare memoria
+ */
+void init_session(struct session *session);
+
+/**
+ * Libera la memoria delle variabili della sessione
+ */
+void free_session(struct session *session);
+
+/**
+ * Cerca il valore di una variabile o di ans
+ *
+ * @param session Sessione, può essere NULL
+ * @param name Nome della variabile, non necessariamente terminato da \0
+ * @param name_len Lunghezza del nome
+ * @param value Dove scrivere il valore
+ * @return -1 se la variabile non esiste, 0 altrimenti
+ */
+int get_session_variable(const struct session *session, const char *name, size_t name_len, operand_t *value);
+
+/**
+ * Assegna una variabile, creandola se non esiste. Assegnare ans cambia solo il registro.
+ *
+ * @param session Sessione
+ * @param name Nome della variabile, terminato da \0
+ * @param value Valore
+ * @return -1 se la sessione ha già SESSION_MAX_VARIABLES variabili o manca la memoria, 0 altrimenti
+ */
+int set_session_variable(struct session *session, const char *name, operand_t value);
+
+/**
+ * Resolver per run_program(), con la sessione come contesto
+ */
+int resolve_session_variable(void *context, const char *name, operand_t *value);
+
+/**
+ * Leggi un operando: un numero, oppure il nome di una variabile della sessione
+ *
+ * @param session Sessione, può essere NULL se ci sono solo numeri
+ * @param text Testo da leggere, gli spazi iniziali vengono saltati
+ * @param end Dove scrivere il puntatore al primo carattere non letto
+ * @param value Dove scrivere l'operando
+ * @return -1 se non è un numero né una variabile esistente, 0 altrimenti
+ */
+int parse_session_operand(const struct session *session, const char *text, const char **end, operand_t *value);
+
+/**
+ * Riconosci un'assegnazione NOME = OPERAZIONE
+ *
+ * @param line Linea ricevuta
+ * @param name Dove copiare il nome della variabile
+ * @return Puntatore all'operazione da assegnare, o NULL se la linea non è un'assegnazione
+ */
+const char *match_assignment(const char *line, char name[EXPRESSION_MAX_NAME_SIZE]);
+
+#endif //SERVER_SESSION_H
@@ -0,0 +1,284 @@
+#define _GNU_SOURCE
+#include "shm_transport.h"
+#include "live_status_table.h"
+#include "result_cache.h"
+#include "metrics.h"
+#include "../common/logger.h"
+#include "../common/main_init.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * Socket Unix su cui vengono accettati i client in memoria condivisa
+ */
+int shm_listener_fd = -1;
+
+/**
+ * Thread che accetta i client in memoria condivisa
+ */
+pthread_t shm_listener_thread;
+
+/**
+ * Contatore delle sessioni, usato come "porta" del client nella tabella e nel log
+ */
+_Atomic uint16_t shm_sessions_counter = 0;
+
+/**
+ * Stato di una sessione in memoria condivisa, posseduto dal suo thread
+ */
+struct shm_worker {
+    /**
+     * Informazioni mostrate nella tabella di stato e nel log.
+     * Non esistono socket_file e socket_output: si comunica solo tramite i ring.
+     */
+    struct sock_info client_info;
+
+    /**
+     * Socket Unix col client, usata per accorgersi della sua chiusura
+     */
+    int unix_socket_fd;
+
+    /**
+     * Regione condivisa con il client
+     */
+    struct shm_region *region;
+};
+
+/**
+ * Controlla se il client ha chiuso la sessione, anche senza avvisare (es: è terminato).
+ *
+ * @param worker Sessione da controllare
+ * @return Diverso da zero se la sessione è terminata
+ */
+int _shm_session_closed(const struct shm_worker *worker) {
+    if (atomic_load_explicit(&worker->region->closed, memory_order_relaxed))
+        return 1;
+
+    struct pollfd poll_fd = {worker->unix_socket_fd, POLLRDHUP, 0};
+    return poll(&poll_fd, 1, 0) > 0 && (poll_fd.revents & (POLLRDHUP | POLLHUP | POLLERR));
+}
+
+/**
+ * Servi le richieste di un client in memoria condivisa.
+ * Il calcolo e le statistiche sono gli stessi delle connessioni TCP,
+ * ma il log per singola operazione è omesso per non dominare la latenza.
+ *
+ * @param worker Sessione da servire, che verrà liberata a fine esecuzione
+ */
+void _shm_serve_client(struct shm_worker *worker) {
+    struct shm_region *region = worker->region;
+    unsigned int operations = 0;
+
+    struct live_status_slot *status_slot = register_client(&worker->client_info, pthread_self());
+    add_metrics_connection(METRICS_SHM, 1);
+    log_message(&worker->client_info, "Nuova sessione in memoria condivisa\n");
+
+    while (socket_fd > 0) {
+        // Svuota il ring delle richieste
+        struct shm_request request;
+        while (shm_ring_pop(&region->request_ring, region->requests, sizeof(request), &request) == 0) {
+            struct shm_response response;
+            response.result = cached_operation(request.left, request.operator, request.right);
+            response.error = errno;
+            errno = 0;
+
+            // La durata non viene misurata: due letture dell'orologio costerebbero quanto l'operazione
+            if (response.error == 0) {
+                add_client_operation(status_slot);
+                add_metrics_operation(metrics_operator(request.operator), NULL, NULL);
+                operations++;
+            } else {
+                add_metrics_error(METRICS_SHM);
+            }
+
+            while (shm_ring_push(&region->response_ring, region->responses, sizeof(response), &response) == -1) {
+                // Il client non sta leggendo le risposte
+                if (_shm_session_closed(worker) || socket_fd <= 0)
+                    break;
+                sched_yield();
+            }
+        }
+
+        // Ring vuoto: attendi, controllando periodicamente se il client è ancora presente.
+        // Può essere interrotto con SIGINT al thread.
+        if (shm_ring_wait(&region->request_ring, 100) == -1) {
+            errno = 0;
+            if (_shm_session_closed(worker))
+                break;
+        }
+    }
+
+    log_message(&worker->client_info, "Sessione in memoria condivisa terminata dopo %u operazioni\n", operations);
+
+    remove_client(status_slot);
+    add_metrics_connection(METRICS_SHM, 0);
+    atomic_store(&region->closed, 1);
+    munmap(region, sizeof(struct shm_region));
+    close(worker->unix_socket_fd);
+    free(worker);
+    pthread_detach(pthread_self());
+}
+
+/**
+ * Crea la regione condivisa per un nuovo client e inviagliela.
+ *
+ * @param client_socket Socket Unix col client
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int _shm_accept_client(int client_socket) {
+    int memfd = memfd_create("calc-server-shm", MFD_CLOEXEC);
+    if (memfd == -1) {
+        log_errno(NULL, "Errore nella memfd_create");
+        return -1;
+    }
+
+    // La memoria è azzerata da ftruncate: ring vuoti e sessione aperta
+    struct shm_region *region = MAP_FAILED;
+    if (ftruncate(memfd, sizeof(struct shm_region)) == -1 ||
+        (region = mmap(NULL, sizeof(struct shm_region), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0)) ==
+        MAP_FAILED) {
+        log_errno(NULL, "Errore nella creazione della memoria condivisa");
+        close(memfd);
+        return -1;
+    }
+    region->magic = SHM_REGION_MAGIC;
+
+    // Invia il file descriptor come messaggio ausiliario SCM_RIGHTS
+    char data = 0;
+    struct iovec iov = {&data, 1};
+    char control[CMSG_SPACE(sizeof(int))];
+    bzero(control, sizeof(control));
+    struct msghdr message;
+    bzero(&message, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+    int sent = sendmsg(client_socket, &message, MSG_NOSIGNAL);
+    close(memfd); // Il client ne riceve una copia, la mappatura resta valida
+    if (sent == -1) {
+        log_errno(NULL, "Errore nell'invio della memoria condivisa");
+        munmap(region, sizeof(struct shm_region));
+        return -1;
+    }
+
+    // Il client appare in tabella come 127.0.0.1, con il numero di sessione al posto della porta
+    struct shm_worker *worker = malloc(sizeof(struct shm_worker));
+    if (worker == NULL) {
+        log_errno(NULL, "Errore nell'allocazione del client in memoria condivisa");
+        munmap(region, sizeof(struct shm_region));
+        return -1;
+    }
+    bzero(worker, sizeof(struct shm_worker));
+    worker->client_info.socket_file = NULL;
+    worker->client_info.socket_output = NULL;
+    worker->client_info.client_info.sin_family = AF_INET;
+    worker->client_info.client_info.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    worker->client_info.client_info.sin_port = htons(++shm_sessions_counter);
+    worker->unix_socket_fd = client_socket;
+    worker->region = region;
+
+    pthread_t worker_thread;
+    if ((errno = pthread_create(&worker_thread, NULL, (void *(*)(void *)) _shm_serve_client, worker)) != 0) {
+        log_errno(NULL, "Errore nella creazione del thread per la memoria condivisa");
+        munmap(region, sizeof(struct shm_region));
+        free(worker);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Procedura del thread che accetta i client in memoria condivisa
+ */
+void _shm_accept_loop(void) {
+    while (socket_fd > 0) {
+        // Può essere interrotto con SIGINT al thread
+        int client_socket = accept(shm_listener_fd, NULL, NULL);
+        if (client_socket == -1) {
+            if (errno != EINTR)
+                log_errno(NULL, "Accettazione nuovo client in memoria condivisa");
+            errno = 0;
+        } else if (_shm_accept_client(client_socket) == -1) {
+            close(client_socket);
+        }
+    }
+}
+
+/**
+ * Crea la socket Unix su cui i client dello stesso host richiedono
+ * una regione di memoria condivisa, e avvia il thread che li accetta.
+ *
+ * @param port Porta TCP del server, da cui deriva il nome della socket Unix
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int start_shm_listener(uint16_t port) {
+    // Indirizzo nel namespace astratto: nessun file da rimuovere alla chiusura
+    struct sockaddr_un server_address;
+    bzero(&server_address, sizeof(server_address));
+    server_address.sun_family = AF_UNIX;
+    int name_len = snprintf(server_address.sun_path + 1, sizeof(server_address.sun_path) - 1,
+                            SHM_SOCKET_NAME_FORMAT, port);
+    socklen_t address_len = (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + name_len);
+
+    shm_listener_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (shm_listener_fd == -1) {
+        log_errno(NULL, "Errore nella creazione della socket Unix");
+        return -1;
+    }
+
+    if (bind(shm_listener_fd, (struct sockaddr *) &server_address, address_len) == -1 ||
+        listen(shm_listener_fd, BACKLOG_SIZE) == -1) {
+        log_errno(NULL, "Errore nel bind della socket Unix");
+        close(shm_listener_fd);
+        shm_listener_fd = -1;
+        return -1;
+    }
+
+    if ((errno = pthread_create(&shm_listener_thread, NULL, (void *(*)(void *)) _shm_accept_loop, NULL)) != 0) {
+        log_errno(NULL, "Errore nella creazione del thread per la memoria condivisa");
+        close(shm_listener_fd);
+        shm_listener_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Termina il thread che accetta i client in memoria condivisa.
+ * Le sessioni attive sono terminate insieme alle altre connessioni,
+ * in stop_status_table().
+ */
+void stop_shm_listener() {
+    if (shm_listener_fd == -1)
+        return;
+
+    // Sblocca il thread dalla accept, socket_fd è già a zero a questo punto
+    if ((errno = pthread_kill(shm_listener_thread, SIGINT)) != 0)
+        perror("pthread_kill in chiusura");
+    if ((errno = pthread_join(shm_listener_thread, NULL)) != 0)
+        perror("pthread_join in chiusura");
+
+    close(shm_listener_fd);
+    shm_listener_fd = -1;
+}
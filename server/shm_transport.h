@@ -0,0 +1,22 @@
+#ifndef SERVER_SHM_TRANSPORT_H
+#define SERVER_SHM_TRANSPORT_H
+
+#include "../common/shm_ring.h"
+
+/**
+ * Crea la socket Unix su cui i client dello stesso host richiedono
+ * una regione di memoria condivisa, e avvia il thread che li accetta.
+ *
+ * @param port Porta TCP del server, da cui deriva il nome della socket Unix
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int start_shm_listener(uint16_t port);
+
+/**
+ * Termina il thread che accetta i client in memoria condivisa.
+ * Le sessioni attive sono terminate insieme alle altre connessioni,
+ * in stop_status_table().
+ */
+void stop_shm_listener();
+
+#endif //SERVER_SHM_TRANSPORT_H
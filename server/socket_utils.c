@@ -2,6 +2,7 @@
 #include "../common/logger.h"
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <netinet/tcp.h>
 #include <strings.h>
 
 /**
@@ -37,6 +38,17 @@ int bind_server(const char *ip, uint16_t port) {
     if (setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0)
         log_errno(NULL, "Errore in setsockopt(SO_REUSEADDR)");
 
+    // Abilita TCP Fast Open: la prima richiesta può arrivare già nel SYN.
+    // Se il kernel non lo permette (sysctl net.ipv4.tcp_fastopen), si prosegue senza.
+    int fast_open_queue = BACKLOG_SIZE;
+    if (setsockopt(socket_fd, IPPROTO_TCP, TCP_FASTOPEN, &fast_open_queue, sizeof(int)) < 0)
+        log_errno(NULL, "Errore in setsockopt(TCP_FASTOPEN)");
+
+    // Disabilita Nagle, ereditato dalle socket accettate: ogni risposta è già scritta con un solo fflush,
+    // e dopo un blocco binario la coda della risposta attenderebbe l'ACK ritardato del client
+    if (setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(int)) < 0)
+        log_errno(NULL, "Errore in setsockopt(TCP_NODELAY)");
+
     // Esegui il bind
     if (bind(socket_fd, (const struct sockaddr *) &server_address, sizeof(server_address)) == -1) {
         log_errno(NULL, "Errore nel bind del socket");
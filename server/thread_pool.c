@@ -0,0 +1,419 @@
+#include "thread_pool.h"
+#include "../common/logger.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * Lavoro parallelo in corso, condiviso tra le sue parti
+ */
+struct parallel_job {
+    parallel_task_t task;
+    void *context;
+
+    /**
+     * Parti non ancora completate, protetto da pool_mutex
+     */
+    size_t pending;
+
+    /**
+     * Segnalata quando pending arriva a zero
+     */
+    pthread_cond_t done_cond;
+};
+
+/**
+ * Una parte di un lavoro, in coda per i thread del pool
+ */
+struct parallel_part {
+    struct parallel_job *job;
+    size_t begin;
+    size_t end;
+    struct parallel_part *next;
+};
+
+/**
+ * Mutua esclusione sulla coda delle parti e sui contatori dei lavori
+ */
+pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Segnalata quando ci sono nuove parti in coda o il pool sta terminando
+ */
+pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Coda delle parti da eseguire (FIFO)
+ */
+struct parallel_part *pool_queue_head = NULL;
+struct parallel_part *pool_queue_tail = NULL;
+
+/**
+ * Thread del pool, creati alla prima richiesta
+ */
+pthread_t pool_threads[THREAD_POOL_MAX_THREADS];
+size_t pool_threads_count = 0;
+
+/**
+ * Diverso da zero quando il pool deve terminare
+ */
+int pool_stopping = 0;
+
+pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Task in attesa in una coda doppia
+ */
+struct group_task_entry {
+    group_task_t task;
+    void *argument;
+};
+
+/**
+ * Coda doppia di un thread partecipante a un gruppo, come buffer circolare:
+ * il proprietario inserisce ed estrae in fondo, gli altri thread rubano in cima
+ */
+struct task_deque {
+    pthread_mutex_t mutex;
+    struct group_task_entry *tasks;
+    size_t capacity;
+    size_t top;
+    size_t count;
+};
+
+/**
+ * Gruppo di task, con una coda doppia per ogni thread partecipante
+ */
+struct task_group {
+    struct task_deque deques[THREAD_POOL_MAX_THREADS];
+    size_t participants;
+
+    /**
+     * Task generati e non ancora completati: il gruppo termina quando arriva a zero
+     */
+    _Atomic size_t pending;
+};
+
+/**
+ * Indice del thread nel gruppo di cui sta eseguendo i task
+ */
+_Thread_local size_t current_participant = 0;
+
+/**
+ * Esegui una parte e segnala il suo completamento.
+ * Da chiamare senza pool_mutex acquisito.
+ *
+ * @param part Parte da eseguire, che viene liberata
+ */
+void _run_part(struct parallel_part *part) {
+    struct parallel_job *job = part->job;
+    job->task(job->context, part->begin, part->end);
+    free(part);
+
+    pthread_mutex_lock(&pool_mutex);
+    if (--job->pending == 0)
+        pthread_cond_signal(&job->done_cond);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/**
+ * Estrai la prossima parte dalla coda.
+ * Da chiamare con pool_mutex acquisito.
+ *
+ * @return La parte estratta, o NULL se la coda è vuota
+ */
+struct parallel_part *_pop_part() {
+    struct parallel_part *part = pool_queue_head;
+    if (part != NULL) {
+        pool_queue_head = part->next;
+        if (pool_queue_head == NULL)
+            pool_queue_tail = NULL;
+    }
+    return part;
+}
+
+/**
+ * Procedura dei thread del pool
+ */
+void _pool_worker(void) {
+    pthread_mutex_lock(&pool_mutex);
+    while (!pool_stopping) {
+        struct parallel_part *part = _pop_part();
+        if (part == NULL) {
+            pthread_cond_wait(&pool_cond, &pool_mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&pool_mutex);
+        _run_part(part);
+        pthread_mutex_lock(&pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/**
+ * Avvia un thread per ogni core oltre al primo,
+ * dato che anche il chiamante partecipa al lavoro.
+ */
+void _start_thread_pool() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores > THREAD_POOL_MAX_THREADS)
+        cores = THREAD_POOL_MAX_THREADS;
+
+    for (long i = 1; i < cores; i++) {
+        if ((errno = pthread_create(&pool_threads[pool_threads_count], NULL,
+                                    (void *(*)(void *)) _pool_worker, NULL)) != 0) {
+            log_errno(NULL, "Errore nella creazione di un thread del pool");
+            errno = 0;
+            break;
+        }
+        pool_threads_count++;
+    }
+}
+
+/**
+ * Numero di thread che partecipano ai lavori paralleli, incluso il chiamante
+ *
+ * @return Numero di thread
+ */
+size_t thread_pool_size() {
+    pthread_once(&pool_once, _start_thread_pool);
+    return pool_threads_count + 1;
+}
+
+/**
+ * Esegui il lavoro sugli indici [0, count) dividendolo tra i core disponibili.
+ * Il thread chiamante partecipa al lavoro e ritorna quando tutto è completato.
+ *
+ * Se count è minore di 2 * min_grain, o c'è un solo core, il lavoro viene
+ * eseguito direttamente nel thread chiamante.
+ *
+ * @param count Numero di indici da elaborare
+ * @param min_grain Numero minimo di indici per ogni parte
+ * @param task Funzione che elabora una parte
+ * @param context Contesto passato alla funzione
+ */
+void parallel_for(size_t count, size_t min_grain, parallel_task_t task, void *context) {
+    size_t parts = thread_pool_size();
+    if (min_grain == 0)
+        min_grain = 1;
+    if (count / min_grain < parts)
+        parts = count / min_grain;
+
+    if (parts <= 1) {
+        task(context, 0, count);
+        return;
+    }
+
+    struct parallel_job job = {task, context, parts - 1};
+    pthread_cond_init(&job.done_cond, NULL);
+
+    // Accoda tutte le parti tranne la prima, che esegue il chiamante
+    size_t part_size = count / parts;
+    size_t inline_begin = count;
+    pthread_mutex_lock(&pool_mutex);
+    for (size_t i = 1; i < parts; i++) {
+        struct parallel_part *part = malloc(sizeof(struct parallel_part));
+        if (part == NULL) {
+            // Senza memoria, le parti non accodate restano al chiamante
+            inline_begin = i * part_size;
+            job.pending -= parts - i;
+            errno = 0;
+            break;
+        }
+        part->job = &job;
+        part->begin = i * part_size;
+        part->end = i == parts - 1 ? count : (i + 1) * part_size;
+        part->next = NULL;
+        if (pool_queue_tail == NULL)
+            pool_queue_head = part;
+        else
+            pool_queue_tail->next = part;
+        pool_queue_tail = part;
+    }
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    task(context, 0, part_size);
+    if (inline_begin < count)
+        task(context, inline_begin, count);
+
+    // Aiuta con le parti ancora in coda (anche di altri lavori), poi attendi le restanti
+    pthread_mutex_lock(&pool_mutex);
+    while (job.pending > 0) {
+        struct parallel_part *part = _pop_part();
+        if (part == NULL) {
+            pthread_cond_wait(&job.done_cond, &pool_mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&pool_mutex);
+        _run_part(part);
+        pthread_mutex_lock(&pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    pthread_cond_destroy(&job.done_cond);
+}
+
+/**
+ * Inserisci un task in fondo alla coda, raddoppiandola se è piena
+ *
+ * @return -1 se manca la memoria, 0 altrimenti
+ */
+int _push_group_task(struct task_deque *deque, group_task_t task, void *argument) {
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count == deque->capacity) {
+        size_t capacity = deque->capacity == 0 ? 64 : deque->capacity * 2;
+        struct group_task_entry *tasks = malloc(capacity * sizeof(struct group_task_entry));
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&deque->mutex);
+            return -1;
+        }
+        for (size_t i = 0; i < deque->count; i++)
+            tasks[i] = deque->tasks[(deque->top + i) % deque->capacity];
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+        deque->top = 0;
+    }
+    deque->tasks[(deque->top + deque->count++) % deque->capacity] = (struct group_task_entry) {task, argument};
+    pthread_mutex_unlock(&deque->mutex);
+    return 0;
+}
+
+/**
+ * Estrai un task dalla coda: dal fondo per il proprietario, dalla cima per un furto
+ *
+ * @return -1 se la coda è vuota, 0 altrimenti
+ */
+int _pop_group_task(struct task_deque *deque, int steal, struct group_task_entry *entry) {
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count == 0) {
+        pthread_mutex_unlock(&deque->mutex);
+        return -1;
+    }
+    if (steal) {
+        *entry = deque->tasks[deque->top];
+        deque->top = (deque->top + 1) % deque->capacity;
+    } else {
+        *entry = deque->tasks[(deque->top + deque->count - 1) % deque->capacity];
+    }
+    deque->count--;
+    pthread_mutex_unlock(&deque->mutex);
+    return 0;
+}
+
+/**
+ * Procedura di un thread partecipante: esegue i task della propria coda,
+ * poi prova a rubarli alle altre partendo da una vittima pseudo-casuale, finché il gruppo non termina
+ */
+void _task_group_worker(void *context, size_t begin, size_t end) {
+    struct task_group *group = context;
+    size_t previous_participant = current_participant;
+    unsigned int seed = (unsigned int) begin * 2654435761u + 1;
+
+    for (size_t participant = begin; participant < end; participant++) {
+        current_participant = participant;
+        while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+            struct group_task_entry entry;
+            int found = _pop_group_task(&group->deques[participant], 0, &entry) == 0;
+
+            seed = seed * 1103515245u + 12345u;
+            for (size_t i = 0; !found && i < group->participants; i++) {
+                size_t victim = (seed / 65536 + i) % group->participants;
+                found = victim != participant && _pop_group_task(&group->deques[victim], 1, &entry) == 0;
+            }
+
+            if (!found) {
+                // Gli altri task sono in esecuzione e potrebbero generarne di nuovi
+                sched_yield();
+                continue;
+            }
+            entry.task(group, entry.argument);
+            atomic_fetch_sub_explicit(&group->pending, 1, memory_order_release);
+        }
+    }
+
+    current_participant = previous_participant;
+}
+
+/**
+ * Esegui un task e tutti quelli che genera, con work stealing tra i thread del pool.
+ *
+ * Ogni thread partecipante ha una coda doppia: i task generati vengono inseriti ed estratti
+ * in fondo alla coda del thread che li genera (i più recenti, con i dati ancora in cache),
+ * mentre un thread senza lavoro ruba dalla cima della coda di un altro (i più vecchi, di solito
+ * i più grandi). Il chiamante partecipa e ritorna quando tutti i task sono completati.
+ *
+ * @param task Primo task
+ * @param argument Argomento del primo task
+ * @param max_participants Numero massimo di thread, incluso il chiamante; 0 per tutti quelli del pool
+ */
+void run_task_group(group_task_t task, void *argument, size_t max_participants) {
+    // Le code crescono solo quando servono: il gruppo in sé sta sullo stack
+    struct task_group group_storage = {}, *group = &group_storage;
+    group->participants = thread_pool_size();
+    if (max_participants > 0 && max_participants < group->participants)
+        group->participants = max_participants;
+    for (size_t i = 0; i < group->participants; i++)
+        pthread_mutex_init(&group->deques[i].mutex, NULL);
+
+    // Il primo task parte dalla coda del chiamante, gli altri thread lo ruberanno appena genera lavoro
+    atomic_store_explicit(&group->pending, 1, memory_order_relaxed);
+    if (_push_group_task(&group->deques[0], task, argument) != 0) {
+        size_t previous_participant = current_participant;
+        current_participant = 0;
+        task(group, argument);
+        current_participant = previous_participant;
+        atomic_fetch_sub_explicit(&group->pending, 1, memory_order_release);
+    }
+    parallel_for(group->participants, 1, _task_group_worker, group);
+
+    for (size_t i = 0; i < group->participants; i++) {
+        pthread_mutex_destroy(&group->deques[i].mutex);
+        free(group->deques[i].tasks);
+    }
+}
+
+/**
+ * Genera un nuovo task nel gruppo, da un task in esecuzione
+ *
+ * @param group Gruppo del task in esecuzione
+ * @param task Funzione del nuovo task
+ * @param argument Argomento del nuovo task
+ */
+void spawn_task(struct task_group *group, group_task_t task, void *argument) {
+    atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+    if (_push_group_task(&group->deques[current_participant], task, argument) != 0) {
+        // Senza memoria per accodarlo, il task viene eseguito subito
+        task(group, argument);
+        atomic_fetch_sub_explicit(&group->pending, 1, memory_order_release);
+    }
+}
+
+/**
+ * Indice del thread che esegue il task corrente nel gruppo, per i dati di ogni thread
+ *
+ * @return Indice in [0, numero di partecipanti)
+ */
+size_t task_group_participant() {
+    return current_participant;
+}
+
+/**
+ * Termina i thread del pool, se erano stati avviati
+ */
+void stop_thread_pool() {
+    pthread_mutex_lock(&pool_mutex);
+    pool_stopping = 1;
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (size_t i = 0; i < pool_threads_count; i++)
+        pthread_join(pool_threads[i], NULL);
+    pool_threads_count = 0;
+}
@@ -0,0 +1,82 @@
+#ifndef SERVER_THREAD_POOL_H
+#define SERVER_THREAD_POOL_H
+
+#include <stddef.h>
+
+/**
+ * Numero massimo di thread del pool, indipendentemente dai core disponibili
+ */
+#define THREAD_POOL_MAX_THREADS 64
+
+/**
+ * Parte di un lavoro parallelo, che elabora gli indici [begin, end).
+ */
+typedef void (*parallel_task_t)(void *context, size_t begin, size_t end);
+
+/**
+ * Gruppo di task generati dinamicamente durante l'esecuzione, vedi run_task_group()
+ */
+struct task_group;
+
+/**
+ * Task di un gruppo, che può generarne altri con spawn_task()
+ */
+typedef void (*group_task_t)(struct task_group *group, void *argument);
+
+/**
+ * Esegui il lavoro sugli indici [0, count) dividendolo tra i core disponibili.
+ * Il thread chiamante partecipa al lavoro e ritorna quando tutto è completato.
+ *
+ * Se count è minore di 2 * min_grain, o c'è un solo core, il lavoro viene
+ * eseguito direttamente nel thread chiamante.
+ *
+ * @param count Numero di indici da elaborare
+ * @param min_grain Numero minimo di indici per ogni parte
+ * @param task Funzione che elabora una parte
+ * @param context Contesto passato alla funzione
+ */
+void parallel_for(size_t count, size_t min_grain, parallel_task_t task, void *context);
+
+/**
+ * Esegui un task e tutti quelli che genera, con work stealing tra i thread del pool.
+ *
+ * Ogni thread partecipante ha una coda doppia: i task generati vengono inseriti ed estratti
+ * in fondo alla coda del thread che li genera (i più recenti, con i dati ancora in cache),
+ * mentre un thread senza lavoro ruba dalla cima della coda di un altro (i più vecchi, di solito
+ * i più grandi). Il chiamante partecipa e ritorna quando tutti i task sono completati.
+ *
+ * @param task Primo task
+ * @param argument Argomento del primo task
+ * @param max_participants Numero massimo di thread, incluso il chiamante; 0 per tutti quelli del pool
+ */
+void run_task_group(group_task_t task, void *argument, size_t max_participants);
+
+/**
+ * Genera un nuovo task nel gruppo, da un task in esecuzione
+ *
+ * @param group Gruppo del task in esecuzione
+ * @param task Funzione del nuovo task
+ * @param argument Argomento del nuovo task
+ */
+void spawn_task(struct task_group *group, group_task_t task, void *argument);
+
+/**
+ * Indice del thread che esegue il task corrente nel gruppo, per i dati di ogni thread
+ *
+ * @return Indice in [0, numero di partecipanti)
+ */
+size_t task_group_participant();
+
+/**
+ * Numero di thread che partecipano ai lavori paralleli, incluso il chiamante
+ *
+ * @return Numero di thread
+ */
+size_t thread_pool_size();
+
+/**
+ * Termina i thread del pool, se erano stati avviati
+ */
+void stop_thread_pool();
+
+#endif //SERVER_THREAD_POOL_H
@@ -0,0 +1,83 @@
+#include "typed_operations.h"
+#include "../common/logger.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <errno.h>
+
+/**
+ * Riconosci una linea che inizia col nome di un tipo: TIPO OPERATORE SINISTRO DESTRO
+ *
+ * @param line Linea ricevuta dal client
+ * @param arguments Dove scrivere il puntatore agli argomenti, dopo il tipo
+ * @return Il tipo, oppure -1 se la linea non inizia con un tipo
+ */
+int match_operand_type(const char *line, const char **arguments) {
+    size_t name_len = 0;
+    while (isalnum((unsigned char) line[name_len]))
+        name_len++;
+    if (name_len == 0 || !isspace((unsigned char) line[name_len]))
+        return -1;
+
+    *arguments = line + name_len;
+    return find_operand_type(line, name_len);
+}
+
+/**
+ * Messaggio per il client di un errore di calculate_typed_block()
+ *
+ * @param error Valore di errno impostato dal kernel
+ * @return Messaggio da inviare dopo SERVER_ERROR_MESSAGE_PREFIX
+ */
+const char *typed_error_message(int error) {
+    switch (error) {
+        case ERANGE:
+            return "Overflow intero";
+        case EDOM:
+            return "Divisione per zero";
+        default:
+            return "Operazione sconosciuta";
+    }
+}
+
+/**
+ * Calcola un'operazione con operandi del tipo indicato
+ *
+ * @param client_info Informazioni sul client
+ * @param type Tipo riconosciuto da match_operand_type()
+ * @param arguments Argomenti, dopo il nome del tipo
+ * @param result Risultato dell'operazione
+ * @param response Buffer della risposta, dove scrivere l'eventuale linea di errore
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int evaluate_typed_operation(const struct sock_info *client_info, enum operand_type type, const char *arguments,
+                             union typed_operand *result, char *response) {
+    while (isspace((unsigned char) *arguments))
+        arguments++;
+    char operator = *arguments;
+
+    // Operatore, poi i due operandi del tipo e nient'altro
+    union typed_operand left, right;
+    char *end = (char *) arguments + 1;
+    int status = operator != '\0' && isspace((unsigned char) *end) ? 0 : -1;
+    if (status == 0)
+        status = parse_typed_operand(type, end, &end, &left);
+    if (status == 0)
+        status = parse_typed_operand(type, end, &end, &right);
+    while (status == 0 && isspace((unsigned char) *end))
+        end++;
+
+    if (status != 0 || *end != '\0') {
+        log_message(client_info, "Errore nel parsing dell'operazione tipizzata\n");
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%cErrore del client\n", SERVER_ERROR_MESSAGE_PREFIX);
+        return -1;
+    }
+
+    if (calculate_typed_block(type, &left, operator, &right, result, 1) != 0) {
+        const char *error = typed_error_message(errno);
+        log_message(client_info, "Errore nell'operazione tipizzata: %s\n", error);
+        errno = 0;
+        snprintf(response, RESPONSE_LINE_MAX_SIZE, "%c%s\n", SERVER_ERROR_MESSAGE_PREFIX, error);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef SERVER_TYPED_OPERATIONS_H
+#define SERVER_TYPED_OPERATIONS_H
+
+#include "../common/socket_utils.h"
+#include "../common/typed_kernels.h"
+
+/**
+ * Riconosci una linea che inizia col nome di un tipo: TIPO OPERATORE SINISTRO DESTRO
+ *
+ * @param line Linea ricevuta dal client
+ * @param arguments Dove scrivere il puntatore agli argomenti, dopo il tipo
+ * @return Il tipo, oppure -1 se la linea non inizia con un tipo
+ */
+int match_operand_type(const char *line, const char **arguments);
+
+/**
+ * Calcola un'operazione con operandi del tipo indicato
+ *
+ * @param client_info Informazioni sul client
+ * @param type Tipo riconosciuto da match_operand_type()
+ * @param arguments Argomenti, dopo il nome del tipo
+ * @param result Risultato dell'operazione
+ * @param response Buffer della risposta, dove scrivere l'eventuale linea di errore
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int evaluate_typed_operation(const struct sock_info *client_info, enum operand_type type, const char *arguments,
+                             union typed_operand *result, char *response);
+
+/**
+ * Messaggio per il client di un errore di calculate_typed_block()
+ *
+ * @param error Valore di errno impostato dal kernel
+ * @return Messaggio da inviare dopo SERVER_ERROR_MESSAGE_PREFIX
+ */
+const char *typed_error_message(int error);
+
+#endif //SERVER_TYPED_OPERATIONS_H
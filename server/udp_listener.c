@@ -0,0 +1,332 @@
+#define _GNU_SOURCE
+#include "udp_listener.h"
+#include "request_worker.h"
+#include "metrics.h"
+#include "../common/logger.h"
+#include "../common/main_init.h"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * File descriptor della socket UDP
+ */
+int udp_socket_fd = -1;
+
+/**
+ * Thread che riceve ed elabora i datagrammi
+ */
+pthread_t udp_thread;
+
+/**
+ * Buffer dei datagrammi ricevuti in un batch.
+ * Usati solo dal thread UDP, quindi non serve allocarli per ogni richiesta.
+ */
+char udp_request_buffers[UDP_BATCH_SIZE][UDP_DATAGRAM_MAX_SIZE + 1];
+
+/**
+ * Buffer dei datagrammi di risposta di un batch
+ */
+char udp_response_buffers[UDP_BATCH_SIZE][UDP_DATAGRAM_MAX_SIZE];
+
+/**
+ * Tabella hash ad indirizzamento aperto delle statistiche per peer
+ */
+struct udp_peer_stats udp_peers[UDP_PEERS_MAX];
+
+/**
+ * Mutua esclusione sulla tabella dei peer, tra thread UDP e tabella di stato.
+ * Viene presa una sola volta per batch di datagrammi.
+ */
+pthread_mutex_t udp_peers_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Peer rimossi a tabella piena, protetto da udp_peers_mutex
+ */
+unsigned long udp_peers_evicted = 0;
+
+/**
+ * Trova (o crea) le statistiche del peer, tramite linear probing.
+ * Da chiamare con udp_peers_mutex acquisito.
+ *
+ * A tabella piena il nuovo peer sostituisce quello visto meno di recente. Le celle non tornano mai libere,
+ * quindi da quel momento ogni ricerca scorre tutta la tabella e trova il peer in qualsiasi cella.
+ *
+ * @param address Indirizzo del peer
+ * @param current_seconds Tempo attuale, in caso il peer sia nuovo
+ * @return Statistiche del peer
+ */
+struct udp_peer_stats *_find_udp_peer(const struct sockaddr_in *address, uint64_t current_seconds) {
+    uint32_t hash = (address->sin_addr.s_addr ^ (address->sin_port * 2654435761u)) * 2654435761u;
+    struct udp_peer_stats *oldest = NULL;
+
+    for (size_t probe = 0; probe < UDP_PEERS_MAX; probe++) {
+        struct udp_peer_stats *peer = &udp_peers[(hash + probe) & (UDP_PEERS_MAX - 1)];
+        if (peer->address.sin_port == 0) {
+            // Cella libera: il peer non è ancora presente, crealo
+            peer->address = *address;
+            peer->first_seen_seconds = current_seconds;
+            return peer;
+        } else if (peer->address.sin_port == address->sin_port &&
+                   peer->address.sin_addr.s_addr == address->sin_addr.s_addr) {
+            return peer;
+        }
+
+        if (oldest == NULL || peer->last_seen_seconds < oldest->last_seen_seconds)
+            oldest = peer;
+    }
+
+    // Tabella piena: rimuovi il peer visto meno di recente
+    if (udp_peers_evicted++ == 0)
+        log_message(NULL, "Tabella dei peer UDP piena (%d): i peer inattivi da più tempo vengono rimossi\n",
+                    UDP_PEERS_MAX);
+    bzero(oldest, sizeof(*oldest));
+    oldest->address = *address;
+    oldest->first_seen_seconds = current_seconds;
+    return oldest;
+}
+
+/**
+ * Elabora tutte le operazioni contenute in un datagramma,
+ * scrivendo le risposte nel datagramma di uscita.
+ *
+ * @param client_info Informazioni sul peer, senza socket_file né socket_output
+ * @param request Contenuto del datagramma, terminato da \0
+ * @param response Datagramma di risposta
+ * @param operations Numero di operazioni eseguite con successo
+ * @param received_nanos Istante di ricezione del datagramma, per il tempo di risposta
+ * @return Dimensione del datagramma di risposta
+ */
+size_t _elaborate_datagram(const struct sock_info *client_info, char *request, char *response,
+                           unsigned int *operations, uint64_t received_nanos) {
+    size_t response_len = 0;
+    char *save_ptr = NULL;
+
+    // Le operazioni dello stesso datagramma condividono ans e le variabili
+    struct session session;
+    init_session(&session);
+
+    for (char *line = strtok_r(request, "\n", &save_ptr); line != NULL; line = strtok_r(NULL, "\n", &save_ptr)) {
+        ssize_t line_len = (ssize_t) strlen(line);
+        strip_newline(line, &line_len);
+        if (line_len == 0 || line[0] == '\r')
+            continue;
+
+        char line_response[RESPONSE_LINE_MAX_SIZE];
+        if (elaborate_operation(client_info, &session, line, line_response) == 0)
+            (*operations)++;
+        else
+            add_metrics_error(METRICS_UDP);
+        add_metrics_response(NULL, received_nanos);
+
+        size_t line_response_len = strlen(line_response);
+        if (response_len + line_response_len > UDP_DATAGRAM_MAX_SIZE) {
+            // Non c'è più spazio nel datagramma di risposta: ignora le restanti operazioni
+            log_message(client_info, "Datagramma di risposta troppo grande, operazioni troncate\n");
+            break;
+        }
+        memcpy(response + response_len, line_response, line_response_len);
+        response_len += line_response_len;
+    }
+
+    free_session(&session);
+    return response_len;
+}
+
+/**
+ * Procedura del thread UDP: riceve batch di datagrammi con recvmmsg(),
+ * li elabora e invia tutte le risposte con un'unica sendmmsg().
+ */
+void _udp_loop(void) {
+    struct mmsghdr requests[UDP_BATCH_SIZE];
+    struct mmsghdr responses[UDP_BATCH_SIZE];
+    struct iovec request_iovecs[UDP_BATCH_SIZE];
+    struct iovec response_iovecs[UDP_BATCH_SIZE];
+    struct sockaddr_in peers[UDP_BATCH_SIZE];
+    unsigned int operations[UDP_BATCH_SIZE];
+
+    while (socket_fd > 0) {
+        // Prepara i descrittori per la ricezione
+        bzero(requests, sizeof(requests));
+        for (int i = 0; i < UDP_BATCH_SIZE; i++) {
+            request_iovecs[i].iov_base = udp_request_buffers[i];
+            request_iovecs[i].iov_len = UDP_DATAGRAM_MAX_SIZE;
+            requests[i].msg_hdr.msg_iov = &request_iovecs[i];
+            requests[i].msg_hdr.msg_iovlen = 1;
+            requests[i].msg_hdr.msg_name = &peers[i];
+            requests[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+        }
+
+        // Attendi almeno un datagramma, poi prendi tutti quelli già disponibili.
+        // Può essere interrotto con SIGINT al thread.
+        int received = recvmmsg(udp_socket_fd, requests, UDP_BATCH_SIZE, MSG_WAITFORONE, NULL);
+        if (received < 0) {
+            if (errno != EINTR)
+                log_errno(NULL, "Errore nella recvmmsg UDP");
+            errno = 0;
+            continue;
+        }
+        uint64_t received_nanos = metrics_now_nanos();
+
+        // Elabora ogni datagramma
+        int responses_count = 0;
+        for (int i = 0; i < received; i++) {
+            udp_request_buffers[i][requests[i].msg_len] = '\0';
+            struct sock_info client_info = {NULL, NULL, peers[i]};
+
+            operations[i] = 0;
+            size_t response_len;
+            if (requests[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                // L'ultima riga sarebbe tagliata: non calcolare niente del datagramma
+                log_message(&client_info, "Datagramma più grande di %d byte, rifiutato\n", UDP_DATAGRAM_MAX_SIZE);
+                add_metrics_error(METRICS_UDP);
+                response_len = snprintf(udp_response_buffers[i], UDP_DATAGRAM_MAX_SIZE, "%cDatagramma troppo grande\n",
+                                        SERVER_ERROR_MESSAGE_PREFIX);
+            } else {
+                response_len = _elaborate_datagram(&client_info, udp_request_buffers[i], udp_response_buffers[i],
+                                                   &operations[i], received_nanos);
+            }
+            add_metrics_bytes(METRICS_UDP, requests[i].msg_len, 0);
+            if (response_len == 0)
+                continue;
+
+            bzero(&responses[responses_count], sizeof(responses[responses_count]));
+            response_iovecs[responses_count].iov_base = udp_response_buffers[i];
+            response_iovecs[responses_count].iov_len = response_len;
+            responses[responses_count].msg_hdr.msg_iov = &response_iovecs[responses_count];
+            responses[responses_count].msg_hdr.msg_iovlen = 1;
+            responses[responses_count].msg_hdr.msg_name = &peers[i];
+            responses[responses_count].msg_hdr.msg_namelen = sizeof(peers[i]);
+            responses_count++;
+        }
+
+        // Invia tutte le risposte insieme
+        int sent = 0;
+        while (sent < responses_count) {
+            int result = sendmmsg(udp_socket_fd, responses + sent, responses_count - sent, 0);
+            if (result < 0) {
+                if (errno != EINTR)
+                    log_errno(NULL, "Errore nella sendmmsg UDP");
+                errno = 0;
+                break;
+            }
+            for (int i = sent; i < sent + result; i++)
+                add_metrics_bytes(METRICS_UDP, 0, responses[i].msg_len);
+            sent += result;
+        }
+
+        // Aggiorna le statistiche dei peer, una sola volta per batch
+        struct timestamp current_time;
+        get_timestamp(&current_time);
+        uint64_t current_seconds = timestamp_to_micros(&current_time) / 1000000;
+
+        pthread_mutex_lock(&udp_peers_mutex);
+        for (int i = 0; i < received; i++) {
+            struct udp_peer_stats *peer = _find_udp_peer(&peers[i], current_seconds);
+            peer->last_seen_seconds = current_seconds;
+            peer->datagrams++;
+            peer->operations += operations[i];
+        }
+        pthread_mutex_unlock(&udp_peers_mutex);
+    }
+}
+
+/**
+ * Crea la socket UDP sullo stesso indirizzo e porta del server TCP,
+ * e avvia il thread che riceve i datagrammi.
+ *
+ * Ogni datagramma contiene una o più operazioni, una per riga,
+ * e riceve un unico datagramma di risposta con una riga per operazione.
+ *
+ * @param ip Indirizzo IP del server
+ * @param port Porta del server
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int start_udp_listener(const char *ip, uint16_t port) {
+    struct sockaddr_in server_address;
+    bzero(&server_address, sizeof(server_address)); // Azzera la struct
+    server_address.sin_port = htons(port); // Imposta la porta
+    server_address.sin_family = AF_INET; // Imposta IPv4
+
+    // Prova a impostare l'indirizzo IP
+    if (inet_pton(AF_INET, ip, &(server_address.sin_addr)) != 1) {
+        log_message(NULL, "ERRORE: Indirizzo IP invalido\n");
+        return -1;
+    }
+
+    // Crea la socket UDP
+    udp_socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp_socket_fd == -1) {
+        log_errno(NULL, "Errore nella creazione della socket UDP");
+        return -1;
+    }
+
+    // Esegui il bind
+    if (bind(udp_socket_fd, (const struct sockaddr *) &server_address, sizeof(server_address)) == -1) {
+        log_errno(NULL, "Errore nel bind della socket UDP");
+        close(udp_socket_fd);
+        udp_socket_fd = -1;
+        return -1;
+    }
+
+    if ((errno = pthread_create(&udp_thread, NULL, (void *(*)(void *)) _udp_loop, NULL)) != 0) {
+        log_errno(NULL, "Errore nella creazione del thread UDP");
+        close(udp_socket_fd);
+        udp_socket_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Termina il thread UDP e chiudi la sua socket.
+ */
+void stop_udp_listener() {
+    if (udp_socket_fd == -1)
+        return;
+
+    // Sblocca il thread dalla recvmmsg, socket_fd è già a zero a questo punto
+    if ((errno = pthread_kill(udp_thread, SIGINT)) != 0)
+        perror("pthread_kill in chiusura");
+    if ((errno = pthread_join(udp_thread, NULL)) != 0)
+        perror("pthread_join in chiusura");
+
+    close(udp_socket_fd);
+    udp_socket_fd = -1;
+}
+
+/**
+ * Copia le statistiche dei peer UDP conosciuti.
+ *
+ * @param peers Vettore dove copiare le statistiche
+ * @param max_peers Dimensione del vettore
+ * @return Numero di peer copiati
+ */
+size_t get_udp_peers(struct udp_peer_stats *peers, size_t max_peers) {
+    size_t count = 0;
+
+    pthread_mutex_lock(&udp_peers_mutex);
+    for (size_t i = 0; i < UDP_PEERS_MAX && count < max_peers; i++) {
+        if (udp_peers[i].address.sin_port != 0)
+            peers[count++] = udp_peers[i];
+    }
+    pthread_mutex_unlock(&udp_peers_mutex);
+
+    return count;
+}
+
+/**
+ * Numero di peer rimossi dalle statistiche per fare posto a nuovi peer, a tabella piena
+ */
+unsigned long get_udp_peers_evicted() {
+    pthread_mutex_lock(&udp_peers_mutex);
+    unsigned long evicted = udp_peers_evicted;
+    pthread_mutex_unlock(&udp_peers_mutex);
+    return evicted;
+}
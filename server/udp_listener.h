@@ -0,0 +1,90 @@
+#ifndef SERVER_UDP_LISTENER_H
+#define SERVER_UDP_LISTENER_H
+
+#include "../common/socket_utils.h"
+#include <stdint.h>
+
+/**
+ * Numero massimo di datagrammi ricevuti e inviati con una singola
+ * chiamata a recvmmsg() e sendmmsg().
+ */
+#define UDP_BATCH_SIZE 64
+
+/**
+ * Dimensione massima di un datagramma, sia in ricezione che in risposta.
+ */
+#define UDP_DATAGRAM_MAX_SIZE 8192
+
+/**
+ * Numero massimo di peer UDP di cui tenere le statistiche.
+ * Deve essere una potenza di 2. Quando la tabella è piena, un nuovo peer prende il posto
+ * di quello che non invia datagrammi da più tempo.
+ */
+#define UDP_PEERS_MAX 1024
+
+/**
+ * Statistiche di un peer UDP.
+ *
+ * A differenza delle connessioni TCP, per un peer UDP non esiste
+ * né un thread né una struct live_status_slot: esiste solo questo contatore.
+ */
+struct udp_peer_stats {
+    /**
+     * Indirizzo del peer. Una porta a zero indica una cella libera.
+     */
+    struct sockaddr_in address;
+
+    /**
+     * Tempo del primo datagramma ricevuto
+     */
+    uint64_t first_seen_seconds;
+
+    /**
+     * Tempo dell'ultimo datagramma ricevuto, per scegliere il peer da rimuovere a tabella piena
+     */
+    uint64_t last_seen_seconds;
+
+    /**
+     * Numero di datagrammi ricevuti
+     */
+    unsigned int datagrams;
+
+    /**
+     * Numero di operazioni eseguite con successo
+     */
+    unsigned int operations;
+};
+
+/**
+ * Crea la socket UDP sullo stesso indirizzo e porta del server TCP,
+ * e avvia il thread che riceve i datagrammi.
+ *
+ * Ogni datagramma contiene una o più operazioni, una per riga,
+ * e riceve un unico datagramma di risposta con una riga per operazione.
+ *
+ * @param ip Indirizzo IP del server
+ * @param port Porta del server
+ * @return -1 in caso di errore, 0 altrimenti
+ */
+int start_udp_listener(const char *ip, uint16_t port);
+
+/**
+ * Termina il thread UDP e chiudi la sua socket.
+ */
+void stop_udp_listener();
+
+/**
+ * Copia le statistiche dei peer UDP conosciuti.
+ *
+ * @param peers Vettore dove copiare le statistiche
+ * @param max_peers Dimensione del vettore
+ * @return Numero di peer copiati
+ */
+size_t get_udp_peers(struct udp_peer_stats *peers, size_t max_peers);
+
+/**
+ * Numero di peer rimossi dalle statistiche per fare posto a nuovi peer, a tabella piena
+ */
+unsigned long get_udp_peers_evicted();
+
+#endif //SERVER_UDP_LISTENER_H
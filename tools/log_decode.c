@@ -0,0 +1,110 @@
+#include "tools.h"
+#include "../common/log_format.h"
+#include "../common/logger.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Scrivi un campo CSV tra virgolette, raddoppiando quelle interne e senza l'a capo finale
+ */
+void _print_csv_text(const char *text, size_t length) {
+    while (length > 0 && text[length - 1] == '\n')
+        length--;
+
+    putchar('"');
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '"')
+            putchar('"');
+        putchar(text[i]);
+    }
+    putchar('"');
+}
+
+/**
+ * Scrivi un record come riga CSV: tipo,inizio,client,operatore,sinistro,destro,risultato,durata_us,testo
+ */
+void _print_csv_record(const struct log_binary_record *record) {
+    printf("%s,", record->type == LOG_BINARY_RESULT ? "risultato" : "messaggio");
+
+    if (record->type == LOG_BINARY_RESULT) {
+        struct timestamp start_time = {.microseconds = record->start_micros};
+        time_t start_seconds = (time_t) record->start_seconds;
+        localtime_r(&start_seconds, &start_time.time);
+        char start_time_str[TIMESTAMP_STRING_SIZE] = {};
+        timestamp_to_string(&start_time, start_time_str);
+        printf("%s", start_time_str);
+    }
+    putchar(',');
+
+    if (record->flags & LOG_BINARY_HAS_CLIENT) {
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &record->client_address, ip, sizeof(ip));
+        printf("%s:%d", ip, ntohs(record->client_port));
+    }
+    putchar(',');
+
+    if (record->type == LOG_BINARY_RESULT && record->operator != '\0')
+        printf("%c,%.17g,%.17g,", record->operator, record->left, record->right);
+    else
+        printf(",,,");
+
+    if (record->type == LOG_BINARY_RESULT)
+        printf("%.17g,%u", record->result, record->elapsed_micros);
+    else
+        putchar(',');
+    putchar(',');
+
+    _print_csv_text((const char *) (record + 1), record->text_length);
+    putchar('\n');
+}
+
+int tool_decode(int argc, const char **argv) {
+    int csv = argc >= 2 && strcmp(argv[1], "csv") == 0;
+    if (argc < 1 || (argc >= 2 && !csv && strcmp(argv[1], "text") != 0)) {
+        fprintf(stderr, "Argomenti: FILE [text|csv]\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = fopen(argv[0], "rb");
+    if (file == NULL) {
+        perror("Apertura del file di log");
+        return EXIT_FAILURE;
+    }
+
+    struct log_binary_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != LOG_BINARY_MAGIC ||
+        header.version != LOG_BINARY_VERSION || header.record_size != sizeof(struct log_binary_record)) {
+        fprintf(stderr, "%s non è un log binario di questa versione\n", argv[0]);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    if (csv)
+        printf("tipo,inizio,client,operatore,sinistro,destro,risultato,durata_us,testo\n");
+
+    // Il testo di un record è lungo al massimo quanto la sua dimensione
+    _Alignas(8) char buffer[sizeof(struct log_binary_record) + UINT16_MAX];
+    struct log_binary_record *record = (struct log_binary_record *) buffer;
+    char line[2 * LOG_LINE_MAX_SIZE];
+    int status = EXIT_SUCCESS;
+
+    while (fread(record, sizeof(struct log_binary_record), 1, file) == 1) {
+        size_t text_size = record->size - sizeof(struct log_binary_record);
+        if (record->size < sizeof(struct log_binary_record) || record->text_length > text_size ||
+            fread(record + 1, 1, text_size, file) != text_size) {
+            fprintf(stderr, "Record non valido o troncato a %ld byte\n", ftell(file));
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        if (csv)
+            _print_csv_record(record);
+        else
+            fwrite(line, 1, format_log_binary_record(record, line, sizeof(line)), stdout);
+    }
+
+    fclose(file);
+    return status;
+}
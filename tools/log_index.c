@@ -0,0 +1,347 @@
+#define _GNU_SOURCE
+#include "log_index.h"
+#include "../common/timestamp.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Blocchi da indicizzare, presi da più thread tramite il contatore
+ */
+struct log_index_job {
+    const char *map;
+    struct log_index_block *blocks;
+    size_t count;
+    _Atomic size_t next;
+};
+
+/**
+ * Leggi un numero di cifre decimali
+ *
+ * @return Il valore, o -1 se un carattere non è una cifra
+ */
+long _parse_log_digits(const char *text, size_t count) {
+    long value = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!isdigit((unsigned char) text[i]))
+            return -1;
+        value = value * 10 + (text[i] - '0');
+    }
+    return value;
+}
+
+uint64_t log_time_key(const char *text) {
+    // Stesso formato di TIME_STRING_FORMAT: GG/MM/AAAA hh:mm:ss
+    if (text[2] != '/' || text[5] != '/' || text[10] != ' ' || text[13] != ':' || text[16] != ':')
+        return 0;
+
+    long day = _parse_log_digits(text, 2), month = _parse_log_digits(text + 3, 2);
+    long year = _parse_log_digits(text + 6, 4), hour = _parse_log_digits(text + 11, 2);
+    long minute = _parse_log_digits(text + 14, 2), second = _parse_log_digits(text + 17, 2);
+    if (day < 0 || month < 0 || year < 0 || hour < 0 || minute < 0 || second < 0)
+        return 0;
+
+    return ((((year * 100 + month) * 100 + day) * 100 + hour) * 100 + minute) * 100 + second;
+}
+
+uint32_t log_client_bit(const char *client, size_t length) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char) client[i]) * 16777619u;
+    return hash % LOG_INDEX_CLIENT_BITS;
+}
+
+void parse_log_line(const char *line, size_t length, struct log_line *parsed) {
+    *parsed = (struct log_line) {};
+    const char *end = line + length;
+    const char *close = length > 0 && line[0] == '[' ? memchr(line, ']', length) : NULL;
+    if (close == NULL || close + 1 >= end || close[1] != ' ')
+        return;
+
+    const char *text = close + 2;
+    size_t time_length = TIME_STRING_SIZE - 1;
+    if (close - line - 1 == 4 && memcmp(line + 1, "MAIN", 4) == 0) {
+        // Il banner di avvio riporta l'orario tra i caratteri =
+        if (text < end && *text == '=') {
+            while (text < end && (*text == '=' || *text == ' '))
+                text++;
+            if ((size_t) (end - text) >= time_length)
+                parsed->time = log_time_key(text);
+        }
+        return;
+    }
+
+    parsed->client = line + 1;
+    parsed->client_length = close - line - 1;
+
+    // Un risultato termina con ", da GG/MM/AAAA hh:mm:ss.uuuuuu per N us"
+    static const char elapsed_prefix[] = " per ", time_prefix[] = ", da ";
+    size_t timestamp_length = TIMESTAMP_STRING_SIZE - 1;
+    if (end - text < 3 || memcmp(end - 3, " us", 3) != 0)
+        return;
+    const char *digits = end - 3;
+    while (digits > text && isdigit((unsigned char) digits[-1]))
+        digits--;
+
+    const char *timestamp = digits - (sizeof(elapsed_prefix) - 1) - timestamp_length;
+    if (digits == end - 3 || timestamp - (sizeof(time_prefix) - 1) < text ||
+        memcmp(digits - (sizeof(elapsed_prefix) - 1), elapsed_prefix, sizeof(elapsed_prefix) - 1) != 0 ||
+        memcmp(timestamp - (sizeof(time_prefix) - 1), time_prefix, sizeof(time_prefix) - 1) != 0)
+        return;
+
+    parsed->time = log_time_key(timestamp);
+    if (parsed->time == 0)
+        return;
+
+    parsed->is_result = 1;
+    parsed->elapsed_micros = (uint32_t) _parse_log_digits(digits, end - 3 - digits);
+    if (end - text >= 2 && text[1] == ' ' && ispunct((unsigned char) text[0]))
+        parsed->operator = text[0];
+}
+
+/**
+ * Riassumi le linee di un blocco. Gli orari ereditati dal blocco precedente vengono aggiunti dopo,
+ * da _link_log_blocks(), così che i blocchi possano essere indicizzati in parallelo.
+ */
+void _index_log_block(const char *map, struct log_index_block *block) {
+    const char *line = map + block->offset;
+    const char *end = line + block->length;
+    struct log_line parsed;
+
+    while (line < end) {
+        const char *newline = memchr(line, '\n', end - line);
+        const char *line_end = newline != NULL ? newline : end;
+        parse_log_line(line, line_end - line, &parsed);
+
+        if (parsed.time != 0) {
+            if (block->min_time == 0 || parsed.time < block->min_time)
+                block->min_time = parsed.time;
+            if (parsed.time > block->max_time)
+                block->max_time = parsed.time;
+            block->last_time = parsed.time;
+        } else if (block->last_time == 0) {
+            block->leading_untimed = 1;
+        }
+
+        if (parsed.client != NULL) {
+            // Sia l'indirizzo con la porta che quello da solo, per filtrare anche solo per IP
+            const char *port = memrchr(parsed.client, ':', parsed.client_length);
+            uint32_t bit = log_client_bit(parsed.client, parsed.client_length);
+            block->clients[bit / 64] |= 1ull << (bit % 64);
+            if (port != NULL) {
+                bit = log_client_bit(parsed.client, port - parsed.client);
+                block->clients[bit / 64] |= 1ull << (bit % 64);
+            }
+        }
+
+        if (parsed.is_result) {
+            if (parsed.elapsed_micros > block->max_elapsed_micros)
+                block->max_elapsed_micros = parsed.elapsed_micros;
+            unsigned char operator = parsed.operator;
+            block->operators[operator / 64] |= 1ull << (operator % 64);
+        }
+
+        line = line_end + 1;
+    }
+}
+
+void *_index_log_blocks(void *arg) {
+    struct log_index_job *job = arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->count)
+        _index_log_block(job->map, &job->blocks[i]);
+    return NULL;
+}
+
+/**
+ * Propaga l'ultimo orario di ogni blocco al successivo, per le linee senza orario all'inizio di quest'ultimo
+ */
+void _link_log_blocks(struct log_index *index) {
+    uint64_t previous = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        struct log_index_block *block = &index->blocks[i];
+        block->start_time = previous;
+        if (block->leading_untimed && previous != 0) {
+            if (block->min_time == 0 || previous < block->min_time)
+                block->min_time = previous;
+            if (previous > block->max_time)
+                block->max_time = previous;
+        }
+
+        if (block->last_time != 0)
+            previous = block->last_time;
+        else
+            block->last_time = previous;
+    }
+}
+
+/**
+ * Hash FNV-1a degli ultimi LOG_INDEX_SIGNATURE_SIZE byte prima di size, con le linee più recenti indicizzate
+ */
+uint64_t _log_signature(const char *map, size_t size) {
+    size_t start = size > LOG_INDEX_SIGNATURE_SIZE ? size - LOG_INDEX_SIGNATURE_SIZE : 0;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = start; i < size; i++)
+        hash = (hash ^ (unsigned char) map[i]) * 1099511628211ull;
+    return hash;
+}
+
+/**
+ * Leggi l'indice salvato, se corrisponde al log
+ *
+ * @return Offset del log da cui continuare a indicizzare
+ */
+size_t _read_log_index(const char *index_path, struct log_index *index) {
+    FILE *file = fopen(index_path, "rb");
+    if (file == NULL)
+        return 0;
+
+    struct log_index_header header;
+    int valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == LOG_INDEX_MAGIC &&
+                header.version == LOG_INDEX_VERSION && header.block_entry_size == sizeof(struct log_index_block) &&
+                header.log_size <= index->size && header.blocks <= index->count &&
+                header.device == index->device && header.inode == index->inode;
+    if (valid) {
+        valid = header.signature == _log_signature(index->map, header.log_size) &&
+                fread(index->blocks, sizeof(struct log_index_block), header.blocks, file) == header.blocks;
+    }
+    fclose(file);
+    if (!valid || header.blocks == 0)
+        return 0;
+
+    index->reused = 1;
+    if (header.log_size == index->size) {
+        index->count = header.blocks;
+        return index->size;
+    }
+
+    // L'ultimo blocco può essere cresciuto con il log: va indicizzato di nuovo
+    index->count = header.blocks - 1;
+    return index->blocks[header.blocks - 1].offset;
+}
+
+/**
+ * Salva l'indice, sostituendo quello precedente solo a scrittura completata
+ */
+void _write_log_index(const char *index_path, const struct log_index *index) {
+    struct log_index_header header = {
+            .magic = LOG_INDEX_MAGIC,
+            .version = LOG_INDEX_VERSION,
+            .block_entry_size = sizeof(struct log_index_block),
+            .log_size = index->size,
+            .blocks = index->count,
+            .device = index->device,
+            .inode = index->inode,
+            .signature = _log_signature(index->map, index->size)
+    };
+
+    char temp_path[PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", index_path);
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Impossibile salvare l'indice %s: %s\n", index_path, strerror(errno));
+        return;
+    }
+
+    int written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(index->blocks, sizeof(struct log_index_block), index->count, file) == index->count;
+    if (fclose(file) != 0 || !written || rename(temp_path, index_path) != 0) {
+        fprintf(stderr, "Impossibile salvare l'indice %s: %s\n", index_path, strerror(errno));
+        unlink(temp_path);
+    }
+}
+
+int load_log_index(const char *path, struct log_index *index, size_t threads) {
+    *index = (struct log_index) {};
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat log_stat;
+    if (fd == -1 || fstat(fd, &log_stat) == -1) {
+        if (fd != -1) close(fd);
+        return -1;
+    }
+
+    index->map_size = log_stat.st_size;
+    index->device = log_stat.st_dev;
+    index->inode = log_stat.st_ino;
+    if (index->map_size > 0) {
+        void *map = mmap(NULL, index->map_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        index->map = map;
+        madvise(map, index->map_size, MADV_WILLNEED);
+    }
+    close(fd);
+
+    // Un segmento ancora aperto dal server termina con lo spazio preallocato, pieno di zeri
+    index->size = index->map_size;
+    while (index->size > 0 && index->map[index->size - 1] == '\0')
+        index->size--;
+
+    // Ogni blocco tranne l'ultimo è lungo almeno LOG_INDEX_BLOCK_SIZE
+    size_t capacity = index->size / LOG_INDEX_BLOCK_SIZE + 1;
+    index->blocks = calloc(capacity, sizeof(struct log_index_block));
+    if (index->blocks == NULL) {
+        free_log_index(index);
+        return -1;
+    }
+    index->count = capacity;
+
+    char index_path[PATH_MAX];
+    snprintf(index_path, sizeof(index_path), "%s%s", path, LOG_INDEX_EXTENSION);
+    size_t offset = _read_log_index(index_path, index);
+    if (!index->reused)
+        index->count = 0;
+    if (offset == index->size && index->reused)
+        return 0;
+
+    // Dividi il resto del log in blocchi che terminano a fine linea
+    size_t first = index->count;
+    while (offset < index->size) {
+        size_t end = offset + LOG_INDEX_BLOCK_SIZE;
+        if (end >= index->size) {
+            end = index->size;
+        } else {
+            const char *newline = memchr(index->map + end, '\n', index->size - end);
+            end = newline != NULL ? (size_t) (newline - index->map) + 1 : index->size;
+        }
+        index->blocks[index->count++] = (struct log_index_block) {.offset = offset, .length = end - offset};
+        offset = end;
+    }
+
+    struct log_index_job job = {.map = index->map, .blocks = index->blocks + first, .count = index->count - first};
+    if (threads > LOG_INDEX_MAX_THREADS)
+        threads = LOG_INDEX_MAX_THREADS;
+    if (threads > job.count)
+        threads = job.count;
+
+    pthread_t workers[LOG_INDEX_MAX_THREADS];
+    size_t started = 0;
+    while (started + 1 < threads && pthread_create(&workers[started], NULL, _index_log_blocks, &job) == 0)
+        started++;
+    _index_log_blocks(&job);
+    for (size_t i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    _link_log_blocks(index);
+    _write_log_index(index_path, index);
+    return 0;
+}
+
+void free_log_index(struct log_index *index) {
+    if (index->map != NULL)
+        munmap((void *) index->map, index->map_size);
+    free(index->blocks);
+    *index = (struct log_index) {};
+}
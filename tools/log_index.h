@@ -0,0 +1,199 @@
+#ifndef TOOLS_LOG_INDEX_H
+#define TOOLS_LOG_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Estensione dell'indice, salvato accanto al file di log (server.log.idx)
+ */
+#define LOG_INDEX_EXTENSION ".idx"
+
+/**
+ * Valore magico e versione all'inizio di un indice
+ */
+#define LOG_INDEX_MAGIC 0x58444e49
+#define LOG_INDEX_VERSION 2
+
+/**
+ * Dimensione indicativa di un blocco: ogni blocco termina alla fine della linea che supera questa dimensione
+ */
+#define LOG_INDEX_BLOCK_SIZE (1 << 20)
+
+/**
+ * Bit dell'insieme approssimato dei client di un blocco: più sono, meno blocchi vengono letti inutilmente
+ */
+#define LOG_INDEX_CLIENT_BITS 4096
+
+/**
+ * Byte del log, alla fine della parte indicizzata, di cui l'indice salva l'hash per riconoscere un file
+ * sostituito da un altro. Non i primi: ogni log inizia con la stessa intestazione di avvio.
+ */
+#define LOG_INDEX_SIGNATURE_SIZE 4096
+
+/**
+ * Thread al massimo per costruire l'indice e per leggere i blocchi
+ */
+#define LOG_INDEX_MAX_THREADS 64
+
+/**
+ * Intestazione del file dell'indice, seguita da blocks record struct log_index_block
+ */
+struct log_index_header {
+    uint32_t magic;
+    uint16_t version;
+
+    /**
+     * Dimensione di struct log_index_block, per riconoscere un formato incompatibile
+     */
+    uint16_t block_entry_size;
+
+    /**
+     * Byte del log indicizzati, esclusi gli zeri preallocati in fondo a un segmento ancora aperto
+     */
+    uint64_t log_size;
+    uint64_t blocks;
+
+    /**
+     * File indicizzato: un log ricreato ha un altro inode, anche se cresce oltre la dimensione precedente
+     */
+    uint64_t device;
+    uint64_t inode;
+
+    /**
+     * Hash degli ultimi LOG_INDEX_SIGNATURE_SIZE byte indicizzati, nel caso l'inode venga riutilizzato
+     */
+    uint64_t signature;
+};
+
+/**
+ * Riassunto di un blocco di linee del log.
+ * Gli orari sono chiavi AAAAMMGGhhmmss, confrontabili come numeri; 0 se sconosciuti.
+ * Le linee senza orario (i messaggi) prendono quello dell'ultima linea che lo riporta.
+ */
+struct log_index_block {
+    uint64_t offset;
+    uint64_t length;
+
+    /**
+     * Orario ereditato dalla fine del blocco precedente, per le linee prima del primo orario del blocco
+     */
+    uint64_t start_time;
+    uint64_t min_time;
+    uint64_t max_time;
+    uint64_t last_time;
+
+    /**
+     * Diverso da zero se il blocco inizia con linee senza orario
+     */
+    uint32_t leading_untimed;
+
+    /**
+     * Durata massima dei risultati nel blocco
+     */
+    uint32_t max_elapsed_micros;
+
+    /**
+     * Insieme degli operatori dei risultati, un bit per carattere
+     */
+    uint64_t operators[4];
+
+    /**
+     * Insieme approssimato dei client: per ognuno il bit dell'indirizzo e quello di indirizzo e porta
+     */
+    uint64_t clients[LOG_INDEX_CLIENT_BITS / 64];
+};
+
+/**
+ * File di log mappato in memoria, con il suo indice
+ */
+struct log_index {
+    const char *map;
+    size_t map_size;
+
+    /**
+     * Byte con delle linee, esclusi gli zeri in fondo
+     */
+    size_t size;
+
+    /**
+     * Identità del file, salvata nell'indice
+     */
+    uint64_t device;
+    uint64_t inode;
+
+    struct log_index_block *blocks;
+    size_t count;
+
+    /**
+     * Diverso da zero se l'indice è stato letto dal file, anche solo in parte
+     */
+    int reused;
+};
+
+/**
+ * Campi di una linea del log di testo del server
+ */
+struct log_line {
+    /**
+     * Client come IP:PORTA, NULL per le linee [MAIN]
+     */
+    const char *client;
+    size_t client_length;
+
+    /**
+     * Diverso da zero per il risultato di un'operazione, che riporta orario e durata
+     */
+    int is_result;
+
+    /**
+     * Operatore del risultato, '\0' se la linea non inizia con un operatore
+     */
+    char operator;
+
+    /**
+     * Orario della linea come chiave AAAAMMGGhhmmss, 0 se la linea non lo riporta
+     */
+    uint64_t time;
+    uint32_t elapsed_micros;
+};
+
+/**
+ * Mappa un file di log e carica il suo indice, aggiornandolo se il log è cresciuto
+ * o ricostruendolo in parallelo se manca o non corrisponde. L'indice aggiornato viene salvato se possibile.
+ *
+ * @param path Percorso del file di log di testo
+ * @param index Indice da riempire
+ * @param threads Thread da usare per la costruzione
+ * @return -1 in caso di errore, con errno impostato, 0 altrimenti
+ */
+int load_log_index(const char *path, struct log_index *index, size_t threads);
+
+/**
+ * Libera l'indice e togli la mappatura del log
+ */
+void free_log_index(struct log_index *index);
+
+/**
+ * Leggi i campi di una linea del log
+ *
+ * @param line Inizio della linea
+ * @param length Lunghezza, senza l'a capo finale
+ * @param parsed Campi letti
+ */
+void parse_log_line(const char *line, size_t length, struct log_line *parsed);
+
+/**
+ * Converti un orario GG/MM/AAAA hh:mm:ss in una chiave AAAAMMGGhhmmss
+ *
+ * @param text Orario, lungo almeno TIME_STRING_SIZE - 1 caratteri
+ * @return La chiave, o 0 se il testo non è un orario
+ */
+uint64_t log_time_key(const char *text);
+
+/**
+ * Bit di un client (IP o IP:PORTA) nell'insieme dei client di un blocco
+ */
+uint32_t log_client_bit(const char *client, size_t length);
+
+#endif //TOOLS_LOG_INDEX_H
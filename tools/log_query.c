@@ -0,0 +1,351 @@
+#include "tools.h"
+#include "log_index.h"
+#include "../common/timestamp.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Blocchi letti in anticipo rispetto a quelli scritti, per ogni thread: limita la memoria dei risultati
+ */
+#define LOG_QUERY_WINDOW_PER_THREAD 4
+
+/**
+ * Filtri di una ricerca. I campi a zero (o NULL) non filtrano.
+ */
+struct log_query {
+    uint64_t from_time;
+    uint64_t to_time;
+
+    /**
+     * Client come IP:PORTA, o solo IP per tutte le sue connessioni
+     */
+    const char *client;
+    size_t client_length;
+    uint32_t client_bit;
+
+    char operator;
+    uint32_t slower_micros;
+};
+
+/**
+ * Intervallo di byte del log con linee trovate consecutive
+ */
+struct log_query_range {
+    size_t offset;
+    size_t length;
+};
+
+/**
+ * Linee trovate in un blocco, da scrivere nell'ordine dei blocchi
+ */
+struct log_query_output {
+    struct log_query_range *ranges;
+    size_t count;
+    size_t capacity;
+    unsigned long lines;
+    int done;
+};
+
+/**
+ * Ricerca su un file: i thread prendono i blocchi selezionati in ordine,
+ * senza superare di più della finestra l'ultimo blocco scritto
+ */
+struct log_query_scan {
+    const struct log_index *index;
+    const struct log_query *query;
+
+    /**
+     * Blocchi selezionati dall'indice, e per ognuno le linee trovate
+     */
+    size_t *blocks;
+    struct log_query_output *outputs;
+    size_t count;
+
+    size_t window;
+    size_t next;
+    size_t written;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+/**
+ * Controlla se un blocco può contenere linee che soddisfano la ricerca
+ */
+int _log_block_matches(const struct log_index_block *block, const struct log_query *query) {
+    if ((query->from_time != 0 || query->to_time != 0) && block->max_time == 0)
+        return 0;
+    if (query->from_time != 0 && block->max_time < query->from_time)
+        return 0;
+    if (query->to_time != 0 && block->min_time > query->to_time)
+        return 0;
+    if (query->client != NULL && !(block->clients[query->client_bit / 64] & (1ull << (query->client_bit % 64))))
+        return 0;
+    if (query->operator != '\0' &&
+        !(block->operators[(unsigned char) query->operator / 64] & (1ull << ((unsigned char) query->operator % 64))))
+        return 0;
+    return query->slower_micros == 0 || block->max_elapsed_micros >= query->slower_micros;
+}
+
+/**
+ * Controlla se una linea soddisfa la ricerca
+ *
+ * @param time Orario della linea, o quello ereditato dalle linee precedenti
+ */
+int _log_line_matches(const struct log_line *line, uint64_t time, const struct log_query *query) {
+    if ((query->from_time != 0 && time < query->from_time) || (query->to_time != 0 && time > query->to_time))
+        return 0;
+    if ((query->from_time != 0 || query->to_time != 0) && time == 0)
+        return 0;
+
+    if (query->client != NULL) {
+        // Solo IP: l'indirizzo deve essere seguito dalla porta
+        if (line->client == NULL || line->client_length < query->client_length ||
+            memcmp(line->client, query->client, query->client_length) != 0 ||
+            (line->client_length > query->client_length && line->client[query->client_length] != ':'))
+            return 0;
+    }
+
+    if ((query->operator != '\0' || query->slower_micros != 0) && !line->is_result)
+        return 0;
+    if (query->operator != '\0' && line->operator != query->operator)
+        return 0;
+    return line->elapsed_micros >= query->slower_micros;
+}
+
+/**
+ * Cerca le linee di un blocco, unendo quelle consecutive in un solo intervallo
+ */
+void _scan_log_block(const struct log_query_scan *scan, const struct log_index_block *block,
+                     struct log_query_output *output) {
+    const char *map = scan->index->map;
+    const char *line = map + block->offset;
+    const char *end = line + block->length;
+    uint64_t time = block->start_time;
+    struct log_line parsed;
+
+    while (line < end) {
+        const char *newline = memchr(line, '\n', end - line);
+        const char *next = newline != NULL ? newline + 1 : end;
+        parse_log_line(line, (newline != NULL ? newline : end) - line, &parsed);
+        if (parsed.time != 0)
+            time = parsed.time;
+
+        if (_log_line_matches(&parsed, time, scan->query)) {
+            size_t offset = line - map;
+            struct log_query_range *last = output->count > 0 ? &output->ranges[output->count - 1] : NULL;
+            if (last != NULL && last->offset + last->length == offset) {
+                last->length += next - line;
+            } else {
+                if (output->count == output->capacity) {
+                    size_t capacity = output->capacity > 0 ? output->capacity * 2 : 64;
+                    struct log_query_range *ranges = realloc(output->ranges, capacity * sizeof(*ranges));
+                    if (ranges == NULL)
+                        break; // Il blocco resta incompleto, ma la ricerca continua
+                    output->ranges = ranges;
+                    output->capacity = capacity;
+                }
+                output->ranges[output->count++] = (struct log_query_range) {.offset = offset, .length = next - line};
+            }
+            output->lines++;
+        }
+        line = next;
+    }
+}
+
+void *_scan_log_blocks(void *arg) {
+    struct log_query_scan *scan = arg;
+    while (1) {
+        pthread_mutex_lock(&scan->mutex);
+        while (scan->next < scan->count && scan->next >= scan->written + scan->window)
+            pthread_cond_wait(&scan->cond, &scan->mutex);
+        if (scan->next >= scan->count) {
+            pthread_mutex_unlock(&scan->mutex);
+            return NULL;
+        }
+        size_t i = scan->next++;
+        pthread_mutex_unlock(&scan->mutex);
+
+        _scan_log_block(scan, &scan->index->blocks[scan->blocks[i]], &scan->outputs[i]);
+
+        pthread_mutex_lock(&scan->mutex);
+        scan->outputs[i].done = 1;
+        pthread_cond_broadcast(&scan->cond);
+        pthread_mutex_unlock(&scan->mutex);
+    }
+}
+
+/**
+ * Cerca in un file di log, scrivendo le linee trovate nell'ordine del file
+ *
+ * @return Numero di linee trovate, o -1 in caso di errore
+ */
+long _query_log_file(const char *path, const struct log_query *query, size_t threads) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // I segmenti ruotati e compressi non possono essere mappati
+    size_t path_length = strlen(path);
+    if (path_length > 3 && strcmp(path + path_length - 3, ".gz") == 0) {
+        fprintf(stderr, "%s: file compresso, va prima decompresso con gunzip\n", path);
+        return -1;
+    }
+
+    struct log_index index;
+    if (load_log_index(path, &index, threads) != 0) {
+        perror(path);
+        return -1;
+    }
+
+    struct log_query_scan scan = {
+            .index = &index,
+            .query = query,
+            .blocks = malloc(index.count * sizeof(size_t) + 1),
+            .outputs = calloc(index.count + 1, sizeof(struct log_query_output)),
+            .window = threads * LOG_QUERY_WINDOW_PER_THREAD,
+            .mutex = PTHREAD_MUTEX_INITIALIZER,
+            .cond = PTHREAD_COND_INITIALIZER
+    };
+    if (scan.blocks == NULL || scan.outputs == NULL) {
+        free(scan.blocks);
+        free(scan.outputs);
+        free_log_index(&index);
+        fprintf(stderr, "%s: memoria insufficiente\n", path);
+        return -1;
+    }
+
+    for (size_t i = 0; i < index.count; i++) {
+        if (_log_block_matches(&index.blocks[i], query))
+            scan.blocks[scan.count++] = i;
+    }
+
+    pthread_t workers[LOG_INDEX_MAX_THREADS];
+    size_t started = 0;
+    while (started < threads && started < scan.count &&
+           pthread_create(&workers[started], NULL, _scan_log_blocks, &scan) == 0)
+        started++;
+    if (started == 0 && scan.count > 0) {
+        // Senza thread, cerca tutto in questo
+        scan.window = scan.count;
+        _scan_log_blocks(&scan);
+    }
+
+    // Scrivi i blocchi in ordine, man mano che vengono completati
+    long lines = 0;
+    for (size_t i = 0; i < scan.count; i++) {
+        pthread_mutex_lock(&scan.mutex);
+        while (!scan.outputs[i].done)
+            pthread_cond_wait(&scan.cond, &scan.mutex);
+        pthread_mutex_unlock(&scan.mutex);
+
+        struct log_query_output *output = &scan.outputs[i];
+        for (size_t r = 0; r < output->count; r++)
+            fwrite(index.map + output->ranges[r].offset, 1, output->ranges[r].length, stdout);
+        lines += (long) output->lines;
+        free(output->ranges);
+
+        pthread_mutex_lock(&scan.mutex);
+        scan.written++;
+        pthread_cond_broadcast(&scan.cond);
+        pthread_mutex_unlock(&scan.mutex);
+    }
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+    fflush(stdout);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%s: %ld linee trovate, %zu/%zu blocchi letti, indice %s, %.3f s\n", path, lines, scan.count,
+            index.count, index.reused ? "riutilizzato" : "creato", seconds);
+
+    free(scan.blocks);
+    free(scan.outputs);
+    free_log_index(&index);
+    return lines;
+}
+
+/**
+ * Leggi un orario GG/MM/AAAA [hh:mm:ss] come chiave: senza ora, l'inizio o la fine del giorno
+ *
+ * @param end_of_day Diverso da zero per la fine del giorno
+ * @return La chiave, o 0 se il testo non è un orario
+ */
+uint64_t _parse_query_time(const char *text, int end_of_day) {
+    char full[TIME_STRING_SIZE];
+    size_t length = strlen(text);
+    if (length == TIME_STRING_SIZE - 1)
+        return log_time_key(text);
+    if (length != 10)
+        return 0;
+    snprintf(full, sizeof(full), "%s %s", text, end_of_day ? "23:59:59" : "00:00:00");
+    return log_time_key(full);
+}
+
+/**
+ * Leggi un filtro NOME=VALORE
+ *
+ * @return -1 se il filtro non è valido, 0 altrimenti
+ */
+int _parse_query_filter(const char *argument, struct log_query *query) {
+    const char *value = strchr(argument, '=');
+    if (value == NULL || value[1] == '\0')
+        return -1;
+    size_t name_length = value - argument;
+    value++;
+
+    if (name_length == 4 && strncmp(argument, "from", 4) == 0) {
+        query->from_time = _parse_query_time(value, 0);
+        return query->from_time != 0 ? 0 : -1;
+    } else if (name_length == 2 && strncmp(argument, "to", 2) == 0) {
+        query->to_time = _parse_query_time(value, 1);
+        return query->to_time != 0 ? 0 : -1;
+    } else if (name_length == 6 && strncmp(argument, "client", 6) == 0) {
+        query->client = value;
+        query->client_length = strlen(value);
+        query->client_bit = log_client_bit(value, query->client_length);
+        return 0;
+    } else if (name_length == 8 && strncmp(argument, "operator", 8) == 0) {
+        query->operator = value[0];
+        return value[1] == '\0' ? 0 : -1;
+    } else if (name_length == 6 && strncmp(argument, "slower", 6) == 0) {
+        char *end;
+        query->slower_micros = (uint32_t) strtoul(value, &end, 10);
+        return *end == '\0' ? 0 : -1;
+    }
+    return -1;
+}
+
+int tool_query(int argc, const char **argv) {
+    struct log_query query = {};
+    int files = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strchr(argv[i], '=') == NULL) {
+            files++;
+        } else if (_parse_query_filter(argv[i], &query) != 0) {
+            fprintf(stderr, "Filtro non valido: %s\n", argv[i]);
+            files = 0;
+            break;
+        }
+    }
+
+    if (files == 0) {
+        fprintf(stderr, "Argomenti: FILE... [from=GG/MM/AAAA[ hh:mm:ss]] [to=GG/MM/AAAA[ hh:mm:ss]] "
+                        "[client=IP[:PORTA]] [operator=C] [slower=MICROSECONDI]\n");
+        return EXIT_FAILURE;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = cores < 1 ? 1 : cores > LOG_INDEX_MAX_THREADS ? LOG_INDEX_MAX_THREADS : (size_t) cores;
+
+    // I file vengono letti nell'ordine dato, ognuno con i blocchi in parallelo
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < argc; i++) {
+        if (strchr(argv[i], '=') == NULL && _query_log_file(argv[i], &query, threads) < 0)
+            status = EXIT_FAILURE;
+    }
+    return status;
+}
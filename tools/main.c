@@ -0,0 +1,36 @@
+#include "tools.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Uno strumento selezionabile da riga di comando
+ */
+struct tool_entry {
+    const char *name;
+    tool_function_t function;
+};
+
+/**
+ * Elenco degli strumenti disponibili
+ */
+const struct tool_entry tools[] = {
+        {"decode", tool_decode},
+        {"query", tool_query},
+};
+
+int main(int argc, const char **argv) {
+    if (argc >= 2) {
+        for (size_t i = 0; i < sizeof(tools) / sizeof(tools[0]); i++) {
+            if (strcmp(argv[1], tools[i].name) == 0)
+                return tools[i].function(argc - 2, argv + 2);
+        }
+    }
+
+    fprintf(stderr, "Utilizzo: %s STRUMENTO [ARGOMENTI]\n", argv[0]);
+    fprintf(stderr, "Strumenti disponibili:");
+    for (size_t i = 0; i < sizeof(tools) / sizeof(tools[0]); i++)
+        fprintf(stderr, " %s", tools[i].name);
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+}
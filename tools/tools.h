@@ -0,0 +1,26 @@
+#ifndef TOOLS_TOOLS_H
+#define TOOLS_TOOLS_H
+
+/**
+ * Funzione di uno strumento.
+ *
+ * @param argc Numero degli argomenti, escluso il nome dello strumento
+ * @param argv Argomenti, escluso il nome dello strumento
+ * @return Exit code
+ */
+typedef int (*tool_function_t)(int argc, const char **argv);
+
+/**
+ * Converti un file di log binario in testo, come il log di testo del server, o in CSV.
+ * Argomenti: FILE [text|csv]
+ */
+int tool_decode(int argc, const char **argv);
+
+/**
+ * Cerca nei file di log di testo, tramite un indice per blocchi salvato accanto a ogni file (FILE.idx).
+ * Vengono letti in parallelo solo i blocchi che possono contenere linee cercate.
+ * Argomenti: FILE... [from=GG/MM/AAAA[ hh:mm:ss]] [to=...] [client=IP[:PORTA]] [operator=C] [slower=MICROSECONDI]
+ */
+int tool_query(int argc, const char **argv);
+
+#endif //TOOLS_TOOLS_H